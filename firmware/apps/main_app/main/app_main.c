@@ -8,13 +8,45 @@
 #include "ble_gatt.h"
 #include "telemetry.h"
 #include "relay_ctrl.h"
+#include "di_sampler.h"
 #include "status_led.h"
 #include "pid_controller.h"
 #include "machine_state.h"
 #include "safety_gate.h"
+#include "session_mgr.h"
+#include "trace_log.h"
+#include "crc16.h"
+#include "recipe.h"
+#include "wire_fragment.h"
 
 static const char *TAG = "main_app";
 
+/* DI edge callback (di_sampler task) - keep telemetry's di_bits current */
+static void on_di_edge(const di_sampler_edge_t *edge, void *ctx)
+{
+    (void)ctx;
+    telemetry_set_di_bits(edge->bits);
+}
+
+/* Session lease lapsed or revived - yellow pulse while the HMI is stale */
+static void on_session_state(session_state_t old_state, session_state_t new_state, void *ctx)
+{
+    (void)old_state;
+    (void)ctx;
+
+    /* Only swap between the two connected patterns; errors and service mode stay */
+    status_led_state_t led = status_led_get_state();
+    if (led != LED_STATE_CONNECTED_HEALTHY && led != LED_STATE_CONNECTED_WARNING) {
+        return;
+    }
+
+    if (new_state == SESSION_STATE_STALE) {
+        status_led_set_state(LED_STATE_CONNECTED_WARNING);
+    } else if (new_state == SESSION_STATE_LIVE) {
+        status_led_set_state(LED_STATE_CONNECTED_HEALTHY);
+    }
+}
+
 /* State change callback - update LED and emit events */
 static void on_state_change(machine_state_t old_state, machine_state_t new_state)
 {
@@ -72,6 +104,22 @@ void app_main(void)
         ESP_LOGW(TAG, "Status LED init failed: %s", esp_err_to_name(ret));
     }
 
+    // Start deferred trace log drain early so hot-path log sites never block
+    ret = trace_log_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Trace log init failed: %s - traces will stay buffered",
+                 esp_err_to_name(ret));
+    }
+
+    // Frame and Modbus integrity both depend on the sliced CRC kernels
+    if (crc16_self_test() != ESP_OK) {
+        ESP_LOGE(TAG, "CRC16 self-test failed - wire and Modbus CRCs are unreliable");
+    }
+#if CONFIG_CRC16_BENCHMARK_AT_BOOT
+    crc16_bench_t crc_bench;
+    crc16_benchmark(WIRE_MAX_PAYLOAD, &crc_bench);
+#endif
+
     // Hardware initialization phase
     status_led_set_state(LED_STATE_BOOT_HW_INIT);
 
@@ -94,6 +142,16 @@ void app_main(void)
         // Continue anyway - software-only mode for testing
     }
 
+    // Start DI sampling (debounced inputs, edge timestamps) on top of relay_ctrl
+    ret = di_sampler_init();
+    if (ret == ESP_OK) {
+        // Telemetry follows accepted edges instead of re-reading the inputs
+        di_sampler_subscribe(on_di_edge, NULL);
+    } else {
+        ESP_LOGW(TAG, "DI sampler init failed: %s - machine state reads inputs directly",
+                 esp_err_to_name(ret));
+    }
+
     // Initialize PID controller manager (RS-485 Modbus to LC108 controllers)
     // Uses default config: addresses 1, 2, 3 polled every 300ms
     ret = pid_controller_init(NULL);
@@ -124,6 +182,10 @@ void app_main(void)
         machine_state_set_callback(on_state_change);
         // Enable machine state in telemetry
         telemetry_use_machine_state(true);
+#if CONFIG_SAFETY_GATE_BENCHMARK_AT_BOOT
+        safety_gate_bench_t gate_bench;
+        safety_gate_benchmark(&gate_bench);
+#endif
     } else {
         ESP_LOGW(TAG, "Machine state init failed: %s - state machine disabled",
                  esp_err_to_name(ret));
@@ -135,6 +197,12 @@ void app_main(void)
     // Initialize BLE GATT server
     ESP_ERROR_CHECK(ble_gatt_init());
 
+    // LED warns the moment the HMI lease lapses
+    session_mgr_subscribe(on_session_state, NULL);
+
+    // Recipe uploads arrive through the Bulk Gateway
+    ESP_ERROR_CHECK(ble_gatt_register_bulk_handler(WIRE_OBJ_RECIPE, recipe_bulk_handler));
+
     // Start telemetry generation (10Hz)
     ESP_ERROR_CHECK(telemetry_init());
 
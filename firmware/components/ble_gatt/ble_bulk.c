@@ -0,0 +1,507 @@
+#include "ble_bulk.h"
+#include "ble_gatt.h"
+#include "wire_protocol.h"
+#include "wire_fragment.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host/ble_hs.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "ble_bulk";
+
+#define BULK_MAX_BLOCKS         512     /* Blocks per inbound transfer (bitmap bits) */
+#define BULK_HANDLERS_MAX       8
+#define BULK_POLL_PERIOD_MS     100     /* Inbound gap/timeout check */
+#define BULK_TX_RETRY_MS        10      /* Wait for mbufs when the pool is exhausted */
+#define BULK_TX_PROBE_ROUNDS    8       /* Silent NACK windows before giving up */
+
+typedef struct {
+    uint8_t object_type;
+    ble_gatt_bulk_handler_t handler;
+} bulk_handler_entry_t;
+
+/* NACK forwarded from the host task to the sending task */
+typedef struct {
+    wire_frag_nack_t hdr;
+    uint16_t missing[WIRE_FRAG_NACK_MAX_MISSING];
+} bulk_nack_item_t;
+
+/* Link: bound to one connection while a transfer is in flight */
+static portMUX_TYPE s_link_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static uint16_t s_attr_handle = 0;
+static volatile bool s_subscribed = false;
+static uint16_t s_seq = 0;
+
+/* Inbound reassembly */
+static uint8_t s_rx_buf[CONFIG_BLE_GATT_BULK_RX_MAX];
+static uint8_t s_rx_bitmap[BULK_MAX_BLOCKS / 8];
+static wire_reasm_t s_rx;
+static uint8_t s_rx_final_status = WIRE_FRAG_STATUS_COMPLETE;
+static SemaphoreHandle_t s_rx_lock = NULL;
+static esp_timer_handle_t s_rx_timer = NULL;
+static bool s_rx_timer_running = false;
+
+static bulk_handler_entry_t s_handlers[BULK_HANDLERS_MAX];
+static uint8_t s_handler_count = 0;
+
+/* Outbound */
+static SemaphoreHandle_t s_tx_lock = NULL;
+static QueueHandle_t s_tx_nacks = NULL;
+static uint16_t s_tx_transfer_id = 0;
+static volatile bool s_tx_active = false;
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/* ===== Frame TX ===== */
+
+static int notify_frame(uint16_t conn, uint16_t attr, const uint8_t *frame, size_t len)
+{
+    if (conn == BLE_HS_CONN_HANDLE_NONE) {
+        return BLE_HS_ENOTCONN;
+    }
+
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(frame, len);
+    if (om == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+    return ble_gatts_notify_custom(conn, attr, om);
+}
+
+/*
+ * Point the link at conn/attr unless a transfer on another connection is in
+ * flight. Host task only: s_rx only becomes ACTIVE in rx_fragment() on this
+ * task, so the unlocked read cannot miss a transfer starting.
+ */
+static bool link_bind(uint16_t conn_handle, uint16_t attr_handle)
+{
+    bool rx_busy = s_rx.state == WIRE_REASM_ACTIVE;
+
+    taskENTER_CRITICAL(&s_link_lock);
+    bool ok = conn_handle == s_conn_handle || s_conn_handle == BLE_HS_CONN_HANDLE_NONE ||
+              (!rx_busy && !s_tx_active);
+    if (ok) {
+        s_conn_handle = conn_handle;
+        s_attr_handle = attr_handle;
+    }
+    taskEXIT_CRITICAL(&s_link_lock);
+    return ok;
+}
+
+/* Send a FRAGMENT_NACK for an inbound transfer (s_rx_lock held) */
+static void send_nack(uint16_t transfer_id, uint8_t status)
+{
+    uint8_t payload[WIRE_FRAG_NACK_HEADER_SIZE + 2 * WIRE_FRAG_NACK_MAX_MISSING];
+    size_t plen = wire_reasm_build_nack(&s_rx, transfer_id, status, payload, sizeof(payload));
+
+    uint8_t frame[WIRE_HEADER_SIZE + sizeof(payload) + WIRE_CRC_SIZE];
+    uint16_t seq = __atomic_fetch_add(&s_seq, 1, __ATOMIC_RELAXED);
+    size_t len = wire_build_frame(frame, sizeof(frame), MSG_TYPE_FRAGMENT_NACK, seq,
+                                  payload, (uint16_t)plen);
+
+    taskENTER_CRITICAL(&s_link_lock);
+    uint16_t conn = s_conn_handle;
+    uint16_t attr = s_attr_handle;
+    taskEXIT_CRITICAL(&s_link_lock);
+
+    int rc = notify_frame(conn, attr, frame, len);
+    ESP_LOGD(TAG, "NACK tx: transfer=%u status=%u missing=%u rc=%d",
+             transfer_id, status, payload[3], rc);
+}
+
+/* ===== Inbound ===== */
+
+static void rx_timer_set(bool run)
+{
+    if (run && !s_rx_timer_running) {
+        esp_timer_start_periodic(s_rx_timer, BULK_POLL_PERIOD_MS * 1000);
+        s_rx_timer_running = true;
+    } else if (!run && s_rx_timer_running) {
+        esp_timer_stop(s_rx_timer);
+        s_rx_timer_running = false;
+    }
+}
+
+static void rx_timer_cb(void *arg)
+{
+    (void)arg;
+    xSemaphoreTake(s_rx_lock, portMAX_DELAY);
+
+    uint16_t transfer_id = s_rx.transfer_id;
+    switch (wire_reasm_poll(&s_rx, now_ms(), CONFIG_BLE_GATT_BULK_GAP_TIMEOUT_MS,
+                            CONFIG_BLE_GATT_BULK_TRANSFER_TIMEOUT_MS)) {
+        case WIRE_REASM_POLL_NACK:
+            send_nack(transfer_id, WIRE_FRAG_STATUS_MISSING);
+            break;
+
+        case WIRE_REASM_POLL_TIMEOUT:
+            ESP_LOGW(TAG, "Inbound transfer %u timed out", transfer_id);
+            send_nack(transfer_id, WIRE_FRAG_STATUS_TIMEOUT);
+            rx_timer_set(false);
+            break;
+
+        case WIRE_REASM_POLL_IDLE:
+            rx_timer_set(false);
+            break;
+
+        default:
+            break;
+    }
+
+    xSemaphoreGive(s_rx_lock);
+}
+
+static uint8_t dispatch_object(void)
+{
+    for (uint8_t i = 0; i < s_handler_count; i++) {
+        if (s_handlers[i].object_type == s_rx.object_type) {
+            esp_err_t err = s_handlers[i].handler(s_rx.object_type, s_rx.buf, s_rx.total_len);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Object type 0x%02X rejected: %s",
+                         s_rx.object_type, esp_err_to_name(err));
+                return WIRE_FRAG_STATUS_REJECTED;
+            }
+            return WIRE_FRAG_STATUS_COMPLETE;
+        }
+    }
+
+    ESP_LOGW(TAG, "No handler for object type 0x%02X", s_rx.object_type);
+    return WIRE_FRAG_STATUS_REJECTED;
+}
+
+static void rx_fragment(const uint8_t *payload, size_t len)
+{
+    uint16_t transfer_id = (len >= 2) ? (payload[0] | ((uint16_t)payload[1] << 8)) : 0;
+
+    xSemaphoreTake(s_rx_lock, portMAX_DELAY);
+
+    switch (wire_reasm_accept(&s_rx, payload, len, now_ms())) {
+        case WIRE_REASM_OK:
+            rx_timer_set(true);
+            break;
+
+        case WIRE_REASM_DONE:
+            rx_timer_set(false);
+            ESP_LOGI(TAG, "Inbound transfer %u complete: type=0x%02X %lu bytes in %u blocks",
+                     transfer_id, s_rx.object_type, (unsigned long)s_rx.total_len,
+                     s_rx.block_count);
+            s_rx_final_status = dispatch_object();
+            send_nack(transfer_id, s_rx_final_status);
+            break;
+
+        case WIRE_REASM_DUPLICATE:
+            /* Sender may have missed our final status - repeat it */
+            if (s_rx.state == WIRE_REASM_COMPLETE && transfer_id == s_rx.transfer_id) {
+                send_nack(transfer_id, s_rx_final_status);
+            }
+            break;
+
+        case WIRE_REASM_ERR_TOO_LARGE:
+            ESP_LOGW(TAG, "Inbound transfer %u exceeds %d-byte buffer", transfer_id,
+                     CONFIG_BLE_GATT_BULK_RX_MAX);
+            send_nack(transfer_id, WIRE_FRAG_STATUS_TOO_LARGE);
+            break;
+
+        case WIRE_REASM_ERR_BUSY:
+            send_nack(transfer_id, WIRE_FRAG_STATUS_BUSY);
+            break;
+
+        case WIRE_REASM_ERR_MALFORMED:
+        default:
+            ESP_LOGW(TAG, "Malformed fragment (len=%u)", (unsigned)len);
+            break;
+    }
+
+    xSemaphoreGive(s_rx_lock);
+}
+
+/* ===== Outbound ===== */
+
+static void rx_nack(const uint8_t *payload, size_t len)
+{
+    bulk_nack_item_t item;
+    const uint8_t *missing;
+
+    if (!wire_parse_frag_nack(payload, len, &item.hdr, &missing)) {
+        ESP_LOGW(TAG, "Malformed NACK (len=%u)", (unsigned)len);
+        return;
+    }
+    if (!s_tx_active || item.hdr.transfer_id != s_tx_transfer_id) {
+        return;
+    }
+
+    uint8_t count = item.hdr.missing_count;
+    if (count > WIRE_FRAG_NACK_MAX_MISSING) {
+        count = WIRE_FRAG_NACK_MAX_MISSING;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        item.missing[i] = missing[2 * i] | ((uint16_t)missing[2 * i + 1] << 8);
+    }
+    item.hdr.missing_count = count;
+
+    xQueueSend(s_tx_nacks, &item, 0);
+}
+
+/* Notify one block, waiting for mbufs if the pool is exhausted */
+static esp_err_t tx_block(uint16_t conn, uint16_t attr, uint8_t *frame, size_t frame_size,
+                          uint8_t object_type, uint16_t chunk, const uint8_t *data, uint32_t len,
+                          uint16_t block, int64_t deadline_us)
+{
+    uint16_t seq = __atomic_fetch_add(&s_seq, 1, __ATOMIC_RELAXED);
+    size_t flen = wire_build_fragment(frame, frame_size, seq, s_tx_transfer_id,
+                                      object_type, chunk, data, len, block);
+    if (flen == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (1) {
+        int rc = notify_frame(conn, attr, frame, flen);
+        if (rc == 0) {
+            return ESP_OK;
+        }
+        if (rc != BLE_HS_ENOMEM || esp_timer_get_time() >= deadline_us) {
+            return rc == BLE_HS_ENOTCONN ? ESP_ERR_INVALID_STATE : ESP_FAIL;
+        }
+        vTaskDelay(pdMS_TO_TICKS(BULK_TX_RETRY_MS));
+    }
+}
+
+esp_err_t ble_gatt_send_bulk(uint8_t object_type, const uint8_t *data, size_t len,
+                             uint32_t timeout_ms)
+{
+    if (data == NULL || len == 0 || len > UINT32_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (xSemaphoreTake(s_tx_lock, 0) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Claim the link: from here other clients cannot rebind it */
+    taskENTER_CRITICAL(&s_link_lock);
+    uint16_t conn = s_conn_handle;
+    uint16_t attr = s_attr_handle;
+    bool ready = conn != BLE_HS_CONN_HANDLE_NONE && s_subscribed;
+    s_tx_active = ready;
+    taskEXIT_CRITICAL(&s_link_lock);
+    if (!ready) {
+        xSemaphoreGive(s_tx_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint16_t chunk = wire_frag_chunk_for_mtu(ble_att_mtu(conn));
+    if (chunk == 0 || (len + chunk - 1) / chunk > UINT16_MAX) {
+        s_tx_active = false;
+        xSemaphoreGive(s_tx_lock);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint16_t blocks = (uint16_t)((len + chunk - 1) / chunk);
+
+    uint8_t frame[WIRE_MAX_FRAME_SIZE];
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    esp_err_t result = ESP_ERR_TIMEOUT;
+
+    s_tx_transfer_id++;
+    xQueueReset(s_tx_nacks);
+
+    ESP_LOGI(TAG, "Outbound transfer %u: type=0x%02X %u bytes, %u blocks of %u",
+             s_tx_transfer_id, object_type, (unsigned)len, blocks, chunk);
+
+    /* First pass: stream every block */
+    esp_err_t err = ESP_OK;
+    for (uint16_t b = 0; b < blocks && err == ESP_OK; b++) {
+        err = tx_block(conn, attr, frame, sizeof(frame), object_type, chunk, data, len, b,
+                       deadline_us);
+    }
+
+    /* Then serve NACKs until the receiver reports a final status */
+    uint8_t probes = 0;
+    while (err == ESP_OK) {
+        int64_t remaining_us = deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0) {
+            break;
+        }
+
+        uint32_t wait_ms = 2 * CONFIG_BLE_GATT_BULK_GAP_TIMEOUT_MS;
+        if (wait_ms > remaining_us / 1000) {
+            wait_ms = remaining_us / 1000;
+        }
+
+        bulk_nack_item_t nack;
+        if (xQueueReceive(s_tx_nacks, &nack, pdMS_TO_TICKS(wait_ms)) != pdTRUE) {
+            /* Receiver silent: resend the last block to prompt a NACK */
+            if (++probes > BULK_TX_PROBE_ROUNDS) {
+                break;
+            }
+            err = tx_block(conn, attr, frame, sizeof(frame), object_type, chunk, data, len,
+                           blocks - 1, deadline_us);
+            continue;
+        }
+        probes = 0;
+
+        if (s_conn_handle != conn) {
+            err = ESP_ERR_INVALID_STATE;
+        } else if (nack.hdr.status == WIRE_FRAG_STATUS_COMPLETE) {
+            result = ESP_OK;
+            break;
+        } else if (nack.hdr.status == WIRE_FRAG_STATUS_MISSING) {
+            for (uint8_t i = 0; i < nack.hdr.missing_count && err == ESP_OK; i++) {
+                if (nack.missing[i] < blocks) {
+                    err = tx_block(conn, attr, frame, sizeof(frame), object_type, chunk, data, len,
+                                   nack.missing[i], deadline_us);
+                }
+            }
+        } else {
+            ESP_LOGW(TAG, "Outbound transfer %u aborted by receiver: status=%u",
+                     s_tx_transfer_id, nack.hdr.status);
+            result = ESP_FAIL;
+            break;
+        }
+    }
+
+    if (err != ESP_OK) {
+        result = err;
+    }
+
+    s_tx_active = false;
+    xSemaphoreGive(s_tx_lock);
+
+    if (result == ESP_OK) {
+        ESP_LOGI(TAG, "Outbound transfer %u confirmed", s_tx_transfer_id);
+    } else {
+        ESP_LOGW(TAG, "Outbound transfer %u failed: %s", s_tx_transfer_id,
+                 esp_err_to_name(result));
+    }
+    return result;
+}
+
+/* ===== Glue ===== */
+
+esp_err_t ble_bulk_init(void)
+{
+    s_rx_lock = xSemaphoreCreateMutex();
+    s_tx_lock = xSemaphoreCreateMutex();
+    s_tx_nacks = xQueueCreate(4, sizeof(bulk_nack_item_t));
+    if (s_rx_lock == NULL || s_tx_lock == NULL || s_tx_nacks == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = rx_timer_cb,
+        .name = "ble_bulk",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_rx_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    wire_reasm_init(&s_rx, s_rx_buf, sizeof(s_rx_buf), s_rx_bitmap, BULK_MAX_BLOCKS);
+    return ESP_OK;
+}
+
+void ble_bulk_on_subscribe(uint16_t conn_handle, uint16_t attr_handle, bool notify)
+{
+    /* Another client unsubscribing leaves the current link alone */
+    if (!notify && conn_handle != s_conn_handle) {
+        return;
+    }
+    if (!link_bind(conn_handle, attr_handle)) {
+        ESP_LOGW(TAG, "Subscribe from conn %u ignored: transfer in progress on conn %u",
+                 conn_handle, s_conn_handle);
+        return;
+    }
+    s_subscribed = notify;
+}
+
+void ble_bulk_on_disconnect(uint16_t conn_handle)
+{
+    /* Another client (observer) left; the transfer is not theirs */
+    taskENTER_CRITICAL(&s_link_lock);
+    bool ours = conn_handle == s_conn_handle;
+    if (ours) {
+        s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        s_subscribed = false;
+    }
+    taskEXIT_CRITICAL(&s_link_lock);
+    if (!ours) {
+        return;
+    }
+
+    xSemaphoreTake(s_rx_lock, portMAX_DELAY);
+    wire_reasm_reset(&s_rx);
+    rx_timer_set(false);
+    xSemaphoreGive(s_rx_lock);
+
+    /* Wake a blocked sender so it sees the disconnect */
+    if (s_tx_active) {
+        bulk_nack_item_t item = {
+            .hdr = { .transfer_id = s_tx_transfer_id, .status = WIRE_FRAG_STATUS_TIMEOUT },
+        };
+        xQueueSend(s_tx_nacks, &item, 0);
+    }
+}
+
+void ble_bulk_on_write(uint16_t conn_handle, uint16_t attr_handle,
+                       const uint8_t *data, size_t len)
+{
+    wire_frame_header_t header;
+    const uint8_t *payload;
+
+    /*
+     * Replies go back on the characteristic the app wrote to. While a transfer
+     * is in flight the link stays with the client that started it; frames from
+     * anyone else would feed its reassembly or ack its outbound blocks.
+     */
+    if (!link_bind(conn_handle, attr_handle)) {
+        ESP_LOGW(TAG, "Bulk write from conn %u dropped: transfer in progress on conn %u",
+                 conn_handle, s_conn_handle);
+        return;
+    }
+
+    if (!wire_parse_frame(data, len, &header, &payload)) {
+        ESP_LOGW(TAG, "Invalid bulk frame (len=%u)", (unsigned)len);
+        return;
+    }
+
+    switch (header.msg_type) {
+        case MSG_TYPE_FRAGMENT:
+            rx_fragment(payload, header.payload_len);
+            break;
+
+        case MSG_TYPE_FRAGMENT_NACK:
+            rx_nack(payload, header.payload_len);
+            break;
+
+        default:
+            ESP_LOGW(TAG, "Unexpected msg_type on Bulk Gateway: 0x%02X", header.msg_type);
+            break;
+    }
+}
+
+esp_err_t ble_gatt_register_bulk_handler(uint8_t object_type, ble_gatt_bulk_handler_t handler)
+{
+    for (uint8_t i = 0; i < s_handler_count; i++) {
+        if (s_handlers[i].object_type == object_type) {
+            s_handlers[i].handler = handler;
+            return ESP_OK;
+        }
+    }
+
+    if (s_handler_count >= BULK_HANDLERS_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_handlers[s_handler_count].object_type = object_type;
+    s_handlers[s_handler_count].handler = handler;
+    s_handler_count++;
+    return ESP_OK;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * Bulk Gateway transfers (component-private)
+ * ==========================================
+ *
+ * Carries objects larger than one ATT PDU over the Bulk Gateway
+ * characteristic using the wire_fragment layer. Inbound objects are
+ * reassembled into a fixed buffer and handed to the handler registered
+ * for their object type. Outbound objects are streamed as notifications;
+ * blocks listed in the receiver's NACKs are retransmitted.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Create buffers, locks and the reassembly timer. Call once from ble_gatt_init().
+ */
+esp_err_t ble_bulk_init(void);
+
+/**
+ * @brief Bulk Gateway subscription changed. Ignored from other connections
+ *        while a transfer is in flight.
+ */
+void ble_bulk_on_subscribe(uint16_t conn_handle, uint16_t attr_handle, bool notify);
+
+/**
+ * @brief Connection lost - if it carried the Bulk Gateway, drop the inbound
+ *        transfer and fail the outbound one
+ */
+void ble_bulk_on_disconnect(uint16_t conn_handle);
+
+/**
+ * @brief Frame written to the Bulk Gateway (NimBLE host task). While a
+ *        transfer is in flight, frames from other connections are dropped.
+ */
+void ble_bulk_on_write(uint16_t conn_handle, uint16_t attr_handle,
+                       const uint8_t *data, size_t len);
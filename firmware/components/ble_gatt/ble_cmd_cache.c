@@ -0,0 +1,98 @@
+#include "ble_cmd_cache.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#define CACHE_ENTRIES   CONFIG_BLE_GATT_CMD_ACK_CACHE_SIZE
+
+static ble_cmd_cache_entry_t s_entries[CACHE_ENTRIES];
+static uint8_t s_used = 0;                  /* Valid entries (grows to CACHE_ENTRIES) */
+static uint8_t s_next = 0;                  /* Slot overwritten by the next begin() */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Unanswered entry for a command; call with s_lock held */
+static ble_cmd_cache_entry_t *find_open(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id)
+{
+    for (uint8_t i = 0; i < s_used; i++) {
+        ble_cmd_cache_entry_t *e = &s_entries[i];
+        if (!e->acked && e->seq == seq && e->cmd_id == cmd_id && e->conn_gen == conn_gen) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+ble_cmd_cache_hit_t ble_cmd_cache_find(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id,
+                                       uint16_t frame_crc, ble_cmd_cache_entry_t *out)
+{
+    ble_cmd_cache_hit_t hit = BLE_CMD_CACHE_MISS;
+
+    taskENTER_CRITICAL(&s_lock);
+    for (uint8_t i = 0; i < s_used; i++) {
+        const ble_cmd_cache_entry_t *e = &s_entries[i];
+        if (e->seq != seq || e->cmd_id != cmd_id ||
+            e->frame_crc != frame_crc || e->conn_gen != conn_gen) {
+            continue;
+        }
+        if (e->acked) {
+            *out = *e;
+            hit = BLE_CMD_CACHE_ACKED;
+            break;
+        }
+        if (e->pending) {
+            hit = BLE_CMD_CACHE_PENDING;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return hit;
+}
+
+void ble_cmd_cache_begin(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id,
+                         uint16_t frame_crc)
+{
+    taskENTER_CRITICAL(&s_lock);
+    ble_cmd_cache_entry_t *e = &s_entries[s_next];
+    s_next = (s_next + 1) % CACHE_ENTRIES;
+    if (s_used < CACHE_ENTRIES) {
+        s_used++;
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->conn_gen = conn_gen;
+    e->seq = seq;
+    e->cmd_id = cmd_id;
+    e->frame_crc = frame_crc;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void ble_cmd_cache_defer(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id)
+{
+    taskENTER_CRITICAL(&s_lock);
+    ble_cmd_cache_entry_t *e = find_open(conn_gen, seq, cmd_id);
+    if (e != NULL) {
+        e->pending = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void ble_cmd_cache_store_ack(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id,
+                             uint8_t status, uint16_t detail,
+                             const uint8_t *opt_data, size_t opt_len)
+{
+    taskENTER_CRITICAL(&s_lock);
+    ble_cmd_cache_entry_t *e = find_open(conn_gen, seq, cmd_id);
+    if (e != NULL) {
+        e->pending = false;
+        if (opt_len <= BLE_CMD_CACHE_DATA_MAX) {
+            e->status = status;
+            e->detail = detail;
+            e->data_len = (uint8_t)opt_len;
+            if (opt_len > 0 && opt_data != NULL) {
+                memcpy(e->data, opt_data, opt_len);
+            }
+            e->acked = true;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
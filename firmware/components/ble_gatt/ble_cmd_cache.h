@@ -0,0 +1,75 @@
+#pragma once
+
+/*
+ * Command ACK cache (component-private)
+ * =====================================
+ *
+ * Remembers the ACK produced for each recently executed command, keyed by
+ * (connection generation, seq, cmd_id, frame CRC). When the app retransmits
+ * a command whose ACK was lost, the command worker replays the cached ACK
+ * instead of executing the command a second time.
+ *
+ * Commands answered later from another task (machine state commands, ACKed
+ * from the state task) stay pending until their ACK is stored; a retransmit
+ * that arrives meanwhile is dropped, the ACK is on its way. The worker and
+ * the deferred ACK path both touch the cache, under a spinlock.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+/* Outcome of a lookup */
+typedef enum {
+    BLE_CMD_CACHE_MISS = 0,     /* Not seen (or ACK not replayable) - execute */
+    BLE_CMD_CACHE_ACKED,        /* Already answered - replay the ACK */
+    BLE_CMD_CACHE_PENDING,      /* Executing, ACK deferred - drop the retransmit */
+} ble_cmd_cache_hit_t;
+
+/* Largest ACK optional data kept for replay. Commands with bigger ACKs
+ * (register/trace dumps) are read-only and simply re-execute. */
+#define BLE_CMD_CACHE_DATA_MAX      48
+
+typedef struct {
+    uint32_t conn_gen;          /* Connection generation the command arrived on */
+    uint16_t seq;               /* COMMAND seq */
+    uint16_t cmd_id;
+    uint16_t frame_crc;         /* Distinguishes a reused seq after wrap-around */
+    bool     acked;             /* ACK recorded and replayable */
+    bool     pending;           /* ACK deferred to another task */
+    uint8_t  status;
+    uint16_t detail;
+    uint8_t  data_len;
+    uint8_t  data[BLE_CMD_CACHE_DATA_MAX];
+} ble_cmd_cache_entry_t;
+
+/**
+ * @brief Look a command up
+ *
+ * @param out Filled with a copy of the entry on BLE_CMD_CACHE_ACKED
+ */
+ble_cmd_cache_hit_t ble_cmd_cache_find(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id,
+                                       uint16_t frame_crc, ble_cmd_cache_entry_t *out);
+
+/**
+ * @brief Start tracking a command about to execute (evicts the oldest entry)
+ */
+void ble_cmd_cache_begin(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id,
+                         uint16_t frame_crc);
+
+/**
+ * @brief Mark a begun command as answered later (see ble_cmd_cache_store_ack)
+ */
+void ble_cmd_cache_defer(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id);
+
+/**
+ * @brief Record the ACK for a begun or deferred command
+ *
+ * Ignored if no unanswered entry matches (evicted meanwhile). If opt_len
+ * exceeds BLE_CMD_CACHE_DATA_MAX the entry is released unanswered, so a
+ * retransmit executes again.
+ */
+void ble_cmd_cache_store_ack(uint32_t conn_gen, uint16_t seq, uint16_t cmd_id,
+                             uint8_t status, uint16_t detail,
+                             const uint8_t *opt_data, size_t opt_len);
@@ -0,0 +1,1124 @@
+#include "ble_cmd_dispatch.h"
+#include "ble_gatt.h"
+#include "wire_cmd_schema.h"
+#include "session_mgr.h"
+#include "telemetry.h"
+#include "relay_ctrl.h"
+#include "pid_controller.h"
+#include "safety_gate.h"
+#include "trace_log.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "ble_gatt";
+
+void ble_cmd_trace_frame_hex(esp_log_level_t level, const uint8_t *data, size_t len)
+{
+    TRACE_LOG(level, TRACE_FMT_BLE_FRAME_HEX,
+              trace_log_pack_bytes(data, len, 0),  trace_log_pack_bytes(data, len, 4),
+              trace_log_pack_bytes(data, len, 8),  trace_log_pack_bytes(data, len, 12),
+              trace_log_pack_bytes(data, len, 16), trace_log_pack_bytes(data, len, 20));
+}
+
+bool ble_cmd_is_observer(uint32_t session_id)
+{
+    switch (session_id != 0 ? session_mgr_get_role(session_id) : SESSION_ROLE_NONE) {
+    case SESSION_ROLE_CONTROLLER:
+        return false;
+    case SESSION_ROLE_OBSERVER:
+        return true;
+    default:
+        return session_mgr_has_controller();
+    }
+}
+
+bool ble_cmd_parse(const uint8_t *data, size_t len, ble_cmd_t *out)
+{
+    wire_frame_header_t header;
+    const uint8_t *payload;
+
+    if (!wire_parse_frame(data, len, &header, &payload)) {
+        TRACE_LOGW(TRACE_FMT_BLE_FRAME_INVALID, len);
+        ble_cmd_trace_frame_hex(ESP_LOG_WARN, data, len);
+        return false;
+    }
+
+    if (header.msg_type != MSG_TYPE_COMMAND) {
+        TRACE_LOGW(TRACE_FMT_BLE_BAD_MSG_TYPE, header.msg_type);
+        return false;
+    }
+
+    if (header.payload_len < sizeof(wire_cmd_header_t)) {
+        TRACE_LOGW(TRACE_FMT_BLE_CMD_SHORT, header.payload_len);
+        return false;
+    }
+
+    /* Parse command header; handlers decode their fields from rd, which
+     * never reads past the payload and latches an error instead */
+    memset(out, 0, sizeof(*out));
+    out->seq = header.seq;
+    wire_reader_init(&out->rd, payload, header.payload_len);
+    out->cmd_id = wire_get_u16(&out->rd);
+    (void)wire_get_u16(&out->rd);               /* flags (reserved) */
+    out->payload_len = wire_reader_remaining(&out->rd);
+
+    TRACE_LOGI(TRACE_FMT_BLE_CMD_RX, len, out->cmd_id, out->seq, out->payload_len);
+    ble_cmd_trace_frame_hex(ESP_LOG_DEBUG, data, len);
+    return true;
+}
+
+static void send_ack(const ble_cmd_env_t *env, uint16_t seq, uint16_t cmd_id, uint8_t status,
+                     uint16_t detail, const uint8_t *data, size_t data_len)
+{
+    env->send_ack(env->ctx, seq, cmd_id, status, detail, data, data_len);
+}
+
+void ble_cmd_dispatch(const ble_cmd_env_t *env, ble_cmd_t *c)
+{
+    const uint16_t seq = c->seq;
+    const uint16_t cmd_id = c->cmd_id;
+    const size_t cmd_payload_len = c->payload_len;
+    wire_reader_t *rd = &c->rd;
+
+    /* Signal activity to reset lazy polling timer (but NOT for KEEPALIVE,
+     * which is sent automatically and shouldn't prevent idle timeout) */
+    if (cmd_id != CMD_KEEPALIVE) {
+        pid_controller_signal_activity();
+    }
+
+    /* Unknown IDs and payloads shorter than the schema minimum never reach
+     * a handler (wire_cmd_schema.h is generated from schema/commands.json) */
+    const wire_cmd_desc_t *desc = wire_cmd_lookup(cmd_id);
+    if (desc == NULL || cmd_payload_len < desc->min_len) {
+        if (desc == NULL) {
+            ESP_LOGW(TAG, "Unknown command: 0x%04X", cmd_id);
+        } else {
+            ESP_LOGW(TAG, "%s: payload too short (%u < %u)", desc->name,
+                     (unsigned)cmd_payload_len, desc->min_len);
+        }
+        send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+        return;
+    }
+
+    /* Observers (supervisors) may only read */
+    if (!(desc->flags & WIRE_CMD_F_OBSERVER) && ble_cmd_is_observer(c->session_id)) {
+        ESP_LOGW(TAG, "%s rejected: observer session", desc->name);
+        send_ack(env, seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0006, NULL, 0);
+        return;
+    }
+
+    switch (cmd_id) {
+        case CMD_OPEN_SESSION: {
+            wire_req_open_session_t req;
+            if (!wire_decode_open_session(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            session_role_t role;
+            if (req.role == WIRE_SESSION_ROLE_CONTROLLER) {
+                role = SESSION_ROLE_CONTROLLER;
+            } else if (req.role == WIRE_SESSION_ROLE_OBSERVER) {
+                role = SESSION_ROLE_OBSERVER;
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0001, NULL, 0);
+                break;
+            }
+
+            uint32_t session_id;
+            uint16_t lease_ms;
+            esp_err_t err = session_mgr_open(c->conn_handle, role, req.client_nonce,
+                                             &session_id, &lease_ms);
+
+            if (err == ESP_OK) {
+                /* Highest telemetry encoding both sides support */
+                uint8_t telemetry_ver = req.telemetry_ver;
+                if (telemetry_ver == 0) {
+                    telemetry_ver = WIRE_TELEMETRY_VER_SNAPSHOT;
+                } else if (telemetry_ver > WIRE_TELEMETRY_VER_MAX) {
+                    telemetry_ver = WIRE_TELEMETRY_VER_MAX;
+                }
+
+                env->session_opened(env->ctx, c->conn_gen, session_id, telemetry_ver);
+
+                /* Build ACK with session_id + lease_ms (+ telemetry_ver, role if asked) */
+                uint8_t opt_data[sizeof(wire_ack_open_session_t)];
+                opt_data[0] = session_id & 0xFF;
+                opt_data[1] = (session_id >> 8) & 0xFF;
+                opt_data[2] = (session_id >> 16) & 0xFF;
+                opt_data[3] = (session_id >> 24) & 0xFF;
+                opt_data[4] = lease_ms & 0xFF;
+                opt_data[5] = (lease_ms >> 8) & 0xFF;
+                opt_data[6] = telemetry_ver;
+                opt_data[7] = req.role;
+                size_t opt_len = 6;
+                if (cmd_payload_len >= offsetof(wire_cmd_open_session_t, role) + 1) {
+                    opt_len = 8;
+                } else if (cmd_payload_len >= offsetof(wire_cmd_open_session_t, telemetry_ver) + 1) {
+                    opt_len = 7;
+                }
+
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, opt_data, opt_len);
+                TRACE_LOGI(TRACE_FMT_BLE_OPEN_SESSION, session_id, role, lease_ms, telemetry_ver);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                /* Another connection holds a live controller session */
+                send_ack(env, seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0007, NULL, 0);
+                ESP_LOGW(TAG, "OPEN_SESSION rejected: controller session held elsewhere");
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_BUSY, 0, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_KEEPALIVE: {
+            wire_req_keepalive_t req;
+            if (!wire_decode_keepalive(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = session_mgr_keepalive(req.session_id);
+
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
+                ESP_LOGW(TAG, "KEEPALIVE rejected: invalid session");
+            }
+
+            break;
+        }
+
+        case CMD_START_RUN: {
+            wire_req_start_run_t req;
+            if (!wire_decode_start_run(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_START_RUN, req.session_id, req.run_mode,
+                       (int32_t)req.target_temp_x10, req.run_duration_ms, req.recipe_slot);
+
+            machine_state_cmd_t cmd = {
+                .op = (req.recipe_slot != 0) ? MACHINE_STATE_CMD_START_RECIPE
+                                             : MACHINE_STATE_CMD_START_RUN,
+                .session_id = req.session_id,
+                .start = {
+                    .run_mode = req.run_mode,
+                    .recipe_slot = req.recipe_slot,
+                    .target_temp_x10 = req.target_temp_x10,
+                    .run_duration_ms = req.run_duration_ms,
+                },
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_STOP_RUN: {
+            wire_req_stop_run_t req;
+            if (!wire_decode_stop_run(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, req.stop_mode);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_STOP_RUN,
+                .session_id = req.session_id,
+                .stop_mode = req.stop_mode,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_PAUSE_RUN: {
+            /* Payload: session_id (u32), pause_mode (u8) */
+            wire_req_pause_run_t req;
+            if (!wire_decode_pause_run(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, req.pause_mode);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_PAUSE_RUN,
+                .session_id = req.session_id,
+                .pause_mode = req.pause_mode,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_RESUME_RUN: {
+            /* Payload: session_id (u32) */
+            wire_req_resume_run_t req;
+            if (!wire_decode_resume_run(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, 0);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_RESUME_RUN,
+                .session_id = req.session_id,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_ENABLE_SERVICE_MODE: {
+            wire_req_enable_service_mode_t req;
+            if (!wire_decode_enable_service_mode(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, 0);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_ENTER_SERVICE,
+                .session_id = req.session_id,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_DISABLE_SERVICE_MODE: {
+            wire_req_disable_service_mode_t req;
+            if (!wire_decode_disable_service_mode(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, 0);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_EXIT_SERVICE,
+                .session_id = req.session_id,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_CLEAR_ESTOP: {
+            wire_req_clear_estop_t req;
+            if (!wire_decode_clear_estop(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, 0);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_CLEAR_ESTOP,
+                .session_id = req.session_id,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_CLEAR_LATCHED_ALARMS: {
+            wire_req_clear_latched_alarms_t req;
+            if (!wire_decode_clear_latched_alarms(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_STATE_CMD, cmd_id, req.session_id, 0);
+
+            machine_state_cmd_t cmd = {
+                .op = MACHINE_STATE_CMD_CLEAR_FAULT,
+                .session_id = req.session_id,
+            };
+            env->post_state_cmd(env->ctx, &cmd, c);
+            break;
+        }
+
+        case CMD_SET_RELAY: {
+            /* Payload: relay_index (u8), state (u8) */
+            wire_req_set_relay_t req;
+            if (!wire_decode_set_relay(rd, &req)) {
+                ESP_LOGW(TAG, "SET_RELAY: payload too short (%u bytes)", (unsigned)cmd_payload_len);
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            /* Validate relay_index is 1-8 */
+            if (req.relay_index < 1 || req.relay_index > 8) {
+                ESP_LOGW(TAG, "SET_RELAY: invalid relay_index %u (must be 1-8)", req.relay_index);
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Validate state is 0, 1, or 2 */
+            if (req.state > 2) {
+                ESP_LOGW(TAG, "SET_RELAY: invalid state %u (must be 0=OFF, 1=ON, 2=TOGGLE)", req.state);
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Control hardware relay via TCA9554 I/O expander */
+            esp_err_t relay_err = relay_ctrl_set(req.relay_index, req.state);
+            if (relay_err != ESP_OK) {
+                ESP_LOGE(TAG, "SET_RELAY: hardware control failed: %s", esp_err_to_name(relay_err));
+                send_ack(env, seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
+                break;
+            }
+
+            /* Update telemetry to match hardware state */
+            uint8_t ro_bits = relay_ctrl_get_state();
+            telemetry_set_ro_bits(ro_bits);
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_RELAY, req.relay_index, req.state, ro_bits);
+
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            break;
+        }
+
+        case CMD_SET_RELAY_MASK: {
+            /* Payload: mask (u8), values (u8) */
+            wire_req_set_relay_mask_t req;
+            if (!wire_decode_set_relay_mask(rd, &req)) {
+                ESP_LOGW(TAG, "SET_RELAY_MASK: payload too short (%u bytes)", (unsigned)cmd_payload_len);
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            /* Validate mask is non-zero */
+            if (req.mask == 0) {
+                ESP_LOGW(TAG, "SET_RELAY_MASK: mask is zero (no channels affected)");
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Get current state before change for logging */
+            uint8_t old_ro_bits = relay_ctrl_get_state();
+
+            /* Control hardware relays via TCA9554 I/O expander */
+            esp_err_t relay_err = relay_ctrl_set_mask(req.mask, req.values);
+            if (relay_err != ESP_OK) {
+                ESP_LOGE(TAG, "SET_RELAY_MASK: hardware control failed: %s", esp_err_to_name(relay_err));
+                send_ack(env, seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
+                break;
+            }
+
+            /* Update telemetry to match hardware state */
+            uint8_t new_ro_bits = relay_ctrl_get_state();
+            telemetry_set_ro_bits(new_ro_bits);
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_RELAY_MASK, old_ro_bits, new_ro_bits, req.mask, req.values);
+
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            break;
+        }
+
+        /* ===== PID Controller Commands ===== */
+
+        case CMD_SET_SV: {
+            /* Payload: controller_id (u8), sv_x10 (i16) */
+            wire_req_set_sv_t req;
+            if (!wire_decode_set_sv(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            float sv_celsius = req.sv_x10 / 10.0f;
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_SV, req.controller_id, (int32_t)req.sv_x10);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = pid_controller_set_sv(req.controller_id, sv_celsius);
+            if (err == ESP_OK) {
+                /* Force a poll to update cached data */
+                pid_controller_force_poll(req.controller_id);
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+            break;
+        }
+
+        case CMD_SET_MODE: {
+            /* Payload: controller_id (u8), mode (u8) */
+            wire_req_set_mode_t req;
+            if (!wire_decode_set_mode(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_MODE, req.controller_id, req.mode);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Safety gate check for enabling AUTO mode */
+            if (req.mode == CTRL_MODE_AUTO) {
+                int8_t blocking_gate = -1;
+                if (!safety_gate_can_enable_pid(req.controller_id, &blocking_gate)) {
+                    ESP_LOGW(TAG, "SET_MODE(AUTO) rejected: gate %d blocking for PID %u",
+                             blocking_gate, req.controller_id);
+                    /* Return which gate is blocking in the detail field */
+                    uint16_t detail = (blocking_gate >= 0) ? (uint16_t)blocking_gate : 0;
+                    send_ack(env, seq, cmd_id, CMD_STATUS_REJECTED_POLICY, detail, NULL, 0);
+                    break;
+                }
+            }
+
+            esp_err_t err = pid_controller_set_mode(req.controller_id, req.mode);
+            if (err == ESP_OK) {
+                pid_controller_force_poll(req.controller_id);
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_ARG) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_REQUEST_PV_SV_REFRESH: {
+            /* Payload: controller_id (u8) */
+            wire_req_request_pv_sv_refresh_t req;
+            if (!wire_decode_request_pv_sv_refresh(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "REQUEST_PV_SV_REFRESH: controller=%u", req.controller_id);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = pid_controller_force_poll(req.controller_id);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_NOT_FOUND) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_SET_PID_PARAMS: {
+            /* Payload: controller_id (u8), p_gain_x10 (i16), i_time (u16), d_time (u16) */
+            wire_req_set_pid_params_t req;
+            if (!wire_decode_set_pid_params(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            float p_gain = req.p_gain_x10 / 10.0f;
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_PID_PARAMS, req.controller_id, (int32_t)req.p_gain_x10,
+                       req.i_time, req.d_time);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = pid_controller_write_params(req.controller_id, p_gain,
+                                                        req.i_time, req.d_time);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+            break;
+        }
+
+        case CMD_READ_PID_PARAMS: {
+            /* Payload: controller_id (u8) */
+            wire_req_read_pid_params_t req;
+            if (!wire_decode_read_pid_params(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "READ_PID_PARAMS: controller=%u", req.controller_id);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            float p_gain;
+            uint16_t i_time, d_time;
+            esp_err_t err = pid_controller_read_params(req.controller_id,
+                                                       &p_gain, &i_time, &d_time);
+
+            if (err == ESP_OK) {
+                wire_ack_pid_params_t params;
+                params.controller_id = req.controller_id;
+                params.p_gain_x10 = (int16_t)(p_gain * 10.0f + 0.5f);
+                params.i_time = i_time;
+                params.d_time = d_time;
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0,
+                         (const uint8_t *)&params, sizeof(params));
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_START_AUTOTUNE: {
+            /* Payload: controller_id (u8) */
+            wire_req_start_autotune_t req;
+            if (!wire_decode_start_autotune(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "START_AUTOTUNE: controller=%u", req.controller_id);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = pid_controller_start_autotune(req.controller_id);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_STOP_AUTOTUNE: {
+            /* Payload: controller_id (u8) */
+            wire_req_stop_autotune_t req;
+            if (!wire_decode_stop_autotune(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "STOP_AUTOTUNE: controller=%u", req.controller_id);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = pid_controller_stop_autotune(req.controller_id);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_SET_ALARM_LIMITS: {
+            /* Payload: controller_id (u8), alarm1_x10 (i16), alarm2_x10 (i16) */
+            wire_req_set_alarm_limits_t req;
+            if (!wire_decode_set_alarm_limits(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            float al1 = req.alarm1_x10 / 10.0f;
+            float al2 = req.alarm2_x10 / 10.0f;
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_ALARMS, req.controller_id, (int32_t)req.alarm1_x10,
+                       (int32_t)req.alarm2_x10);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = pid_controller_set_alarm_limits(req.controller_id, al1, al2);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+            break;
+        }
+
+        case CMD_READ_ALARM_LIMITS: {
+            /* Payload: controller_id (u8) */
+            wire_req_read_alarm_limits_t req;
+            if (!wire_decode_read_alarm_limits(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "READ_ALARM_LIMITS: controller=%u", req.controller_id);
+
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            float al1, al2;
+            esp_err_t err = pid_controller_read_alarm_limits(req.controller_id, &al1, &al2);
+
+            if (err == ESP_OK) {
+                wire_ack_alarm_limits_t limits;
+                limits.controller_id = req.controller_id;
+                limits.alarm1_x10 = (int16_t)(al1 * 10.0f + 0.5f);
+                limits.alarm2_x10 = (int16_t)(al2 * 10.0f + 0.5f);
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0,
+                         (const uint8_t *)&limits, sizeof(limits));
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        /* ===== Generic Register Commands ===== */
+
+        case CMD_READ_REGISTERS: {
+            /* Payload: controller_id (u8), start_address (u16 LE), count (u8) */
+            wire_req_read_registers_t req;
+            if (!wire_decode_read_registers(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "READ_REGISTERS: controller=%u start=%u count=%u",
+                     req.controller_id, req.start_address, req.count);
+
+            /* Validate controller_id */
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Validate count (1-16) */
+            if (req.count == 0 || req.count > 16) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Read registers */
+            uint16_t values[16];
+            esp_err_t err = pid_controller_read_registers(req.controller_id, req.start_address,
+                                                          req.count, values);
+
+            if (err == ESP_OK) {
+                /* Build response: header (4 bytes) + values (2*count bytes) */
+                uint8_t ack_data[4 + 32]; /* max 4 + 16*2 = 36 bytes */
+                ack_data[0] = req.controller_id;
+                ack_data[1] = req.start_address & 0xFF;
+                ack_data[2] = (req.start_address >> 8) & 0xFF;
+                ack_data[3] = req.count;
+                for (int i = 0; i < req.count; i++) {
+                    ack_data[4 + i*2] = values[i] & 0xFF;
+                    ack_data[4 + i*2 + 1] = (values[i] >> 8) & 0xFF;
+                }
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0,
+                         ack_data, 4 + req.count * 2);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_WRITE_REGISTER: {
+            /* Payload: controller_id (u8), address (u16 LE), value (u16 LE) */
+            wire_req_write_register_t req;
+            if (!wire_decode_write_register(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_WRITE_REG, req.controller_id, req.address, req.value);
+
+            /* Validate controller_id */
+            if (req.controller_id < 1 || req.controller_id > PID_MAX_CONTROLLERS) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Protect RS-485 communication registers from writes */
+            if (req.address >= 49 && req.address <= 51) {
+                ESP_LOGW(TAG, "WRITE_REGISTER: protected register %u", req.address);
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Write register with verification */
+            uint16_t verified_value = 0;
+            esp_err_t err = pid_controller_write_register(req.controller_id, req.address,
+                                                          req.value, &verified_value);
+
+            if (err == ESP_OK) {
+                /* Build response with verified value */
+                wire_ack_write_register_t ack;
+                ack.controller_id = req.controller_id;
+                ack.address = req.address;
+                ack.value = verified_value;
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0,
+                         (const uint8_t *)&ack, sizeof(ack));
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_RESPONSE) {
+                /* Write succeeded but verification failed - return HW_FAULT with the actual value */
+                wire_ack_write_register_t ack;
+                ack.controller_id = req.controller_id;
+                ack.address = req.address;
+                ack.value = verified_value;
+                send_ack(env, seq, cmd_id, CMD_STATUS_HW_FAULT, 0,
+                         (const uint8_t *)&ack, sizeof(ack));
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+            }
+
+            break;
+        }
+
+        /* ===== Configuration Commands ===== */
+
+        case CMD_SET_IDLE_TIMEOUT: {
+            /* Payload: timeout_minutes (u8) */
+            wire_req_set_idle_timeout_t req;
+            if (!wire_decode_set_idle_timeout(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "SET_IDLE_TIMEOUT: %u minutes", req.timeout_minutes);
+
+            esp_err_t err = pid_controller_set_idle_timeout(req.timeout_minutes);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_GET_IDLE_TIMEOUT: {
+            /* No payload required */
+            ESP_LOGD(TAG, "GET_IDLE_TIMEOUT");
+
+            uint8_t timeout_minutes = pid_controller_get_idle_timeout();
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, &timeout_minutes, 1);
+            break;
+        }
+
+        /* ===== Safety Gate Commands ===== */
+
+        case CMD_GET_CAPABILITIES: {
+            /* No payload required */
+            ESP_LOGD(TAG, "GET_CAPABILITIES");
+
+            wire_ack_capabilities_t caps;
+            uint8_t cap_array[SUBSYS_MAX];
+            safety_gate_get_all_capabilities(cap_array);
+
+            caps.pid1_cap = cap_array[SUBSYS_PID1];
+            caps.pid2_cap = cap_array[SUBSYS_PID2];
+            caps.pid3_cap = cap_array[SUBSYS_PID3];
+            caps.di1_cap = cap_array[SUBSYS_DI_ESTOP];
+            caps.di2_cap = cap_array[SUBSYS_DI_DOOR];
+            caps.di3_cap = cap_array[SUBSYS_DI_LN2];
+            caps.di4_cap = cap_array[SUBSYS_DI_MOTOR];
+            caps.reserved = 0;
+
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0,
+                     (const uint8_t *)&caps, sizeof(caps));
+            break;
+        }
+
+        case CMD_SET_CAPABILITY: {
+            /* Payload: subsystem_id (u8), capability (u8) */
+            wire_req_set_capability_t req;
+            if (!wire_decode_set_capability(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_CAPABILITY, req.subsystem_id, req.capability);
+
+            /* Validate subsystem_id */
+            if (req.subsystem_id >= SUBSYS_MAX) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            /* Validate capability level */
+            if (req.capability > CAP_REQUIRED) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = safety_gate_set_capability((subsystem_id_t)req.subsystem_id,
+                                                       (capability_level_t)req.capability);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_ARG) {
+                /* Trying to change E-Stop capability */
+                send_ack(env, seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0002, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_GET_SAFETY_GATES: {
+            /* No payload required */
+            ESP_LOGD(TAG, "GET_SAFETY_GATES");
+
+            /* Gate masks are 32-bit internally; this ACK carries 16 gates */
+            _Static_assert(GATE_MAX <= 16, "GET_SAFETY_GATES ACK needs wider gate masks");
+            wire_ack_safety_gates_t gates;
+            gates.gate_enable = (uint16_t)safety_gate_get_enable_mask();
+            gates.gate_status = (uint16_t)safety_gate_get_status_mask();
+
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0,
+                     (const uint8_t *)&gates, sizeof(gates));
+            break;
+        }
+
+        case CMD_SET_SAFETY_GATE: {
+            /* Payload: gate_id (u8), enabled (u8) */
+            wire_req_set_safety_gate_t req;
+            if (!wire_decode_set_safety_gate(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            TRACE_LOGI(TRACE_FMT_BLE_SET_GATE, req.gate_id, req.enabled);
+
+            /* Validate gate_id */
+            if (req.gate_id >= GATE_MAX) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+                break;
+            }
+
+            esp_err_t err = safety_gate_set_enabled((gate_id_t)req.gate_id, req.enabled != 0);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_ARG) {
+                /* Trying to bypass a non-bypassable gate (E-Stop) */
+                send_ack(env, seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0002, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
+            }
+
+            break;
+        }
+
+        /* ===== Diagnostics Commands ===== */
+
+        case CMD_REQUEST_SNAPSHOT_NOW: {
+            /* Compact telemetry: resend full state in the next frame */
+            telemetry_request_keyframe();
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            break;
+        }
+
+        case CMD_SET_TRACE_LEVEL: {
+            /* Payload: module (u8, 0xFF = all), level (u8) */
+            wire_req_set_trace_level_t req;
+            if (!wire_decode_set_trace_level(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "SET_TRACE_LEVEL: module=%u level=%u", req.module, req.level);
+
+            esp_err_t err = ESP_OK;
+            if (req.module == 0xFF) {
+                for (int m = 0; m < TRACE_MOD_MAX && err == ESP_OK; m++) {
+                    err = trace_log_set_level((trace_module_t)m, (esp_log_level_t)req.level);
+                }
+            } else {
+                err = trace_log_set_level((trace_module_t)req.module, (esp_log_level_t)req.level);
+            }
+
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_GET_TRACE_STATS: {
+            /* Payload: first_fmt_id (u8, optional) */
+            wire_req_get_trace_stats_t req;
+            wire_decode_get_trace_stats(rd, &req);
+
+            trace_log_stats_t stats;
+            trace_log_get_stats(&stats);
+
+            /* Header + as many sites (up to 8) as one notification carries at
+             * this link's ATT MTU; the app pages on with first_fmt_id. The
+             * header alone needs an MTU of 27, so the 23-byte default only
+             * works once the link profile's MTU exchange is done. */
+            int room = (int)env->att_mtu(env->ctx, c->conn_handle) - 3 - WIRE_HEADER_SIZE -
+                       (int)sizeof(wire_cmd_ack_t) - WIRE_CRC_SIZE -
+                       (int)sizeof(wire_ack_trace_stats_t);
+            int max_sites = room > 0 ? room / (int)sizeof(wire_trace_site_stats_t) : 0;
+            if (max_sites > 8) {
+                max_sites = 8;
+            }
+
+            uint8_t ack_data[sizeof(wire_ack_trace_stats_t) + 8 * sizeof(wire_trace_site_stats_t)];
+            wire_ack_trace_stats_t *hdr = (wire_ack_trace_stats_t *)ack_data;
+            wire_trace_site_stats_t *sites = (wire_trace_site_stats_t *)&ack_data[sizeof(*hdr)];
+
+            hdr->recorded = stats.recorded;
+            hdr->dropped = stats.dropped;
+            hdr->site_count = 0;
+
+            for (int id = req.first_fmt_id;
+                 id < TRACE_FMT_MAX && hdr->site_count < max_sites; id++) {
+                trace_log_site_stats_t site;
+                trace_log_get_site_stats((trace_fmt_id_t)id, &site);
+
+                wire_trace_site_stats_t *out = &sites[hdr->site_count++];
+                out->fmt_id = (uint8_t)id;
+                out->count = site.count;
+                out->record_cycles_avg = site.record_cycles_avg > UINT16_MAX ?
+                                         UINT16_MAX : (uint16_t)site.record_cycles_avg;
+                out->format_cycles_avg = site.format_cycles_avg;
+            }
+
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, ack_data,
+                     sizeof(*hdr) + hdr->site_count * sizeof(wire_trace_site_stats_t));
+            break;
+        }
+
+        case CMD_SET_LINK_PROFILE: {
+            /* Payload: profile (u8) */
+            wire_req_set_link_profile_t req;
+            if (!wire_decode_set_link_profile(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "SET_LINK_PROFILE: profile=%u", req.profile);
+
+            esp_err_t err = ble_gatt_set_link_profile((ble_link_profile_t)req.profile);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0001, NULL, 0);
+            }
+            break;
+        }
+
+        case CMD_LINK_BENCHMARK: {
+            /* Payload: total_bytes (u32), rtt_samples (u8) */
+            wire_req_link_benchmark_t req;
+            if (!wire_decode_link_benchmark(rd, &req)) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+                break;
+            }
+
+            ESP_LOGD(TAG, "LINK_BENCHMARK: %lu bytes, %u RTT samples",
+                     (unsigned long)req.total_bytes, req.rtt_samples);
+
+            /* The bench task runs below the command worker, so this ACK is
+             * queued ahead of the first benchmark frame */
+            esp_err_t err = env->start_benchmark(env->ctx, c, req.total_bytes,
+                                                 req.rtt_samples);
+            if (err == ESP_OK) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_BUSY, 0, NULL, 0);
+            } else {
+                send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0001, NULL, 0);
+            }
+
+            break;
+        }
+
+        case CMD_GET_RELAY_STATS: {
+            /* Payload: first_channel (u8, optional, 1 = RO1) */
+            wire_req_get_relay_stats_t req;
+            wire_decode_get_relay_stats(rd, &req);
+
+            /* Header + as many channels as one notification carries at this
+             * link's ATT MTU; the app pages on with first_channel. All eight
+             * need an MTU of 131, one needs 40: below that the MTU exchange
+             * has not happened yet and the request is refused. */
+            int room = (int)env->att_mtu(env->ctx, c->conn_handle) - 3 - WIRE_HEADER_SIZE -
+                       (int)sizeof(wire_cmd_ack_t) - WIRE_CRC_SIZE -
+                       (int)sizeof(wire_ack_relay_stats_t);
+            int max_chans = room > 0 ? room / (int)sizeof(wire_relay_channel_stats_t) : 0;
+            if (max_chans == 0) {
+                send_ack(env, seq, cmd_id, CMD_STATUS_NOT_READY, 0x0008, NULL, 0);
+                break;
+            }
+
+            relay_ctrl_wear_stats_t wear;
+            relay_ctrl_get_wear(&wear);
+
+            uint8_t ack_data[sizeof(wire_ack_relay_stats_t) +
+                             RELAY_CTRL_CHANNELS * sizeof(wire_relay_channel_stats_t)];
+            wire_ack_relay_stats_t *hdr = (wire_ack_relay_stats_t *)ack_data;
+            wire_relay_channel_stats_t *chans = (wire_relay_channel_stats_t *)&ack_data[sizeof(*hdr)];
+
+            hdr->flushes = wear.flushes;
+            hdr->unsaved_changes = wear.unsaved_changes;
+            hdr->channel_count = 0;
+
+            for (int i = req.first_channel > 0 ? req.first_channel - 1 : 0;
+                 i < RELAY_CTRL_CHANNELS && hdr->channel_count < max_chans; i++) {
+                wire_relay_channel_stats_t *out = &chans[hdr->channel_count++];
+                out->channel = (uint8_t)(i + 1);
+                out->on_count = wear.channel[i].on_count;
+                out->off_count = wear.channel[i].off_count;
+                out->on_time_s = (uint32_t)(wear.channel[i].on_time_ms / 1000);
+            }
+
+            send_ack(env, seq, cmd_id, CMD_STATUS_OK, 0, ack_data,
+                     sizeof(*hdr) + hdr->channel_count * sizeof(wire_relay_channel_stats_t));
+            break;
+        }
+
+        default:
+            ESP_LOGW(TAG, "Unknown command: 0x%04X", cmd_id);
+            send_ack(env, seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
+            break;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ * Command dispatch (component-private)
+ * ====================================
+ *
+ * Everything that happens to a COMMAND frame once it has been received:
+ * frame and header checks, schema lookup, the observer check, argument
+ * validation and the calls into session_mgr, telemetry, relay_ctrl,
+ * pid_controller, safety_gate and trace_log. Nothing here touches NimBLE
+ * or the client table - ACKs, state commands and the few link-specific
+ * operations go through ble_cmd_env_t.
+ *
+ * ble_gatt.c runs it on the command worker, between the ACK cache lookup
+ * and the ACK. tools/wire_fuzz builds it on the host against stubbed
+ * components and feeds it mutated frames.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "wire_protocol.h"
+#include "machine_state.h"
+
+/* A received COMMAND and the client it came from */
+typedef struct {
+    uint16_t      seq;                  /* COMMAND frame seq */
+    uint16_t      cmd_id;
+    size_t        payload_len;          /* Command payload after cmd_id + flags */
+    wire_reader_t rd;                   /* Positioned at the command payload */
+    uint16_t      conn_handle;
+    uint32_t      conn_gen;             /* Connection generation at arrival */
+    uint32_t      session_id;           /* Last session the client opened, 0 = none */
+    bool          events_indicate;      /* Client enabled Events+Acks indications */
+} ble_cmd_t;
+
+/* Environment the dispatcher runs against. All hooks are required. */
+typedef struct {
+    /* ACK the command being dispatched */
+    void      (*send_ack)(void *ctx, uint16_t seq, uint16_t cmd_id, uint8_t status,
+                          uint16_t detail, const uint8_t *data, size_t data_len);
+    /* Post a state command to the state task; its ACK comes from the reply */
+    void      (*post_state_cmd)(void *ctx, machine_state_cmd_t *cmd, const ble_cmd_t *c);
+    /* OPEN_SESSION succeeded: record the session and telemetry encoding */
+    void      (*session_opened)(void *ctx, uint32_t conn_gen, uint32_t session_id,
+                                uint8_t telemetry_ver);
+    /* Negotiated ATT MTU of a connection */
+    uint16_t  (*att_mtu)(void *ctx, uint16_t conn_handle);
+    /* Start a LINK_BENCHMARK run towards the client */
+    esp_err_t (*start_benchmark)(void *ctx, const ble_cmd_t *c, uint32_t total_bytes,
+                                 uint8_t rtt_samples);
+    void      *ctx;
+} ble_cmd_env_t;
+
+/**
+ * @brief Check a COMMAND frame and read its header
+ *
+ * Fills seq, cmd_id, payload_len and rd; the connection fields are left
+ * for the caller.
+ *
+ * @return false (traced) if the frame is invalid, not a COMMAND or too
+ *         short for the command header
+ */
+bool ble_cmd_parse(const uint8_t *data, size_t len, ble_cmd_t *out);
+
+/**
+ * @brief Execute a parsed command
+ *
+ * Every command is answered exactly once, either through env->send_ack
+ * or, for state commands, through env->post_state_cmd.
+ */
+void ble_cmd_dispatch(const ble_cmd_env_t *env, ble_cmd_t *c);
+
+/**
+ * @brief Whether commands from a client with this session are limited to
+ *        WIRE_CMD_F_OBSERVER ones
+ *
+ * Its own session decides (O(1) in session_mgr); a client without one may
+ * command the machine only while nobody holds the controller session.
+ */
+bool ble_cmd_is_observer(uint32_t session_id);
+
+/**
+ * @brief Deferred hex dump of the first 24 bytes of a frame
+ */
+void ble_cmd_trace_frame_hex(esp_log_level_t level, const uint8_t *data, size_t len);
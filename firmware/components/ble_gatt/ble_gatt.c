@@ -1,19 +1,26 @@
 #include "ble_gatt.h"
+#include "ble_link.h"
+#include "ble_cmd_cache.h"
+#include "ble_cmd_dispatch.h"
+#include "ble_bulk.h"
 #include "wire_protocol.h"
 #include "session_mgr.h"
 #include "telemetry.h"
-#include "relay_ctrl.h"
 #include "status_led.h"
 #include "machine_state.h"
-#include "pid_controller.h"
-#include "safety_gate.h"
+#include "trace_log.h"
 
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
 
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
@@ -25,21 +32,55 @@
 
 static const char *TAG = "ble_gatt";
 
-/* Connection state */
-static uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
-static bool s_telemetry_subscribed = false;
-static bool s_events_notify_subscribed = false;
-static bool s_events_indicate_subscribed = false;
+/* Connected clients. Telemetry and events are encoded once and sent to
+ * every subscriber; commands are checked against the role of the session
+ * the connection opened (session_mgr). Slots are written by the host task
+ * and read by the worker and the telemetry/state tasks, under s_clients_lock. */
+typedef struct {
+    uint32_t gen;                       /* Connection generation, 0 = free slot */
+    uint16_t conn_handle;
+    uint32_t session_id;                /* Last session opened on this link, 0 = none */
+    uint8_t  telemetry_ver;             /* Encoding it negotiated (SNAPSHOT until then) */
+    bool     telemetry_sub;
+    bool     events_notify;
+    bool     events_indicate;
+} ble_client_t;
+
+_Static_assert(CONFIG_BLE_GATT_MAX_CLIENTS <= SESSION_MGR_MAX_SESSIONS,
+               "every client must be able to hold a session");
+#if defined(CONFIG_BT_NIMBLE_MAX_CONNECTIONS) && \
+    CONFIG_BLE_GATT_MAX_CLIENTS > CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#error "CONFIG_BLE_GATT_MAX_CLIENTS exceeds CONFIG_BT_NIMBLE_MAX_CONNECTIONS"
+#endif
+
+static ble_client_t s_clients[CONFIG_BLE_GATT_MAX_CLIENTS];
+static uint32_t s_last_gen = 0;                 /* Last generation handed out */
+static portMUX_TYPE s_clients_lock = portMUX_INITIALIZER_UNLOCKED;
 
 /* Characteristic value handles */
 static uint16_t s_device_info_handle;
 static uint16_t s_telemetry_handle;
 static uint16_t s_command_rx_handle;
 static uint16_t s_events_acks_handle;
+static uint16_t s_bulk_gateway_handle;
 
 /* Sequence counter for outgoing messages */
 static uint16_t s_tx_seq = 0;
 
+/* Command pipeline: the host task queues writes, the worker executes them in order */
+#define CMD_TASK_STACK          6144
+
+typedef struct {
+    uint32_t conn_gen;                  /* Connection generation at arrival */
+    uint16_t conn_handle;
+    uint16_t len;
+    uint8_t  data[WIRE_MAX_FRAME_SIZE];
+} cmd_item_t;
+
+static QueueHandle_t s_cmd_queue = NULL;
+static TaskHandle_t s_cmd_task = NULL;
+static uint32_t s_cmd_conn_gen = 0;         /* Generation of the command the worker is executing */
+
 /* Device name with MAC suffix */
 static char s_device_name[20];
 
@@ -70,7 +111,12 @@ static const ble_uuid128_t chr_events_acks_uuid = BLE_UUID128_INIT(
     0x27, 0x4A, 0x1E, 0x3D, 0xD2, 0xB4, 0xC5, 0xF0
 );
 
-/* Device Info characteristic data */
+static const ble_uuid128_t chr_bulk_gateway_uuid = BLE_UUID128_INIT(
+    0x65, 0x5E, 0x4D, 0x3C, 0x0B, 0x2F, 0x8A, 0x9B,
+    0x27, 0x4A, 0x1E, 0x3D, 0xD2, 0xB4, 0xC5, 0xF0
+);
+
+/* Device Info characteristic data (fixed part; link section appended on read) */
 static const uint8_t device_info_data[] = {
     WIRE_PROTO_VERSION,                     // proto_ver
     FW_VERSION_MAJOR,                       // fw_major
@@ -80,16 +126,23 @@ static const uint8_t device_info_data[] = {
     (FW_BUILD_ID >> 8) & 0xFF,
     (FW_BUILD_ID >> 16) & 0xFF,
     (FW_BUILD_ID >> 24) & 0xFF,
-    CAP_SUPPORTS_SESSION_LEASE & 0xFF,      // cap_bits (little-endian)
-    0, 0, 0
+    (CAP_SUPPORTS_SESSION_LEASE | CAP_SUPPORTS_BULK_GATEWAY |
+     CAP_SUPPORTS_LINK_INFO | CAP_SUPPORTS_COMPACT_TELEM) & 0xFF,  // cap_bits (little-endian)
+    (CAP_SUPPORTS_OBSERVER >> 8) & 0xFF,
+    0, 0
 };
 
 /* Forward declarations */
 static int gatt_chr_access_cb(uint16_t conn_handle, uint16_t attr_handle,
                               struct ble_gatt_access_ctxt *ctxt, void *arg);
-static void handle_command(uint16_t conn_handle, const uint8_t *data, size_t len);
-static void send_ack(uint16_t acked_seq, uint16_t cmd_id, uint8_t status, uint16_t detail,
-                     const uint8_t *opt_data, size_t opt_len);
+static void enqueue_command(uint16_t conn_handle, const uint8_t *data, size_t len);
+static void handle_command(uint16_t conn_handle, uint32_t conn_gen,
+                           const uint8_t *data, size_t len);
+static void send_ack(void *ctx, uint16_t acked_seq, uint16_t cmd_id, uint8_t status,
+                     uint16_t detail, const uint8_t *opt_data, size_t opt_len);
+static void transmit_ack(uint32_t conn_gen, uint16_t acked_seq, uint16_t cmd_id,
+                         uint8_t status, uint16_t detail,
+                         const uint8_t *opt_data, size_t opt_len);
 
 /* GATT service definition */
 static const struct ble_gatt_svc_def gatt_svcs[] = {
@@ -125,1049 +178,492 @@ static const struct ble_gatt_svc_def gatt_svcs[] = {
                 .val_handle = &s_events_acks_handle,
                 .flags = BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE,
             },
+            {
+                /* Bulk Gateway - Write, Write Without Response, Notify */
+                .uuid = &chr_bulk_gateway_uuid.u,
+                .access_cb = gatt_chr_access_cb,
+                .val_handle = &s_bulk_gateway_handle,
+                .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP |
+                         BLE_GATT_CHR_F_NOTIFY,
+            },
             { 0 } /* Terminator */
         },
     },
     { 0 } /* Terminator */
 };
 
-/* GATT characteristic access callback */
-static int gatt_chr_access_cb(uint16_t conn_handle, uint16_t attr_handle,
-                              struct ble_gatt_access_ctxt *ctxt, void *arg)
-{
-    (void)arg;
+/* ===== Clients ===== */
 
-    if (attr_handle == s_device_info_handle) {
-        if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
-            int rc = os_mbuf_append(ctxt->om, device_info_data, sizeof(device_info_data));
-            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+/* Slot lookups; call with s_clients_lock held */
+static ble_client_t *client_by_conn_locked(uint16_t conn_handle)
+{
+    for (int i = 0; i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+        if (s_clients[i].gen != 0 && s_clients[i].conn_handle == conn_handle) {
+            return &s_clients[i];
         }
     }
-    else if (attr_handle == s_command_rx_handle) {
-        if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
-            uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
-            uint8_t buf[WIRE_MAX_FRAME_SIZE];
-
-            if (len > sizeof(buf)) {
-                ESP_LOGW(TAG, "Command too large: %u bytes", len);
-                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
-            }
-
-            int rc = ble_hs_mbuf_to_flat(ctxt->om, buf, len, NULL);
-            if (rc != 0) {
-                return BLE_ATT_ERR_UNLIKELY;
-            }
+    return NULL;
+}
 
-            handle_command(conn_handle, buf, len);
-            return 0;
+static ble_client_t *client_by_gen_locked(uint32_t gen)
+{
+    for (int i = 0; gen != 0 && i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+        if (s_clients[i].gen == gen) {
+            return &s_clients[i];
         }
     }
-
-    return 0;
+    return NULL;
 }
 
-/* Handle incoming command */
-static void handle_command(uint16_t conn_handle, const uint8_t *data, size_t len)
+/* Copy of the client a generation belongs to; false once it has disconnected */
+static bool client_get(uint32_t gen, ble_client_t *out)
 {
-    ESP_LOGI(TAG, "Received command write: %u bytes", (unsigned)len);
-    ESP_LOG_BUFFER_HEX_LEVEL(TAG, data, len, ESP_LOG_INFO);
-
-    wire_frame_header_t header;
-    const uint8_t *payload;
-
-    if (!wire_parse_frame(data, len, &header, &payload)) {
-        ESP_LOGW(TAG, "Invalid frame (len=%u)", (unsigned)len);
-        ESP_LOG_BUFFER_HEX_LEVEL(TAG, data, len > 32 ? 32 : len, ESP_LOG_WARN);
-        return;
+    taskENTER_CRITICAL(&s_clients_lock);
+    ble_client_t *c = client_by_gen_locked(gen);
+    if (c != NULL && out != NULL) {
+        *out = *c;
     }
+    taskEXIT_CRITICAL(&s_clients_lock);
+    return c != NULL;
+}
 
-    if (header.msg_type != MSG_TYPE_COMMAND) {
-        ESP_LOGW(TAG, "Unexpected msg_type: 0x%02X", header.msg_type);
-        return;
-    }
-
-    if (header.payload_len < sizeof(wire_cmd_header_t)) {
-        ESP_LOGW(TAG, "Command payload too short");
-        return;
-    }
-
-    /* Parse command header */
-    uint16_t cmd_id = payload[0] | ((uint16_t)payload[1] << 8);
-    // uint16_t flags = payload[2] | ((uint16_t)payload[3] << 8);
-    const uint8_t *cmd_payload = &payload[sizeof(wire_cmd_header_t)];
-    size_t cmd_payload_len = header.payload_len - sizeof(wire_cmd_header_t);
-
-    ESP_LOGI(TAG, "Command: cmd_id=0x%04X seq=%u payload_len=%u",
-             cmd_id, header.seq, (unsigned)cmd_payload_len);
+static uint32_t client_gen_of(uint16_t conn_handle)
+{
+    taskENTER_CRITICAL(&s_clients_lock);
+    ble_client_t *c = client_by_conn_locked(conn_handle);
+    uint32_t gen = c ? c->gen : 0;
+    taskEXIT_CRITICAL(&s_clients_lock);
+    return gen;
+}
 
-    /* Signal activity to reset lazy polling timer (but NOT for KEEPALIVE,
-     * which is sent automatically and shouldn't prevent idle timeout) */
-    if (cmd_id != CMD_KEEPALIVE) {
-        pid_controller_signal_activity();
+static int client_count(void)
+{
+    int n = 0;
+    taskENTER_CRITICAL(&s_clients_lock);
+    for (int i = 0; i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+        n += s_clients[i].gen != 0;
     }
+    taskEXIT_CRITICAL(&s_clients_lock);
+    return n;
+}
 
-    switch (cmd_id) {
-        case CMD_OPEN_SESSION: {
-            if (cmd_payload_len < sizeof(wire_cmd_open_session_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t client_nonce = cmd_payload[0] |
-                                    ((uint32_t)cmd_payload[1] << 8) |
-                                    ((uint32_t)cmd_payload[2] << 16) |
-                                    ((uint32_t)cmd_payload[3] << 24);
-
-            uint32_t session_id;
-            uint16_t lease_ms;
-            esp_err_t err = session_mgr_open(client_nonce, &session_id, &lease_ms);
-
-            if (err == ESP_OK) {
-                /* Build ACK with session_id + lease_ms */
-                uint8_t opt_data[6];
-                opt_data[0] = session_id & 0xFF;
-                opt_data[1] = (session_id >> 8) & 0xFF;
-                opt_data[2] = (session_id >> 16) & 0xFF;
-                opt_data[3] = (session_id >> 24) & 0xFF;
-                opt_data[4] = lease_ms & 0xFF;
-                opt_data[5] = (lease_ms >> 8) & 0xFF;
-
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, opt_data, sizeof(opt_data));
-                ESP_LOGI(TAG, "OPEN_SESSION OK: session=0x%08lx lease=%ums",
-                         (unsigned long)session_id, lease_ms);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_BUSY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_KEEPALIVE: {
-            if (cmd_payload_len < sizeof(wire_cmd_keepalive_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-
-            esp_err_t err = session_mgr_keepalive(session_id);
-
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-                ESP_LOGW(TAG, "KEEPALIVE rejected: invalid session");
-            }
-            break;
-        }
-
-        case CMD_START_RUN: {
-            if (cmd_payload_len < 5) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-            uint8_t run_mode = cmd_payload[4];
-
-            ESP_LOGI(TAG, "START_RUN: session=0x%08lx mode=%u",
-                     (unsigned long)session_id, run_mode);
-
-            /* Use machine state manager to handle the transition */
-            esp_err_t err = machine_state_start_run(session_id, run_mode, 0, 0);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-                ESP_LOGW(TAG, "START_RUN rejected: invalid session");
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-                ESP_LOGW(TAG, "START_RUN rejected: not in IDLE state");
-            } else if (err == ESP_ERR_NOT_ALLOWED) {
-                uint8_t interlocks = machine_state_get_interlocks();
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0002, &interlocks, 1);
-                ESP_LOGW(TAG, "START_RUN rejected: interlocks=0x%02X", interlocks);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_STOP_RUN: {
-            if (cmd_payload_len < 5) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-            uint8_t stop_mode = cmd_payload[4];
-
-            ESP_LOGI(TAG, "STOP_RUN: session=0x%08lx mode=%u",
-                     (unsigned long)session_id, stop_mode);
-
-            esp_err_t err = machine_state_stop_run(session_id, stop_mode);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_PAUSE_RUN: {
-            /* Payload: session_id (u32), pause_mode (u8) */
-            if (cmd_payload_len < 5) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-            uint8_t pause_mode = cmd_payload[4];
-
-            ESP_LOGI(TAG, "PAUSE_RUN: session=0x%08lx mode=%u",
-                     (unsigned long)session_id, pause_mode);
-
-            esp_err_t err = machine_state_pause_run(session_id, pause_mode);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_RESUME_RUN: {
-            /* Payload: session_id (u32) */
-            if (cmd_payload_len < 4) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-
-            ESP_LOGI(TAG, "RESUME_RUN: session=0x%08lx", (unsigned long)session_id);
-
-            esp_err_t err = machine_state_resume_run(session_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else if (err == ESP_ERR_NOT_ALLOWED) {
-                /* Return interlock info - door open or other safety issue */
-                uint8_t interlocks = machine_state_get_interlocks();
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0002, &interlocks, 1);
-                ESP_LOGW(TAG, "RESUME_RUN rejected: interlocks=0x%02X", interlocks);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_ENABLE_SERVICE_MODE: {
-            if (cmd_payload_len < 4) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-
-            ESP_LOGI(TAG, "ENABLE_SERVICE_MODE: session=0x%08lx", (unsigned long)session_id);
-
-            esp_err_t err = machine_state_enter_service(session_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_DISABLE_SERVICE_MODE: {
-            if (cmd_payload_len < 4) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-
-            ESP_LOGI(TAG, "DISABLE_SERVICE_MODE: session=0x%08lx", (unsigned long)session_id);
-
-            esp_err_t err = machine_state_exit_service(session_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_CLEAR_ESTOP: {
-            if (cmd_payload_len < 4) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-
-            ESP_LOGI(TAG, "CLEAR_ESTOP: session=0x%08lx", (unsigned long)session_id);
-
-            esp_err_t err = machine_state_clear_estop(session_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else {
-                /* E-stop still active */
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0x0003, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_CLEAR_LATCHED_ALARMS: {
-            if (cmd_payload_len < 4) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint32_t session_id = cmd_payload[0] |
-                                  ((uint32_t)cmd_payload[1] << 8) |
-                                  ((uint32_t)cmd_payload[2] << 16) |
-                                  ((uint32_t)cmd_payload[3] << 24);
-
-            ESP_LOGI(TAG, "CLEAR_LATCHED_ALARMS: session=0x%08lx", (unsigned long)session_id);
-
-            esp_err_t err = machine_state_clear_fault(session_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0001, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_SET_RELAY: {
-            /* Payload: relay_index (u8), state (u8) */
-            if (cmd_payload_len < 2) {
-                ESP_LOGW(TAG, "SET_RELAY: payload too short (%u bytes)", (unsigned)cmd_payload_len);
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t relay_index = cmd_payload[0];
-            uint8_t state = cmd_payload[1];
-
-            ESP_LOGI(TAG, "SET_RELAY: relay_index=%u state=%u", relay_index, state);
-
-            /* Validate relay_index is 1-8 */
-            if (relay_index < 1 || relay_index > 8) {
-                ESP_LOGW(TAG, "SET_RELAY: invalid relay_index %u (must be 1-8)", relay_index);
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            /* Validate state is 0, 1, or 2 */
-            if (state > 2) {
-                ESP_LOGW(TAG, "SET_RELAY: invalid state %u (must be 0=OFF, 1=ON, 2=TOGGLE)", state);
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            /* Control hardware relay via TCA9554 I/O expander */
-            esp_err_t relay_err = relay_ctrl_set(relay_index, state);
-            if (relay_err != ESP_OK) {
-                ESP_LOGE(TAG, "SET_RELAY: hardware control failed: %s", esp_err_to_name(relay_err));
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
-                break;
-            }
-
-            /* Update telemetry to match hardware state */
-            uint8_t ro_bits = relay_ctrl_get_state();
-            telemetry_set_ro_bits(ro_bits);
-
-            uint8_t bit_mask = (1 << (relay_index - 1));
-            ESP_LOGI(TAG, "SET_RELAY OK: relay %u -> %s (ro_bits=0x%02X)",
-                     relay_index,
-                     (ro_bits & bit_mask) ? "ON" : "OFF",
-                     ro_bits);
-
-            send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            break;
-        }
-
-        case CMD_SET_RELAY_MASK: {
-            /* Payload: mask (u8), values (u8) */
-            if (cmd_payload_len < 2) {
-                ESP_LOGW(TAG, "SET_RELAY_MASK: payload too short (%u bytes)", (unsigned)cmd_payload_len);
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t mask = cmd_payload[0];
-            uint8_t values = cmd_payload[1];
-
-            ESP_LOGI(TAG, "SET_RELAY_MASK: mask=0x%02X values=0x%02X", mask, values);
-
-            /* Validate mask is non-zero */
-            if (mask == 0) {
-                ESP_LOGW(TAG, "SET_RELAY_MASK: mask is zero (no channels affected)");
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            /* Get current state before change for logging */
-            uint8_t old_ro_bits = relay_ctrl_get_state();
-
-            /* Control hardware relays via TCA9554 I/O expander */
-            esp_err_t relay_err = relay_ctrl_set_mask(mask, values);
-            if (relay_err != ESP_OK) {
-                ESP_LOGE(TAG, "SET_RELAY_MASK: hardware control failed: %s", esp_err_to_name(relay_err));
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
-                break;
-            }
-
-            /* Update telemetry to match hardware state */
-            uint8_t new_ro_bits = relay_ctrl_get_state();
-            telemetry_set_ro_bits(new_ro_bits);
-
-            ESP_LOGI(TAG, "SET_RELAY_MASK OK: ro_bits 0x%02X -> 0x%02X (mask=0x%02X values=0x%02X)",
-                     old_ro_bits, new_ro_bits, mask, values);
-
-            send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            break;
-        }
-
-        /* ===== PID Controller Commands ===== */
-
-        case CMD_SET_SV: {
-            /* Payload: controller_id (u8), sv_x10 (i16) */
-            if (cmd_payload_len < sizeof(wire_cmd_set_sv_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-            int16_t sv_x10 = (int16_t)(cmd_payload[1] | ((uint16_t)cmd_payload[2] << 8));
-            float sv_celsius = sv_x10 / 10.0f;
-
-            ESP_LOGI(TAG, "SET_SV: controller=%u sv=%.1f C", ctrl_id, sv_celsius);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            esp_err_t err = pid_controller_set_sv(ctrl_id, sv_celsius);
-            if (err == ESP_OK) {
-                /* Force a poll to update cached data */
-                pid_controller_force_poll(ctrl_id);
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_SET_MODE: {
-            /* Payload: controller_id (u8), mode (u8) */
-            if (cmd_payload_len < sizeof(wire_cmd_set_mode_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-            uint8_t mode = cmd_payload[1];
-
-            ESP_LOGI(TAG, "SET_MODE: controller=%u mode=%u", ctrl_id, mode);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            /* Safety gate check for enabling AUTO mode */
-            if (mode == CTRL_MODE_AUTO) {
-                int8_t blocking_gate = -1;
-                if (!safety_gate_can_enable_pid(ctrl_id, &blocking_gate)) {
-                    ESP_LOGW(TAG, "SET_MODE(AUTO) rejected: gate %d blocking for PID %u",
-                             blocking_gate, ctrl_id);
-                    /* Return which gate is blocking in the detail field */
-                    uint16_t detail = (blocking_gate >= 0) ? (uint16_t)blocking_gate : 0;
-                    send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, detail, NULL, 0);
-                    break;
-                }
-            }
-
-            esp_err_t err = pid_controller_set_mode(ctrl_id, mode);
-            if (err == ESP_OK) {
-                pid_controller_force_poll(ctrl_id);
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_REQUEST_PV_SV_REFRESH: {
-            /* Payload: controller_id (u8) */
-            if (cmd_payload_len < 1) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-
-            ESP_LOGI(TAG, "REQUEST_PV_SV_REFRESH: controller=%u", ctrl_id);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            esp_err_t err = pid_controller_force_poll(ctrl_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_NOT_FOUND) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_SET_PID_PARAMS: {
-            /* Payload: controller_id (u8), p_gain_x10 (i16), i_time (u16), d_time (u16) */
-            if (cmd_payload_len < sizeof(wire_cmd_set_pid_params_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-            int16_t p_x10 = (int16_t)(cmd_payload[1] | ((uint16_t)cmd_payload[2] << 8));
-            uint16_t i_time = cmd_payload[3] | ((uint16_t)cmd_payload[4] << 8);
-            uint16_t d_time = cmd_payload[5] | ((uint16_t)cmd_payload[6] << 8);
-            float p_gain = p_x10 / 10.0f;
-
-            ESP_LOGI(TAG, "SET_PID_PARAMS: controller=%u P=%.1f I=%u D=%u",
-                     ctrl_id, p_gain, i_time, d_time);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            esp_err_t err = pid_controller_write_params(ctrl_id, p_gain, i_time, d_time);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_READ_PID_PARAMS: {
-            /* Payload: controller_id (u8) */
-            if (cmd_payload_len < 1) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-
-            ESP_LOGI(TAG, "READ_PID_PARAMS: controller=%u", ctrl_id);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            float p_gain;
-            uint16_t i_time, d_time;
-            esp_err_t err = pid_controller_read_params(ctrl_id, &p_gain, &i_time, &d_time);
-
-            if (err == ESP_OK) {
-                wire_ack_pid_params_t params;
-                params.controller_id = ctrl_id;
-                params.p_gain_x10 = (int16_t)(p_gain * 10.0f + 0.5f);
-                params.i_time = i_time;
-                params.d_time = d_time;
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0,
-                         (const uint8_t *)&params, sizeof(params));
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_START_AUTOTUNE: {
-            /* Payload: controller_id (u8) */
-            if (cmd_payload_len < sizeof(wire_cmd_autotune_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-
-            ESP_LOGI(TAG, "START_AUTOTUNE: controller=%u", ctrl_id);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            esp_err_t err = pid_controller_start_autotune(ctrl_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_STOP_AUTOTUNE: {
-            /* Payload: controller_id (u8) */
-            if (cmd_payload_len < sizeof(wire_cmd_autotune_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-
-            ESP_LOGI(TAG, "STOP_AUTOTUNE: controller=%u", ctrl_id);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            esp_err_t err = pid_controller_stop_autotune(ctrl_id);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_SET_ALARM_LIMITS: {
-            /* Payload: controller_id (u8), alarm1_x10 (i16), alarm2_x10 (i16) */
-            if (cmd_payload_len < sizeof(wire_cmd_set_alarm_limits_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-            int16_t al1_x10 = (int16_t)(cmd_payload[1] | ((uint16_t)cmd_payload[2] << 8));
-            int16_t al2_x10 = (int16_t)(cmd_payload[3] | ((uint16_t)cmd_payload[4] << 8));
-            float al1 = al1_x10 / 10.0f;
-            float al2 = al2_x10 / 10.0f;
-
-            ESP_LOGI(TAG, "SET_ALARM_LIMITS: controller=%u AL1=%.1f AL2=%.1f",
-                     ctrl_id, al1, al2);
-
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
-
-            esp_err_t err = pid_controller_set_alarm_limits(ctrl_id, al1, al2);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
-        }
-
-        case CMD_READ_ALARM_LIMITS: {
-            /* Payload: controller_id (u8) */
-            if (cmd_payload_len < 1) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t ctrl_id = cmd_payload[0];
-
-            ESP_LOGI(TAG, "READ_ALARM_LIMITS: controller=%u", ctrl_id);
+/* Writes from this client are limited to what an observer may do */
+static bool conn_is_observer(uint16_t conn_handle)
+{
+    taskENTER_CRITICAL(&s_clients_lock);
+    ble_client_t *c = client_by_conn_locked(conn_handle);
+    uint32_t session_id = c ? c->session_id : 0;
+    taskEXIT_CRITICAL(&s_clients_lock);
+    return ble_cmd_is_observer(session_id);
+}
 
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
+/* Telemetry is encoded once for every subscriber, so it uses the lowest
+ * encoding any connected client negotiated; one that has not negotiated
+ * yet counts as TELEMETRY_SNAPSHOT. Changing it forces a keyframe. */
+static void update_telemetry_version(void)
+{
+    uint8_t ver = WIRE_TELEMETRY_VER_MAX;
+    bool any = false;
 
-            float al1, al2;
-            esp_err_t err = pid_controller_read_alarm_limits(ctrl_id, &al1, &al2);
-
-            if (err == ESP_OK) {
-                wire_ack_alarm_limits_t limits;
-                limits.controller_id = ctrl_id;
-                limits.alarm1_x10 = (int16_t)(al1 * 10.0f + 0.5f);
-                limits.alarm2_x10 = (int16_t)(al2 * 10.0f + 0.5f);
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0,
-                         (const uint8_t *)&limits, sizeof(limits));
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
+    taskENTER_CRITICAL(&s_clients_lock);
+    for (int i = 0; i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+        if (s_clients[i].gen != 0) {
+            any = true;
+            if (s_clients[i].telemetry_ver < ver) {
+                ver = s_clients[i].telemetry_ver;
             }
-            break;
         }
+    }
+    taskEXIT_CRITICAL(&s_clients_lock);
 
-        /* ===== Generic Register Commands ===== */
+    if (!any) {
+        ver = WIRE_TELEMETRY_VER_SNAPSHOT;
+    }
+    if (ver != telemetry_get_version()) {
+        telemetry_set_version(ver);
+    }
+}
 
-        case CMD_READ_REGISTERS: {
-            /* Payload: controller_id (u8), start_address (u16 LE), count (u8) */
-            if (cmd_payload_len < sizeof(wire_cmd_read_registers_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
+/* GATT characteristic access callback */
+static int gatt_chr_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                              struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)arg;
 
-            uint8_t ctrl_id = cmd_payload[0];
-            uint16_t start_addr = cmd_payload[1] | ((uint16_t)cmd_payload[2] << 8);
-            uint8_t count = cmd_payload[3];
+    if (attr_handle == s_device_info_handle) {
+        if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+            uint8_t info[sizeof(device_info_data) + BLE_LINK_INFO_WIRE_SIZE];
+            memcpy(info, device_info_data, sizeof(device_info_data));
+            size_t len = sizeof(device_info_data) +
+                         ble_link_write_info(&info[sizeof(device_info_data)],
+                                             sizeof(info) - sizeof(device_info_data));
 
-            ESP_LOGI(TAG, "READ_REGISTERS: controller=%u start=%u count=%u",
-                     ctrl_id, start_addr, count);
+            int rc = os_mbuf_append(ctxt->om, info, len);
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+    }
+    else if (attr_handle == s_command_rx_handle) {
+        if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
+            uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+            uint8_t buf[WIRE_MAX_FRAME_SIZE];
 
-            /* Validate controller_id */
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
+            if (len > sizeof(buf)) {
+                ESP_LOGW(TAG, "Command too large: %u bytes", len);
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             }
 
-            /* Validate count (1-16) */
-            if (count == 0 || count > 16) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
+            int rc = ble_hs_mbuf_to_flat(ctxt->om, buf, len, NULL);
+            if (rc != 0) {
+                return BLE_ATT_ERR_UNLIKELY;
             }
 
-            /* Read registers */
-            uint16_t values[16];
-            esp_err_t err = pid_controller_read_registers(ctrl_id, start_addr, count, values);
-
-            if (err == ESP_OK) {
-                /* Build response: header (4 bytes) + values (2*count bytes) */
-                uint8_t ack_data[4 + 32]; /* max 4 + 16*2 = 36 bytes */
-                ack_data[0] = ctrl_id;
-                ack_data[1] = start_addr & 0xFF;
-                ack_data[2] = (start_addr >> 8) & 0xFF;
-                ack_data[3] = count;
-                for (int i = 0; i < count; i++) {
-                    ack_data[4 + i*2] = values[i] & 0xFF;
-                    ack_data[4 + i*2 + 1] = (values[i] >> 8) & 0xFF;
-                }
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0,
-                         ack_data, 4 + count * 2);
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
+            enqueue_command(conn_handle, buf, len);
+            return 0;
         }
-
-        case CMD_WRITE_REGISTER: {
-            /* Payload: controller_id (u8), address (u16 LE), value (u16 LE) */
-            if (cmd_payload_len < sizeof(wire_cmd_write_register_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
+    }
+    else if (attr_handle == s_bulk_gateway_handle) {
+        if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
+            /* Inbound objects (recipes) change the machine: controller only */
+            if (conn_is_observer(conn_handle)) {
+                return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
             }
 
-            uint8_t ctrl_id = cmd_payload[0];
-            uint16_t address = cmd_payload[1] | ((uint16_t)cmd_payload[2] << 8);
-            uint16_t value = cmd_payload[3] | ((uint16_t)cmd_payload[4] << 8);
-
-            ESP_LOGI(TAG, "WRITE_REGISTER: controller=%u addr=%u value=0x%04X",
-                     ctrl_id, address, value);
+            uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+            uint8_t buf[WIRE_MAX_FRAME_SIZE];
 
-            /* Validate controller_id */
-            if (ctrl_id < 1 || ctrl_id > PID_MAX_CONTROLLERS) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
+            if (len > sizeof(buf)) {
+                ESP_LOGW(TAG, "Bulk frame too large: %u bytes", len);
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             }
 
-            /* Protect RS-485 communication registers from writes */
-            if (address >= 49 && address <= 51) {
-                ESP_LOGW(TAG, "WRITE_REGISTER: protected register %u", address);
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
+            int rc = ble_hs_mbuf_to_flat(ctxt->om, buf, len, NULL);
+            if (rc != 0) {
+                return BLE_ATT_ERR_UNLIKELY;
             }
 
-            /* Write register with verification */
-            uint16_t verified_value = 0;
-            esp_err_t err = pid_controller_write_register(ctrl_id, address, value, &verified_value);
-
-            if (err == ESP_OK) {
-                /* Build response with verified value */
-                wire_ack_write_register_t ack;
-                ack.controller_id = ctrl_id;
-                ack.address = address;
-                ack.value = verified_value;
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0,
-                         (const uint8_t *)&ack, sizeof(ack));
-            } else if (err == ESP_ERR_INVALID_STATE) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_NOT_READY, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_RESPONSE) {
-                /* Write succeeded but verification failed - return HW_FAULT with the actual value */
-                wire_ack_write_register_t ack;
-                ack.controller_id = ctrl_id;
-                ack.address = address;
-                ack.value = verified_value;
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0,
-                         (const uint8_t *)&ack, sizeof(ack));
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_TIMEOUT, 0x0004, NULL, 0);
-            }
-            break;
+            ble_bulk_on_write(conn_handle, attr_handle, buf, len);
+            return 0;
         }
+    }
 
-        /* ===== Configuration Commands ===== */
-
-        case CMD_SET_IDLE_TIMEOUT: {
-            /* Payload: timeout_minutes (u8) */
-            if (cmd_payload_len < 1) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
-
-            uint8_t timeout_minutes = cmd_payload[0];
-
-            ESP_LOGI(TAG, "SET_IDLE_TIMEOUT: %u minutes", timeout_minutes);
-
-            esp_err_t err = pid_controller_set_idle_timeout(timeout_minutes);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
-            }
-            break;
-        }
+    return 0;
+}
 
-        case CMD_GET_IDLE_TIMEOUT: {
-            /* No payload required */
-            ESP_LOGI(TAG, "GET_IDLE_TIMEOUT");
+/* ===== Command pipeline ===== */
 
-            uint8_t timeout_minutes = pid_controller_get_idle_timeout();
-            send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, &timeout_minutes, 1);
-            break;
-        }
+/* Queue a command write for the worker. Runs on the NimBLE host task, so the
+ * write completes without waiting for execution and the app can keep up to
+ * CONFIG_BLE_GATT_CMD_WINDOW commands in flight. */
+static void enqueue_command(uint16_t conn_handle, const uint8_t *data, size_t len)
+{
+    cmd_item_t item;
+    item.conn_gen = client_gen_of(conn_handle);
+    item.conn_handle = conn_handle;
+    item.len = (uint16_t)len;
+    memcpy(item.data, data, len);
 
-        /* ===== Safety Gate Commands ===== */
+    if (xQueueSend(s_cmd_queue, &item, 0) == pdTRUE) {
+        return;
+    }
 
-        case CMD_GET_CAPABILITIES: {
-            /* No payload required */
-            ESP_LOGI(TAG, "GET_CAPABILITIES");
+    /* Window full - reject with BUSY so the app backs off and retries */
+    wire_frame_header_t header;
+    const uint8_t *payload;
+    if (wire_parse_frame(data, len, &header, &payload) &&
+        header.msg_type == MSG_TYPE_COMMAND &&
+        header.payload_len >= sizeof(wire_cmd_header_t)) {
+        uint16_t cmd_id = payload[0] | ((uint16_t)payload[1] << 8);
+        TRACE_LOGW(TRACE_FMT_BLE_CMD_BUSY, header.seq, cmd_id, CONFIG_BLE_GATT_CMD_WINDOW);
+        transmit_ack(item.conn_gen, header.seq, cmd_id, CMD_STATUS_BUSY, 0, NULL, 0);
+    }
+}
 
-            wire_ack_capabilities_t caps;
-            uint8_t cap_array[SUBSYS_MAX];
-            safety_gate_get_all_capabilities(cap_array);
+static void cmd_task(void *arg)
+{
+    (void)arg;
+    static cmd_item_t item;
 
-            caps.pid1_cap = cap_array[SUBSYS_PID1];
-            caps.pid2_cap = cap_array[SUBSYS_PID2];
-            caps.pid3_cap = cap_array[SUBSYS_PID3];
-            caps.di1_cap = cap_array[SUBSYS_DI_ESTOP];
-            caps.di2_cap = cap_array[SUBSYS_DI_DOOR];
-            caps.di3_cap = cap_array[SUBSYS_DI_LN2];
-            caps.di4_cap = cap_array[SUBSYS_DI_MOTOR];
-            caps.reserved = 0;
+    ESP_LOGI(TAG, "Command worker started (window %d, ACK cache %d)",
+             CONFIG_BLE_GATT_CMD_WINDOW, CONFIG_BLE_GATT_CMD_ACK_CACHE_SIZE);
 
-            send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0,
-                     (const uint8_t *)&caps, sizeof(caps));
-            break;
+    while (1) {
+        if (xQueueReceive(s_cmd_queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
         }
 
-        case CMD_SET_CAPABILITY: {
-            /* Payload: subsystem_id (u8), capability (u8) */
-            if (cmd_payload_len < sizeof(wire_cmd_set_capability_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
+        /* Never execute commands left over from a connection that has gone away */
+        if (!client_get(item.conn_gen, NULL)) {
+            TRACE_LOGW(TRACE_FMT_BLE_CMD_STALE, item.len);
+            continue;
+        }
 
-            uint8_t subsys_id = cmd_payload[0];
-            uint8_t capability = cmd_payload[1];
+        handle_command(item.conn_handle, item.conn_gen, item.data, item.len);
+    }
+}
 
-            ESP_LOGI(TAG, "SET_CAPABILITY: subsys=%u cap=%u", subsys_id, capability);
+/* Deferred hex dump of the head of an outgoing mbuf (before it is consumed) */
+static void trace_mbuf_hex(esp_log_level_t level, const struct os_mbuf *om)
+{
+    if (!trace_log_enabled(level, TRACE_FMT_BLE_FRAME_HEX)) {
+        return;
+    }
 
-            /* Validate subsystem_id */
-            if (subsys_id >= SUBSYS_MAX) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
+    uint8_t head[24];
+    size_t len = OS_MBUF_PKTLEN(om);
+    if (len > sizeof(head)) {
+        len = sizeof(head);
+    }
+    os_mbuf_copydata(om, 0, len, head);
+    ble_cmd_trace_frame_hex(level, head, len);
+}
 
-            /* Validate capability level */
-            if (capability > CAP_REQUIRED) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
+/* ===== Machine state commands ===== */
 
-            esp_err_t err = safety_gate_set_capability((subsystem_id_t)subsys_id,
-                                                       (capability_level_t)capability);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                /* Trying to change E-Stop capability */
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0002, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
-            }
-            break;
+/*
+ * The state task owns the state machine, so state commands are posted to it
+ * and ACKed from its reply callback once the transition has been applied.
+ * The ACK cache entry stays pending meanwhile; tag carries seq | cmd_id << 16
+ * and ctx the connection generation.
+ */
+static void state_cmd_reply(const machine_state_cmd_t *cmd, const machine_state_reply_t *reply)
+{
+    uint16_t seq = (uint16_t)(cmd->tag & 0xFFFF);
+    uint16_t cmd_id = (uint16_t)(cmd->tag >> 16);
+    uint32_t conn_gen = (uint32_t)(uintptr_t)cmd->ctx;
+    uint8_t status;
+    uint16_t detail = 0;
+    const uint8_t *data = NULL;
+    size_t data_len = 0;
+
+    switch (reply->err) {
+    case ESP_OK:
+        status = CMD_STATUS_OK;
+        break;
+    case ESP_ERR_INVALID_ARG:
+        status = CMD_STATUS_REJECTED_POLICY;
+        detail = 0x0001;                        /* Invalid session */
+        break;
+    case ESP_ERR_NOT_ALLOWED:
+        /* Return interlock info - door open or other safety issue */
+        status = CMD_STATUS_REJECTED_POLICY;
+        detail = 0x0002;
+        data = &reply->interlocks;
+        data_len = 1;
+        ESP_LOGW(TAG, "Command 0x%04X rejected: interlocks=0x%02X", cmd_id, reply->interlocks);
+        break;
+    case ESP_ERR_NOT_FOUND:
+    case ESP_ERR_NOT_SUPPORTED:
+        status = CMD_STATUS_INVALID_ARGS;       /* Recipe slot empty / unusable */
+        break;
+    case ESP_ERR_INVALID_STATE:
+        status = CMD_STATUS_NOT_READY;
+        if (cmd->op == MACHINE_STATE_CMD_CLEAR_ESTOP) {
+            detail = 0x0003;                    /* E-stop still active */
         }
+        break;
+    default:
+        status = (cmd->op == MACHINE_STATE_CMD_START_RUN ||
+                  cmd->op == MACHINE_STATE_CMD_START_RECIPE)
+                 ? CMD_STATUS_HW_FAULT : CMD_STATUS_NOT_READY;
+        break;
+    }
 
-        case CMD_GET_SAFETY_GATES: {
-            /* No payload required */
-            ESP_LOGI(TAG, "GET_SAFETY_GATES");
-
-            wire_ack_safety_gates_t gates;
-            gates.gate_enable = safety_gate_get_enable_mask();
-            gates.gate_status = safety_gate_get_status_mask();
+    if (!client_get(conn_gen, NULL)) {
+        TRACE_LOGW(TRACE_FMT_BLE_ACK_STALE, seq, cmd_id);
+        return;
+    }
+    ble_cmd_cache_store_ack(conn_gen, seq, cmd_id, status, detail, data, data_len);
+    transmit_ack(conn_gen, seq, cmd_id, status, detail, data, data_len);
+}
 
-            send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0,
-                     (const uint8_t *)&gates, sizeof(gates));
-            break;
-        }
+/* Worker: post a decoded state command; its ACK follows from the state task */
+static void post_state_cmd(void *ctx, machine_state_cmd_t *cmd, const ble_cmd_t *c)
+{
+    (void)ctx;
+    uint32_t conn_gen = c->conn_gen;
+    uint16_t seq = c->seq;
+    uint16_t cmd_id = c->cmd_id;
+
+    cmd->reply = state_cmd_reply;
+    cmd->tag = seq | ((uint32_t)cmd_id << 16);
+    cmd->ctx = (void *)(uintptr_t)conn_gen;
+
+    esp_err_t err = machine_state_post(cmd);
+    if (err != ESP_OK) {
+        /* Not cached: a retransmit should execute, not replay BUSY */
+        transmit_ack(conn_gen, seq, cmd_id,
+                     (err == ESP_ERR_NO_MEM) ? CMD_STATUS_BUSY : CMD_STATUS_NOT_READY, 0, NULL, 0);
+        return;
+    }
 
-        case CMD_SET_SAFETY_GATE: {
-            /* Payload: gate_id (u8), enabled (u8) */
-            if (cmd_payload_len < sizeof(wire_cmd_set_safety_gate_t)) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-                break;
-            }
+    /* If the reply has already run it stored the ACK and this is a no-op */
+    ble_cmd_cache_defer(conn_gen, seq, cmd_id);
+}
 
-            uint8_t gate_id = cmd_payload[0];
-            uint8_t enabled = cmd_payload[1];
+/* ===== Dispatch environment ===== */
 
-            ESP_LOGI(TAG, "SET_SAFETY_GATE: gate=%u enabled=%u", gate_id, enabled);
+static void session_opened(void *ctx, uint32_t conn_gen, uint32_t session_id,
+                           uint8_t telemetry_ver)
+{
+    (void)ctx;
 
-            /* Validate gate_id */
-            if (gate_id >= GATE_MAX) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0x0005, NULL, 0);
-                break;
-            }
+    taskENTER_CRITICAL(&s_clients_lock);
+    ble_client_t *c = client_by_gen_locked(conn_gen);
+    if (c != NULL) {
+        c->session_id = session_id;
+        c->telemetry_ver = telemetry_ver;
+    }
+    taskEXIT_CRITICAL(&s_clients_lock);
+    update_telemetry_version();
+}
 
-            esp_err_t err = safety_gate_set_enabled((gate_id_t)gate_id, enabled != 0);
-            if (err == ESP_OK) {
-                send_ack(header.seq, cmd_id, CMD_STATUS_OK, 0, NULL, 0);
-            } else if (err == ESP_ERR_INVALID_ARG) {
-                /* Trying to bypass E-Stop gate */
-                send_ack(header.seq, cmd_id, CMD_STATUS_REJECTED_POLICY, 0x0002, NULL, 0);
-            } else {
-                send_ack(header.seq, cmd_id, CMD_STATUS_HW_FAULT, 0, NULL, 0);
-            }
-            break;
-        }
+static uint16_t att_mtu(void *ctx, uint16_t conn_handle)
+{
+    (void)ctx;
+    return ble_att_mtu(conn_handle);
+}
 
-        default:
-            ESP_LOGW(TAG, "Unknown command: 0x%04X", cmd_id);
-            send_ack(header.seq, cmd_id, CMD_STATUS_INVALID_ARGS, 0, NULL, 0);
-            break;
-    }
+static esp_err_t start_benchmark(void *ctx, const ble_cmd_t *c, uint32_t total_bytes,
+                                 uint8_t rtt_samples)
+{
+    (void)ctx;
+    return ble_link_start_benchmark(c->conn_handle, s_events_acks_handle, c->events_indicate,
+                                    total_bytes, rtt_samples);
 }
 
-/* Send command ACK */
-static void send_ack(uint16_t acked_seq, uint16_t cmd_id, uint8_t status, uint16_t detail,
-                     const uint8_t *opt_data, size_t opt_len)
+static const ble_cmd_env_t s_cmd_env = {
+    .send_ack = send_ack,
+    .post_state_cmd = post_state_cmd,
+    .session_opened = session_opened,
+    .att_mtu = att_mtu,
+    .start_benchmark = start_benchmark,
+    .ctx = NULL,
+};
+
+/* Handle incoming command (command worker task) */
+static void handle_command(uint16_t conn_handle, uint32_t conn_gen,
+                           const uint8_t *data, size_t len)
 {
-    if (s_conn_handle == BLE_HS_CONN_HANDLE_NONE) {
-        ESP_LOGW(TAG, "send_ack: no connection");
+    ble_cmd_t cmd;
+    if (!ble_cmd_parse(data, len, &cmd)) {
         return;
     }
 
-    uint8_t frame[WIRE_MAX_FRAME_SIZE];
-    size_t frame_len = wire_build_cmd_ack(frame, sizeof(frame), s_tx_seq++,
-                                          acked_seq, cmd_id, status, detail,
-                                          opt_data, opt_len);
+    /* Retransmit of a command we already executed: replay its ACK, or drop
+     * it if the ACK is still to come from the state task */
+    uint16_t frame_crc = data[len - 2] | ((uint16_t)data[len - 1] << 8);
+    ble_cmd_cache_entry_t cached;
+    switch (ble_cmd_cache_find(conn_gen, cmd.seq, cmd.cmd_id, frame_crc, &cached)) {
+    case BLE_CMD_CACHE_ACKED:
+        TRACE_LOGI(TRACE_FMT_BLE_CMD_REPLAY, cmd.seq, cmd.cmd_id, cached.status);
+        transmit_ack(conn_gen, cmd.seq, cmd.cmd_id, cached.status, cached.detail,
+                     cached.data, cached.data_len);
+        return;
+    case BLE_CMD_CACHE_PENDING:
+        TRACE_LOGI(TRACE_FMT_BLE_CMD_PENDING, cmd.seq, cmd.cmd_id);
+        return;
+    default:
+        break;
+    }
+    s_cmd_conn_gen = conn_gen;
+    ble_cmd_cache_begin(conn_gen, cmd.seq, cmd.cmd_id, frame_crc);
 
-    if (frame_len == 0) {
-        ESP_LOGE(TAG, "Failed to build ACK frame");
+    ble_client_t client;
+    if (!client_get(conn_gen, &client)) {
         return;
     }
+    cmd.conn_handle = conn_handle;
+    cmd.conn_gen = conn_gen;
+    cmd.session_id = client.session_id;
+    cmd.events_indicate = client.events_indicate;
+
+    ble_cmd_dispatch(&s_cmd_env, &cmd);
+}
+
+/* Send command ACK for the command the worker is executing */
+static void send_ack(void *ctx, uint16_t acked_seq, uint16_t cmd_id, uint8_t status,
+                     uint16_t detail, const uint8_t *opt_data, size_t opt_len)
+{
+    (void)ctx;
 
-    /* Log the frame being sent */
-    ESP_LOGI(TAG, "Sending ACK: acked_seq=%u cmd_id=0x%04X status=%u len=%u",
-             acked_seq, cmd_id, status, (unsigned)frame_len);
-    ESP_LOG_BUFFER_HEX_LEVEL(TAG, frame, frame_len, ESP_LOG_DEBUG);
+    /* Remember what the worker answered so a retransmit can be replayed */
+    ble_cmd_cache_store_ack(s_cmd_conn_gen, acked_seq, cmd_id, status, detail,
+                            opt_data, opt_len);
 
-    /* Check subscription status */
-    bool can_indicate = s_events_indicate_subscribed;
-    bool can_notify = s_events_notify_subscribed;
+    transmit_ack(s_cmd_conn_gen, acked_seq, cmd_id, status, detail, opt_data, opt_len);
+}
 
-    if (!can_indicate && !can_notify) {
-        ESP_LOGW(TAG, "Events+Acks not subscribed (indicate=%d notify=%d), sending anyway",
-                 can_indicate, can_notify);
-        /* Try anyway - some BLE stacks allow unsolicited notifications */
+/* Build and send an ACK frame to the client the command came from; any task */
+static void transmit_ack(uint32_t conn_gen, uint16_t acked_seq, uint16_t cmd_id,
+                         uint8_t status, uint16_t detail,
+                         const uint8_t *opt_data, size_t opt_len)
+{
+    ble_client_t client;
+    if (!client_get(conn_gen, &client)) {
+        TRACE_LOGW(TRACE_FMT_BLE_ACK_NO_CONN, acked_seq, cmd_id);
+        return;
     }
 
-    struct os_mbuf *om = ble_hs_mbuf_from_flat(frame, frame_len);
-    if (!om) {
+    /* Build the ACK directly into the outgoing mbuf */
+    wire_writer_t w;
+    if (ble_gatt_frame_begin(&w) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to allocate mbuf for ACK");
         return;
     }
 
+    uint16_t tx_seq = __atomic_fetch_add(&s_tx_seq, 1, __ATOMIC_RELAXED);
+    size_t frame_len = wire_write_cmd_ack(&w, tx_seq, acked_seq, cmd_id, status, detail,
+                                          opt_data, opt_len);
+    if (frame_len == 0) {
+        ESP_LOGE(TAG, "Failed to build ACK frame");
+        ble_gatt_frame_discard(&w);
+        return;
+    }
+
+    /* Check subscription status. Unsubscribed clients are still sent the
+     * ACK - some BLE stacks accept unsolicited notifications. */
+    bool can_indicate = client.events_indicate;
+    struct os_mbuf *om = w.sink_ctx;
+    trace_mbuf_hex(ESP_LOG_DEBUG, om);
+
     /* Prefer indication for critical commands, but fall back to notification */
     bool want_indicate = (cmd_id == CMD_OPEN_SESSION ||
                           cmd_id == CMD_START_RUN ||
                           cmd_id == CMD_STOP_RUN);
 
+    bool use_indicate = want_indicate && can_indicate;
     int rc;
-    if (want_indicate && can_indicate) {
-        rc = ble_gatts_indicate_custom(s_conn_handle, s_events_acks_handle, om);
-        ESP_LOGI(TAG, "Sent ACK via indication: rc=%d", rc);
+    if (use_indicate) {
+        rc = ble_gatts_indicate_custom(client.conn_handle, s_events_acks_handle, om);
     } else {
         /* Use notification (works even without explicit subscription on some stacks) */
-        rc = ble_gatts_notify_custom(s_conn_handle, s_events_acks_handle, om);
-        ESP_LOGI(TAG, "Sent ACK via notification: rc=%d", rc);
+        rc = ble_gatts_notify_custom(client.conn_handle, s_events_acks_handle, om);
+    }
+
+    TRACE_LOGI(TRACE_FMT_BLE_ACK_TX, acked_seq, cmd_id, status, frame_len, use_indicate, rc);
+
+    if (rc != 0) {
+        TRACE_LOGW(TRACE_FMT_BLE_ACK_FAIL, cmd_id, rc);
+    }
+}
+
+static int gap_event_cb(struct ble_gap_event *event, void *arg);
+
+/* Advertise while another client may still connect */
+static void start_advertising(void)
+{
+    if (client_count() >= CONFIG_BLE_GATT_MAX_CLIENTS || ble_gap_adv_active()) {
+        return;
     }
 
+    int rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
+                               &(struct ble_gap_adv_params){
+                                   .conn_mode = BLE_GAP_CONN_MODE_UND,
+                                   .disc_mode = BLE_GAP_DISC_MODE_GEN,
+                               },
+                               gap_event_cb, NULL);
     if (rc != 0) {
-        ESP_LOGW(TAG, "Failed to send ACK: rc=%d (0=OK, 6=not subscribed, 14=no resources)", rc);
+        ESP_LOGE(TAG, "Failed to start advertising: rc=%d", rc);
     }
 }
 
@@ -1177,60 +673,130 @@ static int gap_event_cb(struct ble_gap_event *event, void *arg)
     (void)arg;
 
     switch (event->type) {
-        case BLE_GAP_EVENT_CONNECT:
-            if (event->connect.status == 0) {
-                s_conn_handle = event->connect.conn_handle;
-                ESP_LOGI(TAG, "Client connected: conn_handle=%u", s_conn_handle);
-                /* Update LED to show connected state */
-                status_led_set_state(LED_STATE_CONNECTED_HEALTHY);
-            } else {
+        case BLE_GAP_EVENT_CONNECT: {
+            if (event->connect.status != 0) {
                 ESP_LOGW(TAG, "Connection failed: status=%d", event->connect.status);
-                s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+                start_advertising();
+                break;
+            }
+
+            uint16_t conn = event->connect.conn_handle;
+            ble_client_t *c = NULL;
+            taskENTER_CRITICAL(&s_clients_lock);
+            for (int i = 0; i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+                if (s_clients[i].gen == 0) {
+                    c = &s_clients[i];
+                    /* Never 0, never reused while a stale command can carry it */
+                    if (++s_last_gen == 0) {
+                        s_last_gen = 1;
+                    }
+                    *c = (ble_client_t){
+                        .gen = s_last_gen,
+                        .conn_handle = conn,
+                        .telemetry_ver = WIRE_TELEMETRY_VER_SNAPSHOT,
+                    };
+                    break;
+                }
+            }
+            taskEXIT_CRITICAL(&s_clients_lock);
+
+            if (c == NULL) {
+                /* Advertising stops at the limit, so only a race gets here */
+                ESP_LOGW(TAG, "No client slot for conn_handle=%u", conn);
+                ble_gap_terminate(conn, BLE_ERR_REM_USER_CONN_TERM);
+                break;
+            }
+
+            ESP_LOGI(TAG, "Client connected: conn_handle=%u (%d/%d)", conn,
+                     client_count(), CONFIG_BLE_GATT_MAX_CLIENTS);
+            ble_link_on_connect(conn);
+            update_telemetry_version();
+            /* Update LED to show connected state */
+            if (client_count() == 1) {
+                status_led_set_state(LED_STATE_CONNECTED_HEALTHY);
             }
+            start_advertising();
             break;
+        }
+
+        case BLE_GAP_EVENT_DISCONNECT: {
+            uint16_t conn = event->disconnect.conn.conn_handle;
+            ESP_LOGI(TAG, "Client disconnected: conn_handle=%u reason=%d",
+                     conn, event->disconnect.reason);
+
+            taskENTER_CRITICAL(&s_clients_lock);
+            ble_client_t *c = client_by_conn_locked(conn);
+            if (c != NULL) {
+                c->gen = 0;             /* Its queued commands and pending ACKs go stale */
+            }
+            taskEXIT_CRITICAL(&s_clients_lock);
+
+            ble_link_on_disconnect(conn);
+            ble_bulk_on_disconnect(conn);
 
-        case BLE_GAP_EVENT_DISCONNECT:
-            ESP_LOGI(TAG, "Client disconnected: reason=%d", event->disconnect.reason);
-            s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
-            s_telemetry_subscribed = false;
-            s_events_notify_subscribed = false;
-            s_events_indicate_subscribed = false;
+            /* Its session ends with the link (a controller frees control) */
+            session_mgr_drop_conn(conn);
 
-            /* Force-expire session on disconnect */
-            session_mgr_force_expire();
+            /* Remaining clients may be able to take a richer encoding again */
+            update_telemetry_version();
 
             /* Brief disconnect indication then back to advertising */
-            status_led_set_state(LED_STATE_ERROR_DISCONNECT);
+            if (client_count() == 0) {
+                status_led_set_state(LED_STATE_ERROR_DISCONNECT);
+            }
 
             /* Restart advertising */
-            ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
-                              &(struct ble_gap_adv_params){
-                                  .conn_mode = BLE_GAP_CONN_MODE_UND,
-                                  .disc_mode = BLE_GAP_DISC_MODE_GEN,
-                              },
-                              gap_event_cb, NULL);
+            start_advertising();
             break;
+        }
 
-        case BLE_GAP_EVENT_SUBSCRIBE:
-            ESP_LOGI(TAG, "Subscribe event: attr_handle=%u notify=%d indicate=%d",
+        case BLE_GAP_EVENT_SUBSCRIBE: {
+            ESP_LOGI(TAG, "Subscribe event: conn_handle=%u attr_handle=%u notify=%d indicate=%d",
+                     event->subscribe.conn_handle,
                      event->subscribe.attr_handle,
                      event->subscribe.cur_notify,
                      event->subscribe.cur_indicate);
 
+            bool telemetry_on = false;
+            taskENTER_CRITICAL(&s_clients_lock);
+            ble_client_t *c = client_by_conn_locked(event->subscribe.conn_handle);
+            if (c != NULL && event->subscribe.attr_handle == s_telemetry_handle) {
+                telemetry_on = event->subscribe.cur_notify && !c->telemetry_sub;
+                c->telemetry_sub = event->subscribe.cur_notify;
+            } else if (c != NULL && event->subscribe.attr_handle == s_events_acks_handle) {
+                c->events_notify = event->subscribe.cur_notify;
+                c->events_indicate = event->subscribe.cur_indicate;
+            }
+            taskEXIT_CRITICAL(&s_clients_lock);
+
             if (event->subscribe.attr_handle == s_telemetry_handle) {
-                s_telemetry_subscribed = event->subscribe.cur_notify;
                 ESP_LOGI(TAG, "Telemetry subscription: %s",
-                         s_telemetry_subscribed ? "enabled" : "disabled");
+                         event->subscribe.cur_notify ? "enabled" : "disabled");
+                /* A client joining a compact stream needs full state first */
+                if (telemetry_on) {
+                    telemetry_request_keyframe();
+                }
             } else if (event->subscribe.attr_handle == s_events_acks_handle) {
-                s_events_notify_subscribed = event->subscribe.cur_notify;
-                s_events_indicate_subscribed = event->subscribe.cur_indicate;
                 ESP_LOGI(TAG, "Events/Acks subscription: notify=%d indicate=%d",
-                         s_events_notify_subscribed, s_events_indicate_subscribed);
+                         event->subscribe.cur_notify, event->subscribe.cur_indicate);
+            } else if (event->subscribe.attr_handle == s_bulk_gateway_handle) {
+                ble_bulk_on_subscribe(event->subscribe.conn_handle,
+                                      event->subscribe.attr_handle,
+                                      event->subscribe.cur_notify);
             }
             break;
+        }
 
         case BLE_GAP_EVENT_MTU:
-            ESP_LOGI(TAG, "MTU update: %u", event->mtu.value);
+        case BLE_GAP_EVENT_CONN_UPDATE:
+        case BLE_GAP_EVENT_NOTIFY_TX:
+#ifdef BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+#endif
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+        case BLE_GAP_EVENT_DATA_LEN_CHG:
+#endif
+            ble_link_on_gap_event(event);
             break;
 
         default:
@@ -1327,6 +893,32 @@ esp_err_t ble_gatt_init(void)
     /* Initialize session manager */
     session_mgr_init();
 
+    /* Command pipeline */
+    s_cmd_queue = xQueueCreate(CONFIG_BLE_GATT_CMD_WINDOW, sizeof(cmd_item_t));
+    if (s_cmd_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create command queue");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(cmd_task, "ble_cmd", CMD_TASK_STACK, NULL,
+                    CONFIG_BLE_GATT_CMD_TASK_PRIORITY, &s_cmd_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create command task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Bulk Gateway (fragmented transfers) */
+    esp_err_t err = ble_bulk_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ble_bulk_init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    /* Link tuning state (timers, benchmark) */
+    err = ble_link_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ble_link_init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
     /* Initialize NimBLE */
     int rc = nimble_port_init();
     if (rc != ESP_OK) {
@@ -1362,9 +954,81 @@ esp_err_t ble_gatt_init(void)
     return ESP_OK;
 }
 
+/* ===== Fan-out ===== */
+
+/* One subscriber of Telemetry or Events + Acks */
+typedef struct {
+    uint16_t conn_handle;
+    bool     notify;
+    bool     indicate;
+} fanout_target_t;
+
+/* Subscribers of a characteristic, copied so sending runs without the lock */
+static int collect_targets(uint16_t attr_handle, fanout_target_t out[CONFIG_BLE_GATT_MAX_CLIENTS])
+{
+    int n = 0;
+    taskENTER_CRITICAL(&s_clients_lock);
+    for (int i = 0; i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+        const ble_client_t *c = &s_clients[i];
+        if (c->gen == 0) {
+            continue;
+        }
+        bool notify = (attr_handle == s_telemetry_handle) ? c->telemetry_sub : c->events_notify;
+        bool indicate = (attr_handle == s_telemetry_handle) ? false : c->events_indicate;
+        if (notify || indicate) {
+            out[n++] = (fanout_target_t){ c->conn_handle, notify, indicate };
+        }
+    }
+    taskEXIT_CRITICAL(&s_clients_lock);
+    return n;
+}
+
+/* Send a ready mbuf to every target. The frame is encoded once: each
+ * client but the last gets a duplicate of the chain, the last gets om
+ * itself. NimBLE consumes om in every case. Returns ESP_OK if every target
+ * got it, ESP_ERR_NOT_FINISHED if only some did, ESP_FAIL if none did. */
+static esp_err_t fanout_om(const fanout_target_t *targets, int n, uint16_t attr_handle,
+                           struct os_mbuf *om, bool indicate)
+{
+    int sent = 0;
+
+    for (int i = 0; i < n; i++) {
+        const fanout_target_t *t = &targets[i];
+        struct os_mbuf *copy = (i == n - 1) ? om : os_mbuf_dup(om);
+        if (copy == NULL) {
+            ESP_LOGW(TAG, "No mbuf for conn_handle=%u", t->conn_handle);
+            continue;
+        }
+
+        /* Prefer indication if subscribed and requested, otherwise use notification;
+         * a client subscribed to indications only gets those */
+        int rc;
+        if (t->indicate && (indicate || !t->notify)) {
+            rc = ble_gatts_indicate_custom(t->conn_handle, attr_handle, copy);
+        } else {
+            rc = ble_gatts_notify_custom(t->conn_handle, attr_handle, copy);
+        }
+
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Failed to send %s to conn_handle=%u: rc=%d",
+                     attr_handle == s_telemetry_handle ? "telemetry" : "event",
+                     t->conn_handle, rc);
+        } else {
+            sent++;
+        }
+    }
+
+    if (sent == n) {
+        return ESP_OK;
+    }
+    return sent > 0 ? ESP_ERR_NOT_FINISHED : ESP_FAIL;
+}
+
 esp_err_t ble_gatt_send_telemetry(const uint8_t *data, size_t len)
 {
-    if (s_conn_handle == BLE_HS_CONN_HANDLE_NONE || !s_telemetry_subscribed) {
+    fanout_target_t targets[CONFIG_BLE_GATT_MAX_CLIENTS];
+    int n = collect_targets(s_telemetry_handle, targets);
+    if (n == 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -1373,19 +1037,14 @@ esp_err_t ble_gatt_send_telemetry(const uint8_t *data, size_t len)
         return ESP_ERR_NO_MEM;
     }
 
-    int rc = ble_gatts_notify_custom(s_conn_handle, s_telemetry_handle, om);
-    if (rc != 0) {
-        ESP_LOGW(TAG, "Failed to send telemetry: rc=%d", rc);
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
+    return fanout_om(targets, n, s_telemetry_handle, om, false);
 }
 
 esp_err_t ble_gatt_send_event(const uint8_t *data, size_t len, bool indicate)
 {
-    if (s_conn_handle == BLE_HS_CONN_HANDLE_NONE ||
-        (!s_events_notify_subscribed && !s_events_indicate_subscribed)) {
+    fanout_target_t targets[CONFIG_BLE_GATT_MAX_CLIENTS];
+    int n = collect_targets(s_events_acks_handle, targets);
+    if (n == 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -1394,36 +1053,109 @@ esp_err_t ble_gatt_send_event(const uint8_t *data, size_t len, bool indicate)
         return ESP_ERR_NO_MEM;
     }
 
-    int rc;
-    // Prefer indication if subscribed and requested, otherwise use notification
-    if (indicate && s_events_indicate_subscribed) {
-        rc = ble_gatts_indicate_custom(s_conn_handle, s_events_acks_handle, om);
-    } else if (s_events_notify_subscribed) {
-        rc = ble_gatts_notify_custom(s_conn_handle, s_events_acks_handle, om);
-    } else {
-        // Only indicate subscribed, use that
-        rc = ble_gatts_indicate_custom(s_conn_handle, s_events_acks_handle, om);
-    }
+    return fanout_om(targets, n, s_events_acks_handle, om, indicate);
+}
 
-    if (rc != 0) {
-        ESP_LOGW(TAG, "Failed to send event: rc=%d", rc);
-        return ESP_FAIL;
+/* ===== Zero-copy frames ===== */
+
+static bool mbuf_sink(void *ctx, const uint8_t *data, size_t len)
+{
+    return os_mbuf_append((struct os_mbuf *)ctx, data, len) == 0;
+}
+
+esp_err_t ble_gatt_frame_begin(wire_writer_t *w)
+{
+    struct os_mbuf *om = ble_hs_mbuf_att_pkt();
+    if (!om) {
+        return ESP_ERR_NO_MEM;
     }
 
+    wire_writer_init_sink(w, mbuf_sink, om);
     return ESP_OK;
 }
 
+void ble_gatt_frame_discard(wire_writer_t *w)
+{
+    if (w->sink == mbuf_sink && w->sink_ctx != NULL) {
+        os_mbuf_free_chain((struct os_mbuf *)w->sink_ctx);
+        w->sink_ctx = NULL;
+    }
+}
+
+/* Take the finished mbuf out of the writer, or free it if the frame is bad */
+static struct os_mbuf *frame_take(wire_writer_t *w)
+{
+    struct os_mbuf *om = w->sink_ctx;
+    if (w->sink != mbuf_sink || om == NULL) {
+        return NULL;
+    }
+    if (w->error || w->len == 0) {
+        ble_gatt_frame_discard(w);
+        return NULL;
+    }
+
+    w->sink_ctx = NULL;
+    return om;
+}
+
+esp_err_t ble_gatt_frame_send_telemetry(wire_writer_t *w)
+{
+    fanout_target_t targets[CONFIG_BLE_GATT_MAX_CLIENTS];
+    int n = collect_targets(s_telemetry_handle, targets);
+    if (n == 0) {
+        ble_gatt_frame_discard(w);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct os_mbuf *om = frame_take(w);
+    if (!om) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return fanout_om(targets, n, s_telemetry_handle, om, false);
+}
+
+esp_err_t ble_gatt_frame_send_event(wire_writer_t *w, bool indicate)
+{
+    fanout_target_t targets[CONFIG_BLE_GATT_MAX_CLIENTS];
+    int n = collect_targets(s_events_acks_handle, targets);
+    if (n == 0) {
+        ble_gatt_frame_discard(w);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct os_mbuf *om = frame_take(w);
+    if (!om) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return fanout_om(targets, n, s_events_acks_handle, om, indicate);
+}
+
 bool ble_gatt_is_connected(void)
 {
-    return s_conn_handle != BLE_HS_CONN_HANDLE_NONE;
+    return client_count() > 0;
 }
 
 bool ble_gatt_telemetry_subscribed(void)
 {
-    return s_telemetry_subscribed;
+    fanout_target_t targets[CONFIG_BLE_GATT_MAX_CLIENTS];
+    return collect_targets(s_telemetry_handle, targets) > 0;
 }
 
 uint16_t ble_gatt_get_conn_handle(void)
 {
-    return s_conn_handle;
+    uint16_t conn = BLE_HS_CONN_HANDLE_NONE;
+    uint32_t first_gen = UINT32_MAX;
+
+    /* Longest-standing client */
+    taskENTER_CRITICAL(&s_clients_lock);
+    for (int i = 0; i < CONFIG_BLE_GATT_MAX_CLIENTS; i++) {
+        if (s_clients[i].gen != 0 && s_clients[i].gen < first_gen) {
+            first_gen = s_clients[i].gen;
+            conn = s_clients[i].conn_handle;
+        }
+    }
+    taskEXIT_CRITICAL(&s_clients_lock);
+    return conn;
 }
@@ -0,0 +1,509 @@
+#include "ble_link.h"
+#include "wire_protocol.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "ble_link";
+
+/* Requested LL data length (max octets / max time for 1M PHY) */
+#define LINK_DLE_TX_OCTETS      251
+#define LINK_DLE_TX_TIME_US     2120
+
+/* Benchmark limits */
+#define BENCH_MAX_BYTES         (1024 * 1024)
+#define BENCH_MAX_RTT_SAMPLES   64
+#define BENCH_TASK_STACK        4096
+#define BENCH_TASK_PRIORITY     3
+#define BENCH_TX_WAIT_MS        20      /* Wait for a TX slot when mbufs run out */
+#define BENCH_DRAIN_TIMEOUT_MS  2000    /* Wait for the last notifications to go out */
+#define BENCH_RTT_TIMEOUT_MS    1000    /* Per indication confirmation */
+
+/* Connection parameters per profile */
+static const struct ble_gap_upd_params s_profile_params[BLE_LINK_PROFILE_MAX] = {
+    [BLE_LINK_PROFILE_LOW_LATENCY] = {
+        .itvl_min = 6,                  /* 7.5 ms */
+        .itvl_max = 12,                 /* 15 ms */
+        .latency = 0,
+        .supervision_timeout = 400,     /* 4 s */
+        .min_ce_len = 0,
+        .max_ce_len = 0,
+    },
+    [BLE_LINK_PROFILE_BULK] = {
+        .itvl_min = 24,                 /* 30 ms */
+        .itvl_max = 40,                 /* 50 ms */
+        .latency = 0,
+        .supervision_timeout = 500,     /* 5 s */
+        .min_ce_len = 0,
+        .max_ce_len = 80,               /* Up to the full 50 ms interval (0.625 ms units) */
+    },
+};
+
+static const char *const s_profile_names[BLE_LINK_PROFILE_MAX] = {
+    [BLE_LINK_PROFILE_LOW_LATENCY] = "LOW_LATENCY",
+    [BLE_LINK_PROFILE_BULK]        = "BULK",
+};
+
+/* Link state */
+static uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static ble_link_info_t s_info;
+static ble_link_profile_t s_profile =
+#if CONFIG_BLE_GATT_LINK_PROFILE_BULK
+    BLE_LINK_PROFILE_BULK;
+#else
+    BLE_LINK_PROFILE_LOW_LATENCY;
+#endif
+static esp_timer_handle_t s_apply_timer = NULL;
+
+/* Benchmark state */
+static volatile bool s_bench_running = false;
+static volatile bool s_bench_abort = false;
+static uint16_t s_bench_conn;
+static uint16_t s_bench_attr;
+static bool s_bench_can_indicate;
+static uint32_t s_bench_total;
+static uint8_t s_bench_rtt_samples;
+static uint16_t s_bench_seq = 0;
+static volatile uint32_t s_bench_tx_done = 0;
+static volatile int64_t s_bench_last_tx_us = 0;
+static volatile int64_t s_rtt_done_us = 0;
+static SemaphoreHandle_t s_bench_tx_sem = NULL;
+static SemaphoreHandle_t s_rtt_sem = NULL;
+
+/* ===== Link negotiation ===== */
+
+/* Refresh interval/latency/timeout from the host's connection descriptor */
+static void refresh_conn_params(uint16_t conn_handle)
+{
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(conn_handle, &desc) == 0) {
+        s_info.conn_itvl = desc.conn_itvl;
+        s_info.conn_latency = desc.conn_latency;
+        s_info.supervision_timeout = desc.supervision_timeout;
+    }
+}
+
+/* Issue DLE / PHY / MTU / connection parameter requests for the current profile */
+static void apply_profile(void)
+{
+    uint16_t conn = s_conn_handle;
+    if (conn == BLE_HS_CONN_HANDLE_NONE) {
+        return;
+    }
+
+    int rc;
+
+#if CONFIG_BLE_GATT_LINK_REQUEST_DLE
+    rc = ble_gap_set_data_len(conn, LINK_DLE_TX_OCTETS, LINK_DLE_TX_TIME_US);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "DLE request failed: rc=%d", rc);
+    }
+#endif
+
+#if CONFIG_BLE_GATT_LINK_REQUEST_2M_PHY
+    rc = ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                     BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "2M PHY request failed: rc=%d", rc);
+    }
+#endif
+
+    /* Peripheral-initiated MTU exchange is a no-op if the central already did it */
+    rc = ble_gattc_exchange_mtu(conn, NULL, NULL);
+    if (rc != 0) {
+        ESP_LOGD(TAG, "MTU exchange not started: rc=%d", rc);
+    }
+
+    rc = ble_gap_update_params(conn, &s_profile_params[s_profile]);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Connection parameter update failed: rc=%d", rc);
+    }
+
+    ESP_LOGI(TAG, "Requested %s link profile (itvl %u-%u)",
+             s_profile_names[s_profile],
+             s_profile_params[s_profile].itvl_min, s_profile_params[s_profile].itvl_max);
+}
+
+static void apply_timer_cb(void *arg)
+{
+    (void)arg;
+    apply_profile();
+}
+
+esp_err_t ble_link_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = apply_timer_cb,
+        .name = "ble_link",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_apply_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_bench_tx_sem = xSemaphoreCreateBinary();
+    s_rtt_sem = xSemaphoreCreateBinary();
+    if (s_bench_tx_sem == NULL || s_rtt_sem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(&s_info, 0, sizeof(s_info));
+    s_info.profile = s_profile;
+    return ESP_OK;
+}
+
+void ble_link_on_connect(uint16_t conn_handle)
+{
+    if (s_conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+        int rc = ble_gattc_exchange_mtu(conn_handle, NULL, NULL);
+        if (rc != 0) {
+            ESP_LOGD(TAG, "MTU exchange not started: rc=%d", rc);
+        }
+        return;
+    }
+    s_conn_handle = conn_handle;
+
+    memset(&s_info, 0, sizeof(s_info));
+    s_info.mtu = ble_att_mtu(conn_handle);
+    s_info.tx_phy = 1;
+    s_info.rx_phy = 1;
+    s_info.max_tx_octets = 27;
+    s_info.profile = s_profile;
+    refresh_conn_params(conn_handle);
+
+    if (s_apply_timer != NULL) {
+        esp_timer_stop(s_apply_timer);
+        esp_timer_start_once(s_apply_timer,
+                             (uint64_t)CONFIG_BLE_GATT_LINK_APPLY_DELAY_MS * 1000);
+    }
+}
+
+void ble_link_on_disconnect(uint16_t conn_handle)
+{
+    if (s_bench_running && conn_handle == s_bench_conn) {
+        s_bench_abort = true;
+    }
+    if (conn_handle != s_conn_handle) {
+        return;
+    }
+
+    if (s_apply_timer != NULL) {
+        esp_timer_stop(s_apply_timer);
+    }
+    s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+
+    memset(&s_info, 0, sizeof(s_info));
+    s_info.profile = s_profile;
+}
+
+void ble_link_on_gap_event(const struct ble_gap_event *event)
+{
+    switch (event->type) {
+        case BLE_GAP_EVENT_MTU:
+            if (event->mtu.conn_handle != s_conn_handle) {
+                break;
+            }
+            s_info.mtu = event->mtu.value;
+            ESP_LOGI(TAG, "MTU update: %u", event->mtu.value);
+            break;
+
+        case BLE_GAP_EVENT_CONN_UPDATE:
+            if (event->conn_update.conn_handle != s_conn_handle) {
+                break;
+            }
+            if (event->conn_update.status == 0) {
+                refresh_conn_params(event->conn_update.conn_handle);
+                ESP_LOGI(TAG, "Conn params: itvl=%u (x1.25ms) latency=%u timeout=%u (x10ms)",
+                         s_info.conn_itvl, s_info.conn_latency, s_info.supervision_timeout);
+            } else {
+                ESP_LOGW(TAG, "Conn param update failed: status=%d", event->conn_update.status);
+            }
+            break;
+
+#ifdef BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+            if (event->phy_updated.conn_handle == s_conn_handle &&
+                event->phy_updated.status == 0) {
+                s_info.tx_phy = event->phy_updated.tx_phy;
+                s_info.rx_phy = event->phy_updated.rx_phy;
+                ESP_LOGI(TAG, "PHY update: tx=%u rx=%u", s_info.tx_phy, s_info.rx_phy);
+            }
+            break;
+#endif
+
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+        case BLE_GAP_EVENT_DATA_LEN_CHG:
+            if (event->data_len_chg.conn_handle != s_conn_handle) {
+                break;
+            }
+            s_info.max_tx_octets = event->data_len_chg.max_tx_octets;
+            ESP_LOGI(TAG, "Data length: tx=%u rx=%u octets",
+                     event->data_len_chg.max_tx_octets, event->data_len_chg.max_rx_octets);
+            break;
+#endif
+
+        case BLE_GAP_EVENT_NOTIFY_TX:
+            if (!s_bench_running || event->notify_tx.conn_handle != s_bench_conn ||
+                event->notify_tx.attr_handle != s_bench_attr) {
+                break;
+            }
+            if (event->notify_tx.indication) {
+                /* BLE_HS_EDONE = client confirmed the indication */
+                if (event->notify_tx.status == BLE_HS_EDONE) {
+                    s_rtt_done_us = esp_timer_get_time();
+                    xSemaphoreGive(s_rtt_sem);
+                }
+            } else if (event->notify_tx.status == 0) {
+                s_bench_tx_done++;
+                s_bench_last_tx_us = esp_timer_get_time();
+                xSemaphoreGive(s_bench_tx_sem);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+size_t ble_link_write_info(uint8_t *out, size_t out_size)
+{
+    if (out_size < BLE_LINK_INFO_WIRE_SIZE) {
+        return 0;
+    }
+
+    out[0]  = s_info.mtu & 0xFF;
+    out[1]  = (s_info.mtu >> 8) & 0xFF;
+    out[2]  = s_info.conn_itvl & 0xFF;
+    out[3]  = (s_info.conn_itvl >> 8) & 0xFF;
+    out[4]  = s_info.conn_latency & 0xFF;
+    out[5]  = (s_info.conn_latency >> 8) & 0xFF;
+    out[6]  = s_info.supervision_timeout & 0xFF;
+    out[7]  = (s_info.supervision_timeout >> 8) & 0xFF;
+    out[8]  = s_info.tx_phy;
+    out[9]  = s_info.rx_phy;
+    out[10] = s_info.max_tx_octets & 0xFF;
+    out[11] = (s_info.max_tx_octets >> 8) & 0xFF;
+    out[12] = s_info.profile;
+
+    return BLE_LINK_INFO_WIRE_SIZE;
+}
+
+/* ===== Public link API (declared in ble_gatt.h) ===== */
+
+esp_err_t ble_gatt_set_link_profile(ble_link_profile_t profile)
+{
+    if (profile >= BLE_LINK_PROFILE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_profile = profile;
+    s_info.profile = profile;
+    apply_profile();
+    return ESP_OK;
+}
+
+void ble_gatt_get_link_info(ble_link_info_t *out_info)
+{
+    if (out_info != NULL) {
+        *out_info = s_info;
+    }
+}
+
+/* ===== Link benchmark ===== */
+
+/* Notify one frame, waiting for mbufs to free up if the pool is exhausted */
+static int bench_send(const uint8_t *frame, size_t len, bool indicate)
+{
+    while (!s_bench_abort) {
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(frame, len);
+        if (om == NULL) {
+            xSemaphoreTake(s_bench_tx_sem, pdMS_TO_TICKS(BENCH_TX_WAIT_MS));
+            continue;
+        }
+
+        int rc = indicate ? ble_gatts_indicate_custom(s_bench_conn, s_bench_attr, om)
+                          : ble_gatts_notify_custom(s_bench_conn, s_bench_attr, om);
+        if (rc == BLE_HS_ENOMEM) {
+            xSemaphoreTake(s_bench_tx_sem, pdMS_TO_TICKS(BENCH_TX_WAIT_MS));
+            continue;
+        }
+        return rc;
+    }
+    return BLE_HS_ENOTCONN;
+}
+
+/* Sort a small sample set in place (n <= BENCH_MAX_RTT_SAMPLES) */
+static void sort_u32(uint32_t *v, size_t n)
+{
+    for (size_t i = 1; i < n; i++) {
+        uint32_t key = v[i];
+        size_t j = i;
+        while (j > 0 && v[j - 1] > key) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = key;
+    }
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t n, unsigned pct)
+{
+    if (n == 0) {
+        return 0;
+    }
+    size_t idx = (n * pct + 99) / 100;
+    return sorted[idx > 0 ? idx - 1 : 0];
+}
+
+static void bench_task(void *arg)
+{
+    (void)arg;
+
+    uint8_t frame[WIRE_MAX_FRAME_SIZE];
+    uint8_t payload[WIRE_MAX_PAYLOAD];
+    wire_event_link_benchmark_t result;
+    memset(&result, 0, sizeof(result));
+
+    /* Largest filler chunk that fits one notification: ATT header (3) + frame overhead */
+    uint16_t mtu = ble_att_mtu(s_bench_conn);
+    size_t overhead = 3 + WIRE_HEADER_SIZE + WIRE_CRC_SIZE + sizeof(wire_link_bench_data_t);
+    size_t chunk = (mtu > overhead) ? mtu - overhead : 0;
+    if (chunk > WIRE_MAX_PAYLOAD - sizeof(wire_link_bench_data_t)) {
+        chunk = WIRE_MAX_PAYLOAD - sizeof(wire_link_bench_data_t);
+    }
+    result.mtu = mtu;
+
+    ESP_LOGI(TAG, "Benchmark: %lu bytes, %u-byte chunks, %u RTT samples",
+             (unsigned long)s_bench_total, (unsigned)chunk, s_bench_rtt_samples);
+
+    /* Phase 1: throughput */
+    s_bench_tx_done = 0;
+    uint32_t frames_sent = 0;
+    uint32_t offset = 0;
+    int64_t start_us = esp_timer_get_time();
+    s_bench_last_tx_us = start_us;
+
+    while (chunk > 0 && offset < s_bench_total && !s_bench_abort) {
+        size_t n = s_bench_total - offset;
+        if (n > chunk) {
+            n = chunk;
+        }
+
+        payload[0] = offset & 0xFF;
+        payload[1] = (offset >> 8) & 0xFF;
+        payload[2] = (offset >> 16) & 0xFF;
+        payload[3] = (offset >> 24) & 0xFF;
+        for (size_t i = 0; i < n; i++) {
+            payload[4 + i] = (uint8_t)(offset + i);
+        }
+
+        size_t len = wire_build_frame(frame, sizeof(frame), MSG_TYPE_LINK_BENCH_DATA,
+                                      s_bench_seq++, payload, (uint16_t)(4 + n));
+        if (bench_send(frame, len, false) != 0) {
+            break;
+        }
+        frames_sent++;
+        offset += n;
+    }
+
+    /* Wait until the controller has taken every queued notification */
+    int64_t drain_deadline = esp_timer_get_time() + BENCH_DRAIN_TIMEOUT_MS * 1000LL;
+    while (s_bench_tx_done < frames_sent && !s_bench_abort &&
+           esp_timer_get_time() < drain_deadline) {
+        xSemaphoreTake(s_bench_tx_sem, pdMS_TO_TICKS(BENCH_TX_WAIT_MS));
+    }
+
+    int64_t elapsed_us = s_bench_last_tx_us - start_us;
+    result.bytes_sent = offset;
+    result.duration_ms = (uint32_t)(elapsed_us / 1000);
+    result.throughput_bps = elapsed_us > 0 ?
+                            (uint32_t)((uint64_t)offset * 1000000ULL / (uint64_t)elapsed_us) : 0;
+
+    /* Phase 2: indication round trips */
+    uint32_t rtt[BENCH_MAX_RTT_SAMPLES];
+    size_t rtt_count = 0;
+
+    if (s_bench_can_indicate) {
+        for (uint8_t i = 0; i < s_bench_rtt_samples && !s_bench_abort; i++) {
+            uint32_t marker = s_bench_total + i;
+            payload[0] = marker & 0xFF;
+            payload[1] = (marker >> 8) & 0xFF;
+            payload[2] = (marker >> 16) & 0xFF;
+            payload[3] = (marker >> 24) & 0xFF;
+
+            size_t len = wire_build_frame(frame, sizeof(frame), MSG_TYPE_LINK_BENCH_DATA,
+                                          s_bench_seq++, payload, sizeof(wire_link_bench_data_t));
+
+            xSemaphoreTake(s_rtt_sem, 0);
+            int64_t t0 = esp_timer_get_time();
+            if (bench_send(frame, len, true) != 0) {
+                break;
+            }
+            if (xSemaphoreTake(s_rtt_sem, pdMS_TO_TICKS(BENCH_RTT_TIMEOUT_MS)) != pdTRUE) {
+                ESP_LOGW(TAG, "Benchmark: indication %u not confirmed", i);
+                break;
+            }
+            rtt[rtt_count++] = (uint32_t)(s_rtt_done_us - t0);
+        }
+    }
+
+    sort_u32(rtt, rtt_count);
+    result.rtt_count = (uint8_t)rtt_count;
+    result.rtt_p50_us = percentile(rtt, rtt_count, 50);
+    result.rtt_p90_us = percentile(rtt, rtt_count, 90);
+    result.rtt_p99_us = percentile(rtt, rtt_count, 99);
+    result.rtt_max_us = rtt_count ? rtt[rtt_count - 1] : 0;
+
+    ESP_LOGI(TAG, "Benchmark done: %lu bytes in %lu ms (%lu B/s), RTT p50=%luus p90=%luus max=%luus (n=%u)",
+             (unsigned long)result.bytes_sent, (unsigned long)result.duration_ms,
+             (unsigned long)result.throughput_bps, (unsigned long)result.rtt_p50_us,
+             (unsigned long)result.rtt_p90_us, (unsigned long)result.rtt_max_us,
+             (unsigned)rtt_count);
+
+    if (!s_bench_abort) {
+        size_t len = wire_build_event(frame, sizeof(frame), s_bench_seq++,
+                                      EVENT_LINK_BENCHMARK_RESULT, EVENT_SEVERITY_INFO, 0,
+                                      (const uint8_t *)&result, sizeof(result));
+        if (len > 0) {
+            ble_gatt_send_event(frame, len, false);
+        }
+    }
+
+    s_bench_running = false;
+    vTaskDelete(NULL);
+}
+
+esp_err_t ble_link_start_benchmark(uint16_t conn_handle, uint16_t attr_handle,
+                                   bool can_indicate, uint32_t total_bytes,
+                                   uint8_t rtt_samples)
+{
+    if (total_bytes == 0 || total_bytes > BENCH_MAX_BYTES ||
+        rtt_samples > BENCH_MAX_RTT_SAMPLES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_bench_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_bench_conn = conn_handle;
+    s_bench_attr = attr_handle;
+    s_bench_can_indicate = can_indicate;
+    s_bench_total = total_bytes;
+    s_bench_rtt_samples = rtt_samples;
+    s_bench_abort = false;
+    s_bench_running = true;
+
+    BaseType_t ret = xTaskCreate(bench_task, "ble_bench", BENCH_TASK_STACK,
+                                 NULL, BENCH_TASK_PRIORITY, NULL);
+    if (ret != pdPASS) {
+        s_bench_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+ * BLE link tuning (component-private)
+ * ===================================
+ *
+ * Negotiates ATT MTU, LE Data Length Extension, PHY and connection
+ * interval after a client connects, according to the selected
+ * ble_link_profile_t, and tracks the resulting parameters.
+ *
+ * Also implements the LINK_BENCHMARK diagnostic: stream N filler bytes
+ * as notifications, then time indication round trips.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "ble_gatt.h"
+#include "host/ble_hs.h"
+
+/* Size of the link section appended to Device Info */
+#define BLE_LINK_INFO_WIRE_SIZE     13
+
+/**
+ * @brief Create timers/state. Call once from ble_gatt_init().
+ */
+esp_err_t ble_link_init(void);
+
+/**
+ * @brief Connection established - schedule link parameter requests
+ *
+ * Profiles and Device Info track the first connection; later ones (observers)
+ * only get an MTU exchange so full telemetry frames fit.
+ */
+void ble_link_on_connect(uint16_t conn_handle);
+
+/**
+ * @brief Connection lost - reset tracked parameters / abort the benchmark if they were on it
+ */
+void ble_link_on_disconnect(uint16_t conn_handle);
+
+/**
+ * @brief Feed GAP events (MTU, CONN_UPDATE, PHY, DLE, NOTIFY_TX)
+ */
+void ble_link_on_gap_event(const struct ble_gap_event *event);
+
+/**
+ * @brief Serialize link parameters for Device Info (little-endian)
+ *
+ * Layout: mtu(u16) conn_itvl(u16) conn_latency(u16) supervision_timeout(u16)
+ *         tx_phy(u8) rx_phy(u8) max_tx_octets(u16) profile(u8)
+ *
+ * @return Bytes written (BLE_LINK_INFO_WIRE_SIZE), or 0 if out_size too small
+ */
+size_t ble_link_write_info(uint8_t *out, size_t out_size);
+
+/**
+ * @brief Start the link benchmark on a background task
+ *
+ * @param conn_handle   Connection to stream to
+ * @param attr_handle   Characteristic used for notifications/indications
+ * @param can_indicate  Client subscribed to indications (RTT needs it)
+ * @param total_bytes   Filler bytes to stream
+ * @param rtt_samples   Indication round trips to time
+ * @return ESP_OK if started, ESP_ERR_INVALID_STATE if one is running,
+ *         ESP_ERR_INVALID_ARG for out-of-range parameters
+ */
+esp_err_t ble_link_start_benchmark(uint16_t conn_handle, uint16_t attr_handle,
+                                   bool can_indicate, uint32_t total_bytes,
+                                   uint8_t rtt_samples);
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "esp_err.h"
 #include "fw_version.h"
+#include "wire_protocol.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,8 +21,13 @@ extern "C" {
  * - Telemetry Stream (5E62): Notify
  * - Command RX       (5E63): Write, Write Without Response
  * - Events + Acks    (5E64): Indicate, Notify
- * - Bulk Gateway     (5E65): Write, Notify (future)
+ * - Bulk Gateway     (5E65): Write, Write Without Response, Notify (fragmented objects)
  * - Diagnostic Log   (5E66): Notify (optional)
+ *
+ * Up to CONFIG_BLE_GATT_MAX_CLIENTS apps may be connected at once. Each
+ * telemetry/event frame is built once and sent to every subscriber; only
+ * the connection holding the controller session may send commands that
+ * change the machine (see session_mgr.h).
  */
 
 /* GATT UUIDs - all share same base, differ in last byte */
@@ -46,6 +52,28 @@ extern "C" {
 #define CAP_SUPPORTS_MODBUS_TOOLS   (1 << 3)
 #define CAP_SUPPORTS_PID_TUNING     (1 << 4)
 #define CAP_SUPPORTS_OTA            (1 << 5)
+#define CAP_SUPPORTS_LINK_INFO      (1 << 6)    /* Device Info carries link parameters */
+#define CAP_SUPPORTS_COMPACT_TELEM  (1 << 7)    /* OPEN_SESSION accepts telemetry_ver 2 */
+#define CAP_SUPPORTS_OBSERVER       (1 << 8)    /* OPEN_SESSION accepts role 1 (observer) */
+
+/* BLE link profiles (see CMD_SET_LINK_PROFILE) */
+typedef enum {
+    BLE_LINK_PROFILE_LOW_LATENCY = 0,   /* Short connection interval for interactive control */
+    BLE_LINK_PROFILE_BULK        = 1,   /* Longer connection events for bulk transfer */
+    BLE_LINK_PROFILE_MAX
+} ble_link_profile_t;
+
+/* Negotiated link parameters for the first connection */
+typedef struct {
+    uint16_t mtu;                   /* ATT MTU */
+    uint16_t conn_itvl;             /* Connection interval, 1.25 ms units */
+    uint16_t conn_latency;          /* Peripheral latency, connection events */
+    uint16_t supervision_timeout;   /* Supervision timeout, 10 ms units */
+    uint8_t  tx_phy;                /* 1 = 1M, 2 = 2M */
+    uint8_t  rx_phy;                /* 1 = 1M, 2 = 2M */
+    uint16_t max_tx_octets;         /* LL payload size (27 without DLE, up to 251) */
+    uint8_t  profile;               /* ble_link_profile_t currently requested */
+} ble_link_info_t;
 
 /**
  * @brief Initialize and start the BLE GATT server
@@ -57,7 +85,7 @@ extern "C" {
 esp_err_t ble_gatt_init(void);
 
 /**
- * @brief Send a telemetry notification to connected client
+ * @brief Send a telemetry notification to every subscribed client
  *
  * @param data Telemetry frame data (already formatted with wire protocol)
  * @param len Length of the data
@@ -66,7 +94,7 @@ esp_err_t ble_gatt_init(void);
 esp_err_t ble_gatt_send_telemetry(const uint8_t *data, size_t len);
 
 /**
- * @brief Send an event/ack notification to connected client
+ * @brief Send an event/ack notification to every subscribed client
  *
  * @param data Event/ACK frame data
  * @param len Length of the data
@@ -76,7 +104,7 @@ esp_err_t ble_gatt_send_telemetry(const uint8_t *data, size_t len);
 esp_err_t ble_gatt_send_event(const uint8_t *data, size_t len, bool indicate);
 
 /**
- * @brief Check if a client is connected
+ * @brief Check if any client is connected
  *
  * @return true if connected
  */
@@ -85,17 +113,103 @@ bool ble_gatt_is_connected(void);
 /**
  * @brief Check if telemetry notifications are enabled
  *
- * @return true if client has subscribed to telemetry
+ * @return true if any client has subscribed to telemetry
  */
 bool ble_gatt_telemetry_subscribed(void);
 
 /**
- * @brief Get the connection handle (for advanced use)
+ * @brief Select the link profile and renegotiate the current connection
+ *
+ * The profile is also applied to every future connection.
+ *
+ * @param profile BLE_LINK_PROFILE_LOW_LATENCY or BLE_LINK_PROFILE_BULK
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an unknown profile
+ */
+esp_err_t ble_gatt_set_link_profile(ble_link_profile_t profile);
+
+/**
+ * @brief Get negotiated link parameters for the current connection
+ *
+ * @param out_info Filled with current values (zeros when disconnected)
+ */
+void ble_gatt_get_link_info(ble_link_info_t *out_info);
+
+/**
+ * @brief Get the connection handle of the longest-connected client (for advanced use)
  *
  * @return Connection handle, or BLE_HS_CONN_HANDLE_NONE if not connected
  */
 uint16_t ble_gatt_get_conn_handle(void);
 
+/**
+ * @brief Start a frame that is written straight into a NimBLE mbuf
+ *
+ * Binds the writer to a freshly allocated ATT mbuf, so wire_write_*()
+ * fills the outgoing packet directly with no flat staging buffer. Pass
+ * the writer to one of the ble_gatt_frame_send_*() calls, or to
+ * ble_gatt_frame_discard() on any error path.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if no mbuf is available
+ */
+esp_err_t ble_gatt_frame_begin(wire_writer_t *w);
+
+/**
+ * @brief Notify a frame built with ble_gatt_frame_begin() on the telemetry characteristic
+ *
+ * Goes to every subscribed client; all but the last get a copy of the
+ * mbuf chain, so the frame is encoded once. Always consumes the mbuf.
+ *
+ * @return ESP_OK if every subscribed client got it, ESP_ERR_NOT_FINISHED if
+ *         some missed it (delta streams must restart with a keyframe),
+ *         ESP_ERR_INVALID_STATE if not connected/subscribed,
+ *         ESP_ERR_INVALID_SIZE if the frame was not completed, ESP_FAIL if
+ *         no client got it
+ */
+esp_err_t ble_gatt_frame_send_telemetry(wire_writer_t *w);
+
+/**
+ * @brief Send a frame built with ble_gatt_frame_begin() on the Events+Acks characteristic
+ *
+ * Same subscription rules as ble_gatt_send_event(). Always consumes the mbuf.
+ */
+esp_err_t ble_gatt_frame_send_event(wire_writer_t *w, bool indicate);
+
+/**
+ * @brief Release the mbuf of an unsent frame
+ */
+void ble_gatt_frame_discard(wire_writer_t *w);
+
+/**
+ * @brief Handler for a completed inbound bulk object
+ *
+ * Runs on the NimBLE host task; data is only valid during the call.
+ * Return ESP_OK to accept (sender sees COMPLETE) or an error to reject.
+ */
+typedef esp_err_t (*ble_gatt_bulk_handler_t)(uint8_t object_type, const uint8_t *data, size_t len);
+
+/**
+ * @brief Register the handler for one bulk object type (wire_obj_type_t)
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM if the handler table is full
+ */
+esp_err_t ble_gatt_register_bulk_handler(uint8_t object_type, ble_gatt_bulk_handler_t handler);
+
+/**
+ * @brief Send a large object over the Bulk Gateway (blocking)
+ *
+ * Fragments the object to the current MTU, streams it as notifications and
+ * retransmits blocks the app reports missing until it confirms COMPLETE.
+ * Must not be called from the NimBLE host task. data must stay valid until
+ * the call returns. One outbound transfer at a time.
+ *
+ * @return ESP_OK when the app confirmed the object,
+ *         ESP_ERR_INVALID_STATE if not connected/subscribed or a transfer is running,
+ *         ESP_ERR_TIMEOUT if not confirmed within timeout_ms,
+ *         ESP_FAIL if the app aborted the transfer
+ */
+esp_err_t ble_gatt_send_bulk(uint8_t object_type, const uint8_t *data, size_t len,
+                             uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,211 @@
+#include "crc16.h"
+#include "crc16_tables.h"
+
+#include <string.h>
+#include "esp_cpu.h"
+#include "esp_log.h"
+
+static const char *TAG = "crc16";
+
+#define WORD_BYTES          4
+#define SLICE_BYTES         (CRC16_SLICES)
+
+/* Self-test sweep */
+#define TEST_MAX_LEN        67
+#define TEST_MAX_ALIGN      8
+#define BENCH_MAX_LEN       512
+#define BENCH_RUNS          4
+
+#define T_CCITT             crc16_ccitt_tables
+#define T_MODBUS            crc16_modbus_tables
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));       /* Single l32i on aligned input */
+    return w;
+}
+
+/* ===== Byte-wise reference kernels ===== */
+
+static uint16_t ccitt_bytewise(uint16_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc << 8) ^ T_CCITT[0][((crc >> 8) ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+static uint16_t modbus_bytewise(uint16_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc >> 8) ^ T_MODBUS[0][(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+/* ===== Sliced kernels ===== */
+
+/*
+ * Both kernels align the input to a word boundary byte-wise, then fold
+ * SLICE_BYTES per iteration. The 16-bit register only overlaps the first
+ * two bytes of each slice; the remaining lookups are independent loads the
+ * core can issue back to back instead of one serial table walk per byte.
+ */
+
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    if (len >= SLICE_BYTES + WORD_BYTES) {
+        size_t head = (WORD_BYTES - ((uintptr_t)data & (WORD_BYTES - 1))) & (WORD_BYTES - 1);
+        crc = ccitt_bytewise(crc, data, head);
+        data += head;
+        len -= head;
+
+        while (len >= SLICE_BYTES) {
+            /* MSB-first: register high byte lines up with the first data byte */
+            uint32_t w = load_le32(data) ^ (uint32_t)((crc >> 8) | ((crc & 0xFF) << 8));
+#if CRC16_SLICES == 8
+            uint32_t w1 = load_le32(data + 4);
+            crc = T_CCITT[7][w & 0xFF] ^ T_CCITT[6][(w >> 8) & 0xFF] ^
+                  T_CCITT[5][(w >> 16) & 0xFF] ^ T_CCITT[4][w >> 24] ^
+                  T_CCITT[3][w1 & 0xFF] ^ T_CCITT[2][(w1 >> 8) & 0xFF] ^
+                  T_CCITT[1][(w1 >> 16) & 0xFF] ^ T_CCITT[0][w1 >> 24];
+#else
+            crc = T_CCITT[3][w & 0xFF] ^ T_CCITT[2][(w >> 8) & 0xFF] ^
+                  T_CCITT[1][(w >> 16) & 0xFF] ^ T_CCITT[0][w >> 24];
+#endif
+            data += SLICE_BYTES;
+            len -= SLICE_BYTES;
+        }
+    }
+    return ccitt_bytewise(crc, data, len);
+}
+
+uint16_t crc16_modbus_update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    if (len >= SLICE_BYTES + WORD_BYTES) {
+        size_t head = (WORD_BYTES - ((uintptr_t)data & (WORD_BYTES - 1))) & (WORD_BYTES - 1);
+        crc = modbus_bytewise(crc, data, head);
+        data += head;
+        len -= head;
+
+        while (len >= SLICE_BYTES) {
+            /* LSB-first: register overlays the first two bytes as-is */
+            uint32_t w = load_le32(data) ^ crc;
+#if CRC16_SLICES == 8
+            uint32_t w1 = load_le32(data + 4);
+            crc = T_MODBUS[7][w & 0xFF] ^ T_MODBUS[6][(w >> 8) & 0xFF] ^
+                  T_MODBUS[5][(w >> 16) & 0xFF] ^ T_MODBUS[4][w >> 24] ^
+                  T_MODBUS[3][w1 & 0xFF] ^ T_MODBUS[2][(w1 >> 8) & 0xFF] ^
+                  T_MODBUS[1][(w1 >> 16) & 0xFF] ^ T_MODBUS[0][w1 >> 24];
+#else
+            crc = T_MODBUS[3][w & 0xFF] ^ T_MODBUS[2][(w >> 8) & 0xFF] ^
+                  T_MODBUS[1][(w >> 16) & 0xFF] ^ T_MODBUS[0][w >> 24];
+#endif
+            data += SLICE_BYTES;
+            len -= SLICE_BYTES;
+        }
+    }
+    return modbus_bytewise(crc, data, len);
+}
+
+/* ===== Diagnostics ===== */
+
+static void fill_pattern(uint8_t *buf, size_t len)
+{
+    uint32_t x = 0x2545F491;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (uint8_t)x;
+    }
+}
+
+esp_err_t crc16_self_test(void)
+{
+    static const uint8_t check[] = "123456789";
+
+    uint16_t c = crc16_ccitt(check, 9);
+    uint16_t m = crc16_modbus(check, 9);
+    if (c != CRC16_CCITT_CHECK || m != CRC16_MODBUS_CHECK) {
+        ESP_LOGE(TAG, "Check value mismatch: ccitt=0x%04X modbus=0x%04X", c, m);
+        return ESP_FAIL;
+    }
+
+    uint8_t buf[TEST_MAX_ALIGN + TEST_MAX_LEN];
+    fill_pattern(buf, sizeof(buf));
+
+    for (size_t align = 0; align < TEST_MAX_ALIGN; align++) {
+        const uint8_t *p = &buf[align];
+        for (size_t len = 0; len <= TEST_MAX_LEN; len++) {
+            uint16_t ref_c = ccitt_bytewise(CRC16_CCITT_INIT, p, len);
+            uint16_t ref_m = modbus_bytewise(CRC16_MODBUS_INIT, p, len);
+
+            /* Streaming must match regardless of where the split falls */
+            size_t split = len / 3;
+            crc16_ctx_t cc, mc;
+            crc16_ccitt_init(&cc);
+            crc16_ccitt_feed(&cc, p, split);
+            crc16_ccitt_feed(&cc, p + split, len - split);
+            crc16_modbus_init(&mc);
+            crc16_modbus_feed(&mc, p, split);
+            crc16_modbus_feed(&mc, p + split, len - split);
+
+            if (crc16_ccitt(p, len) != ref_c || crc16_ccitt_final(&cc) != ref_c ||
+                crc16_modbus(p, len) != ref_m || crc16_modbus_final(&mc) != ref_m) {
+                ESP_LOGE(TAG, "Kernel mismatch at align=%u len=%u",
+                         (unsigned)align, (unsigned)len);
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    ESP_LOGD(TAG, "Self-test passed (slice-by-%d)", CRC16_SLICES);
+    return ESP_OK;
+}
+
+typedef uint16_t (*crc_kernel_t)(uint16_t crc, const uint8_t *data, size_t len);
+
+static uint32_t time_kernel(crc_kernel_t fn, const uint8_t *data, size_t len)
+{
+    uint32_t best = UINT32_MAX;
+    volatile uint16_t sink;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        sink = fn(0xFFFF, data, len);
+        uint32_t dt = esp_cpu_get_cycle_count() - t0;
+        if (dt < best) {
+            best = dt;
+        }
+    }
+    (void)sink;
+    return best;
+}
+
+esp_err_t crc16_benchmark(size_t len, crc16_bench_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len > BENCH_MAX_LEN) {
+        len = BENCH_MAX_LEN;
+    }
+
+    static uint8_t buf[BENCH_MAX_LEN] __attribute__((aligned(4)));
+    fill_pattern(buf, len);
+
+    out->len = (uint32_t)len;
+    out->ccitt_bytewise = time_kernel(ccitt_bytewise, buf, len);
+    out->ccitt_sliced = time_kernel(crc16_ccitt_update, buf, len);
+    out->modbus_bytewise = time_kernel(modbus_bytewise, buf, len);
+    out->modbus_sliced = time_kernel(crc16_modbus_update, buf, len);
+
+    ESP_LOGI(TAG, "%u bytes: ccitt %lu -> %lu cycles, modbus %lu -> %lu cycles (slice-by-%d)",
+             (unsigned)len,
+             (unsigned long)out->ccitt_bytewise, (unsigned long)out->ccitt_sliced,
+             (unsigned long)out->modbus_bytewise, (unsigned long)out->modbus_sliced,
+             CRC16_SLICES);
+    return ESP_OK;
+}
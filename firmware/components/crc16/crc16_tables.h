@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+ * Slice-by-N lookup tables (component-private)
+ *
+ * crc16_tables.c is generated by tools/gen_crc16_tables.py. Table k is the
+ * CRC of a byte followed by k zero bytes; T0 is the classic byte-wise table.
+ */
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#if CONFIG_CRC16_SLICE_BY_8
+#define CRC16_SLICES    8
+#else
+#define CRC16_SLICES    4
+#endif
+
+#if CONFIG_CRC16_TABLES_IN_DRAM
+#include "esp_attr.h"
+#define CRC16_TABLE_ATTR    DRAM_ATTR
+#else
+#define CRC16_TABLE_ATTR
+#endif
+
+extern const uint16_t crc16_ccitt_tables[CRC16_SLICES][256];
+extern const uint16_t crc16_modbus_tables[CRC16_SLICES][256];
@@ -0,0 +1,149 @@
+#pragma once
+
+/*
+ * CRC-16 Kernels
+ * ==============
+ *
+ * Table-driven slice-by-4 / slice-by-8 implementations of the two CRC-16
+ * variants used on this device:
+ *
+ *   CCITT-FALSE  poly 0x1021, init 0xFFFF, MSB-first   (BLE wire frames)
+ *   MODBUS       poly 0xA001, init 0xFFFF, LSB-first   (RS-485 RTU)
+ *
+ * Neither variant applies a final XOR, so a running value can be resumed
+ * with the *_update() functions at any byte boundary. The streaming context
+ * API wraps the same kernels for callers that accumulate over several
+ * buffers (mbuf chains, fragment reassembly).
+ *
+ * Kernel width is selected with CONFIG_CRC16_SLICE_BY_4 / _8.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initial register values */
+#define CRC16_CCITT_INIT        0xFFFF
+#define CRC16_MODBUS_INIT       0xFFFF
+
+/* Standard check values (CRC of ASCII "123456789") */
+#define CRC16_CCITT_CHECK       0x29B1
+#define CRC16_MODBUS_CHECK      0x4B37
+
+/**
+ * @brief Streaming CRC context
+ */
+typedef struct {
+    uint16_t crc;               /* Running register value */
+} crc16_ctx_t;
+
+/**
+ * @brief Cycle counts from crc16_benchmark()
+ */
+typedef struct {
+    uint32_t len;               /* Bytes per run */
+    uint32_t ccitt_bytewise;    /* Cycles, one table lookup per byte */
+    uint32_t ccitt_sliced;      /* Cycles, slice-by-N kernel */
+    uint32_t modbus_bytewise;
+    uint32_t modbus_sliced;
+} crc16_bench_t;
+
+/* ===== CRC-16/CCITT-FALSE ===== */
+
+/**
+ * @brief Continue a CCITT-FALSE CRC over more data
+ *
+ * @param crc Running value (CRC16_CCITT_INIT for a fresh CRC)
+ * @param data Data buffer
+ * @param len Data length
+ * @return Updated CRC
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief One-shot CCITT-FALSE CRC
+ */
+static inline uint16_t crc16_ccitt(const uint8_t *data, size_t len)
+{
+    return crc16_ccitt_update(CRC16_CCITT_INIT, data, len);
+}
+
+static inline void crc16_ccitt_init(crc16_ctx_t *ctx)
+{
+    ctx->crc = CRC16_CCITT_INIT;
+}
+
+static inline void crc16_ccitt_feed(crc16_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    ctx->crc = crc16_ccitt_update(ctx->crc, data, len);
+}
+
+static inline uint16_t crc16_ccitt_final(const crc16_ctx_t *ctx)
+{
+    return ctx->crc;
+}
+
+/* ===== CRC-16/MODBUS ===== */
+
+/**
+ * @brief Continue a Modbus CRC over more data
+ *
+ * @param crc Running value (CRC16_MODBUS_INIT for a fresh CRC)
+ * @param data Data buffer
+ * @param len Data length
+ * @return Updated CRC (transmitted low byte first)
+ */
+uint16_t crc16_modbus_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief One-shot Modbus CRC
+ */
+static inline uint16_t crc16_modbus(const uint8_t *data, size_t len)
+{
+    return crc16_modbus_update(CRC16_MODBUS_INIT, data, len);
+}
+
+static inline void crc16_modbus_init(crc16_ctx_t *ctx)
+{
+    ctx->crc = CRC16_MODBUS_INIT;
+}
+
+static inline void crc16_modbus_feed(crc16_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    ctx->crc = crc16_modbus_update(ctx->crc, data, len);
+}
+
+static inline uint16_t crc16_modbus_final(const crc16_ctx_t *ctx)
+{
+    return ctx->crc;
+}
+
+/* ===== Diagnostics ===== */
+
+/**
+ * @brief Check the sliced kernels against the byte-wise reference
+ *
+ * Verifies the standard check values, then compares sliced and byte-wise
+ * results for every length 0..67 at every start alignment 0..7, including
+ * split-buffer streaming. Cheap enough to run once at boot.
+ *
+ * @return ESP_OK on match, ESP_FAIL on any mismatch
+ */
+esp_err_t crc16_self_test(void);
+
+/**
+ * @brief Measure byte-wise vs sliced kernel cost on this CPU
+ *
+ * @param len Bytes per run (clamped to 512)
+ * @param out Cycle counts (best of several runs)
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG
+ */
+esp_err_t crc16_benchmark(size_t len, crc16_bench_t *out);
+
+#ifdef __cplusplus
+}
+#endif
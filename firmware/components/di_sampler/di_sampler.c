@@ -0,0 +1,425 @@
+#include "di_sampler.h"
+#include "relay_ctrl.h"
+
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "di_sampler";
+
+#define SAMPLER_TASK_STACK_SIZE 3072
+#define SAMPLER_TASK_PRIORITY   CONFIG_DI_SAMPLER_TASK_PRIORITY
+#define IDLE_PERIOD_MS          CONFIG_DI_SAMPLER_IDLE_PERIOD_MS
+#define BURST_PERIOD_US         CONFIG_DI_SAMPLER_BURST_PERIOD_US
+#define BURST_MAX_SAMPLES       CONFIG_DI_SAMPLER_BURST_MAX_SAMPLES
+
+/* TCA9534 INT (open-drain, active-low) - see Kconfig */
+#define DI_INT_GPIO             CONFIG_DI_SAMPLER_INT_GPIO
+
+/* Sampler task notification bits */
+#define NOTIFY_INT              (1 << 0)    /* INT falling edge */
+#define NOTIFY_SAMPLE           (1 << 1)    /* Burst timer */
+
+typedef struct {
+    di_filter_t filter;
+    uint32_t    history;        /* Raw samples, newest in bit 0 */
+    bool        level;          /* Filtered level */
+    int64_t     pending_us;     /* First sight of a change not yet accepted, 0 = none */
+} channel_t;
+
+typedef struct {
+    di_sampler_edge_cb_t cb;
+    void                *ctx;
+} subscriber_t;
+
+/* Guards everything below that other tasks read or configure */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static channel_t s_ch[DI_SAMPLER_CHANNELS];
+static uint8_t s_bits = 0xFF;               /* Filtered image */
+static esp_err_t s_last_err = ESP_ERR_INVALID_STATE;
+static di_sampler_stats_t s_stats = {0};
+static subscriber_t s_subs[DI_SAMPLER_MAX_SUBSCRIBERS];
+static uint8_t s_sub_count = 0;
+
+/* INT edge timestamp (low 32 bits of esp_timer, us) */
+static volatile uint32_t s_int_edge_us = 0;
+
+/* Sampler task state */
+static TaskHandle_t s_task = NULL;
+static esp_timer_handle_t s_burst_timer = NULL;
+static bool s_bursting = false;
+static bool s_capped = false;               /* Burst limit hit, wait for quiet or INT */
+static uint32_t s_burst_samples = 0;
+
+/* ===== Filters ===== */
+
+static uint32_t window_mask(const channel_t *c)
+{
+    return (1u << c->filter.window) - 1;
+}
+
+static bool filter_level(const channel_t *c, bool raw)
+{
+    if ((c->filter.fast == DI_FAST_LOW && !raw) || (c->filter.fast == DI_FAST_HIGH && raw)) {
+        return raw;
+    }
+
+    uint32_t mask = window_mask(c);
+    uint32_t h = c->history & mask;
+
+    switch (c->filter.mode) {
+    case DI_FILTER_DEBOUNCE:
+        if (h == mask) return true;
+        if (h == 0) return false;
+        return c->level;
+    case DI_FILTER_MAJORITY: {
+        int ones = __builtin_popcount(h);
+        if (ones * 2 > c->filter.window) return true;
+        if (ones * 2 < c->filter.window) return false;
+        return c->level;
+    }
+    default:
+        return raw;
+    }
+}
+
+/* Whole window agrees with the filtered level */
+static bool channel_settled(const channel_t *c)
+{
+    uint32_t h = c->history & window_mask(c);
+    return c->level ? (h == window_mask(c)) : (h == 0);
+}
+
+/* ===== Sampling ===== */
+
+/*
+ * Read the inputs once and run every filter. Returns true when all channels
+ * have settled. `seen_us` is the best estimate of when a change first showed:
+ * the INT edge if one arrived since the last sample, else this read.
+ */
+static bool take_sample(int64_t seen_us)
+{
+    uint8_t raw = 0;
+    esp_err_t err = relay_ctrl_read_di(&raw);
+    int64_t now_us = esp_timer_get_time();
+    if (seen_us == 0) {
+        seen_us = now_us;
+    }
+
+    di_sampler_edge_t edges[DI_SAMPLER_CHANNELS];
+    subscriber_t subs[DI_SAMPLER_MAX_SUBSCRIBERS];
+    uint8_t edge_count = 0;
+    uint8_t sub_count;
+    bool settled = true;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.samples++;
+    if (err != ESP_OK) {
+        s_stats.read_errors++;
+        s_last_err = err;
+        taskEXIT_CRITICAL(&s_lock);
+        return false;
+    }
+
+    for (int i = 0; i < DI_SAMPLER_CHANNELS; i++) {
+        channel_t *c = &s_ch[i];
+        bool bit = (raw >> i) & 1;
+
+        c->history = (c->history << 1) | bit;
+        if (bit != c->level && c->pending_us == 0) {
+            c->pending_us = seen_us;
+        }
+
+        bool level = filter_level(c, bit);
+        if (level != c->level) {
+            c->level = level;
+            edges[edge_count++] = (di_sampler_edge_t){
+                .t_us = c->pending_us ? c->pending_us : seen_us,
+                .accepted_us = now_us,
+                .channel = (uint8_t)(i + 1),
+                .level = level,
+            };
+            c->pending_us = 0;
+            s_bits = (uint8_t)((s_bits & ~(1u << i)) | ((unsigned)level << i));
+            s_stats.edges++;
+        }
+
+        if (!channel_settled(c)) {
+            settled = false;
+        } else if (c->pending_us != 0) {
+            s_stats.glitches++;         /* Bounced back before the filter took it */
+            c->pending_us = 0;
+        }
+    }
+    s_last_err = ESP_OK;
+
+    sub_count = s_sub_count;
+    memcpy(subs, s_subs, sizeof(subs[0]) * sub_count);
+    taskEXIT_CRITICAL(&s_lock);
+
+    for (uint8_t e = 0; e < edge_count; e++) {
+        edges[e].bits = s_bits;
+        for (uint8_t i = 0; i < sub_count; i++) {
+            subs[i].cb(&edges[e], subs[i].ctx);
+        }
+    }
+    return settled;
+}
+
+static void burst_timer_cb(void *arg)
+{
+    (void)arg;
+    xTaskNotify(s_task, NOTIFY_SAMPLE, eSetBits);
+}
+
+static bool int_asserted(void)
+{
+#if DI_INT_GPIO >= 0
+    return relay_ctrl_di_available() && gpio_get_level(DI_INT_GPIO) == 0;
+#else
+    return false;
+#endif
+}
+
+/* Switch between idle polling and the burst timer after a sample */
+static void update_rate(bool settled)
+{
+    /* INT still low: inputs changed again after the read (or the read
+     * failed) - no new edge will come, so keep sampling fast */
+    bool busy = !settled || int_asserted();
+
+    if (!busy) {
+        s_capped = false;
+        if (s_bursting) {
+            esp_timer_stop(s_burst_timer);
+            s_bursting = false;
+        }
+        return;
+    }
+
+    if (s_bursting) {
+        if (++s_burst_samples >= BURST_MAX_SAMPLES) {
+            esp_timer_stop(s_burst_timer);
+            s_bursting = false;
+            s_capped = true;
+            taskENTER_CRITICAL(&s_lock);
+            s_stats.bursts_capped++;
+            taskEXIT_CRITICAL(&s_lock);
+            ESP_LOGW(TAG, "Inputs still changing after %d samples - back to %dms polling",
+                     BURST_MAX_SAMPLES, IDLE_PERIOD_MS);
+        }
+    } else if (!s_capped) {
+        s_bursting = true;
+        s_burst_samples = 0;
+        esp_timer_start_periodic(s_burst_timer, BURST_PERIOD_US);
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.bursts++;
+        taskEXIT_CRITICAL(&s_lock);
+    }
+}
+
+static void sampler_task(void *arg)
+{
+    (void)arg;
+
+    ESP_LOGI(TAG, "DI sampler started (idle %dms, burst %dus)", IDLE_PERIOD_MS, BURST_PERIOD_US);
+
+    while (1) {
+        uint32_t notified = 0;
+        TickType_t wait = s_bursting ? portMAX_DELAY : pdMS_TO_TICKS(IDLE_PERIOD_MS);
+        xTaskNotifyWait(0, UINT32_MAX, &notified, wait);
+
+        int64_t seen_us = 0;
+        if (notified & NOTIFY_INT) {
+            /* Widen the 32-bit ISR stamp against the current time */
+            int64_t now_us = esp_timer_get_time();
+            seen_us = now_us - (uint32_t)((uint32_t)now_us - s_int_edge_us);
+            s_capped = false;
+            taskENTER_CRITICAL(&s_lock);
+            s_stats.int_edges++;
+            taskEXIT_CRITICAL(&s_lock);
+        }
+
+        update_rate(take_sample(seen_us));
+    }
+}
+
+/* ===== INT line ===== */
+
+static void IRAM_ATTR int_isr(void *arg)
+{
+    (void)arg;
+    BaseType_t woken = pdFALSE;
+
+    s_int_edge_us = (uint32_t)esp_timer_get_time();
+    xTaskNotifyFromISR(s_task, NOTIFY_INT, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void int_init(void)
+{
+#if DI_INT_GPIO >= 0
+    if (!relay_ctrl_di_available()) {
+        ESP_LOGW(TAG, "DI expander not present - INT on GPIO%d unused", DI_INT_GPIO);
+        return;
+    }
+
+    gpio_config_t cfg = {
+        .pin_bit_mask = 1ULL << DI_INT_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,   /* INT is open-drain */
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    esp_err_t err = gpio_config(&cfg);
+    if (err == ESP_OK) {
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE) {
+            err = ESP_OK;   /* Already installed by another driver */
+        }
+    }
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add(DI_INT_GPIO, int_isr, NULL);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "DI INT setup failed on GPIO%d: %s - polling only",
+                 DI_INT_GPIO, esp_err_to_name(err));
+        return;
+    }
+
+    /* INT may already be asserted from a change before the ISR was armed */
+    if (gpio_get_level(DI_INT_GPIO) == 0) {
+        s_int_edge_us = (uint32_t)esp_timer_get_time();
+        xTaskNotify(s_task, NOTIFY_INT, eSetBits);
+    }
+    ESP_LOGI(TAG, "DI INT on GPIO%d (idle poll %dms)", DI_INT_GPIO, IDLE_PERIOD_MS);
+#else
+    ESP_LOGI(TAG, "DI INT not configured - idle poll every %dms", IDLE_PERIOD_MS);
+#endif
+}
+
+/* ===== Public API ===== */
+
+esp_err_t di_sampler_init(void)
+{
+    if (s_task != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Seed every filter with the current inputs so boot produces no edges */
+    uint8_t raw = 0xFF;
+    esp_err_t err = relay_ctrl_read_di(&raw);
+    if (err == ESP_ERR_INVALID_STATE) {
+        /* relay_ctrl is not running: stay stopped so readers go to it directly */
+        ESP_LOGE(TAG, "relay_ctrl not initialized - DI sampler not started");
+        return err;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Initial DI read failed: %s - assuming 0xFF", esp_err_to_name(err));
+        raw = 0xFF;
+    }
+    for (int i = 0; i < DI_SAMPLER_CHANNELS; i++) {
+        bool bit = (raw >> i) & 1;
+        s_ch[i] = (channel_t){
+            .filter = {
+                .mode = DI_FILTER_DEBOUNCE,
+                .window = CONFIG_DI_SAMPLER_DEBOUNCE_SAMPLES,
+                .fast = DI_FAST_NONE,
+            },
+            .history = bit ? UINT32_MAX : 0,
+            .level = bit,
+        };
+    }
+    s_bits = raw;
+    s_last_err = err;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = burst_timer_cb,
+        .name = "di_burst",
+    };
+    if (esp_timer_create(&timer_args, &s_burst_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create burst timer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(sampler_task, "di_sampler", SAMPLER_TASK_STACK_SIZE,
+                                            NULL, SAMPLER_TASK_PRIORITY, &s_task, 0);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sampler task");
+        esp_timer_delete(s_burst_timer);
+        s_burst_timer = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    int_init();
+
+    ESP_LOGI(TAG, "DI sampler initialized: di_bits=0x%02X, debounce %d samples",
+             raw, CONFIG_DI_SAMPLER_DEBOUNCE_SAMPLES);
+    return ESP_OK;
+}
+
+esp_err_t di_sampler_set_filter(uint8_t channel, const di_filter_t *filter)
+{
+    if (channel < 1 || channel > DI_SAMPLER_CHANNELS || filter == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (filter->mode > DI_FILTER_MAJORITY || filter->fast > DI_FAST_HIGH ||
+        filter->window < 1 || filter->window > DI_SAMPLER_MAX_WINDOW) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_ch[channel - 1].filter = *filter;
+    taskEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t di_sampler_subscribe(di_sampler_edge_cb_t cb, void *ctx)
+{
+    if (cb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_sub_count < DI_SAMPLER_MAX_SUBSCRIBERS) {
+        s_subs[s_sub_count++] = (subscriber_t){ .cb = cb, .ctx = ctx };
+    } else {
+        err = ESP_ERR_NO_MEM;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return err;
+}
+
+esp_err_t di_sampler_read(uint8_t *bits)
+{
+    if (bits == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    *bits = s_bits;
+    esp_err_t err = s_last_err;
+    taskEXIT_CRITICAL(&s_lock);
+    return err;
+}
+
+void di_sampler_get_stats(di_sampler_stats_t *out)
+{
+    if (out == NULL) return;
+
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
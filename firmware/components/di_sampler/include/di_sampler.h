@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Digital input sampling engine
+ *
+ * One task reads DI1..DI8 from the TCA9534 (through relay_ctrl, at i2c_bus
+ * SAFETY priority) and filters every channel:
+ * - idle: one read every CONFIG_DI_SAMPLER_IDLE_PERIOD_MS
+ * - burst: once a raw change is seen (or the INT line falls), one read every
+ *   CONFIG_DI_SAMPLER_BURST_PERIOD_US until every channel has settled
+ *
+ * A filter accepts a new level per channel (debounce or majority vote over
+ * a window of samples). Each accepted change is an edge, timestamped with
+ * the first raw sight of it: the INT edge when the line is wired, else the
+ * sample that first showed it. Edges go to subscribers; anyone needing the
+ * current inputs reads the filtered image with di_sampler_read() instead of
+ * touching the bus.
+ */
+
+#define DI_SAMPLER_CHANNELS         8
+#define DI_SAMPLER_MAX_SUBSCRIBERS  4
+#define DI_SAMPLER_MAX_WINDOW       31
+
+/* Per-channel filter */
+typedef enum {
+    DI_FILTER_NONE = 0,         /* Every raw change is an edge */
+    DI_FILTER_DEBOUNCE,         /* Level held for `window` consecutive samples */
+    DI_FILTER_MAJORITY,         /* Level seen in most of the last `window` samples */
+} di_filter_mode_t;
+
+/* Level accepted on first sight, bypassing the filter (fail-safe direction) */
+typedef enum {
+    DI_FAST_NONE = 0,
+    DI_FAST_LOW,
+    DI_FAST_HIGH,
+} di_fast_level_t;
+
+typedef struct {
+    uint8_t mode;               /* di_filter_mode_t */
+    uint8_t window;             /* Samples, 1..DI_SAMPLER_MAX_WINDOW (MAJORITY ties keep the level) */
+    uint8_t fast;               /* di_fast_level_t */
+} di_filter_t;
+
+/* One accepted input change */
+typedef struct {
+    int64_t  t_us;              /* First raw sight of the change (esp_timer us) */
+    int64_t  accepted_us;       /* Sample at which the filter accepted it */
+    uint8_t  channel;           /* 1..8 */
+    bool     level;             /* New filtered level */
+    uint8_t  bits;              /* Filtered DI1..DI8 after the sample */
+} di_sampler_edge_t;
+
+/**
+ * @brief Edge callback
+ *
+ * Runs on the sampler task, once per edge in channel order. Keep it short:
+ * post a notification or copy the bits, do not block or touch the bus.
+ */
+typedef void (*di_sampler_edge_cb_t)(const di_sampler_edge_t *edge, void *ctx);
+
+typedef struct {
+    uint32_t samples;           /* Input reads */
+    uint32_t read_errors;       /* Failed reads */
+    uint32_t int_edges;         /* INT falling edges */
+    uint32_t bursts;            /* Idle -> burst switches */
+    uint32_t bursts_capped;     /* Bursts ended by CONFIG_DI_SAMPLER_BURST_MAX_SAMPLES */
+    uint32_t edges;             /* Accepted edges */
+    uint32_t glitches;          /* Raw changes that settled back without an edge */
+} di_sampler_stats_t;
+
+/**
+ * @brief Seed the filters with one read, arm the INT line and start sampling
+ *
+ * Call after relay_ctrl_init(). Without the DI expander the sampler runs on
+ * relay_ctrl's simulated inputs.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already running or relay_ctrl is
+ *         not initialized (di_sampler_read() then keeps failing), ESP_ERR_NO_MEM
+ */
+esp_err_t di_sampler_init(void);
+
+/**
+ * @brief Replace a channel's filter
+ *
+ * Takes effect from the next sample; the channel's history is kept.
+ *
+ * @param channel 1..8
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad channel, mode or window
+ */
+esp_err_t di_sampler_set_filter(uint8_t channel, const di_filter_t *filter);
+
+/**
+ * @brief Register an edge callback
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM when DI_SAMPLER_MAX_SUBSCRIBERS are registered
+ */
+esp_err_t di_sampler_subscribe(di_sampler_edge_cb_t cb, void *ctx);
+
+/**
+ * @brief Filtered DI1..DI8 (bit 0 = DI1)
+ *
+ * Never touches the bus. Fails with the read error while the latest sample
+ * failed (bits hold the last good image), ESP_ERR_INVALID_STATE before init.
+ */
+esp_err_t di_sampler_read(uint8_t *bits);
+
+/**
+ * @brief Sampler counters since boot
+ */
+void di_sampler_get_stats(di_sampler_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,498 @@
+#include "i2c_bus.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c_master.h"
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "i2c_bus";
+
+#define BUS_TASK_STACK_SIZE     3072
+#define BUS_TASK_PRIORITY       CONFIG_I2C_BUS_TASK_PRIORITY
+#define XFER_TIMEOUT_MS         CONFIG_I2C_BUS_XFER_TIMEOUT_MS
+#define REQUEST_TIMEOUT_MS      CONFIG_I2C_BUS_REQUEST_TIMEOUT_MS
+
+/* Requests served by one transaction */
+#define MAX_BATCH               8
+
+typedef enum {
+    OP_READ,
+    OP_WRITE,
+    OP_PROBE,
+} req_op_t;
+
+typedef enum {
+    REQ_QUEUED,
+    REQ_ACTIVE,
+    REQ_DONE,
+} req_state_t;
+
+/* One caller's request; lives on the caller's stack until it completes */
+typedef struct i2c_req {
+    struct i2c_req    *next;
+    i2c_bus_dev_t     *dev;             /* NULL for OP_PROBE */
+    uint8_t            op;              /* req_op_t */
+    uint8_t            state;           /* req_state_t */
+    uint8_t            addr;            /* OP_PROBE */
+    uint8_t            reg;
+    uint8_t            len;
+    uint8_t           *rx;
+    const uint8_t     *tx;
+    esp_err_t          result;
+    int64_t            submit_us;
+    SemaphoreHandle_t  done;
+    StaticSemaphore_t  done_buf;
+} i2c_req_t;
+
+struct i2c_bus_dev {
+    const char              *name;
+    uint8_t                  addr;
+    uint8_t                  flags;
+    i2c_master_dev_handle_t  handle;
+    i2c_bus_dev_stats_t      stats;     /* Guarded by s_lock */
+};
+
+/* Requests picked for one transaction */
+typedef struct {
+    i2c_req_t *req[MAX_BATCH];
+    uint8_t    off[MAX_BATCH];          /* Reads: offset of each request in the burst */
+    uint8_t    count;
+    uint8_t    reg;                     /* Burst start register and length */
+    uint8_t    len;
+} batch_t;
+
+static i2c_master_bus_handle_t s_bus = NULL;
+static TaskHandle_t s_task = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Pending requests per priority, oldest first */
+static i2c_req_t *s_head[I2C_BUS_PRIO_COUNT];
+static i2c_req_t *s_tail[I2C_BUS_PRIO_COUNT];
+
+static i2c_bus_dev_t s_devs[I2C_BUS_MAX_DEVICES];
+static uint8_t s_dev_count = 0;
+
+/* ===== Queue (call with s_lock held) ===== */
+
+static void queue_unlink(i2c_bus_prio_t prio, i2c_req_t *prev, i2c_req_t *req)
+{
+    if (prev == NULL) {
+        s_head[prio] = req->next;
+    } else {
+        prev->next = req->next;
+    }
+    if (s_tail[prio] == req) {
+        s_tail[prio] = prev;
+    }
+    req->next = NULL;
+}
+
+static bool withdraw(i2c_req_t *req)
+{
+    for (int p = 0; p < I2C_BUS_PRIO_COUNT; p++) {
+        i2c_req_t *prev = NULL;
+        for (i2c_req_t *r = s_head[p]; r != NULL; prev = r, r = r->next) {
+            if (r == req) {
+                queue_unlink((i2c_bus_prio_t)p, prev, r);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Fold later writes of the same register into the head write. Stops at the
+ * first other request for the device so reads still see writes in order. */
+static void batch_writes(batch_t *b, i2c_bus_prio_t prio)
+{
+    i2c_req_t *head = b->req[0];
+    i2c_req_t *prev = NULL;
+    i2c_req_t *r = s_head[prio];
+
+    while (r != NULL && b->count < MAX_BATCH) {
+        i2c_req_t *next = r->next;
+        if (r->dev == head->dev) {
+            if (r->op != OP_WRITE || r->reg != head->reg || r->len != head->len) {
+                break;
+            }
+            queue_unlink(prio, prev, r);
+            r->state = REQ_ACTIVE;
+            b->req[b->count++] = r;
+        } else {
+            prev = r;
+        }
+        r = next;
+    }
+}
+
+/* Join identical reads from any priority, and adjacent ones on auto-increment devices */
+static void batch_reads(batch_t *b)
+{
+    i2c_bus_dev_t *dev = b->req[0]->dev;
+    bool grew = true;
+
+    while (grew && b->count < MAX_BATCH) {
+        grew = false;
+        for (int p = 0; p < I2C_BUS_PRIO_COUNT && b->count < MAX_BATCH; p++) {
+            i2c_req_t *prev = NULL;
+            i2c_req_t *r = s_head[p];
+            while (r != NULL && b->count < MAX_BATCH) {
+                i2c_req_t *next = r->next;
+                int off = -1;
+                if (r->dev == dev && r->op == OP_READ) {
+                    if (r->reg >= b->reg && r->reg + r->len <= b->reg + b->len) {
+                        off = r->reg - b->reg;                  /* Inside the burst */
+                    } else if ((dev->flags & I2C_BUS_DEV_AUTO_INC) &&
+                               r->reg == b->reg + b->len &&
+                               b->len + r->len <= I2C_BUS_MAX_XFER) {
+                        off = b->len;                           /* Extends it */
+                        b->len += r->len;
+                        grew = true;
+                    }
+                }
+                if (off >= 0) {
+                    queue_unlink((i2c_bus_prio_t)p, prev, r);
+                    r->state = REQ_ACTIVE;
+                    b->off[b->count] = (uint8_t)off;
+                    b->req[b->count++] = r;
+                } else {
+                    prev = r;
+                }
+                r = next;
+            }
+        }
+    }
+}
+
+/* Take the oldest request of the highest priority, plus whatever can share its transaction */
+static bool take_batch(batch_t *b)
+{
+    bool found = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    for (int p = 0; p < I2C_BUS_PRIO_COUNT; p++) {
+        i2c_req_t *head = s_head[p];
+        if (head == NULL) {
+            continue;
+        }
+        queue_unlink((i2c_bus_prio_t)p, NULL, head);
+        head->state = REQ_ACTIVE;
+        b->req[0] = head;
+        b->off[0] = 0;
+        b->count = 1;
+        b->reg = head->reg;
+        b->len = head->len;
+
+        if (head->op == OP_READ) {
+            batch_reads(b);
+        } else if (head->op == OP_WRITE) {
+            batch_writes(b, (i2c_bus_prio_t)p);
+        }
+        found = true;
+        break;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return found;
+}
+
+/* ===== Scheduler task ===== */
+
+static esp_err_t execute(batch_t *b, uint8_t *rx)
+{
+    i2c_req_t *req = b->req[0];
+
+    switch (req->op) {
+    case OP_READ:
+        return i2c_master_transmit_receive(req->dev->handle, &b->reg, 1, rx, b->len,
+                                           XFER_TIMEOUT_MS);
+    case OP_WRITE: {
+        /* Folded writes: the newest data goes out */
+        const i2c_req_t *last = b->req[b->count - 1];
+        uint8_t tx[1 + I2C_BUS_MAX_XFER];
+        tx[0] = last->reg;
+        memcpy(&tx[1], last->tx, last->len);
+        return i2c_master_transmit(req->dev->handle, tx, 1 + last->len, XFER_TIMEOUT_MS);
+    }
+    case OP_PROBE:
+        return i2c_master_probe(s_bus, req->addr, XFER_TIMEOUT_MS);
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static void complete(batch_t *b, const uint8_t *rx, esp_err_t err, int64_t start_us)
+{
+    int64_t now_us = esp_timer_get_time();
+    i2c_bus_dev_t *dev = b->req[0]->dev;
+
+    if (err != ESP_OK) {
+        if (dev != NULL) {
+            ESP_LOGE(TAG, "%s: %s reg 0x%02X failed: %s", dev->name,
+                     (b->req[0]->op == OP_READ) ? "read" : "write", b->reg,
+                     esp_err_to_name(err));
+        }
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    if (dev != NULL) {
+        dev->stats.transactions++;
+        if (err != ESP_OK) {
+            dev->stats.errors++;
+        }
+    }
+    for (uint8_t i = 0; i < b->count; i++) {
+        i2c_req_t *r = b->req[i];
+        if (dev != NULL) {
+            uint32_t wait_us = (uint32_t)(start_us - r->submit_us);
+            uint32_t latency_us = (uint32_t)(now_us - r->submit_us);
+            dev->stats.requests++;
+            dev->stats.last_latency_us = latency_us;
+            if (latency_us > dev->stats.max_latency_us) {
+                dev->stats.max_latency_us = latency_us;
+            }
+            if (wait_us > dev->stats.max_wait_us) {
+                dev->stats.max_wait_us = wait_us;
+            }
+        }
+        if (r->op == OP_READ && err == ESP_OK) {
+            memcpy(r->rx, rx + b->off[i], r->len);
+        }
+        r->result = err;
+        r->state = REQ_DONE;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    /* The request may go out of scope as soon as its semaphore is given */
+    for (uint8_t i = 0; i < b->count; i++) {
+        xSemaphoreGive(b->req[i]->done);
+    }
+}
+
+static void bus_task(void *arg)
+{
+    (void)arg;
+    batch_t batch;
+    uint8_t rx[I2C_BUS_MAX_XFER];
+
+    ESP_LOGI(TAG, "Bus scheduler started");
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (take_batch(&batch)) {
+            int64_t start_us = esp_timer_get_time();
+            esp_err_t err = execute(&batch, rx);
+            complete(&batch, rx, err, start_us);
+        }
+    }
+}
+
+/* ===== Requests ===== */
+
+static esp_err_t submit(i2c_req_t *req, i2c_bus_prio_t prio)
+{
+    if (s_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (prio >= I2C_BUS_PRIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    req->done = xSemaphoreCreateBinaryStatic(&req->done_buf);
+    req->next = NULL;
+    req->state = REQ_QUEUED;
+    req->result = ESP_FAIL;
+    req->submit_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    if (s_tail[prio] == NULL) {
+        s_head[prio] = req;
+    } else {
+        s_tail[prio]->next = req;
+    }
+    s_tail[prio] = req;
+    taskEXIT_CRITICAL(&s_lock);
+
+    xTaskNotifyGive(s_task);
+
+    if (xSemaphoreTake(req->done, pdMS_TO_TICKS(REQUEST_TIMEOUT_MS)) != pdTRUE) {
+        taskENTER_CRITICAL(&s_lock);
+        bool withdrawn = (req->state == REQ_QUEUED) && withdraw(req);
+        if (withdrawn && req->dev != NULL) {
+            req->dev->stats.timeouts++;
+        }
+        taskEXIT_CRITICAL(&s_lock);
+
+        if (withdrawn) {
+            return ESP_ERR_TIMEOUT;
+        }
+        /* On the wire: the driver timeout bounds it, and it writes into req */
+        xSemaphoreTake(req->done, portMAX_DELAY);
+    }
+    return req->result;
+}
+
+esp_err_t i2c_bus_read(i2c_bus_dev_t *dev, uint8_t reg, uint8_t *data, size_t len,
+                       i2c_bus_prio_t prio)
+{
+    if (dev == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len == 0 || len > I2C_BUS_MAX_XFER) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    i2c_req_t req = {
+        .dev = dev,
+        .op = OP_READ,
+        .reg = reg,
+        .len = (uint8_t)len,
+        .rx = data,
+    };
+    return submit(&req, prio);
+}
+
+esp_err_t i2c_bus_write(i2c_bus_dev_t *dev, uint8_t reg, const uint8_t *data, size_t len,
+                        i2c_bus_prio_t prio)
+{
+    if (dev == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len == 0 || len > I2C_BUS_MAX_XFER) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    i2c_req_t req = {
+        .dev = dev,
+        .op = OP_WRITE,
+        .reg = reg,
+        .len = (uint8_t)len,
+        .tx = data,
+    };
+    return submit(&req, prio);
+}
+
+esp_err_t i2c_bus_probe(uint8_t addr)
+{
+    i2c_req_t req = {
+        .op = OP_PROBE,
+        .addr = addr,
+    };
+    return submit(&req, I2C_BUS_PRIO_DIAG);
+}
+
+/* ===== Setup ===== */
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *cfg)
+{
+    if (s_bus != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cfg == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = cfg->port,
+        .sda_io_num = cfg->sda_io,
+        .scl_io_num = cfg->scl_io,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .intr_priority = 0,
+        .trans_queue_depth = 0,
+        .flags = {
+            .enable_internal_pullup = cfg->internal_pullup,
+        },
+    };
+
+    esp_err_t ret = i2c_new_master_bus(&bus_config, &s_bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+        s_bus = NULL;
+        return ret;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(bus_task, "i2c_bus", BUS_TASK_STACK_SIZE,
+                                            NULL, BUS_TASK_PRIORITY, &s_task, 0);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create scheduler task");
+        i2c_del_master_bus(s_bus);
+        s_bus = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "I2C%d: SDA=GPIO%d SCL=GPIO%d, scheduler priority %d",
+             cfg->port, cfg->sda_io, cfg->scl_io, BUS_TASK_PRIORITY);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_add_device(const char *name, uint8_t addr, uint32_t scl_hz,
+                             uint8_t flags, i2c_bus_dev_t **out_dev)
+{
+    if (s_bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (name == NULL || out_dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_dev_count >= I2C_BUS_MAX_DEVICES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_bus_dev_t *dev = &s_devs[s_dev_count];
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = scl_hz,
+    };
+    esp_err_t ret = i2c_master_bus_add_device(s_bus, &dev_config, &dev->handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add %s @ 0x%02X: %s", name, addr, esp_err_to_name(ret));
+        return ret;
+    }
+
+    dev->name = name;
+    dev->addr = addr;
+    dev->flags = flags;
+    memset(&dev->stats, 0, sizeof(dev->stats));
+    s_dev_count++;
+
+    *out_dev = dev;
+    return ESP_OK;
+}
+
+/* ===== Statistics ===== */
+
+void i2c_bus_get_stats(const i2c_bus_dev_t *dev, i2c_bus_dev_stats_t *out)
+{
+    if (dev == NULL || out == NULL) return;
+
+    taskENTER_CRITICAL(&s_lock);
+    *out = dev->stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+const char *i2c_bus_dev_name(const i2c_bus_dev_t *dev)
+{
+    return (dev != NULL) ? dev->name : "?";
+}
+
+void i2c_bus_log_stats(void)
+{
+    for (uint8_t i = 0; i < s_dev_count; i++) {
+        i2c_bus_dev_stats_t st;
+        i2c_bus_get_stats(&s_devs[i], &st);
+        ESP_LOGI(TAG, "%s @ 0x%02X: req=%lu xfer=%lu err=%lu timeout=%lu "
+                 "latency last=%luus max=%luus wait max=%luus",
+                 s_devs[i].name, s_devs[i].addr,
+                 (unsigned long)st.requests, (unsigned long)st.transactions,
+                 (unsigned long)st.errors, (unsigned long)st.timeouts,
+                 (unsigned long)st.last_latency_us, (unsigned long)st.max_latency_us,
+                 (unsigned long)st.max_wait_us);
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Shared I2C bus scheduler
+ *
+ * One task owns the I2C master bus and executes register reads and writes
+ * queued by any number of callers, highest priority first. A caller blocks
+ * only on its own request; a slow diagnostic transfer can delay a safety
+ * read by at most the one transaction already on the wire.
+ *
+ * While picking the next request the scheduler batches queued work:
+ * - identical reads (device, register, length) share one transaction
+ * - a write superseded by a later write of the same register (with nothing
+ *   else for that device in between) is folded into it; both callers get
+ *   the later write's result. Register images such as the relay outputs are
+ *   written whole, so only the newest image needs to reach the device.
+ * - on devices added with I2C_BUS_DEV_AUTO_INC, reads of adjacent registers
+ *   merge into one burst
+ *
+ * Per-device statistics show queueing and transfer latency, so a new device
+ * on the bus can be checked against the E-stop input read.
+ */
+
+/* Request priority, highest first */
+typedef enum {
+    I2C_BUS_PRIO_SAFETY = 0,    /* E-stop / door inputs */
+    I2C_BUS_PRIO_OUTPUT,        /* Relay and actuator writes */
+    I2C_BUS_PRIO_DIAG,          /* Readback, probes, sensors */
+    I2C_BUS_PRIO_COUNT
+} i2c_bus_prio_t;
+
+/* i2c_bus_add_device() flags */
+#define I2C_BUS_DEV_AUTO_INC    (1 << 0)    /* Register pointer auto-increments on reads */
+
+/* Devices on the bus, and the largest single transfer */
+#define I2C_BUS_MAX_DEVICES     6
+#define I2C_BUS_MAX_XFER        16
+
+typedef struct {
+    int      port;              /* I2C controller number */
+    int      sda_io;
+    int      scl_io;
+    bool     internal_pullup;
+} i2c_bus_config_t;
+
+typedef struct i2c_bus_dev i2c_bus_dev_t;
+
+typedef struct {
+    uint32_t requests;          /* Requests completed */
+    uint32_t transactions;      /* Bus transactions (< requests when batched) */
+    uint32_t errors;            /* Failed transactions */
+    uint32_t timeouts;          /* Requests withdrawn before they ran */
+    uint32_t last_latency_us;   /* Submit -> complete, last request */
+    uint32_t max_latency_us;
+    uint32_t max_wait_us;       /* Submit -> start of its transaction */
+} i2c_bus_dev_stats_t;
+
+/**
+ * @brief Create the bus and start the scheduler task
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already initialized
+ */
+esp_err_t i2c_bus_init(const i2c_bus_config_t *cfg);
+
+/**
+ * @brief Check for a device at a 7-bit address (DIAG priority)
+ */
+esp_err_t i2c_bus_probe(uint8_t addr);
+
+/**
+ * @brief Register a device
+ *
+ * @param name Short name for logs and stats (kept by reference)
+ * @param addr 7-bit address
+ * @param scl_hz Bus clock for this device
+ * @param flags I2C_BUS_DEV_* flags
+ * @param out_dev Device handle
+ */
+esp_err_t i2c_bus_add_device(const char *name, uint8_t addr, uint32_t scl_hz,
+                             uint8_t flags, i2c_bus_dev_t **out_dev);
+
+/**
+ * @brief Read len bytes starting at register reg
+ *
+ * Blocks the caller until the transfer is done or the request times out.
+ *
+ * @return ESP_OK, a driver error, ESP_ERR_TIMEOUT if withdrawn unexecuted,
+ *         ESP_ERR_INVALID_SIZE if len is 0 or above I2C_BUS_MAX_XFER
+ */
+esp_err_t i2c_bus_read(i2c_bus_dev_t *dev, uint8_t reg, uint8_t *data, size_t len,
+                       i2c_bus_prio_t prio);
+
+/**
+ * @brief Write len bytes starting at register reg
+ *
+ * @return As i2c_bus_read()
+ */
+esp_err_t i2c_bus_write(i2c_bus_dev_t *dev, uint8_t reg, const uint8_t *data, size_t len,
+                        i2c_bus_prio_t prio);
+
+/**
+ * @brief Copy a device's statistics
+ */
+void i2c_bus_get_stats(const i2c_bus_dev_t *dev, i2c_bus_dev_stats_t *out);
+
+/**
+ * @brief Name given to i2c_bus_add_device()
+ */
+const char *i2c_bus_dev_name(const i2c_bus_dev_t *dev);
+
+/**
+ * @brief Log one line of statistics per device
+ */
+void i2c_bus_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
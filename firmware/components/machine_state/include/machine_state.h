@@ -76,17 +76,32 @@ typedef enum {
 #define RO_DOOR_LOCK        6       /* CH6: Door lock solenoid */
 #define RO_CHAMBER_LIGHT    7       /* CH7: Chamber lighting */
 
-/* Run state information for telemetry */
+/*
+ * Run state information for telemetry.
+ * Fixed-width fields: telemetry.c reads this through a local mirror of the
+ * layout (it cannot depend on machine_state), so keep the two in step.
+ */
 typedef struct {
-    machine_state_t state;              /* Current machine state */
-    run_mode_t      run_mode;           /* Active run mode */
+    uint8_t         state;              /* Current machine state (machine_state_t) */
+    uint8_t         run_mode;           /* Active run mode (run_mode_t) */
     uint32_t        run_elapsed_ms;     /* Time since run started (0 if not running) */
-    uint32_t        run_remaining_ms;   /* Time until run completes (0 if no target) */
+    uint32_t        run_remaining_ms;   /* Time until run completes (0 if no target);
+                                         * in PRECOOL the time-to-target estimate */
     int16_t         target_temp_x10;    /* Current target temperature × 10 */
-    uint8_t         recipe_step;        /* Current recipe step (0-based) */
+    uint8_t         recipe_step;        /* Current recipe step, 1-based (0 = no recipe) */
     uint8_t         interlock_bits;     /* Which interlocks are blocking start */
+    uint8_t         precool_eta;        /* WIRE_PRECOOL_ETA_* status | band */
 } machine_run_info_t;
 
+/* Digital input wake-up statistics (di_sampler edges) */
+typedef struct {
+    uint32_t edges;             /* DI edges that woke the state task */
+    uint32_t trips_irq;         /* E-stop / door trips detected on an edge wake */
+    uint32_t trips_poll;        /* ...detected by the periodic tick instead */
+    uint32_t last_latency_us;   /* Raw change -> safe outputs applied, last edge trip */
+    uint32_t max_latency_us;    /* Worst edge trip latency since boot */
+} machine_state_di_stats_t;
+
 /* State change callback type */
 typedef void (*machine_state_cb_t)(machine_state_t old_state, machine_state_t new_state);
 
@@ -111,6 +126,9 @@ const char *machine_state_to_str(machine_state_t state);
 
 /**
  * @brief Get current run information for telemetry
+ *
+ * Lock-free copy of the snapshot the state task publishes after every
+ * tick and command; at most one tick old.
  */
 void machine_state_get_run_info(machine_run_info_t *out_info);
 
@@ -131,89 +149,87 @@ uint8_t machine_state_get_interlocks(void);
  */
 bool machine_state_start_allowed(void);
 
-/**
- * @brief Request transition to PRECOOL/RUNNING state
- *
- * @param session_id Session ID for validation
- * @param mode Run mode (NORMAL, DRY_RUN, PRECOOL_ONLY)
- * @param target_temp_x10 Target temperature × 10 (optional, 0 for default)
- * @param run_duration_ms Run duration in ms (0 for indefinite)
- * @return ESP_OK if transition started
- *         ESP_ERR_INVALID_STATE if not in IDLE
- *         ESP_ERR_NOT_ALLOWED if interlocks prevent start
- */
-esp_err_t machine_state_start_run(uint32_t session_id, run_mode_t mode,
-                                   int16_t target_temp_x10, uint32_t run_duration_ms);
+/* Commands accepted by machine_state_post() */
+typedef enum {
+    MACHINE_STATE_CMD_START_RUN = 0,    /* IDLE -> PRECOOL; INVALID_STATE if not IDLE,
+                                         * NOT_ALLOWED if interlocks prevent start */
+    MACHINE_STATE_CMD_START_RECIPE,     /* As START_RUN, running the recipe in a slot;
+                                         * NOT_FOUND for an empty slot, NOT_SUPPORTED
+                                         * for RUN_MODE_PRECOOL_ONLY */
+    MACHINE_STATE_CMD_STOP_RUN,         /* INVALID_STATE if nothing to stop */
+    MACHINE_STATE_CMD_PAUSE_RUN,        /* RUNNING/PRECOOL -> PAUSED: motor off, door unlocked,
+                                         * E-stop stays armed */
+    MACHINE_STATE_CMD_RESUME_RUN,       /* PAUSED -> previous state; NOT_ALLOWED if the door
+                                         * is open or another interlock is active */
+    MACHINE_STATE_CMD_ENTER_SERVICE,    /* IDLE -> SERVICE */
+    MACHINE_STATE_CMD_EXIT_SERVICE,     /* SERVICE -> IDLE */
+    MACHINE_STATE_CMD_CLEAR_ESTOP,      /* INVALID_STATE while the E-stop is still pressed */
+    MACHINE_STATE_CMD_CLEAR_FAULT,      /* INVALID_STATE while the fault is still present */
+} machine_state_cmd_op_t;
 
-/**
- * @brief Request stop/abort of current run
- *
- * @param session_id Session ID for validation
- * @param mode Stop mode (NORMAL or ABORT)
- * @return ESP_OK if stop initiated
- */
-esp_err_t machine_state_stop_run(uint32_t session_id, stop_mode_t mode);
+typedef struct machine_state_cmd machine_state_cmd_t;
 
-/**
- * @brief Pause current run
- *
- * Stops motor, unlocks door for inspection. Optionally keeps cooling active.
- * Door interlock is bypassed during pause to allow inspection without fault.
- * E-stop remains active and will still trigger E_STOP state.
- *
- * @param session_id Session ID for validation
- * @param mode PAUSE_MODE_KEEP_COOLING or PAUSE_MODE_STOP_COOLING
- * @return ESP_OK if pause initiated
- *         ESP_ERR_INVALID_STATE if not in RUNNING or PRECOOL
- */
-esp_err_t machine_state_pause_run(uint32_t session_id, pause_mode_t mode);
+/* Outcome of a command, delivered on the state task */
+typedef struct {
+    esp_err_t       err;            /* ESP_OK, or as listed per machine_state_cmd_op_t;
+                                     * ESP_ERR_INVALID_ARG for an invalid session */
+    uint8_t         state;          /* Machine state after the command (machine_state_t) */
+    uint8_t         interlocks;     /* Interlock bits after the command */
+    uint32_t        latency_us;     /* Post -> command applied (entry actions included) */
+} machine_state_reply_t;
 
-/**
- * @brief Resume from paused state
- *
- * Closes door, locks it, re-establishes cooling, then resumes run.
- * Will re-check interlocks (except door during the resume sequence).
- * Motor will restart after safety checks pass.
- *
- * @param session_id Session ID for validation
- * @return ESP_OK if resume initiated
- *         ESP_ERR_INVALID_STATE if not in PAUSED
- *         ESP_ERR_NOT_ALLOWED if door still open or other interlocks active
+/*
+ * Reply callback. Runs on the state task once the command has been applied:
+ * keep it short and never call back into a blocking API from it.
  */
-esp_err_t machine_state_resume_run(uint32_t session_id);
+typedef void (*machine_state_reply_cb_t)(const machine_state_cmd_t *cmd,
+                                         const machine_state_reply_t *reply);
 
-/**
- * @brief Enter service mode (manual relay control)
- *
- * @param session_id Session ID for validation
- * @return ESP_OK if entered service mode
- *         ESP_ERR_INVALID_STATE if not in IDLE
- */
-esp_err_t machine_state_enter_service(uint32_t session_id);
+struct machine_state_cmd {
+    machine_state_cmd_op_t op;
+    uint32_t        session_id;     /* Checked against the live session */
+    union {
+        struct {
+            uint8_t  run_mode;          /* run_mode_t */
+            uint8_t  recipe_slot;       /* START_RECIPE: 1..RECIPE_SLOT_COUNT */
+            int16_t  target_temp_x10;   /* START_RUN: 0 for the default */
+            uint32_t run_duration_ms;   /* START_RUN: 0 for indefinite */
+        } start;
+        uint8_t     stop_mode;          /* stop_mode_t */
+        uint8_t     pause_mode;         /* pause_mode_t */
+    };
+    machine_state_reply_cb_t reply; /* NULL: fire and forget */
+    uint32_t        tag;            /* Caller data, passed back untouched */
+    void            *ctx;
+    int64_t         posted_us;      /* Set by machine_state_post() */
+};
 
-/**
- * @brief Exit service mode
- *
- * @param session_id Session ID for validation
- * @return ESP_OK if exited service mode
- */
-esp_err_t machine_state_exit_service(uint32_t session_id);
+/* Command queue statistics */
+typedef struct {
+    uint32_t posted;            /* Commands accepted by machine_state_post() */
+    uint32_t queue_full;        /* Commands rejected because the queue was full */
+    uint32_t last_latency_us;   /* Post -> command applied, last command */
+    uint32_t max_latency_us;    /* Worst command latency since boot */
+} machine_state_cmd_stats_t;
 
 /**
- * @brief Clear E-stop condition (requires E-stop released + HMI ack)
+ * @brief Queue a command for the state task
+ *
+ * Never blocks: the state task owns the state machine (and the relay I2C
+ * writes its transitions perform), applies queued commands in order after
+ * its next tick and reports the outcome through cmd->reply.
  *
- * @param session_id Session ID for validation
- * @return ESP_OK if cleared, ESP_ERR_INVALID_STATE if E-stop still active
+ * @param cmd Command; copied into the queue
+ * @return ESP_OK if queued (the reply will follow)
+ *         ESP_ERR_INVALID_STATE if not initialized
+ *         ESP_ERR_NO_MEM if the queue is full (no reply will follow)
  */
-esp_err_t machine_state_clear_estop(uint32_t session_id);
+esp_err_t machine_state_post(const machine_state_cmd_t *cmd);
 
 /**
- * @brief Clear fault condition
- *
- * @param session_id Session ID for validation
- * @return ESP_OK if cleared, ESP_ERR_INVALID_STATE if fault still present
+ * @brief Get command queue statistics
  */
-esp_err_t machine_state_clear_fault(uint32_t session_id);
+void machine_state_get_cmd_stats(machine_state_cmd_stats_t *out);
 
 /**
  * @brief Register state change callback
@@ -227,17 +243,27 @@ void machine_state_set_callback(machine_state_cb_t cb);
 /**
  * @brief Read current digital input state
  *
- * Reads all 8 digital inputs and returns as bitmask.
+ * Returns the filtered inputs (di_sampler) as of the state task's last tick.
  * bit 0 = DI1, bit 7 = DI8
  *
  * @return Digital input bitmask
  */
 uint16_t machine_state_read_di_bits(void);
 
+/**
+ * @brief Get digital input wake-up statistics
+ *
+ * Latency is measured from the edge's first raw sight (the INT edge when
+ * wired, see di_sampler.h) to the return of the E_STOP / FAULT transition,
+ * i.e. after the safe relay pattern has been written to the output expander.
+ */
+void machine_state_get_di_stats(machine_state_di_stats_t *out);
+
 /**
  * @brief Force transition to safe state (called on critical errors)
  *
- * Immediately disables all outputs and transitions to FAULT state.
+ * Wakes the state task, which disables all outputs and transitions to
+ * FAULT ahead of any queued command. Safe to call from any task.
  */
 void machine_state_force_safe(void);
 
@@ -1,19 +1,26 @@
 #include "machine_state.h"
+#include "machine_state_core.h"
 #include "relay_ctrl.h"
+#include "di_sampler.h"
 #include "session_mgr.h"
 #include "telemetry.h"
 #include "wire_protocol.h"
 #include "pid_controller.h"
 #include "ble_gatt.h"
 #include "safety_gate.h"
+#include "trace_log.h"
 
+#include <stdatomic.h>
+#include <string.h>
+
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "driver/gpio.h"
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
+#include "freertos/queue.h"
 
 static const char *TAG = "machine_state";
 
@@ -25,34 +32,60 @@ static const char *TAG = "machine_state";
 /* State machine task parameters */
 #define STATE_TASK_STACK_SIZE   4096
 #define STATE_TASK_PRIORITY     6       /* Higher than telemetry (5) */
-#define STATE_POLL_INTERVAL_MS  50      /* 20 Hz state machine tick */
+#define STATE_POLL_INTERVAL_MS  MS_CORE_TICK_MS     /* 20 Hz state machine tick */
+
+/* Commands waiting for the state task */
+#define STATE_CMD_QUEUE_LEN     8
+
+/* State task notification bits */
+#define NOTIFY_DI_EDGE          (1 << 0)    /* di_sampler accepted an input change */
+#define NOTIFY_CMD              (1 << 1)    /* Command queued */
+#define NOTIFY_FORCE_SAFE       (1 << 2)    /* machine_state_force_safe() */
+#define NOTIFY_SEQ              (1 << 3)    /* Relay sequence step due */
+#define NOTIFY_RELAY_MISMATCH   (1 << 4)    /* relay_ctrl found the outputs wrong */
+#define NOTIFY_SESSION          (1 << 5)    /* HMI session went live, stale or closed */
 
-/* Precool parameters */
-#define PRECOOL_TARGET_TEMP_X10     (-500)  /* -50.0°C default precool target */
-#define PRECOOL_TIMEOUT_MS          (300000) /* 5 minute precool timeout */
-#define PRECOOL_TEMP_TOLERANCE_X10  50      /* ±5°C tolerance for temp reached */
+/* LN2 supply sensor flickers with boil-off: majority over this many samples */
+#define DI_LN2_MAJORITY_WINDOW  15
+
+/* PID controller address for chamber temperature */
+#define CHAMBER_PID_ADDR    MS_PID_ADDR_CHAMBER
 
-/* Stopping phase parameters */
-#define STOPPING_SOAK_TIME_MS       (30000) /* 30 second thermal soak */
+/* State machine core (see machine_state_core.h), owned by the state task */
+static ms_core_t s_core;
 
-/* State machine state */
-static machine_state_t s_state = MACHINE_STATE_IDLE;
-static run_mode_t s_run_mode = RUN_MODE_NORMAL;
-static int64_t s_run_start_us = 0;
-static uint32_t s_run_duration_ms = 0;
-static int16_t s_target_temp_x10 = 0;
-static int64_t s_state_enter_us = 0;
+/* First raw sight of the last DI edge (low 32 bits of esp_timer, us) */
+static volatile uint32_t s_di_edge_us = 0;
 
-/* Pause state tracking */
-static pause_mode_t s_pause_mode = PAUSE_MODE_KEEP_COOLING;
-static machine_state_t s_pre_pause_state = MACHINE_STATE_IDLE;  /* State before pause (RUNNING or PRECOOL) */
-static int64_t s_pause_time_us = 0;  /* Time at which pause started (for run timer adjustment) */
+/* Last output mismatch from the relay_ctrl reconciler, reported by the state task */
+static relay_ctrl_mismatch_t s_relay_mismatch;
 
-/* Digital input state (cached from last read) */
-static uint16_t s_di_bits = 0xFF;   /* All HIGH = safe default */
+/* One-shot for the next relay sequence step (ms_env_t.wake_at) */
+static esp_timer_handle_t s_seq_timer = NULL;
 
-/* Mutex for state access */
-static SemaphoreHandle_t s_mutex = NULL;
+/* Commands from other tasks; only the state task dequeues */
+static QueueHandle_t s_cmd_queue = NULL;
+
+/*
+ * What other tasks may read, republished by the state task after every tick
+ * and command. Sequence lock: the writer makes seq odd while it copies, a
+ * reader retries if seq was odd or moved during its copy.
+ */
+typedef struct {
+    machine_run_info_t        info;
+    uint16_t                  di_bits;
+    machine_state_di_stats_t  di_stats;
+    machine_state_cmd_stats_t cmd_stats;
+} state_snapshot_t;
+
+static state_snapshot_t s_snap;             /* Written by the state task only */
+static atomic_uint s_snap_seq = 0;
+
+/* Working copies of the statistics, state task only */
+static machine_state_di_stats_t s_di_stats = {0};
+static machine_state_cmd_stats_t s_cmd_stats = {0};
+static atomic_uint s_cmd_posted = 0;
+static atomic_uint s_cmd_queue_full = 0;
 
 /* State change callback */
 static machine_state_cb_t s_state_callback = NULL;
@@ -64,425 +97,416 @@ static bool s_running = false;
 /* Event sequence counter */
 static uint16_t s_event_seq = 0;
 
-/* State name strings */
-static const char *state_names[] = {
-    [MACHINE_STATE_IDLE]     = "IDLE",
-    [MACHINE_STATE_PRECOOL]  = "PRECOOL",
-    [MACHINE_STATE_RUNNING]  = "RUNNING",
-    [MACHINE_STATE_STOPPING] = "STOPPING",
-    [MACHINE_STATE_E_STOP]   = "E_STOP",
-    [MACHINE_STATE_FAULT]    = "FAULT",
-    [MACHINE_STATE_SERVICE]  = "SERVICE",
-    [MACHINE_STATE_PAUSED]   = "PAUSED",
-};
-
-/* PID controller address for chamber temperature */
-#define CHAMBER_PID_ADDR    1
-
 /* Forward declarations */
 static void state_task(void *arg);
-static void transition_to(machine_state_t new_state);
-static void set_outputs_safe(void);
-static void update_di_bits(void);
-static bool check_estop_active(void);
-static bool check_door_open(void);
-static bool check_motor_fault(void);
-static bool check_ln2_present(void);
-static bool get_chamber_temp(int16_t *temp_x10);
-
-const char *machine_state_to_str(machine_state_t state)
-{
-    if (state < MACHINE_STATE_MAX) {
-        return state_names[state];
-    }
-    return "UNKNOWN";
-}
+static void di_subscribe(void);
+static void on_relay_mismatch(const relay_ctrl_mismatch_t *m, void *ctx);
+static void on_session_state(session_state_t old_state, session_state_t new_state, void *ctx);
 
-esp_err_t machine_state_init(void)
+/* ===== Environment ===== */
+
+static int64_t env_now_us(void *ctx)
 {
-    if (s_mutex != NULL) {
-        ESP_LOGW(TAG, "Already initialized");
-        return ESP_ERR_INVALID_STATE;
-    }
+    (void)ctx;
+    return esp_timer_get_time();
+}
 
-    s_mutex = xSemaphoreCreateMutex();
-    if (s_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create mutex");
-        return ESP_ERR_NO_MEM;
+static esp_err_t env_read_di(void *ctx, uint8_t *di_byte)
+{
+    (void)ctx;
+    /* Filtered image from the sampler; straight from the expander without it */
+    esp_err_t err = di_sampler_read(di_byte);
+    if (err == ESP_ERR_INVALID_STATE) {
+        err = relay_ctrl_read_di(di_byte);
     }
+    return err;
+}
 
-    /* Initialize state */
-    s_state = MACHINE_STATE_IDLE;
-    s_state_enter_us = esp_timer_get_time();
-
-    /* Read initial DI state */
-    update_di_bits();
+/**
+ * @brief Get current chamber temperature from PID controller
+ *
+ * @param temp_x10 Output: temperature in tenths of degree C
+ * @return true if valid temperature was read, false if controller offline/stale
+ */
+static bool env_chamber_temp(void *ctx, int16_t *temp_x10)
+{
+    (void)ctx;
+    pid_controller_t ctrl;
 
-    /* Check if E-stop is active on startup */
-    if (check_estop_active()) {
-        ESP_LOGW(TAG, "E-Stop active on startup");
-        s_state = MACHINE_STATE_E_STOP;
-        set_outputs_safe();
+    /* Get PID controller 1 (chamber temperature) */
+    if (pid_controller_get_by_addr(CHAMBER_PID_ADDR, &ctrl) != ESP_OK) {
+        return false;
     }
 
-    /* Start state machine task */
-    s_running = true;
-    BaseType_t ok = xTaskCreatePinnedToCore(
-        state_task,
-        "machine_state",
-        STATE_TASK_STACK_SIZE,
-        NULL,
-        STATE_TASK_PRIORITY,
-        &s_task_handle,
-        0
-    );
-
-    if (ok != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create state task");
-        vSemaphoreDelete(s_mutex);
-        s_mutex = NULL;
-        return ESP_FAIL;
+    /* Check if data is fresh */
+    if (ctrl.state != PID_STATE_ONLINE) {
+        ESP_LOGD(TAG, "PID controller %d not online (state=%d)", CHAMBER_PID_ADDR, ctrl.state);
+        return false;
     }
 
-    ESP_LOGI(TAG, "Machine state initialized: state=%s", machine_state_to_str(s_state));
-    return ESP_OK;
+    /* Convert from float to x10 integer */
+    *temp_x10 = (int16_t)(ctrl.data.pv * 10.0f);
+    return true;
 }
 
-machine_state_t machine_state_get(void)
+static bool env_hmi_live(void *ctx)
 {
-    return s_state;
+    (void)ctx;
+    return session_mgr_is_live();
 }
 
-void machine_state_get_run_info(machine_run_info_t *out_info)
+static bool env_start_allowed(void *ctx)
 {
-    if (out_info == NULL) return;
-
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-
-    out_info->state = s_state;
-    out_info->run_mode = s_run_mode;
-    out_info->target_temp_x10 = s_target_temp_x10;
-    out_info->recipe_step = 0;  /* Not implemented yet */
-    out_info->interlock_bits = machine_state_get_interlocks();
-
-    /* Calculate elapsed/remaining time */
-    if (s_run_start_us > 0 && (s_state == MACHINE_STATE_PRECOOL ||
-                                s_state == MACHINE_STATE_RUNNING)) {
-        int64_t elapsed_us = esp_timer_get_time() - s_run_start_us;
-        out_info->run_elapsed_ms = (uint32_t)(elapsed_us / 1000);
+    (void)ctx;
+    return machine_state_start_allowed();
+}
 
-        if (s_run_duration_ms > 0 && out_info->run_elapsed_ms < s_run_duration_ms) {
-            out_info->run_remaining_ms = s_run_duration_ms - out_info->run_elapsed_ms;
-        } else {
-            out_info->run_remaining_ms = 0;
-        }
-    } else {
-        out_info->run_elapsed_ms = 0;
-        out_info->run_remaining_ms = 0;
+static void env_set_sv(void *ctx, uint8_t pid_addr, int16_t sv_x10)
+{
+    (void)ctx;
+    /* Coalesced in pid_controller; called every tick during a ramp */
+    esp_err_t err = pid_controller_stream_sv(pid_addr, sv_x10 / 10.0f);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "SV request for PID %u failed: %s", pid_addr, esp_err_to_name(err));
     }
+}
 
-    xSemaphoreGive(s_mutex);
+static esp_err_t env_write_outputs(void *ctx, uint8_t mask, uint8_t values, bool verify)
+{
+    (void)ctx;
+    relay_ctrl_txn_t txn;
+    relay_ctrl_txn_begin(&txn);
+    relay_ctrl_txn_set_mask(&txn, mask, values);
+    /* Verify forces the write: safing re-asserts the image even if the cache agrees */
+    return relay_ctrl_txn_commit(&txn, verify ? (RELAY_TXN_VERIFY | RELAY_TXN_FORCE) : 0);
 }
 
-uint8_t machine_state_get_interlocks(void)
+static void env_outputs_changed(void *ctx)
 {
-    uint8_t interlocks = 0;
+    (void)ctx;
+    telemetry_set_ro_bits(relay_ctrl_get_state());
+}
 
-    if (check_estop_active()) {
-        interlocks |= INTERLOCK_BIT_ESTOP;
-    }
-    if (check_door_open()) {
-        interlocks |= INTERLOCK_BIT_DOOR_OPEN;
-    }
-    if (!check_ln2_present()) {
-        interlocks |= INTERLOCK_BIT_LN2_ABSENT;
+static void env_inputs_changed(void *ctx, uint16_t di_bits)
+{
+    /* Telemetry subscribes to di_sampler edges itself */
+    (void)ctx;
+    (void)di_bits;
+}
+
+/**
+ * @brief Emit an event via BLE GATT
+ */
+static void env_event(void *ctx, uint16_t event_id, uint8_t severity,
+                      const uint8_t *data, size_t data_len)
+{
+    (void)ctx;
+    wire_writer_t w;
+    esp_err_t err = ble_gatt_frame_begin(&w);
+    if (err == ESP_OK) {
+        wire_write_event(&w, s_event_seq++, event_id, severity, 0, data, data_len);
+        err = ble_gatt_frame_send_event(&w, severity >= EVENT_SEVERITY_ALARM);
     }
-    /* Motor fault check disabled - soft starter has no fault output.
-     * INTERLOCK_BIT_MOTOR_FAULT reserved for future accelerometer-based detection.
-     * if (check_motor_fault()) {
-     *     interlocks |= INTERLOCK_BIT_MOTOR_FAULT;
-     * }
-     */
-    if (!session_mgr_is_live()) {
-        interlocks |= INTERLOCK_BIT_HMI_STALE;
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "Failed to send event 0x%04X: %s", event_id, esp_err_to_name(err));
     }
-
-    return interlocks;
 }
 
-bool machine_state_start_allowed(void)
+static void env_transition(void *ctx, machine_state_t old_state, machine_state_t new_state)
 {
-    /* Use the safety gate framework for comprehensive start checks.
-     * This evaluates E-stop, door, HMI, and PID-related gates based on
-     * configured capability levels and gate bypass states. */
-    return safety_gate_can_start_run(NULL);
+    (void)ctx;
+    if (s_state_callback != NULL) {
+        s_state_callback(old_state, new_state);
+    }
 }
 
-esp_err_t machine_state_start_run(uint32_t session_id, run_mode_t mode,
-                                   int16_t target_temp_x10, uint32_t run_duration_ms)
+static void seq_timer_cb(void *arg)
 {
-    /* Validate session */
-    if (!session_mgr_is_valid(session_id)) {
-        ESP_LOGW(TAG, "START_RUN rejected: invalid session");
-        return ESP_ERR_INVALID_ARG;
-    }
+    (void)arg;
+    xTaskNotify(s_task_handle, NOTIFY_SEQ, eSetBits);
+}
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+/* Steps are written on a state task wake-up, never by a blocking delay */
+static void env_wake_at(void *ctx, int64_t due_us)
+{
+    (void)ctx;
+    int64_t delay_us = due_us - esp_timer_get_time();
+    esp_timer_stop(s_seq_timer);
+    esp_timer_start_once(s_seq_timer, delay_us > 0 ? (uint64_t)delay_us : 0);
+}
 
-    /* Check current state */
-    if (s_state != MACHINE_STATE_IDLE) {
-        ESP_LOGW(TAG, "START_RUN rejected: not in IDLE (state=%s)",
-                 machine_state_to_str(s_state));
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
-    }
+static void env_seq_step(void *ctx, const relay_seq_t *seq, uint8_t index, int64_t started_us)
+{
+    (void)ctx;
+    int64_t now_us = esp_timer_get_time();
+    TRACE_LOGI(TRACE_FMT_STATE_SEQ_STEP, seq->id, index + 1, seq->count,
+               relay_ctrl_get_state(), (uint32_t)now_us, (uint32_t)(now_us - started_us));
+}
 
-    /* Check interlocks */
-    if (!machine_state_start_allowed()) {
-        uint8_t interlocks = machine_state_get_interlocks();
-        ESP_LOGW(TAG, "START_RUN rejected: interlocks=0x%02X", interlocks);
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_NOT_ALLOWED;
-    }
+static const ms_env_t s_env = {
+    .now_us          = env_now_us,
+    .read_di         = env_read_di,
+    .chamber_temp    = env_chamber_temp,
+    .hmi_live        = env_hmi_live,
+    .start_allowed   = env_start_allowed,
+    .set_sv          = env_set_sv,
+    .write_outputs   = env_write_outputs,
+    .outputs_changed = env_outputs_changed,
+    .inputs_changed  = env_inputs_changed,
+    .event           = env_event,
+    .transition      = env_transition,
+    .wake_at         = env_wake_at,
+    .seq_step        = env_seq_step,
+    .ctx             = NULL,
+};
 
-    /* Warn if LN2 not present but don't block */
-    if (!check_ln2_present()) {
-        ESP_LOGW(TAG, "Warning: LN2 not present, cooling may be impaired");
-    }
+/* ===== Snapshot ===== */
 
-    /* Store run parameters */
-    s_run_mode = mode;
-    s_target_temp_x10 = (target_temp_x10 != 0) ? target_temp_x10 : PRECOOL_TARGET_TEMP_X10;
-    s_run_duration_ms = run_duration_ms;
-    s_run_start_us = esp_timer_get_time();
+static bool on_state_task(void)
+{
+    return xTaskGetCurrentTaskHandle() == s_task_handle;
+}
 
-    /* Transition to PRECOOL */
-    transition_to(MACHINE_STATE_PRECOOL);
+/* State task only */
+static void publish_snapshot(void)
+{
+    unsigned seq = atomic_load_explicit(&s_snap_seq, memory_order_relaxed);
+    atomic_store_explicit(&s_snap_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
 
-    ESP_LOGI(TAG, "Run started: mode=%d target_temp=%d.%d run_duration=%lums",
-             mode, s_target_temp_x10 / 10, abs(s_target_temp_x10 % 10),
-             (unsigned long)run_duration_ms);
+    ms_core_get_run_info(&s_core, &s_snap.info);
+    s_snap.di_bits = s_core.di_bits;
+    s_snap.di_stats = s_di_stats;
+    s_snap.cmd_stats = s_cmd_stats;
 
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
+    atomic_store_explicit(&s_snap_seq, seq + 2, memory_order_release);
 }
 
-esp_err_t machine_state_stop_run(uint32_t session_id, stop_mode_t mode)
+static void read_snapshot(state_snapshot_t *out)
 {
-    /* Validate session */
-    if (!session_mgr_is_valid(session_id)) {
-        ESP_LOGW(TAG, "STOP_RUN rejected: invalid session");
-        return ESP_ERR_INVALID_ARG;
-    }
+    unsigned seq;
+    do {
+        seq = atomic_load_explicit(&s_snap_seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(out, &s_snap, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || atomic_load_explicit(&s_snap_seq, memory_order_relaxed) != seq);
+}
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+/* ===== Commands (state task) ===== */
 
-    /* Check if we're in a stoppable state (including PAUSED) */
-    if (s_state != MACHINE_STATE_PRECOOL &&
-        s_state != MACHINE_STATE_RUNNING &&
-        s_state != MACHINE_STATE_PAUSED) {
-        ESP_LOGW(TAG, "STOP_RUN ignored: state=%s", machine_state_to_str(s_state));
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
+static esp_err_t start_recipe(run_mode_t mode, uint8_t slot)
+{
+    /* A recipe ends in STOPPING; it has no PRECOOL-only form */
+    if (mode == RUN_MODE_PRECOOL_ONLY) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
 
-    if (mode == STOP_MODE_ABORT) {
-        /* Fast stop - go directly to safe state */
-        ESP_LOGW(TAG, "ABORT requested - immediate stop");
-        set_outputs_safe();
-        transition_to(MACHINE_STATE_IDLE);
-    } else {
-        /* Normal stop - go through STOPPING phase */
-        transition_to(MACHINE_STATE_STOPPING);
+    /* NVS read, no I2C */
+    recipe_t recipe;
+    esp_err_t err = recipe_load(slot, &recipe);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "START_RUN rejected: recipe slot %u: %s", slot, esp_err_to_name(err));
+        return ESP_ERR_NOT_FOUND;
     }
-
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
+    return ms_core_start_recipe(&s_core, mode, &recipe);
 }
 
-esp_err_t machine_state_pause_run(uint32_t session_id, pause_mode_t mode)
+static esp_err_t execute_command(const machine_state_cmd_t *cmd)
 {
-    /* Validate session */
-    if (!session_mgr_is_valid(session_id)) {
-        ESP_LOGW(TAG, "PAUSE_RUN rejected: invalid session");
+    if (!session_mgr_is_valid(cmd->session_id)) {
+        ESP_LOGW(TAG, "Command %d rejected: invalid session", cmd->op);
         return ESP_ERR_INVALID_ARG;
     }
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-
-    /* Check if we're in a pausable state */
-    if (s_state != MACHINE_STATE_PRECOOL && s_state != MACHINE_STATE_RUNNING) {
-        ESP_LOGW(TAG, "PAUSE_RUN rejected: state=%s", machine_state_to_str(s_state));
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
+    switch (cmd->op) {
+    case MACHINE_STATE_CMD_START_RUN:
+        return ms_core_start_run(&s_core, (run_mode_t)cmd->start.run_mode,
+                                 cmd->start.target_temp_x10, cmd->start.run_duration_ms);
+    case MACHINE_STATE_CMD_START_RECIPE:
+        return start_recipe((run_mode_t)cmd->start.run_mode, cmd->start.recipe_slot);
+    case MACHINE_STATE_CMD_STOP_RUN:
+        return ms_core_stop_run(&s_core, (stop_mode_t)cmd->stop_mode);
+    case MACHINE_STATE_CMD_PAUSE_RUN:
+        return ms_core_pause_run(&s_core, (pause_mode_t)cmd->pause_mode);
+    case MACHINE_STATE_CMD_RESUME_RUN:
+        return ms_core_resume_run(&s_core);
+    case MACHINE_STATE_CMD_ENTER_SERVICE:
+        return ms_core_enter_service(&s_core);
+    case MACHINE_STATE_CMD_EXIT_SERVICE:
+        return ms_core_exit_service(&s_core);
+    case MACHINE_STATE_CMD_CLEAR_ESTOP:
+        return ms_core_clear_estop(&s_core);
+    case MACHINE_STATE_CMD_CLEAR_FAULT:
+        /* Also acknowledges a relay output mismatch (ALARM_BIT_RELAY_MISMATCH) */
+        relay_ctrl_clear_mismatch();
+        return ms_core_clear_fault(&s_core);
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
-
-    /* Store pause state info */
-    s_pause_mode = mode;
-    s_pre_pause_state = s_state;
-    s_pause_time_us = esp_timer_get_time();
-
-    ESP_LOGI(TAG, "Pausing run: mode=%s from_state=%s",
-             mode == PAUSE_MODE_KEEP_COOLING ? "KEEP_COOLING" : "STOP_COOLING",
-             machine_state_to_str(s_pre_pause_state));
-
-    /* Set LN2 valve based on pause mode BEFORE transition
-     * (transition_to will set other outputs) */
-    if (mode == PAUSE_MODE_STOP_COOLING) {
-        relay_ctrl_set(RO_LN2_VALVE, RELAY_STATE_OFF);
-    }
-    /* If KEEP_COOLING, leave LN2 valve in current state (already on from PRECOOL/RUNNING) */
-
-    transition_to(MACHINE_STATE_PAUSED);
-
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
 }
 
-esp_err_t machine_state_resume_run(uint32_t session_id)
+/* Apply everything queued so far, in order, replying to each */
+static void drain_commands(void)
 {
-    /* Validate session */
-    if (!session_mgr_is_valid(session_id)) {
-        ESP_LOGW(TAG, "RESUME_RUN rejected: invalid session");
-        return ESP_ERR_INVALID_ARG;
+    machine_state_cmd_t cmd;
+
+    while (xQueueReceive(s_cmd_queue, &cmd, 0) == pdTRUE) {
+        machine_state_reply_t reply;
+        reply.err = execute_command(&cmd);
+        reply.state = (uint8_t)s_core.state;
+        reply.interlocks = ms_core_get_interlocks(&s_core);
+        reply.latency_us = (uint32_t)(esp_timer_get_time() - cmd.posted_us);
+
+        s_cmd_stats.last_latency_us = reply.latency_us;
+        if (reply.latency_us > s_cmd_stats.max_latency_us) {
+            s_cmd_stats.max_latency_us = reply.latency_us;
+        }
+        ESP_LOGD(TAG, "Command %d: %s in %luus", cmd.op, esp_err_to_name(reply.err),
+                 (unsigned long)reply.latency_us);
+
+        if (cmd.reply != NULL) {
+            cmd.reply(&cmd, &reply);
+        }
     }
+}
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+/* ===== Public API ===== */
 
-    /* Check if we're in PAUSED state */
-    if (s_state != MACHINE_STATE_PAUSED) {
-        ESP_LOGW(TAG, "RESUME_RUN rejected: state=%s", machine_state_to_str(s_state));
-        xSemaphoreGive(s_mutex);
+esp_err_t machine_state_init(void)
+{
+    if (s_cmd_queue != NULL) {
+        ESP_LOGW(TAG, "Already initialized");
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Check that door is closed before resuming */
-    if (check_door_open()) {
-        ESP_LOGW(TAG, "RESUME_RUN rejected: door still open");
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_NOT_ALLOWED;
-    }
-
-    /* Check E-stop is clear */
-    if (check_estop_active()) {
-        ESP_LOGW(TAG, "RESUME_RUN rejected: E-stop active");
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_NOT_ALLOWED;
+    s_cmd_queue = xQueueCreate(STATE_CMD_QUEUE_LEN, sizeof(machine_state_cmd_t));
+    if (s_cmd_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create command queue");
+        return ESP_ERR_NO_MEM;
     }
 
-    /* Check HMI is live */
-    if (!session_mgr_is_live()) {
-        ESP_LOGW(TAG, "RESUME_RUN rejected: HMI not live");
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_NOT_ALLOWED;
+    const esp_timer_create_args_t seq_timer_args = {
+        .callback = seq_timer_cb,
+        .name = "relay_seq",
+    };
+    if (esp_timer_create(&seq_timer_args, &s_seq_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create sequence timer");
+        vQueueDelete(s_cmd_queue);
+        s_cmd_queue = NULL;
+        return ESP_ERR_NO_MEM;
     }
 
-    ESP_LOGI(TAG, "Resuming run: returning to %s",
-             machine_state_to_str(s_pre_pause_state));
+    /* IDLE, or E_STOP if the button is already pressed */
+    ms_core_init(&s_core, &s_env);
+    publish_snapshot();
 
-    /* Always go through PRECOOL to re-establish temperature before resuming
-     * This ensures the chamber re-cools to target before motor starts */
-    transition_to(MACHINE_STATE_PRECOOL);
-
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
-}
+    /* Start state machine task */
+    s_running = true;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        state_task,
+        "machine_state",
+        STATE_TASK_STACK_SIZE,
+        NULL,
+        STATE_TASK_PRIORITY,
+        &s_task_handle,
+        0
+    );
 
-esp_err_t machine_state_enter_service(uint32_t session_id)
-{
-    if (!session_mgr_is_valid(session_id)) {
-        return ESP_ERR_INVALID_ARG;
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create state task");
+        esp_timer_delete(s_seq_timer);
+        s_seq_timer = NULL;
+        vQueueDelete(s_cmd_queue);
+        s_cmd_queue = NULL;
+        return ESP_FAIL;
     }
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-
-    if (s_state != MACHINE_STATE_IDLE) {
-        ESP_LOGW(TAG, "Cannot enter SERVICE: not in IDLE");
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
+    di_subscribe();
+    relay_ctrl_set_mismatch_cb(on_relay_mismatch, NULL);
+    if (session_mgr_subscribe(on_session_state, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "No session callbacks - HMI loss seen on the next periodic tick");
     }
 
-    transition_to(MACHINE_STATE_SERVICE);
-
-    xSemaphoreGive(s_mutex);
+    ESP_LOGI(TAG, "Machine state initialized: state=%s", machine_state_to_str(s_core.state));
     return ESP_OK;
 }
 
-esp_err_t machine_state_exit_service(uint32_t session_id)
+machine_state_t machine_state_get(void)
 {
-    if (!session_mgr_is_valid(session_id)) {
-        return ESP_ERR_INVALID_ARG;
+    if (on_state_task()) {
+        return s_core.state;
     }
-
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-
-    if (s_state != MACHINE_STATE_SERVICE) {
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    /* Turn off all relays when leaving service mode */
-    relay_ctrl_all_off();
-    telemetry_set_ro_bits(0);
-
-    transition_to(MACHINE_STATE_IDLE);
-
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
+    state_snapshot_t snap;
+    read_snapshot(&snap);
+    return (machine_state_t)snap.info.state;
 }
 
-esp_err_t machine_state_clear_estop(uint32_t session_id)
+void machine_state_get_run_info(machine_run_info_t *out_info)
 {
-    if (!session_mgr_is_valid(session_id)) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (out_info == NULL) return;
 
-    if (s_state != MACHINE_STATE_E_STOP) {
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
+    if (on_state_task()) {
+        ms_core_get_run_info(&s_core, out_info);
+        return;
     }
+    state_snapshot_t snap;
+    read_snapshot(&snap);
+    *out_info = snap.info;
+}
 
-    /* Check that E-stop is actually released */
-    if (check_estop_active()) {
-        ESP_LOGW(TAG, "Cannot clear E-stop: still active");
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
+uint8_t machine_state_get_interlocks(void)
+{
+    /* The state task (start checks via safety_gate) needs the live bits */
+    if (on_state_task()) {
+        return ms_core_get_interlocks(&s_core);
     }
+    state_snapshot_t snap;
+    read_snapshot(&snap);
+    return snap.info.interlock_bits;
+}
 
-    transition_to(MACHINE_STATE_IDLE);
-    ESP_LOGI(TAG, "E-stop cleared");
-
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
+bool machine_state_start_allowed(void)
+{
+    /* Use the safety gate framework for comprehensive start checks.
+     * This evaluates E-stop, door, HMI, and PID-related gates based on
+     * configured capability levels and gate bypass states. */
+    return safety_gate_can_start_run(NULL);
 }
 
-esp_err_t machine_state_clear_fault(uint32_t session_id)
+esp_err_t machine_state_post(const machine_state_cmd_t *cmd)
 {
-    if (!session_mgr_is_valid(session_id)) {
+    if (cmd == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
-
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-
-    if (s_state != MACHINE_STATE_FAULT) {
-        xSemaphoreGive(s_mutex);
+    if (s_cmd_queue == NULL || s_task_handle == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Check that fault condition is resolved */
-    if (check_motor_fault()) {
-        ESP_LOGW(TAG, "Cannot clear fault: motor fault still active");
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_INVALID_STATE;
+    machine_state_cmd_t item = *cmd;
+    item.posted_us = esp_timer_get_time();
+
+    if (xQueueSend(s_cmd_queue, &item, 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&s_cmd_queue_full, 1, memory_order_relaxed);
+        ESP_LOGW(TAG, "Command %d dropped: queue full", cmd->op);
+        return ESP_ERR_NO_MEM;
     }
+    atomic_fetch_add_explicit(&s_cmd_posted, 1, memory_order_relaxed);
+    xTaskNotify(s_task_handle, NOTIFY_CMD, eSetBits);
+    return ESP_OK;
+}
 
-    transition_to(MACHINE_STATE_IDLE);
-    ESP_LOGI(TAG, "Fault cleared");
+void machine_state_get_cmd_stats(machine_state_cmd_stats_t *out)
+{
+    if (out == NULL) return;
 
-    xSemaphoreGive(s_mutex);
-    return ESP_OK;
+    state_snapshot_t snap;
+    read_snapshot(&snap);
+    *out = snap.cmd_stats;
+    out->posted = atomic_load_explicit(&s_cmd_posted, memory_order_relaxed);
+    out->queue_full = atomic_load_explicit(&s_cmd_queue_full, memory_order_relaxed);
 }
 
 void machine_state_set_callback(machine_state_cb_t cb)
@@ -492,383 +516,190 @@ void machine_state_set_callback(machine_state_cb_t cb)
 
 uint16_t machine_state_read_di_bits(void)
 {
-    update_di_bits();
-    return s_di_bits;
-}
-
-void machine_state_force_safe(void)
-{
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-    set_outputs_safe();
-    transition_to(MACHINE_STATE_FAULT);
-    xSemaphoreGive(s_mutex);
-}
-
-/* ===== Internal Functions ===== */
-
-/**
- * @brief Emit an event via BLE GATT
- */
-static void emit_event(uint16_t event_id, uint8_t severity, const uint8_t *data, size_t data_len)
-{
-    uint8_t buf[64];
-    size_t frame_len = wire_build_event(buf, sizeof(buf), s_event_seq++,
-                                         event_id, severity, 0, data, data_len);
-    if (frame_len > 0) {
-        esp_err_t err = ble_gatt_send_event(buf, frame_len, severity >= EVENT_SEVERITY_ALARM);
-        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
-            ESP_LOGW(TAG, "Failed to send event 0x%04X: %s", event_id, esp_err_to_name(err));
-        }
+    if (on_state_task()) {
+        return s_core.di_bits;
     }
+    state_snapshot_t snap;
+    read_snapshot(&snap);
+    return snap.di_bits;
 }
 
-/**
- * @brief Emit a state change event with old and new state in payload
- */
-static void emit_state_change_event(machine_state_t old_state, machine_state_t new_state)
-{
-    uint8_t payload[2] = { (uint8_t)old_state, (uint8_t)new_state };
-
-    /* Determine severity based on new state */
-    uint8_t severity = EVENT_SEVERITY_INFO;
-    if (new_state == MACHINE_STATE_E_STOP) {
-        severity = EVENT_SEVERITY_CRITICAL;
-    } else if (new_state == MACHINE_STATE_FAULT) {
-        severity = EVENT_SEVERITY_ALARM;
-    } else if (new_state == MACHINE_STATE_STOPPING) {
-        severity = EVENT_SEVERITY_WARN;
-    }
+void machine_state_get_di_stats(machine_state_di_stats_t *out)
+{
+    if (out == NULL) return;
 
-    emit_event(EVENT_STATE_CHANGED, severity, payload, sizeof(payload));
+    state_snapshot_t snap;
+    read_snapshot(&snap);
+    *out = snap.di_stats;
 }
 
-static void transition_to(machine_state_t new_state)
+void machine_state_force_safe(void)
 {
-    machine_state_t old_state = s_state;
-
-    if (old_state == new_state) {
+    if (s_task_handle == NULL) {
         return;
     }
-
-    ESP_LOGI(TAG, "State transition: %s -> %s",
-             machine_state_to_str(old_state), machine_state_to_str(new_state));
-
-    s_state = new_state;
-    s_state_enter_us = esp_timer_get_time();
-
-    /* Execute entry actions for new state */
-    switch (new_state) {
-        case MACHINE_STATE_IDLE:
-            set_outputs_safe();
-            s_run_start_us = 0;
-            break;
-
-        case MACHINE_STATE_PRECOOL:
-            /* Lock door, start cooling */
-            relay_ctrl_set(RO_DOOR_LOCK, RELAY_STATE_ON);
-            relay_ctrl_set(RO_LN2_VALVE, RELAY_STATE_ON);
-            /* Heaters controlled by PID - enable them */
-            relay_ctrl_set(RO_HEATER_1, RELAY_STATE_ON);
-            relay_ctrl_set(RO_HEATER_2, RELAY_STATE_ON);
-            /* Energize motor circuit (contactor + soft starter power) but don't start yet */
-            relay_ctrl_set(RO_MAIN_CONTACTOR, RELAY_STATE_ON);
-            telemetry_set_ro_bits(relay_ctrl_get_state());
-            break;
-
-        case MACHINE_STATE_RUNNING:
-            /* Trigger soft starter to start motor */
-            relay_ctrl_set(RO_MOTOR_START, RELAY_STATE_ON);
-            telemetry_set_ro_bits(relay_ctrl_get_state());
-            break;
-
-        case MACHINE_STATE_STOPPING:
-            /* Stop motor via soft starter (contactor stays on during soak) */
-            relay_ctrl_set(RO_MOTOR_START, RELAY_STATE_OFF);
-            relay_ctrl_set(RO_HEATER_1, RELAY_STATE_OFF);
-            relay_ctrl_set(RO_HEATER_2, RELAY_STATE_OFF);
-            /* Keep door locked and LN2 off during soak */
-            relay_ctrl_set(RO_LN2_VALVE, RELAY_STATE_OFF);
-            telemetry_set_ro_bits(relay_ctrl_get_state());
-            break;
-
-        case MACHINE_STATE_E_STOP:
-        case MACHINE_STATE_FAULT:
-            set_outputs_safe();
-            break;
-
-        case MACHINE_STATE_SERVICE:
-            /* All relays available for manual control */
-            break;
-
-        case MACHINE_STATE_PAUSED:
-            /* Stop motor, heaters off, unlock door for inspection */
-            relay_ctrl_set(RO_MOTOR_START, RELAY_STATE_OFF);
-            relay_ctrl_set(RO_MAIN_CONTACTOR, RELAY_STATE_OFF);
-            relay_ctrl_set(RO_HEATER_1, RELAY_STATE_OFF);
-            relay_ctrl_set(RO_HEATER_2, RELAY_STATE_OFF);
-            relay_ctrl_set(RO_DOOR_LOCK, RELAY_STATE_OFF);  /* Unlock door */
-            /* LN2 valve controlled by pause mode (set in pause_run function) */
-            telemetry_set_ro_bits(relay_ctrl_get_state());
-            break;
-
-        default:
-            break;
-    }
-
-    /* Notify callback */
-    if (s_state_callback != NULL) {
-        s_state_callback(old_state, new_state);
-    }
-
-    /* Emit state change event via BLE */
-    emit_state_change_event(old_state, new_state);
-
-    /* Emit specific events for key transitions */
-    if (new_state == MACHINE_STATE_E_STOP) {
-        emit_event(EVENT_ESTOP_ASSERTED, EVENT_SEVERITY_CRITICAL, NULL, 0);
-    } else if (old_state == MACHINE_STATE_E_STOP && new_state == MACHINE_STATE_IDLE) {
-        emit_event(EVENT_ESTOP_CLEARED, EVENT_SEVERITY_INFO, NULL, 0);
-    }
-
-    if (old_state == MACHINE_STATE_IDLE && new_state == MACHINE_STATE_PRECOOL) {
-        emit_event(EVENT_RUN_STARTED, EVENT_SEVERITY_INFO, NULL, 0);
-    } else if (old_state == MACHINE_STATE_PRECOOL && new_state == MACHINE_STATE_RUNNING) {
-        emit_event(EVENT_PRECOOL_COMPLETE, EVENT_SEVERITY_INFO, NULL, 0);
-    } else if (new_state == MACHINE_STATE_IDLE &&
-               (old_state == MACHINE_STATE_STOPPING || old_state == MACHINE_STATE_RUNNING)) {
-        emit_event(EVENT_RUN_STOPPED, EVENT_SEVERITY_INFO, NULL, 0);
-    } else if (new_state == MACHINE_STATE_FAULT || new_state == MACHINE_STATE_E_STOP) {
-        if (old_state == MACHINE_STATE_RUNNING || old_state == MACHINE_STATE_PRECOOL ||
-            old_state == MACHINE_STATE_PAUSED) {
-            emit_event(EVENT_RUN_ABORTED, EVENT_SEVERITY_ALARM, NULL, 0);
-        }
-    }
-
-    /* Pause/resume events */
-    if (new_state == MACHINE_STATE_PAUSED) {
-        emit_event(EVENT_RUN_PAUSED, EVENT_SEVERITY_INFO, NULL, 0);
-    } else if (old_state == MACHINE_STATE_PAUSED &&
-               (new_state == MACHINE_STATE_PRECOOL || new_state == MACHINE_STATE_RUNNING)) {
-        emit_event(EVENT_RUN_RESUMED, EVENT_SEVERITY_INFO, NULL, 0);
+    if (on_state_task()) {
+        ms_core_force_safe(&s_core);
+        return;
     }
+    xTaskNotify(s_task_handle, NOTIFY_FORCE_SAFE, eSetBits);
 }
 
-static void set_outputs_safe(void)
-{
-    ESP_LOGI(TAG, "Setting outputs to safe state");
+/* ===== DI edges ===== */
 
-    /* Turn off all relays except chamber light (user preference) */
-    relay_ctrl_set(RO_MOTOR_START, RELAY_STATE_OFF);    /* Stop motor first */
-    relay_ctrl_set(RO_MAIN_CONTACTOR, RELAY_STATE_OFF); /* Then kill power circuit */
-    relay_ctrl_set(RO_HEATER_1, RELAY_STATE_OFF);
-    relay_ctrl_set(RO_HEATER_2, RELAY_STATE_OFF);
-    relay_ctrl_set(RO_LN2_VALVE, RELAY_STATE_OFF);
-    relay_ctrl_set(RO_DOOR_LOCK, RELAY_STATE_OFF);
-    /* Keep light state as-is or turn off */
-
-    telemetry_set_ro_bits(relay_ctrl_get_state());
+/* Runs on the di_sampler task */
+static void on_di_edge(const di_sampler_edge_t *edge, void *ctx)
+{
+    (void)ctx;
+    s_di_edge_us = (uint32_t)edge->t_us;
+    xTaskNotify(s_task_handle, NOTIFY_DI_EDGE, eSetBits);
 }
 
-static void update_di_bits(void)
+static void di_subscribe(void)
 {
-    /* Read from hardware via relay_ctrl (which manages I2C bus) */
-    uint8_t di_byte = 0;
-    esp_err_t ret = relay_ctrl_read_di(&di_byte);
-
-    if (ret == ESP_OK) {
-        s_di_bits = di_byte;
-    } else {
-        /* If read fails, keep previous value and log warning */
-        ESP_LOGW(TAG, "DI read failed: %s - keeping previous state", esp_err_to_name(ret));
+    /* E-stop press is taken on first sight; release, door and LN2 are filtered */
+    const di_filter_t estop = {
+        .mode = DI_FILTER_DEBOUNCE,
+        .window = CONFIG_DI_SAMPLER_DEBOUNCE_SAMPLES,
+        .fast = DI_FAST_LOW,
+    };
+    const di_filter_t ln2 = {
+        .mode = DI_FILTER_MAJORITY,
+        .window = DI_LN2_MAJORITY_WINDOW,
+        .fast = DI_FAST_NONE,
+    };
+    di_sampler_set_filter(DI_ESTOP, &estop);
+    di_sampler_set_filter(DI_LN2_PRESENT, &ln2);
+
+    esp_err_t err = di_sampler_subscribe(on_di_edge, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "DI edge subscription failed: %s - polling only", esp_err_to_name(err));
+        return;
     }
-
-    /* Update telemetry with current DI state */
-    telemetry_set_di_bits(s_di_bits);
+    ESP_LOGI(TAG, "DI edges from di_sampler (poll fallback %dms)", STATE_POLL_INTERVAL_MS);
 }
 
-static bool check_estop_active(void)
-{
-    /* E-Stop is active-LOW: DI1 LOW = E-stop pressed */
-    return (s_di_bits & (1 << (DI_ESTOP - 1))) == 0;
-}
+/* ===== Relay output mismatch ===== */
 
-static bool check_door_open(void)
+/* Runs on the relay_ctrl reconcile task */
+static void on_relay_mismatch(const relay_ctrl_mismatch_t *m, void *ctx)
 {
-    /* Door closed is HIGH: DI2 LOW = door open */
-    return (s_di_bits & (1 << (DI_DOOR_CLOSED - 1))) == 0;
+    (void)ctx;
+    s_relay_mismatch = *m;
+    xTaskNotify(s_task_handle, NOTIFY_RELAY_MISMATCH, eSetBits);
 }
 
-static bool check_motor_fault(void)
+static void report_relay_mismatch(void)
 {
-    /* Motor fault check disabled - soft starter has no fault output signal.
-     * DI4 is reserved for future use if we add a VFD with fault output.
-     * Always returns false (no fault) for now. */
-    (void)DI_MOTOR_FAULT;  /* Suppress unused warning */
-    return false;
+    const relay_ctrl_mismatch_t m = s_relay_mismatch;
+    wire_event_relay_mismatch_t data = {
+        .expected = m.expected,
+        .actual = m.actual,
+        .config = m.config,
+        .restored = m.restored ? 1 : 0,
+    };
+    env_event(NULL, EVENT_RELAY_MISMATCH, EVENT_SEVERITY_ALARM,
+              (const uint8_t *)&data, sizeof(data));
 }
 
-static bool check_ln2_present(void)
+/* ===== HMI session ===== */
+
+/*
+ * esp_timer task (lease expiry) or BLE tasks. The tick reads
+ * session_mgr_is_live() itself; this only wakes it, so a run stops on the
+ * lapse rather than up to a tick later.
+ */
+static void on_session_state(session_state_t old_state, session_state_t new_state, void *ctx)
 {
-    /* LN2 present is HIGH: DI3 HIGH = LN2 available */
-    return (s_di_bits & (1 << (DI_LN2_PRESENT - 1))) != 0;
+    (void)old_state;
+    (void)new_state;
+    (void)ctx;
+    if (s_task_handle != NULL) {
+        xTaskNotify(s_task_handle, NOTIFY_SESSION, eSetBits);
+    }
 }
 
-/**
- * @brief Get current chamber temperature from PID controller
- *
- * @param temp_x10 Output: temperature in tenths of degree C
- * @return true if valid temperature was read, false if controller offline/stale
+/*
+ * Sleep until the next periodic tick, a DI edge, a relay sequence step, a
+ * session change or a command, whichever comes first. Early wakes do not
+ * move the periodic schedule. Returns the NOTIFY_* bits that ended the
+ * wait (0 on a periodic tick).
  */
-static bool get_chamber_temp(int16_t *temp_x10)
+static uint32_t wait_tick_or_notify(TickType_t *next_wake)
 {
-    pid_controller_t ctrl;
+    TickType_t period = pdMS_TO_TICKS(STATE_POLL_INTERVAL_MS);
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = ((int32_t)(*next_wake - now) > 0) ? (*next_wake - now) : 0;
+    uint32_t bits = 0;
 
-    /* Get PID controller 1 (chamber temperature) */
-    if (pid_controller_get_by_addr(CHAMBER_PID_ADDR, &ctrl) != ESP_OK) {
-        return false;
+    if (xTaskNotifyWait(0, UINT32_MAX, &bits, wait) == pdTRUE && bits != 0) {
+        return bits;
     }
 
-    /* Check if data is fresh */
-    if (ctrl.state != PID_STATE_ONLINE) {
-        ESP_LOGD(TAG, "PID controller %d not online (state=%d)", CHAMBER_PID_ADDR, ctrl.state);
-        return false;
+    *next_wake += period;
+    now = xTaskGetTickCount();
+    if ((int32_t)(now - *next_wake) >= 0) {
+        *next_wake = now + period;      /* Overran a tick - don't burst to catch up */
     }
-
-    /* Convert from float to x10 integer */
-    *temp_x10 = (int16_t)(ctrl.data.pv * 10.0f);
-    return true;
+    return 0;
 }
 
+/* ===== State task ===== */
+
 static void state_task(void *arg)
 {
     (void)arg;
 
-    TickType_t last_wake = xTaskGetTickCount();
+    TickType_t next_wake = xTaskGetTickCount() + pdMS_TO_TICKS(STATE_POLL_INTERVAL_MS);
+    uint32_t notified = 0;
 
     ESP_LOGI(TAG, "State machine task started");
 
     while (s_running) {
-        /* Read digital inputs */
-        update_di_bits();
+        bool di_edge = (notified & NOTIFY_DI_EDGE) != 0;
 
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        /* Filtered inputs as of the sampler's last read */
+        uint32_t edge_us = s_di_edge_us;
+        ms_core_read_inputs(&s_core);
 
-        /* Check for E-stop - highest priority, any state */
-        if (check_estop_active() && s_state != MACHINE_STATE_E_STOP) {
-            ESP_LOGE(TAG, "E-STOP ACTIVATED!");
-            transition_to(MACHINE_STATE_E_STOP);
+        if (di_edge) {
+            s_di_stats.edges++;
         }
 
-        /* Check for motor fault - triggers FAULT from most states
-         * (not from IDLE, SERVICE, PAUSED, or already in E_STOP/FAULT) */
-        if (check_motor_fault() &&
-            s_state != MACHINE_STATE_E_STOP &&
-            s_state != MACHINE_STATE_FAULT &&
-            s_state != MACHINE_STATE_IDLE &&
-            s_state != MACHINE_STATE_SERVICE &&
-            s_state != MACHINE_STATE_PAUSED) {
-            ESP_LOGE(TAG, "Motor fault detected!");
-            transition_to(MACHINE_STATE_FAULT);
+        if (notified & NOTIFY_FORCE_SAFE) {
+            ESP_LOGW(TAG, "Forced safe state");
+            ms_core_force_safe(&s_core);
         }
 
-        /* Check door interlock during run */
-        if (check_door_open() &&
-            (s_state == MACHINE_STATE_RUNNING || s_state == MACHINE_STATE_PRECOOL)) {
-            ESP_LOGE(TAG, "Door opened during run - stopping!");
-            /* Door open during run is a fault condition */
-            transition_to(MACHINE_STATE_FAULT);
+        if (notified & NOTIFY_RELAY_MISMATCH) {
+            report_relay_mismatch();
         }
 
-        /* State-specific logic */
-        int64_t now_us = esp_timer_get_time();
-        int64_t state_duration_ms = (now_us - s_state_enter_us) / 1000;
-
-        switch (s_state) {
-            case MACHINE_STATE_PRECOOL: {
-                /* Check actual temperature from PID controller */
-                int16_t current_temp_x10;
-                bool temp_valid = get_chamber_temp(&current_temp_x10);
-
-                if (temp_valid) {
-                    /* Check if we've reached target temperature (within tolerance) */
-                    int16_t temp_diff = current_temp_x10 - s_target_temp_x10;
-                    if (temp_diff < 0) temp_diff = -temp_diff;  /* abs() */
-
-                    if (temp_diff <= PRECOOL_TEMP_TOLERANCE_X10) {
-                        ESP_LOGI(TAG, "Precool target reached: current=%d.%d target=%d.%d",
-                                 current_temp_x10 / 10, abs(current_temp_x10 % 10),
-                                 s_target_temp_x10 / 10, abs(s_target_temp_x10 % 10));
-                        if (s_run_mode == RUN_MODE_PRECOOL_ONLY) {
-                            transition_to(MACHINE_STATE_STOPPING);
-                        } else {
-                            transition_to(MACHINE_STATE_RUNNING);
-                        }
-                        break;
-                    }
-
-                    /* Log progress periodically (every 5 seconds) */
-                    if ((state_duration_ms % 5000) < STATE_POLL_INTERVAL_MS) {
-                        ESP_LOGI(TAG, "Precool: current=%d.%d target=%d.%d diff=%d.%d",
-                                 current_temp_x10 / 10, abs(current_temp_x10 % 10),
-                                 s_target_temp_x10 / 10, abs(s_target_temp_x10 % 10),
-                                 temp_diff / 10, temp_diff % 10);
-                    }
-                }
-
-                /* Check if precool timeout exceeded */
-                if (state_duration_ms > PRECOOL_TIMEOUT_MS) {
-                    if (temp_valid) {
-                        ESP_LOGW(TAG, "Precool timeout at temp=%d.%d (target=%d.%d) - proceeding anyway",
-                                 current_temp_x10 / 10, abs(current_temp_x10 % 10),
-                                 s_target_temp_x10 / 10, abs(s_target_temp_x10 % 10));
-                    } else {
-                        ESP_LOGW(TAG, "Precool timeout (no valid temp reading) - proceeding anyway");
-                    }
-
-                    if (s_run_mode == RUN_MODE_PRECOOL_ONLY) {
-                        transition_to(MACHINE_STATE_STOPPING);
-                    } else {
-                        transition_to(MACHINE_STATE_RUNNING);
-                    }
-                }
-                break;
-            }
-
-            case MACHINE_STATE_RUNNING: {
-                /* Check run duration timeout */
-                if (s_run_duration_ms > 0) {
-                    int64_t run_elapsed_ms = (now_us - s_run_start_us) / 1000;
-                    if (run_elapsed_ms >= s_run_duration_ms) {
-                        ESP_LOGI(TAG, "Run duration complete");
-                        transition_to(MACHINE_STATE_STOPPING);
-                    }
-                }
-
-                /* Check for HMI stale - continue to safe stop */
-                if (!session_mgr_is_live()) {
-                    ESP_LOGW(TAG, "HMI disconnected during run - safe stop");
-                    transition_to(MACHINE_STATE_STOPPING);
-                }
-                break;
-            }
-
-            case MACHINE_STATE_STOPPING: {
-                /* Wait for thermal soak period */
-                if (state_duration_ms > STOPPING_SOAK_TIME_MS) {
-                    ESP_LOGI(TAG, "Thermal soak complete");
-                    transition_to(MACHINE_STATE_IDLE);
+        /* Outputs are safe once a tripping tick returns - account for the trip */
+        if (ms_core_tick(&s_core)) {
+            if (di_edge) {
+                uint32_t latency_us = (uint32_t)esp_timer_get_time() - edge_us;
+                s_di_stats.trips_irq++;
+                s_di_stats.last_latency_us = latency_us;
+                if (latency_us > s_di_stats.max_latency_us) {
+                    s_di_stats.max_latency_us = latency_us;
                 }
-                break;
+                ESP_LOGW(TAG, "%s: outputs safe %luus after DI edge",
+                         machine_state_to_str(s_core.state), (unsigned long)latency_us);
+            } else {
+                s_di_stats.trips_poll++;
             }
-
-            default:
-                break;
         }
 
-        xSemaphoreGive(s_mutex);
+        /* One gate evaluation per tick; START checks and telemetry read the result */
+        safety_gate_evaluate(ms_core_get_interlocks(&s_core));
+
+        /* Commands see the inputs and trips of this tick */
+        drain_commands();
+        publish_snapshot();
 
-        /* Sleep until next tick */
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STATE_POLL_INTERVAL_MS));
+        /* Sleep until next tick, DI change, sequence step, session change or command */
+        notified = wait_tick_or_notify(&next_wake);
     }
 
     ESP_LOGI(TAG, "State machine task stopped");
@@ -0,0 +1,946 @@
+#include "machine_state_core.h"
+#include "wire_protocol.h"
+
+#include <stdlib.h>
+#include "esp_log.h"
+
+static const char *TAG = "machine_state";
+
+/* State name strings */
+static const char *state_names[] = {
+    [MACHINE_STATE_IDLE]     = "IDLE",
+    [MACHINE_STATE_PRECOOL]  = "PRECOOL",
+    [MACHINE_STATE_RUNNING]  = "RUNNING",
+    [MACHINE_STATE_STOPPING] = "STOPPING",
+    [MACHINE_STATE_E_STOP]   = "E_STOP",
+    [MACHINE_STATE_FAULT]    = "FAULT",
+    [MACHINE_STATE_SERVICE]  = "SERVICE",
+    [MACHINE_STATE_PAUSED]   = "PAUSED",
+};
+
+/* Forward declarations */
+static void transition_to(ms_core_t *c, machine_state_t new_state);
+static void set_outputs_safe(ms_core_t *c);
+static void set_relay(ms_core_t *c, uint8_t channel, bool on);
+static void commit_outputs(ms_core_t *c);
+static void seq_service(ms_core_t *c);
+static bool check_estop_active(const ms_core_t *c);
+static bool check_door_open(const ms_core_t *c);
+static bool check_motor_fault(const ms_core_t *c);
+static bool check_ln2_present(const ms_core_t *c);
+static void recipe_begin_segment(ms_core_t *c, int64_t now_us);
+static void recipe_tick(ms_core_t *c, int64_t now_us);
+static uint32_t recipe_remaining_ms(const ms_core_t *c, int64_t now_us);
+static void report_precool_at_risk(ms_core_t *c);
+
+/* Relay sequences run by entry actions (see relay_seq.h) */
+
+#define RO(ch)  ((uint8_t)(1 << ((ch) - 1)))
+
+/* Lock the door, start cooling, then power the motor circuit (START comes later) */
+static const relay_seq_step_t power_up_steps[] = {
+    { .mask = RO(RO_DOOR_LOCK), .values = RO(RO_DOOR_LOCK), .dwell_ms = MS_SEQ_DOOR_LOCK_MS },
+    { .mask = RO(RO_LN2_VALVE) | RO(RO_HEATER_1) | RO(RO_HEATER_2),
+      .values = RO(RO_LN2_VALVE) | RO(RO_HEATER_1) | RO(RO_HEATER_2) },
+    { .mask = RO(RO_MAIN_CONTACTOR), .values = RO(RO_MAIN_CONTACTOR),
+      .dwell_ms = MS_SEQ_CONTACTOR_SETTLE_MS },
+};
+
+static const relay_seq_step_t motor_start_steps[] = {
+    { .mask = RO(RO_MOTOR_START), .values = RO(RO_MOTOR_START) },
+};
+
+static const relay_seq_step_t motor_stop_steps[] = {
+    { .mask = RO(RO_MOTOR_START), .values = 0, .dwell_ms = MS_SEQ_SOFT_STOP_MS },
+};
+
+/* Soft stop; contactor and door lock stay on through the soak */
+static const relay_seq_step_t cool_down_steps[] = {
+    { .mask = RO(RO_MOTOR_START) | RO(RO_HEATER_1) | RO(RO_HEATER_2) | RO(RO_LN2_VALVE),
+      .values = 0 },
+};
+
+/* Soft stop, drop motor power, unlock once the rotor has run down.
+ * LN2 is left to the pause mode (staged by ms_core_pause_run). */
+static const relay_seq_step_t pause_steps[] = {
+    { .mask = RO(RO_MOTOR_START) | RO(RO_HEATER_1) | RO(RO_HEATER_2), .values = 0,
+      .dwell_ms = MS_SEQ_SOFT_STOP_MS },
+    { .mask = RO(RO_MAIN_CONTACTOR), .values = 0, .dwell_ms = MS_SEQ_SPINDOWN_MS },
+    { .mask = RO(RO_DOOR_LOCK), .values = 0 },
+};
+
+/* As pause, with everything but the light off and each step read back */
+static const relay_seq_step_t shutdown_steps[] = {
+    { .mask = RO(RO_MOTOR_START) | RO(RO_HEATER_1) | RO(RO_HEATER_2) | RO(RO_LN2_VALVE),
+      .values = 0, .verify = true, .dwell_ms = MS_SEQ_SOFT_STOP_MS },
+    { .mask = RO(RO_MAIN_CONTACTOR), .values = 0, .verify = true,
+      .dwell_ms = MS_SEQ_SPINDOWN_MS },
+    { .mask = RO(RO_DOOR_LOCK), .values = 0, .verify = true },
+};
+
+#define SEQ(id_, name_, steps_) \
+    { .id = (id_), .name = (name_), .steps = (steps_), \
+      .count = (uint8_t)(sizeof(steps_) / sizeof((steps_)[0])) }
+
+static const relay_seq_t seq_power_up   = SEQ(MS_SEQ_POWER_UP,    "power_up",    power_up_steps);
+static const relay_seq_t seq_motor_start = SEQ(MS_SEQ_MOTOR_START, "motor_start", motor_start_steps);
+static const relay_seq_t seq_motor_stop = SEQ(MS_SEQ_MOTOR_STOP,  "motor_stop",  motor_stop_steps);
+static const relay_seq_t seq_cool_down  = SEQ(MS_SEQ_COOL_DOWN,   "cool_down",   cool_down_steps);
+static const relay_seq_t seq_pause      = SEQ(MS_SEQ_PAUSE,       "pause",       pause_steps);
+static const relay_seq_t seq_shutdown   = SEQ(MS_SEQ_SHUTDOWN,    "shutdown",    shutdown_steps);
+
+const char *machine_state_to_str(machine_state_t state)
+{
+    if (state < MACHINE_STATE_MAX) {
+        return state_names[state];
+    }
+    return "UNKNOWN";
+}
+
+void ms_core_init(ms_core_t *c, const ms_env_t *env)
+{
+    *c = (ms_core_t){
+        .env = env,
+        .state = MACHINE_STATE_IDLE,
+        .run_mode = RUN_MODE_NORMAL,
+        .pause_mode = PAUSE_MODE_KEEP_COOLING,
+        .pre_pause_state = MACHINE_STATE_IDLE,
+        .di_bits = 0xFF,                /* All HIGH = safe default */
+    };
+    c->state_enter_us = env->now_us(env->ctx);
+
+    /* Read initial DI state */
+    ms_core_read_inputs(c);
+
+    /* Check if E-stop is active on startup */
+    if (check_estop_active(c)) {
+        ESP_LOGW(TAG, "E-Stop active on startup");
+        c->state = MACHINE_STATE_E_STOP;
+        set_outputs_safe(c);
+        commit_outputs(c);
+    }
+}
+
+void ms_core_read_inputs(ms_core_t *c)
+{
+    uint8_t di_byte = 0;
+    esp_err_t ret = c->env->read_di(c->env->ctx, &di_byte);
+
+    if (ret == ESP_OK) {
+        c->di_bits = di_byte;
+    } else {
+        /* If read fails, keep previous value and log warning */
+        ESP_LOGW(TAG, "DI read failed: %s - keeping previous state", esp_err_to_name(ret));
+    }
+
+    c->env->inputs_changed(c->env->ctx, c->di_bits);
+}
+
+void ms_core_get_run_info(ms_core_t *c, machine_run_info_t *out_info)
+{
+    out_info->state = c->state;
+    out_info->run_mode = c->run_mode;
+    out_info->target_temp_x10 = c->recipe_started ? c->sv_x10 : c->target_temp_x10;
+    out_info->recipe_step = c->recipe_started ? (uint8_t)(c->seg + 1) : 0;
+    out_info->interlock_bits = ms_core_get_interlocks(c);
+    out_info->precool_eta = 0;
+
+    /* Calculate elapsed/remaining time */
+    if (c->run_start_us > 0 && (c->state == MACHINE_STATE_PRECOOL ||
+                                c->state == MACHINE_STATE_RUNNING)) {
+        int64_t now_us = c->env->now_us(c->env->ctx);
+        int64_t elapsed_us = now_us - c->run_start_us;
+        out_info->run_elapsed_ms = (uint32_t)(elapsed_us / 1000);
+
+        if (c->state == MACHINE_STATE_PRECOOL) {
+            /* Time to target from the cool-down fit; 0 while it is learning */
+            out_info->precool_eta = precool_eta_wire(&c->eta);
+            out_info->run_remaining_ms = out_info->precool_eta ? c->eta.eta_ms : 0;
+        } else if (c->has_recipe) {
+            out_info->run_remaining_ms = recipe_remaining_ms(c, now_us);
+        } else if (c->run_duration_ms > 0 && out_info->run_elapsed_ms < c->run_duration_ms) {
+            out_info->run_remaining_ms = c->run_duration_ms - out_info->run_elapsed_ms;
+        } else {
+            out_info->run_remaining_ms = 0;
+        }
+    } else {
+        out_info->run_elapsed_ms = 0;
+        out_info->run_remaining_ms = 0;
+    }
+}
+
+uint8_t ms_core_get_interlocks(ms_core_t *c)
+{
+    uint8_t interlocks = 0;
+
+    if (check_estop_active(c)) {
+        interlocks |= INTERLOCK_BIT_ESTOP;
+    }
+    if (check_door_open(c)) {
+        interlocks |= INTERLOCK_BIT_DOOR_OPEN;
+    }
+    if (!check_ln2_present(c)) {
+        interlocks |= INTERLOCK_BIT_LN2_ABSENT;
+    }
+    /* Motor fault check disabled - soft starter has no fault output.
+     * INTERLOCK_BIT_MOTOR_FAULT reserved for future accelerometer-based detection.
+     * if (check_motor_fault(c)) {
+     *     interlocks |= INTERLOCK_BIT_MOTOR_FAULT;
+     * }
+     */
+    if (!c->env->hmi_live(c->env->ctx)) {
+        interlocks |= INTERLOCK_BIT_HMI_STALE;
+    }
+
+    return interlocks;
+}
+
+/* ===== Commands ===== */
+
+static esp_err_t start_common(ms_core_t *c, run_mode_t mode, int16_t target_temp_x10,
+                              uint32_t run_duration_ms, const recipe_t *recipe)
+{
+    /* Check current state */
+    if (c->state != MACHINE_STATE_IDLE) {
+        ESP_LOGW(TAG, "START_RUN rejected: not in IDLE (state=%s)",
+                 machine_state_to_str(c->state));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Check interlocks */
+    if (!c->env->start_allowed(c->env->ctx)) {
+        ESP_LOGW(TAG, "START_RUN rejected: interlocks=0x%02X", ms_core_get_interlocks(c));
+        return ESP_ERR_NOT_ALLOWED;
+    }
+
+    /* Warn if LN2 not present but don't block */
+    if (!check_ln2_present(c)) {
+        ESP_LOGW(TAG, "Warning: LN2 not present, cooling may be impaired");
+    }
+
+    /* Store run parameters */
+    c->run_mode = mode;
+    c->target_temp_x10 = (target_temp_x10 != 0) ? target_temp_x10 : PRECOOL_TARGET_TEMP_X10;
+    c->run_duration_ms = run_duration_ms;
+    c->run_start_us = c->env->now_us(c->env->ctx);
+
+    c->has_recipe = (recipe != NULL);
+    c->recipe_started = false;
+    if (recipe != NULL) {
+        c->recipe = *recipe;
+        c->seg = 0;
+        c->sv_x10 = c->target_temp_x10;
+        c->env->set_sv(c->env->ctx, MS_PID_ADDR_CHAMBER, c->sv_x10);
+    }
+
+    /* Transition to PRECOOL */
+    transition_to(c, MACHINE_STATE_PRECOOL);
+
+    ESP_LOGI(TAG, "Run started: mode=%d target_temp=%d.%d run_duration=%lums",
+             mode, c->target_temp_x10 / 10, abs(c->target_temp_x10 % 10),
+             (unsigned long)run_duration_ms);
+    return ESP_OK;
+}
+
+esp_err_t ms_core_start_run(ms_core_t *c, run_mode_t mode,
+                            int16_t target_temp_x10, uint32_t run_duration_ms)
+{
+    return start_common(c, mode, target_temp_x10, run_duration_ms, NULL);
+}
+
+esp_err_t ms_core_start_recipe(ms_core_t *c, run_mode_t mode, const recipe_t *recipe)
+{
+    if (recipe->header.segment_count == 0 || mode == RUN_MODE_PRECOOL_ONLY) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = start_common(c, mode, recipe_precool_target(recipe), 0, recipe);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Recipe 0x%04X: %u segments, %lu ms planned after precool",
+                 recipe->header.recipe_id, recipe->header.segment_count,
+                 (unsigned long)recipe_planned_ms(recipe, 0, c->target_temp_x10));
+    }
+    return err;
+}
+
+esp_err_t ms_core_stop_run(ms_core_t *c, stop_mode_t mode)
+{
+    /* Check if we're in a stoppable state (including PAUSED) */
+    if (c->state != MACHINE_STATE_PRECOOL &&
+        c->state != MACHINE_STATE_RUNNING &&
+        c->state != MACHINE_STATE_PAUSED) {
+        ESP_LOGW(TAG, "STOP_RUN ignored: state=%s", machine_state_to_str(c->state));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (mode == STOP_MODE_ABORT) {
+        /* Fast stop - go directly to safe state (IDLE entry makes outputs safe) */
+        ESP_LOGW(TAG, "ABORT requested - immediate stop");
+        transition_to(c, MACHINE_STATE_IDLE);
+    } else {
+        /* Normal stop - go through STOPPING phase */
+        transition_to(c, MACHINE_STATE_STOPPING);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ms_core_pause_run(ms_core_t *c, pause_mode_t mode)
+{
+    /* Check if we're in a pausable state */
+    if (c->state != MACHINE_STATE_PRECOOL && c->state != MACHINE_STATE_RUNNING) {
+        ESP_LOGW(TAG, "PAUSE_RUN rejected: state=%s", machine_state_to_str(c->state));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Store pause state info */
+    c->pause_mode = mode;
+    c->pre_pause_state = c->state;
+    c->pause_time_us = c->env->now_us(c->env->ctx);
+
+    ESP_LOGI(TAG, "Pausing run: mode=%s from_state=%s",
+             mode == PAUSE_MODE_KEEP_COOLING ? "KEEP_COOLING" : "STOP_COOLING",
+             machine_state_to_str(c->pre_pause_state));
+
+    /* Stage the LN2 valve for the pause mode; transition_to stages the
+     * other outputs and commits them together */
+    if (mode == PAUSE_MODE_STOP_COOLING) {
+        set_relay(c, RO_LN2_VALVE, false);
+    }
+    /* If KEEP_COOLING, leave LN2 valve in current state (already on from PRECOOL/RUNNING) */
+
+    transition_to(c, MACHINE_STATE_PAUSED);
+    return ESP_OK;
+}
+
+esp_err_t ms_core_resume_run(ms_core_t *c)
+{
+    /* Check if we're in PAUSED state */
+    if (c->state != MACHINE_STATE_PAUSED) {
+        ESP_LOGW(TAG, "RESUME_RUN rejected: state=%s", machine_state_to_str(c->state));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Check that door is closed before resuming */
+    if (check_door_open(c)) {
+        ESP_LOGW(TAG, "RESUME_RUN rejected: door still open");
+        return ESP_ERR_NOT_ALLOWED;
+    }
+
+    /* Check E-stop is clear */
+    if (check_estop_active(c)) {
+        ESP_LOGW(TAG, "RESUME_RUN rejected: E-stop active");
+        return ESP_ERR_NOT_ALLOWED;
+    }
+
+    /* Check HMI is live */
+    if (!c->env->hmi_live(c->env->ctx)) {
+        ESP_LOGW(TAG, "RESUME_RUN rejected: HMI not live");
+        return ESP_ERR_NOT_ALLOWED;
+    }
+
+    ESP_LOGI(TAG, "Resuming run: returning to %s",
+             machine_state_to_str(c->pre_pause_state));
+
+    /* A recipe re-precools to the setpoint it was paused at */
+    if (c->recipe_started) {
+        c->target_temp_x10 = c->sv_x10;
+    }
+
+    /* Always go through PRECOOL to re-establish temperature before resuming
+     * This ensures the chamber re-cools to target before motor starts */
+    transition_to(c, MACHINE_STATE_PRECOOL);
+    return ESP_OK;
+}
+
+esp_err_t ms_core_enter_service(ms_core_t *c)
+{
+    if (c->state != MACHINE_STATE_IDLE) {
+        ESP_LOGW(TAG, "Cannot enter SERVICE: not in IDLE");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    transition_to(c, MACHINE_STATE_SERVICE);
+    return ESP_OK;
+}
+
+esp_err_t ms_core_exit_service(ms_core_t *c)
+{
+    if (c->state != MACHINE_STATE_SERVICE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Turn off all relays (chamber light too) when leaving service mode;
+     * committed with the IDLE entry actions */
+    c->out_mask = 0xFF;
+    c->out_values = 0;
+
+    transition_to(c, MACHINE_STATE_IDLE);
+    return ESP_OK;
+}
+
+esp_err_t ms_core_clear_estop(ms_core_t *c)
+{
+    if (c->state != MACHINE_STATE_E_STOP) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Check that E-stop is actually released */
+    if (check_estop_active(c)) {
+        ESP_LOGW(TAG, "Cannot clear E-stop: still active");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    transition_to(c, MACHINE_STATE_IDLE);
+    ESP_LOGI(TAG, "E-stop cleared");
+    return ESP_OK;
+}
+
+esp_err_t ms_core_clear_fault(ms_core_t *c)
+{
+    if (c->state != MACHINE_STATE_FAULT) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Check that fault condition is resolved */
+    if (check_motor_fault(c)) {
+        ESP_LOGW(TAG, "Cannot clear fault: motor fault still active");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    transition_to(c, MACHINE_STATE_IDLE);
+    ESP_LOGI(TAG, "Fault cleared");
+    return ESP_OK;
+}
+
+void ms_core_force_safe(ms_core_t *c)
+{
+    set_outputs_safe(c);
+    transition_to(c, MACHINE_STATE_FAULT);
+    commit_outputs(c);      /* Already in FAULT: no entry actions ran */
+}
+
+/* ===== Tick ===== */
+
+bool ms_core_tick(ms_core_t *c)
+{
+    const ms_env_t *env = c->env;
+    machine_state_t state_before = c->state;
+
+    /* Check for E-stop - highest priority, any state */
+    if (check_estop_active(c) && c->state != MACHINE_STATE_E_STOP) {
+        ESP_LOGE(TAG, "E-STOP ACTIVATED!");
+        transition_to(c, MACHINE_STATE_E_STOP);
+    }
+
+    /* Check for motor fault - triggers FAULT from most states
+     * (not from IDLE, SERVICE, PAUSED, or already in E_STOP/FAULT) */
+    if (check_motor_fault(c) &&
+        c->state != MACHINE_STATE_E_STOP &&
+        c->state != MACHINE_STATE_FAULT &&
+        c->state != MACHINE_STATE_IDLE &&
+        c->state != MACHINE_STATE_SERVICE &&
+        c->state != MACHINE_STATE_PAUSED) {
+        ESP_LOGE(TAG, "Motor fault detected!");
+        transition_to(c, MACHINE_STATE_FAULT);
+    }
+
+    /* Check door interlock during run */
+    if (check_door_open(c) &&
+        (c->state == MACHINE_STATE_RUNNING || c->state == MACHINE_STATE_PRECOOL)) {
+        ESP_LOGE(TAG, "Door opened during run - stopping!");
+        /* Door open during run is a fault condition */
+        transition_to(c, MACHINE_STATE_FAULT);
+    }
+
+    /* Outputs are safe once the transition returns */
+    bool tripped = c->state != state_before &&
+                   (c->state == MACHINE_STATE_E_STOP || c->state == MACHINE_STATE_FAULT);
+
+    /* State-specific logic */
+    int64_t now_us = env->now_us(env->ctx);
+    int64_t state_duration_ms = (now_us - c->state_enter_us) / 1000;
+
+    switch (c->state) {
+        case MACHINE_STATE_PRECOOL: {
+            /* Check actual temperature from PID controller */
+            int16_t current_temp_x10;
+            bool temp_valid = env->chamber_temp(env->ctx, &current_temp_x10);
+
+            if (temp_valid) {
+                /* Check if we've reached target temperature (within tolerance) */
+                int16_t temp_diff = current_temp_x10 - c->target_temp_x10;
+                if (temp_diff < 0) temp_diff = -temp_diff;  /* abs() */
+
+                if (temp_diff <= PRECOOL_TEMP_TOLERANCE_X10) {
+                    ESP_LOGI(TAG, "Precool target reached: current=%d.%d target=%d.%d",
+                             current_temp_x10 / 10, abs(current_temp_x10 % 10),
+                             c->target_temp_x10 / 10, abs(c->target_temp_x10 % 10));
+                    if (c->run_mode == RUN_MODE_PRECOOL_ONLY) {
+                        transition_to(c, MACHINE_STATE_STOPPING);
+                    } else {
+                        transition_to(c, MACHINE_STATE_RUNNING);
+                    }
+                    break;
+                }
+
+                uint32_t budget_ms = (state_duration_ms < PRECOOL_TIMEOUT_MS) ?
+                                     (uint32_t)(PRECOOL_TIMEOUT_MS - state_duration_ms) : 0;
+                if (precool_eta_update(&c->eta, now_us, current_temp_x10,
+                                       c->target_temp_x10 + PRECOOL_TEMP_TOLERANCE_X10,
+                                       budget_ms) &&
+                    c->eta.risk_run == PRECOOL_ETA_RISK_SAMPLES) {
+                    report_precool_at_risk(c);
+                }
+
+                /* Log progress periodically (every 5 seconds) */
+                if ((state_duration_ms % 5000) < MS_CORE_TICK_MS) {
+                    ESP_LOGI(TAG, "Precool: current=%d.%d target=%d.%d diff=%d.%d eta=%lds (%lu..%lu)",
+                             current_temp_x10 / 10, abs(current_temp_x10 % 10),
+                             c->target_temp_x10 / 10, abs(c->target_temp_x10 % 10),
+                             temp_diff / 10, temp_diff % 10,
+                             c->eta.status ? (long)(c->eta.eta_ms / 1000) : -1L,
+                             (unsigned long)(c->eta.eta_lo_ms / 1000),
+                             (unsigned long)(c->eta.eta_hi_ms / 1000));
+                }
+            }
+
+            /* Check if precool timeout exceeded */
+            if (state_duration_ms > PRECOOL_TIMEOUT_MS) {
+                if (temp_valid) {
+                    ESP_LOGW(TAG, "Precool timeout at temp=%d.%d (target=%d.%d) - proceeding anyway",
+                             current_temp_x10 / 10, abs(current_temp_x10 % 10),
+                             c->target_temp_x10 / 10, abs(c->target_temp_x10 % 10));
+                } else {
+                    ESP_LOGW(TAG, "Precool timeout (no valid temp reading) - proceeding anyway");
+                }
+
+                if (c->run_mode == RUN_MODE_PRECOOL_ONLY) {
+                    transition_to(c, MACHINE_STATE_STOPPING);
+                } else {
+                    transition_to(c, MACHINE_STATE_RUNNING);
+                }
+            }
+            break;
+        }
+
+        case MACHINE_STATE_RUNNING: {
+            if (c->has_recipe) {
+                /* Setpoint profile; STOPPING after the last segment */
+                recipe_tick(c, now_us);
+            } else if (c->run_duration_ms > 0) {
+                /* Check run duration timeout */
+                int64_t run_elapsed_ms = (now_us - c->run_start_us) / 1000;
+                if (run_elapsed_ms >= c->run_duration_ms) {
+                    ESP_LOGI(TAG, "Run duration complete");
+                    transition_to(c, MACHINE_STATE_STOPPING);
+                }
+            }
+
+            /* Check for HMI stale - continue to safe stop */
+            if (!env->hmi_live(env->ctx)) {
+                ESP_LOGW(TAG, "HMI disconnected during run - safe stop");
+                transition_to(c, MACHINE_STATE_STOPPING);
+            }
+            break;
+        }
+
+        case MACHINE_STATE_STOPPING: {
+            /* Wait for thermal soak period */
+            if (state_duration_ms > STOPPING_SOAK_TIME_MS) {
+                ESP_LOGI(TAG, "Thermal soak complete");
+                transition_to(c, MACHINE_STATE_IDLE);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    /* Sequence steps due by now (including any just queued above) */
+    seq_service(c);
+
+    return tripped;
+}
+
+/* ===== Precool ETA ===== */
+
+/*
+ * The fit says the chamber will not reach the precool target before
+ * PRECOOL_TIMEOUT_MS, typically an empty or disconnected LN2 supply. The
+ * run carries on (the timeout handling is unchanged); this only warns early.
+ */
+static void report_precool_at_risk(ms_core_t *c)
+{
+    const precool_eta_t *e = &c->eta;
+    /* Seconds, 0xFFFF = not expected to reach the target at all */
+    uint16_t eta_s = (e->eta_ms / 1000 > UINT16_MAX) ? UINT16_MAX : (uint16_t)(e->eta_ms / 1000);
+
+    ESP_LOGW(TAG, "Precool will not reach %d.%d before timeout: eta=%lds asymptote=%d.%d",
+             c->target_temp_x10 / 10, abs(c->target_temp_x10 % 10),
+             (e->eta_ms == PRECOOL_ETA_NEVER) ? -1L : (long)(e->eta_ms / 1000),
+             e->asymptote_x10 / 10, abs(e->asymptote_x10 % 10));
+
+    uint8_t data[4] = {
+        (uint8_t)(eta_s & 0xFF), (uint8_t)(eta_s >> 8),
+        (uint8_t)((uint16_t)e->asymptote_x10 & 0xFF), (uint8_t)((uint16_t)e->asymptote_x10 >> 8),
+    };
+    c->env->event(c->env->ctx, EVENT_PRECOOL_AT_RISK, EVENT_SEVERITY_WARN, data, sizeof(data));
+}
+
+/* ===== Recipe ===== */
+
+static void request_chamber_sv(ms_core_t *c, int16_t sv_x10)
+{
+    if (sv_x10 != c->sv_x10) {
+        c->sv_x10 = sv_x10;
+        c->env->set_sv(c->env->ctx, MS_PID_ADDR_CHAMBER, sv_x10);
+    }
+}
+
+/*
+ * Enter segment c->seg: apply motor and heater settings and start its ramp
+ * from the current chamber SV. Used for the first segment, each following
+ * one, and to restart a segment after pause/resume (its hold starts over).
+ */
+static void recipe_begin_segment(ms_core_t *c, int64_t now_us)
+{
+    const recipe_segment_t *seg = &c->recipe.segments[c->seg];
+    static const uint8_t heater_addr[2] = { MS_PID_ADDR_HEATER_1, MS_PID_ADDR_HEATER_2 };
+
+    c->recipe_started = true;
+    c->holding = false;
+    c->seg_start_us = now_us;
+    c->seg_from_x10 = c->sv_x10;
+
+    bool motor = (seg->flags & RECIPE_SEG_MOTOR) != 0;
+    if (motor != c->seg_motor) {
+        c->seg_motor = motor;
+        relay_seq_queue(&c->seq, motor ? &seq_motor_start : &seq_motor_stop, now_us);
+    }
+    for (int h = 0; h < 2; h++) {
+        if (seg->heater_sv_x10[h] != RECIPE_SV_UNCHANGED) {
+            c->env->set_sv(c->env->ctx, heater_addr[h], seg->heater_sv_x10[h]);
+        }
+    }
+
+    ESP_LOGI(TAG, "Recipe step %u/%u: SV %d.%d -> %d.%d in %lums, hold %lums%s",
+             c->seg + 1, c->recipe.header.segment_count,
+             c->seg_from_x10 / 10, abs(c->seg_from_x10 % 10),
+             seg->chamber_sv_x10 / 10, abs(seg->chamber_sv_x10 % 10),
+             (unsigned long)recipe_ramp_ms(c->seg_from_x10, seg), (unsigned long)seg->hold_ms,
+             (seg->flags & RECIPE_SEG_MOTOR) ? ", motor" : "");
+
+    uint8_t data[2] = { (uint8_t)(c->seg + 1), c->recipe.header.segment_count };
+    c->env->event(c->env->ctx, EVENT_RECIPE_STEP, EVENT_SEVERITY_INFO, data, sizeof(data));
+}
+
+static void recipe_tick(ms_core_t *c, int64_t now_us)
+{
+    const recipe_segment_t *seg = &c->recipe.segments[c->seg];
+    uint32_t ramp_ms = recipe_ramp_ms(c->seg_from_x10, seg);
+    int64_t seg_ms = (now_us - c->seg_start_us) / 1000;
+
+    if (seg_ms < ramp_ms) {
+        /* Linear ramp; the env coalesces the resulting SV writes */
+        int32_t span = seg->chamber_sv_x10 - c->seg_from_x10;
+        request_chamber_sv(c, (int16_t)(c->seg_from_x10 + span * seg_ms / (int64_t)ramp_ms));
+        return;
+    }
+
+    request_chamber_sv(c, seg->chamber_sv_x10);
+
+    if (!c->holding) {
+        if (seg->flags & RECIPE_SEG_WAIT_PV) {
+            int16_t pv_x10;
+            if (!c->env->chamber_temp(c->env->ctx, &pv_x10) ||
+                abs(pv_x10 - seg->chamber_sv_x10) > PRECOOL_TEMP_TOLERANCE_X10) {
+                return;
+            }
+        }
+        c->holding = true;
+        c->hold_start_us = now_us;
+    }
+
+    if ((now_us - c->hold_start_us) / 1000 < seg->hold_ms) {
+        return;
+    }
+
+    if (c->seg + 1 >= c->recipe.header.segment_count) {
+        ESP_LOGI(TAG, "Recipe 0x%04X complete", c->recipe.header.recipe_id);
+        transition_to(c, MACHINE_STATE_STOPPING);
+        return;
+    }
+
+    c->seg++;
+    recipe_begin_segment(c, now_us);
+}
+
+static uint32_t recipe_remaining_ms(const ms_core_t *c, int64_t now_us)
+{
+    if (!c->recipe_started) {
+        return recipe_planned_ms(&c->recipe, 0, c->target_temp_x10);
+    }
+
+    const recipe_segment_t *seg = &c->recipe.segments[c->seg];
+    int64_t ms;
+    if (c->holding) {
+        ms = (int64_t)seg->hold_ms - (now_us - c->hold_start_us) / 1000;
+    } else {
+        ms = (int64_t)recipe_ramp_ms(c->seg_from_x10, seg) + seg->hold_ms -
+             (now_us - c->seg_start_us) / 1000;
+        if (ms < (int64_t)seg->hold_ms) {
+            ms = seg->hold_ms;      /* Waiting for PV: the whole hold is still ahead */
+        }
+    }
+    if (ms < 0) {
+        ms = 0;
+    }
+    ms += recipe_planned_ms(&c->recipe, c->seg + 1, seg->chamber_sv_x10);
+    return ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+}
+
+/* ===== Output sequences ===== */
+
+/* Write every step that is due, one output write each, and ask for a
+ * tick when the next one is */
+static void seq_service(ms_core_t *c)
+{
+    const ms_env_t *env = c->env;
+    int64_t now_us = env->now_us(env->ctx);
+
+    for (;;) {
+        int64_t started_us = c->seq.started_us;
+        const relay_seq_t *seq;
+        uint8_t index;
+        const relay_seq_step_t *step = relay_seq_poll(&c->seq, now_us, &seq, &index);
+        if (step == NULL) {
+            break;
+        }
+        c->out_mask |= step->mask;
+        c->out_values = (c->out_values & ~step->mask) | (step->values & step->mask);
+        c->out_verify |= step->verify;
+        commit_outputs(c);
+        env->seq_step(env->ctx, seq, index, started_us);
+    }
+
+    if (relay_seq_busy(&c->seq)) {
+        env->wake_at(env->ctx, relay_seq_due_us(&c->seq));
+    }
+}
+
+/* ===== Internal Functions ===== */
+
+/**
+ * @brief Emit a state change event with old and new state in payload
+ */
+static void emit_state_change_event(ms_core_t *c, machine_state_t old_state,
+                                    machine_state_t new_state)
+{
+    uint8_t payload[2] = { (uint8_t)old_state, (uint8_t)new_state };
+
+    /* Determine severity based on new state */
+    uint8_t severity = EVENT_SEVERITY_INFO;
+    if (new_state == MACHINE_STATE_E_STOP) {
+        severity = EVENT_SEVERITY_CRITICAL;
+    } else if (new_state == MACHINE_STATE_FAULT) {
+        severity = EVENT_SEVERITY_ALARM;
+    } else if (new_state == MACHINE_STATE_STOPPING) {
+        severity = EVENT_SEVERITY_WARN;
+    }
+
+    c->env->event(c->env->ctx, EVENT_STATE_CHANGED, severity, payload, sizeof(payload));
+}
+
+static void emit_event(ms_core_t *c, uint16_t event_id, uint8_t severity)
+{
+    c->env->event(c->env->ctx, event_id, severity, NULL, 0);
+}
+
+/* Stage a relay change; nothing is written until commit_outputs() */
+static void set_relay(ms_core_t *c, uint8_t channel, bool on)
+{
+    uint8_t bit = (uint8_t)(1 << (channel - 1));
+    c->out_mask |= bit;
+    c->out_values = on ? (c->out_values | bit) : (c->out_values & ~bit);
+}
+
+/* Write everything staged as one output image and publish it */
+static void commit_outputs(ms_core_t *c)
+{
+    if (c->out_mask == 0) {
+        return;
+    }
+
+    esp_err_t err = c->env->write_outputs(c->env->ctx, c->out_mask, c->out_values,
+                                          c->out_verify);
+    if (err != ESP_OK && c->out_verify) {
+        /* Safing must not be lost to one bus glitch */
+        ESP_LOGE(TAG, "Safe output write failed (%s) - retrying", esp_err_to_name(err));
+        err = c->env->write_outputs(c->env->ctx, c->out_mask, c->out_values, true);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Output write failed: %s", esp_err_to_name(err));
+    }
+
+    c->out_mask = 0;
+    c->out_values = 0;
+    c->out_verify = false;
+    c->env->outputs_changed(c->env->ctx);
+}
+
+static void transition_to(ms_core_t *c, machine_state_t new_state)
+{
+    machine_state_t old_state = c->state;
+
+    if (old_state == new_state) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "State transition: %s -> %s",
+             machine_state_to_str(old_state), machine_state_to_str(new_state));
+
+    c->state = new_state;
+    c->state_enter_us = c->env->now_us(c->env->ctx);
+
+    /* Execute entry actions for new state */
+    switch (new_state) {
+        case MACHINE_STATE_IDLE:
+            relay_seq_start(&c->seq, &seq_shutdown, c->state_enter_us);
+            c->run_start_us = 0;
+            c->has_recipe = false;
+            c->recipe_started = false;
+            break;
+
+        case MACHINE_STATE_PRECOOL:
+            precool_eta_reset(&c->eta, c->state_enter_us);
+            /* Lock door, start cooling (heaters under PID), energize motor circuit */
+            relay_seq_start(&c->seq, &seq_power_up, c->state_enter_us);
+            break;
+
+        case MACHINE_STATE_RUNNING:
+            /* Motor start waits out the power-up sequence's contactor settle */
+            c->seg_motor = false;
+            if (c->has_recipe) {
+                /* First segment, or restart the interrupted one after a pause */
+                recipe_begin_segment(c, c->state_enter_us);
+            } else {
+                relay_seq_queue(&c->seq, &seq_motor_start, c->state_enter_us);
+            }
+            break;
+
+        case MACHINE_STATE_STOPPING:
+            /* Stop motor via soft starter, heaters and LN2 off; contactor and
+             * door lock stay on during the soak */
+            relay_seq_start(&c->seq, &seq_cool_down, c->state_enter_us);
+            break;
+
+        case MACHINE_STATE_E_STOP:
+        case MACHINE_STATE_FAULT:
+            set_outputs_safe(c);
+            break;
+
+        case MACHINE_STATE_SERVICE:
+            /* All relays available for manual control (a shutdown sequence
+             * still running from IDLE finishes first) */
+            break;
+
+        case MACHINE_STATE_PAUSED:
+            /* Stop motor, heaters off, unlock door for inspection after spin-down.
+             * LN2 valve controlled by pause mode (staged in ms_core_pause_run) */
+            relay_seq_start(&c->seq, &seq_pause, c->state_enter_us);
+            break;
+
+        default:
+            break;
+    }
+
+    /* Staged entry actions switch together, in one output write, with the
+     * first step of a sequence started above */
+    seq_service(c);
+    commit_outputs(c);
+
+    /* Notify callback */
+    c->env->transition(c->env->ctx, old_state, new_state);
+
+    /* Emit state change event */
+    emit_state_change_event(c, old_state, new_state);
+
+    /* Emit specific events for key transitions */
+    if (new_state == MACHINE_STATE_E_STOP) {
+        emit_event(c, EVENT_ESTOP_ASSERTED, EVENT_SEVERITY_CRITICAL);
+    } else if (old_state == MACHINE_STATE_E_STOP && new_state == MACHINE_STATE_IDLE) {
+        emit_event(c, EVENT_ESTOP_CLEARED, EVENT_SEVERITY_INFO);
+    }
+
+    if (old_state == MACHINE_STATE_IDLE && new_state == MACHINE_STATE_PRECOOL) {
+        emit_event(c, EVENT_RUN_STARTED, EVENT_SEVERITY_INFO);
+    } else if (old_state == MACHINE_STATE_PRECOOL && new_state == MACHINE_STATE_RUNNING) {
+        emit_event(c, EVENT_PRECOOL_COMPLETE, EVENT_SEVERITY_INFO);
+    } else if (new_state == MACHINE_STATE_IDLE &&
+               (old_state == MACHINE_STATE_STOPPING || old_state == MACHINE_STATE_RUNNING)) {
+        emit_event(c, EVENT_RUN_STOPPED, EVENT_SEVERITY_INFO);
+    } else if (new_state == MACHINE_STATE_FAULT || new_state == MACHINE_STATE_E_STOP) {
+        if (old_state == MACHINE_STATE_RUNNING || old_state == MACHINE_STATE_PRECOOL ||
+            old_state == MACHINE_STATE_PAUSED) {
+            emit_event(c, EVENT_RUN_ABORTED, EVENT_SEVERITY_ALARM);
+        }
+    }
+
+    /* Pause/resume events */
+    if (new_state == MACHINE_STATE_PAUSED) {
+        emit_event(c, EVENT_RUN_PAUSED, EVENT_SEVERITY_INFO);
+    } else if (old_state == MACHINE_STATE_PAUSED &&
+               (new_state == MACHINE_STATE_PRECOOL || new_state == MACHINE_STATE_RUNNING)) {
+        emit_event(c, EVENT_RUN_RESUMED, EVENT_SEVERITY_INFO);
+    }
+}
+
+static void set_outputs_safe(ms_core_t *c)
+{
+    ESP_LOGI(TAG, "Setting outputs to safe state");
+
+    /* Safing never waits for a sequence step */
+    if (relay_seq_abort(&c->seq)) {
+        ESP_LOGW(TAG, "Relay sequence aborted");
+    }
+
+    /* Turn off all relays except chamber light (user preference). Staged:
+     * the caller's commit drops motor start and contactor in the same write. */
+    set_relay(c, RO_MOTOR_START, false);
+    set_relay(c, RO_MAIN_CONTACTOR, false);
+    set_relay(c, RO_HEATER_1, false);
+    set_relay(c, RO_HEATER_2, false);
+    set_relay(c, RO_LN2_VALVE, false);
+    set_relay(c, RO_DOOR_LOCK, false);
+    /* Keep light state as-is or turn off */
+    c->out_verify = true;
+}
+
+static bool check_estop_active(const ms_core_t *c)
+{
+    /* E-Stop is active-LOW: DI1 LOW = E-stop pressed */
+    return (c->di_bits & (1 << (DI_ESTOP - 1))) == 0;
+}
+
+static bool check_door_open(const ms_core_t *c)
+{
+    /* Door closed is HIGH: DI2 LOW = door open */
+    return (c->di_bits & (1 << (DI_DOOR_CLOSED - 1))) == 0;
+}
+
+static bool check_motor_fault(const ms_core_t *c)
+{
+    /* Motor fault check disabled - soft starter has no fault output signal.
+     * DI4 is reserved for future use if we add a VFD with fault output.
+     * Always returns false (no fault) for now. */
+    (void)c;
+    (void)DI_MOTOR_FAULT;  /* Suppress unused warning */
+    return false;
+}
+
+static bool check_ln2_present(const ms_core_t *c)
+{
+    /* LN2 present is HIGH: DI3 HIGH = LN2 available */
+    return (c->di_bits & (1 << (DI_LN2_PRESENT - 1))) != 0;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "machine_state.h"
+#include "recipe.h"
+#include "precool_eta.h"
+#include "relay_seq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Machine state core
+ * ==================
+ *
+ * The state machine itself: transitions, entry actions, command checks and
+ * the per-tick timeout logic. It has no FreeRTOS, esp_timer or driver
+ * dependencies - time, inputs and outputs all go through ms_env_t, and the
+ * caller decides when a tick happens and serialises access.
+ *
+ * machine_state.c wraps one core with the real environment, a command queue
+ * and the 50 ms state task that owns it. tools/machine_state_sim drives a core
+ * on the host with a virtual clock and scripted DI / PV / HMI inputs.
+ * precool_eta.c and relay_seq.c are part of the core.
+ */
+
+/* Nominal tick period; the firmware task ticks at this rate */
+#define MS_CORE_TICK_MS             50
+
+/* Precool parameters */
+#define PRECOOL_TARGET_TEMP_X10     (-500)  /* -50.0°C default precool target */
+#define PRECOOL_TIMEOUT_MS          (300000) /* 5 minute precool timeout */
+#define PRECOOL_TEMP_TOLERANCE_X10  50      /* ±5°C tolerance for temp reached */
+
+/* Stopping phase parameters */
+#define STOPPING_SOAK_TIME_MS       (30000) /* 30 second thermal soak */
+
+/* Output sequence timing (sequence tables in machine_state_core.c) */
+#define MS_SEQ_DOOR_LOCK_MS         200     /* Lock solenoid thrown before cooling / motor power */
+#define MS_SEQ_CONTACTOR_SETTLE_MS  500     /* Contactor + soft starter powered before START */
+#define MS_SEQ_SOFT_STOP_MS         200     /* START released before the contactor drops */
+#define MS_SEQ_SPINDOWN_MS          2000    /* Motor power off before the door unlocks */
+
+/* Output sequence IDs (relay_seq_t.id, traced) */
+typedef enum {
+    MS_SEQ_POWER_UP = 0,        /* PRECOOL entry */
+    MS_SEQ_MOTOR_START,         /* RUNNING entry, recipe segment with motor */
+    MS_SEQ_MOTOR_STOP,          /* Recipe segment without motor */
+    MS_SEQ_COOL_DOWN,           /* STOPPING entry */
+    MS_SEQ_PAUSE,               /* PAUSED entry */
+    MS_SEQ_SHUTDOWN,            /* IDLE entry */
+} ms_seq_id_t;
+
+/* PID controller addresses driven by recipes */
+#define MS_PID_ADDR_CHAMBER         1
+#define MS_PID_ADDR_HEATER_1        2
+#define MS_PID_ADDR_HEATER_2        3
+
+/* Environment the core runs against. All hooks are required. */
+typedef struct {
+    /* Monotonic time in microseconds */
+    int64_t   (*now_us)(void *ctx);
+    /* Read the DI byte; on error the core keeps the previous value */
+    esp_err_t (*read_di)(void *ctx, uint8_t *di_byte);
+    /* Chamber PV in 0.1°C; false if the controller is offline or stale */
+    bool      (*chamber_temp)(void *ctx, int16_t *temp_x10);
+    /* HMI heartbeat is live */
+    bool      (*hmi_live)(void *ctx);
+    /* Safety gates allow a run to start */
+    bool      (*start_allowed)(void *ctx);
+    /* Request a PID setpoint; may be called every tick during a ramp */
+    void      (*set_sv)(void *ctx, uint8_t pid_addr, int16_t sv_x10);
+    /* Apply staged relay changes in one output write: relays in mask
+     * (bit 0 = RO1) take their level from values. verify: read back. */
+    esp_err_t (*write_outputs)(void *ctx, uint8_t mask, uint8_t values, bool verify);
+    /* Relay image changed - publish it */
+    void      (*outputs_changed)(void *ctx);
+    /* DI bits were (re)read - publish them */
+    void      (*inputs_changed)(void *ctx, uint16_t di_bits);
+    /* Emit an event (EVENT_* id, EVENT_SEVERITY_*) */
+    void      (*event)(void *ctx, uint16_t event_id, uint8_t severity,
+                       const uint8_t *data, size_t data_len);
+    /* State changed; called after entry actions, before events */
+    void      (*transition)(void *ctx, machine_state_t old_state, machine_state_t new_state);
+    /* Tick again at due_us (next relay sequence step); replaces any earlier request */
+    void      (*wake_at)(void *ctx, int64_t due_us);
+    /* Sequence step index of seq was just written; started_us is the sequence start */
+    void      (*seq_step)(void *ctx, const relay_seq_t *seq, uint8_t index, int64_t started_us);
+    void      *ctx;
+} ms_env_t;
+
+typedef struct {
+    const ms_env_t *env;
+
+    machine_state_t state;
+    run_mode_t      run_mode;
+    int64_t         run_start_us;
+    uint32_t        run_duration_ms;
+    int16_t         target_temp_x10;
+    int64_t         state_enter_us;
+
+    /* Pause state tracking */
+    pause_mode_t    pause_mode;
+    machine_state_t pre_pause_state;    /* State before pause (RUNNING or PRECOOL) */
+    int64_t         pause_time_us;      /* Time at which pause started */
+
+    /* Digital input state (cached from last read) */
+    uint16_t        di_bits;
+
+    /* Relay changes staged by entry actions, written by one commit */
+    uint8_t         out_mask;
+    uint8_t         out_values;
+    bool            out_verify;         /* Safe-state commit: read the image back */
+
+    /* Timed relay sequences from entry actions, stepped by ticks */
+    relay_seq_run_t seq;
+
+    /* Time-to-target fit, restarted on every PRECOOL entry */
+    precool_eta_t   eta;
+
+    /* Recipe execution (START_RUN with a recipe slot) */
+    bool            has_recipe;
+    bool            recipe_started;     /* First segment entered */
+    bool            holding;            /* Current segment is in its hold phase */
+    bool            seg_motor;          /* Motor start sequenced for the current segment */
+    uint8_t         seg;                /* Current segment, 0-based */
+    int16_t         seg_from_x10;       /* Chamber SV when the segment (re)started */
+    int16_t         sv_x10;             /* Last chamber SV requested */
+    int64_t         seg_start_us;
+    int64_t         hold_start_us;
+    recipe_t        recipe;
+} ms_core_t;
+
+/**
+ * @brief Reset the core to IDLE, read inputs and latch E_STOP if active
+ */
+void ms_core_init(ms_core_t *core, const ms_env_t *env);
+
+/**
+ * @brief Re-read the digital inputs into the core
+ */
+void ms_core_read_inputs(ms_core_t *core);
+
+/**
+ * @brief Run one tick against the cached inputs
+ *
+ * Checks E-stop, motor fault and door interlocks, then the PRECOOL /
+ * RUNNING / STOPPING timers, then writes any relay sequence step that is
+ * due. Call ms_core_read_inputs() first. Ticks may come early (env
+ * wake_at); the timers work from env time, not a tick count.
+ *
+ * @return true if the tick tripped the machine into E_STOP or FAULT
+ */
+bool ms_core_tick(ms_core_t *core);
+
+/**
+ * @brief Fill run information at the current env time
+ */
+void ms_core_get_run_info(ms_core_t *core, machine_run_info_t *out_info);
+
+/**
+ * @brief Interlock bits from the cached inputs and HMI state
+ */
+uint8_t ms_core_get_interlocks(ms_core_t *core);
+
+/* Commands - same semantics and return codes as MACHINE_STATE_CMD_*,
+ * without the session check */
+esp_err_t ms_core_start_run(ms_core_t *core, run_mode_t mode,
+                            int16_t target_temp_x10, uint32_t run_duration_ms);
+esp_err_t ms_core_start_recipe(ms_core_t *core, run_mode_t mode, const recipe_t *recipe);
+esp_err_t ms_core_stop_run(ms_core_t *core, stop_mode_t mode);
+esp_err_t ms_core_pause_run(ms_core_t *core, pause_mode_t mode);
+esp_err_t ms_core_resume_run(ms_core_t *core);
+esp_err_t ms_core_enter_service(ms_core_t *core);
+esp_err_t ms_core_exit_service(ms_core_t *core);
+esp_err_t ms_core_clear_estop(ms_core_t *core);
+esp_err_t ms_core_clear_fault(ms_core_t *core);
+void ms_core_force_safe(ms_core_t *core);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,153 @@
+#include "precool_eta.h"
+#include "wire_protocol.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Slopes closer to 1 than this are treated as a straight line */
+#define SLOPE_LINEAR_EPS    1e-4f
+
+void precool_eta_reset(precool_eta_t *e, int64_t now_us)
+{
+    memset(e, 0, sizeof(*e));
+    e->next_sample_us = now_us;
+    e->eta_ms = e->eta_lo_ms = e->eta_hi_ms = PRECOOL_ETA_NEVER;
+    e->asymptote_x10 = INT16_MAX;
+}
+
+/*
+ * Samples until t (relative °C) falls to r on the line y = a * x + (my - a * mx)
+ * through the centroid, as a time in ms.
+ */
+static uint32_t eta_for(float a, float mx, float my, float t, float r)
+{
+    float n;
+
+    if (t <= r) {
+        return 0;
+    }
+    if (a > 0.0f && a < 1.0f - SLOPE_LINEAR_EPS) {
+        float t_inf = (my - a * mx) / (1.0f - a);
+        if (t_inf >= r) {
+            return PRECOOL_ETA_NEVER;
+        }
+        n = logf((r - t_inf) / (t - t_inf)) / logf(a);
+    } else {
+        /* No usable curvature: extrapolate the mean drift per sample */
+        float drift = my - mx;
+        if (drift >= -1e-3f) {
+            return PRECOOL_ETA_NEVER;
+        }
+        n = (t - r) / -drift;
+    }
+
+    float ms = n * PRECOOL_ETA_SAMPLE_MS;
+    return (ms >= (float)UINT32_MAX) ? PRECOOL_ETA_NEVER : (uint32_t)ms;
+}
+
+static uint8_t band_pct(uint32_t eta, uint32_t lo, uint32_t hi)
+{
+    if (eta == 0) {
+        return 0;
+    }
+    if (eta == PRECOOL_ETA_NEVER || hi == PRECOOL_ETA_NEVER) {
+        return WIRE_PRECOOL_ETA_BAND_MAX;
+    }
+    uint64_t spread = (eta - lo > hi - eta) ? eta - lo : hi - eta;
+    uint64_t pct = (spread * 100 + eta - 1) / eta;
+    return (pct > WIRE_PRECOOL_ETA_BAND_MAX) ? WIRE_PRECOOL_ETA_BAND_MAX : (uint8_t)pct;
+}
+
+static void estimate(precool_eta_t *e, int16_t reach_x10, uint32_t budget_ms)
+{
+    float mx = e->sx / e->sw;
+    float my = e->sy / e->sw;
+    float cxx = e->sxx - e->sw * mx * mx;
+    float cxy = e->sxy - e->sw * mx * my;
+    float cyy = e->syy - e->sw * my * my;
+    float r = reach_x10 / 10.0f - e->ref_c;
+
+    float a = 1.0f;
+    float sigma = 0.0f;
+    if (cxx > 1e-6f) {
+        a = cxy / cxx;
+        float resid = cyy - a * cxy;
+        if (resid > 0.0f && e->sw > 2.0f) {
+            sigma = sqrtf(resid / (e->sw - 2.0f) / cxx);
+        }
+    }
+
+    e->eta_ms = eta_for(a, mx, my, e->last_c, r);
+    e->eta_lo_ms = e->eta_hi_ms = e->eta_ms;
+    for (int k = -1; k <= 1; k += 2) {
+        uint32_t t = eta_for(a + k * 2.0f * sigma, mx, my, e->last_c, r);
+        if (t < e->eta_lo_ms) e->eta_lo_ms = t;
+        if (t > e->eta_hi_ms) e->eta_hi_ms = t;
+    }
+    e->band_pct = band_pct(e->eta_ms, e->eta_lo_ms, e->eta_hi_ms);
+
+    e->asymptote_x10 = INT16_MAX;
+    if (a > 0.0f && a < 1.0f - SLOPE_LINEAR_EPS) {
+        float t_inf = e->ref_c + (my - a * mx) / (1.0f - a);
+        if (t_inf > -3000.0f && t_inf < 3000.0f) {
+            e->asymptote_x10 = (int16_t)lroundf(t_inf * 10.0f);
+        }
+    }
+
+    /* Judge on the optimistic bound so a noisy fit does not cry wolf */
+    if (e->eta_lo_ms > budget_ms) {
+        e->status = WIRE_PRECOOL_ETA_AT_RISK;
+        if (e->risk_run < UINT8_MAX) e->risk_run++;
+    } else {
+        e->status = WIRE_PRECOOL_ETA_ON_TRACK;
+        e->risk_run = 0;
+    }
+}
+
+bool precool_eta_update(precool_eta_t *e, int64_t now_us, int16_t pv_x10,
+                        int16_t reach_x10, uint32_t budget_ms)
+{
+    if (now_us < e->next_sample_us) {
+        return false;
+    }
+    e->next_sample_us += PRECOOL_ETA_SAMPLE_MS * 1000LL;
+    if (e->next_sample_us <= now_us) {
+        /* Missed samples (PV offline): resume the grid from now */
+        e->next_sample_us = now_us + PRECOOL_ETA_SAMPLE_MS * 1000LL;
+    }
+
+    float t = pv_x10 / 10.0f;
+    if (e->samples == 0) {
+        e->ref_c = t;
+    }
+    float x = e->last_c;
+    float y = t - e->ref_c;
+    e->last_c = y;
+    if (e->samples < UINT16_MAX) {
+        e->samples++;
+    }
+    if (e->samples < 2) {
+        return false;
+    }
+
+    e->sw  = e->sw  * PRECOOL_ETA_FORGET + 1.0f;
+    e->sx  = e->sx  * PRECOOL_ETA_FORGET + x;
+    e->sy  = e->sy  * PRECOOL_ETA_FORGET + y;
+    e->sxx = e->sxx * PRECOOL_ETA_FORGET + x * x;
+    e->sxy = e->sxy * PRECOOL_ETA_FORGET + x * y;
+    e->syy = e->syy * PRECOOL_ETA_FORGET + y * y;
+
+    if (e->samples < PRECOOL_ETA_MIN_SAMPLES) {
+        return false;
+    }
+    estimate(e, reach_x10, budget_ms);
+    return true;
+}
+
+uint8_t precool_eta_wire(const precool_eta_t *e)
+{
+    if (e->status == WIRE_PRECOOL_ETA_NONE) {
+        return 0;
+    }
+    return (uint8_t)(e->status | (e->band_pct << WIRE_PRECOOL_ETA_BAND_SHIFT));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Precool ETA estimator
+ * =====================
+ *
+ * Online fit of the chamber cool-down to an exponential approach
+ *
+ *   T(t) = T_inf + (T_0 - T_inf) * exp(-t / tau)
+ *
+ * Sampled every PRECOOL_ETA_SAMPLE_MS this is the linear recurrence
+ * T[k+1] = a * T[k] + b with a = exp(-dt / tau) and T_inf = b / (1 - a),
+ * so a weighted least-squares line through (T[k], T[k+1]) pairs, kept as
+ * running sums with exponential forgetting, tracks a and b in O(1) per
+ * sample. The confidence band comes from the standard error of a.
+ *
+ * A stalled or warming chamber (empty dewar) fits T_inf above the target,
+ * or a non-negative drift, and is reported as unreachable.
+ *
+ * Pure C, no FreeRTOS or ESP-IDF dependencies; the machine_state core
+ * feeds it and tools/machine_state_sim runs it on the host.
+ */
+
+#define PRECOOL_ETA_SAMPLE_MS       1000    /* Fit sample period */
+#define PRECOOL_ETA_MIN_SAMPLES     60      /* Learning time before the first estimate */
+#define PRECOOL_ETA_RISK_SAMPLES    5       /* Consecutive AT_RISK estimates before warning */
+#define PRECOOL_ETA_FORGET          0.98f   /* Per-sample weight decay (~50 s memory) */
+
+#define PRECOOL_ETA_NEVER           UINT32_MAX
+
+typedef struct {
+    /* Fit state, temperatures in °C relative to the first sample */
+    float    ref_c;
+    float    last_c;
+    float    sw, sx, sy, sxx, sxy, syy;
+    uint16_t samples;
+    int64_t  next_sample_us;
+
+    /* Last estimate */
+    uint8_t  status;            /* WIRE_PRECOOL_ETA_* */
+    uint8_t  band_pct;          /* ± uncertainty of eta_ms, 0..WIRE_PRECOOL_ETA_BAND_MAX */
+    uint8_t  risk_run;          /* Consecutive AT_RISK estimates */
+    uint32_t eta_ms;            /* Time until PV <= reach_x10, or PRECOOL_ETA_NEVER */
+    uint32_t eta_lo_ms;
+    uint32_t eta_hi_ms;
+    int16_t  asymptote_x10;     /* Fitted T_inf, INT16_MAX if the fit is not exponential */
+} precool_eta_t;
+
+/**
+ * @brief Start a new fit (PRECOOL entry)
+ */
+void precool_eta_reset(precool_eta_t *eta, int64_t now_us);
+
+/**
+ * @brief Feed a PV reading; call every tick, it samples internally
+ *
+ * @param reach_x10 PV at which precool completes (target + tolerance)
+ * @param budget_ms Time left before the precool timeout
+ * @return true if a new estimate was made
+ */
+bool precool_eta_update(precool_eta_t *eta, int64_t now_us, int16_t pv_x10,
+                        int16_t reach_x10, uint32_t budget_ms);
+
+/**
+ * @brief Telemetry byte: status | band << WIRE_PRECOOL_ETA_BAND_SHIFT
+ */
+uint8_t precool_eta_wire(const precool_eta_t *eta);
+
+#ifdef __cplusplus
+}
+#endif
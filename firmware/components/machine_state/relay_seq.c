@@ -0,0 +1,75 @@
+#include "relay_seq.h"
+
+#include <stddef.h>
+
+void relay_seq_init(relay_seq_run_t *run)
+{
+    *run = (relay_seq_run_t){ 0 };
+}
+
+void relay_seq_start(relay_seq_run_t *run, const relay_seq_t *seq, int64_t now_us)
+{
+    run->seq = seq;
+    run->next = NULL;
+    run->step = 0;
+    run->due_us = now_us;
+    run->started_us = now_us;
+}
+
+void relay_seq_queue(relay_seq_run_t *run, const relay_seq_t *seq, int64_t now_us)
+{
+    if (run->seq != NULL) {
+        run->next = seq;
+        return;
+    }
+
+    /* Idle, but the last step's dwell may still be running */
+    run->seq = seq;
+    run->step = 0;
+    if (run->due_us < now_us) {
+        run->due_us = now_us;
+    }
+    run->started_us = run->due_us;
+}
+
+bool relay_seq_abort(relay_seq_run_t *run)
+{
+    bool pending = run->seq != NULL;
+    relay_seq_init(run);
+    return pending;
+}
+
+const relay_seq_step_t *relay_seq_poll(relay_seq_run_t *run, int64_t now_us,
+                                       const relay_seq_t **out_seq, uint8_t *out_index)
+{
+    if (run->seq == NULL || now_us < run->due_us) {
+        return NULL;
+    }
+
+    const relay_seq_t *seq = run->seq;
+    const relay_seq_step_t *step = &seq->steps[run->step];
+    *out_seq = seq;
+    *out_index = run->step;
+
+    /* Dwell counts from when the step actually ran */
+    run->step++;
+    run->due_us = now_us + (int64_t)step->dwell_ms * 1000;
+
+    if (run->step >= seq->count) {
+        run->seq = run->next;
+        run->next = NULL;
+        run->step = 0;
+        run->started_us = run->due_us;
+    }
+    return step;
+}
+
+bool relay_seq_busy(const relay_seq_run_t *run)
+{
+    return run->seq != NULL;
+}
+
+int64_t relay_seq_due_us(const relay_seq_run_t *run)
+{
+    return run->due_us;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Relay output sequencer
+ * ======================
+ *
+ * A sequence is a const table of steps. Each step sets the relays in its
+ * mask to its values, then holds for at least dwell_ms before the next
+ * step may run. The executor never waits: relay_seq_poll() hands out the
+ * steps that are due at the given time and relay_seq_due_us() says when
+ * to call it again, so the owner applies steps from its own tick or timer.
+ *
+ * One sequence runs at a time with at most one queued behind it. A queued
+ * sequence starts once the running one has finished, including its last
+ * dwell (a contactor settles before the motor is started). Starting a
+ * sequence outright, or aborting, drops whatever was pending - safing
+ * never waits for a step.
+ *
+ * Pure C, no FreeRTOS or ESP-IDF dependencies; the machine_state core
+ * drives it and tools/machine_state_sim runs it on the host.
+ */
+
+typedef struct {
+    uint8_t  mask;              /* Relays this step drives (bit 0 = RO1) */
+    uint8_t  values;            /* Their levels */
+    bool     verify;            /* Read the image back after the write */
+    uint16_t dwell_ms;          /* Minimum hold before the next step */
+} relay_seq_step_t;
+
+typedef struct {
+    uint8_t                 id;         /* Stable trace ID */
+    const char             *name;
+    const relay_seq_step_t *steps;
+    uint8_t                 count;
+} relay_seq_t;
+
+typedef struct {
+    const relay_seq_t *seq;     /* Running, NULL when idle */
+    const relay_seq_t *next;    /* Queued behind it */
+    uint8_t            step;    /* Next step of seq */
+    int64_t            due_us;  /* Earliest time for that step (or, idle, for a queued start) */
+    int64_t            started_us;
+} relay_seq_run_t;
+
+/**
+ * @brief Idle executor, nothing pending
+ */
+void relay_seq_init(relay_seq_run_t *run);
+
+/**
+ * @brief Drop the running and queued sequences; first step of seq due now
+ */
+void relay_seq_start(relay_seq_run_t *run, const relay_seq_t *seq, int64_t now_us);
+
+/**
+ * @brief Run seq after the current sequence and its last dwell
+ *
+ * Replaces a sequence that was already queued.
+ */
+void relay_seq_queue(relay_seq_run_t *run, const relay_seq_t *seq, int64_t now_us);
+
+/**
+ * @brief Drop everything pending
+ *
+ * @return true if a step was still to run
+ */
+bool relay_seq_abort(relay_seq_run_t *run);
+
+/**
+ * @brief Take the next step due at now_us
+ *
+ * Call until it returns NULL. Each call advances the executor, so apply
+ * every step it returns, in order.
+ *
+ * @param out_seq   Sequence the step belongs to
+ * @param out_index Step index within it
+ * @return The step, or NULL if none is due
+ */
+const relay_seq_step_t *relay_seq_poll(relay_seq_run_t *run, int64_t now_us,
+                                       const relay_seq_t **out_seq, uint8_t *out_index);
+
+/**
+ * @brief Steps remain to be run
+ */
+bool relay_seq_busy(const relay_seq_run_t *run);
+
+/**
+ * @brief When the next step is due (valid while relay_seq_busy())
+ */
+int64_t relay_seq_due_us(const relay_seq_run_t *run);
+
+#ifdef __cplusplus
+}
+#endif
@@ -23,6 +23,7 @@ extern "C" {
 #define PID_POLL_INTERVAL_MS        300     /* Poll each controller every N ms (fast mode) */
 #define PID_POLL_INTERVAL_SLOW_MS   2000    /* Poll interval in lazy mode (0.5 Hz per controller) */
 #define PID_STALE_THRESHOLD_MS      2000    /* Data considered stale after this */
+#define PID_SV_STREAM_MIN_GAP_MS    500     /* Min spacing of streamed SV writes per controller */
 
 /* Lazy polling defaults */
 #define PID_IDLE_TIMEOUT_DEFAULT    5       /* Default idle timeout in minutes */
@@ -142,6 +143,20 @@ esp_err_t pid_controller_get_by_addr(uint8_t addr, pid_controller_t *out);
  */
 esp_err_t pid_controller_set_sv(uint8_t addr, float sv_celsius);
 
+/**
+ * @brief Request a setpoint to be written by the poll task (setpoint ramps)
+ *
+ * Only the latest request per controller is kept. The poll task writes it
+ * in that controller's poll slot, at most once per PID_SV_STREAM_MIN_GAP_MS,
+ * without the read-back of pid_controller_set_sv() - the poll that follows
+ * reads SV anyway. Does not block on the bus.
+ *
+ * @param addr Modbus address
+ * @param sv_celsius Setpoint in degrees C
+ * @return ESP_OK, ESP_ERR_NOT_FOUND for an unknown address
+ */
+esp_err_t pid_controller_stream_sv(uint8_t addr, float sv_celsius);
+
 /**
  * @brief Read PID parameters from controller
  *
@@ -1,5 +1,6 @@
 #include "pid_controller.h"
 #include "modbus_master.h"
+#include "trace_log.h"
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -29,6 +30,14 @@ static uint8_t s_idle_timeout_minutes = PID_IDLE_TIMEOUT_DEFAULT;
 static volatile uint32_t s_last_activity_ms = 0;
 static volatile bool s_lazy_polling_active = false;
 
+/* Streamed setpoints: latest request per controller, written by the poll task */
+typedef struct {
+    int16_t  raw;
+    bool     pending;
+    uint32_t last_write_ms;
+} sv_stream_t;
+static sv_stream_t s_sv_stream[PID_MAX_CONTROLLERS];
+
 /* Get current time in milliseconds */
 static uint32_t get_time_ms(void)
 {
@@ -111,9 +120,38 @@ static void poll_controller(pid_controller_t *ctrl)
 
     xSemaphoreGive(s_data_mutex);
 
-    ESP_LOGD(TAG, "[%d] PV=%.1f SV=%.1f OUT=%.1f%% ST=0x%04X MODE=%d",
-             ctrl->addr, ctrl->data.pv, ctrl->data.sv,
-             ctrl->data.output_pct, ctrl->data.status, ctrl->data.mode);
+    /* Raw register values are already ×10 - no float formatting on the poll path */
+    TRACE_LOGD(TRACE_FMT_PID_POLL, ctrl->addr, (int16_t)regs[0], (int16_t)regs[5],
+               (int16_t)regs[1], regs[4], ctrl->data.mode);
+}
+
+/* Write a pending streamed setpoint in this controller's poll slot */
+static void write_streamed_sv(uint8_t idx)
+{
+    sv_stream_t *st = &s_sv_stream[idx];
+    uint32_t now = get_time_ms();
+    int16_t raw;
+
+    xSemaphoreTake(s_data_mutex, portMAX_DELAY);
+    bool due = st->pending && (now - st->last_write_ms) >= PID_SV_STREAM_MIN_GAP_MS;
+    raw = st->raw;
+    if (due) {
+        st->pending = false;
+        st->last_write_ms = now;
+    }
+    xSemaphoreGive(s_data_mutex);
+
+    if (!due) return;
+
+    modbus_err_t err = modbus_write_single(s_controllers[idx].addr, LC108_REG_SV, (uint16_t)raw);
+    if (err != MODBUS_OK) {
+        ESP_LOGW(TAG, "Streamed SV write to addr %d failed: %s",
+                 s_controllers[idx].addr, modbus_err_str(err));
+        /* Retry in the next slot (with the newest value if one arrived meanwhile) */
+        xSemaphoreTake(s_data_mutex, portMAX_DELAY);
+        st->pending = true;
+        xSemaphoreGive(s_data_mutex);
+    }
 }
 
 /* Check if we should be in lazy polling mode */
@@ -163,8 +201,9 @@ static void poll_task(void *arg)
 
         if (!s_poll_running) break;
 
-        /* Poll current controller */
+        /* Poll current controller (pending ramp setpoint first) */
         if (current_idx < s_config.count) {
+            write_streamed_sv(current_idx);
             poll_controller(&s_controllers[current_idx]);
         }
 
@@ -283,6 +322,7 @@ esp_err_t pid_controller_init(const pid_config_t *config)
 
     /* Initialize controller state */
     memset(s_controllers, 0, sizeof(s_controllers));
+    memset(s_sv_stream, 0, sizeof(s_sv_stream));
     for (int i = 0; i < s_config.count; i++) {
         s_controllers[i].addr = s_config.addresses[i];
         s_controllers[i].state = PID_STATE_UNKNOWN;
@@ -391,6 +431,22 @@ esp_err_t pid_controller_set_sv(uint8_t addr, float sv_celsius)
     return ESP_OK;
 }
 
+esp_err_t pid_controller_stream_sv(uint8_t addr, float sv_celsius)
+{
+    if (!s_initialized) return ESP_ERR_INVALID_STATE;
+
+    for (int i = 0; i < s_config.count; i++) {
+        if (s_controllers[i].addr == addr) {
+            xSemaphoreTake(s_data_mutex, portMAX_DELAY);
+            s_sv_stream[i].raw = encode_temp(sv_celsius);
+            s_sv_stream[i].pending = true;
+            xSemaphoreGive(s_data_mutex);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
 esp_err_t pid_controller_read_params(uint8_t addr, float *p_gain,
                                       uint16_t *i_time, uint16_t *d_time)
 {
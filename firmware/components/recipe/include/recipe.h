@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file recipe.h
+ * @brief Multi-segment run recipes (chamber SV ramp/soak profiles)
+ *
+ * A recipe is a list of segments executed in order while RUNNING. Each
+ * segment ramps the chamber setpoint (PID1) from the previous segment's
+ * value to its own at a fixed rate, then holds it for hold_ms, optionally
+ * only counting the hold once PV has arrived. Segments also switch the
+ * motor and may set the bearing heater setpoints (PID2, PID3).
+ *
+ * Recipes are uploaded as one bulk object (WIRE_OBJ_RECIPE) and kept in
+ * NVS slots 1..RECIPE_SLOT_COUNT in exactly the uploaded format:
+ *
+ *   recipe_header_t                     8 bytes
+ *   recipe_segment_t x segment_count   14 bytes each
+ *
+ * An object with segment_count 0 erases the slot. START_RUN with a
+ * recipe_slot runs it.
+ */
+
+#define RECIPE_FORMAT_VERSION   1
+#define RECIPE_SLOT_COUNT       4       /* Slots 1..4; slot 0 = no recipe */
+#define RECIPE_MAX_SEGMENTS     16
+
+/* Setpoint limits (x10 °C) accepted in a recipe */
+#define RECIPE_SV_MIN_X10       (-2000) /* -200.0°C */
+#define RECIPE_SV_MAX_X10       1000    /* 100.0°C */
+
+/* heater_sv_x10 value that leaves the heater setpoint alone */
+#define RECIPE_SV_UNCHANGED     INT16_MIN
+
+/* Segment flags */
+#define RECIPE_SEG_MOTOR        (1 << 0)    /* Motor running during the segment */
+#define RECIPE_SEG_WAIT_PV      (1 << 1)    /* Hold time starts once PV is within tolerance */
+#define RECIPE_SEG_FLAGS_MASK   (RECIPE_SEG_MOTOR | RECIPE_SEG_WAIT_PV)
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;           /* RECIPE_FORMAT_VERSION */
+    uint8_t  slot;              /* 1..RECIPE_SLOT_COUNT */
+    uint8_t  segment_count;     /* 0 = erase slot */
+    uint8_t  flags;             /* Reserved, 0 */
+    uint16_t recipe_id;         /* App-defined tag, echoed in logs */
+    int16_t  precool_x10;       /* PRECOOL target; 0 = first segment's chamber_sv */
+} recipe_header_t;
+
+typedef struct __attribute__((packed)) {
+    int16_t  chamber_sv_x10;    /* Chamber setpoint at the end of the ramp */
+    uint16_t ramp_x10_per_min;  /* Ramp rate in 0.1°C/min; 0 = step */
+    uint32_t hold_ms;           /* Hold time at chamber_sv */
+    int16_t  heater_sv_x10[2];  /* PID2 / PID3 setpoints, or RECIPE_SV_UNCHANGED */
+    uint8_t  flags;             /* RECIPE_SEG_* */
+    uint8_t  reserved;          /* 0 */
+} recipe_segment_t;
+
+typedef struct {
+    recipe_header_t  header;
+    recipe_segment_t segments[RECIPE_MAX_SEGMENTS];
+} recipe_t;
+
+#define RECIPE_BLOB_MAX (sizeof(recipe_header_t) + RECIPE_MAX_SEGMENTS * sizeof(recipe_segment_t))
+
+/* ===== Format (no NVS, usable on the host) ===== */
+
+/**
+ * @brief Validate a serialised recipe and copy it into out
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if len does not match the header,
+ *         ESP_ERR_INVALID_VERSION for an unknown format version,
+ *         ESP_ERR_INVALID_ARG for a bad slot, flag or setpoint
+ */
+esp_err_t recipe_parse(const uint8_t *data, size_t len, recipe_t *out);
+
+/**
+ * @brief Ramp time of a segment starting from from_x10 (0 for a step)
+ */
+uint32_t recipe_ramp_ms(int16_t from_x10, const recipe_segment_t *seg);
+
+/**
+ * @brief PRECOOL target of a recipe
+ */
+int16_t recipe_precool_target(const recipe_t *recipe);
+
+/**
+ * @brief Planned time of segments first..last, starting from from_x10
+ *
+ * WAIT_PV segments count from the end of their ramp, so this is a lower bound.
+ */
+uint32_t recipe_planned_ms(const recipe_t *recipe, uint8_t first, int16_t from_x10);
+
+/* ===== Storage ===== */
+
+/**
+ * @brief Validate and store a serialised recipe in its NVS slot
+ *
+ * segment_count 0 erases the slot.
+ */
+esp_err_t recipe_store(const uint8_t *data, size_t len);
+
+/**
+ * @brief Load the recipe in a slot
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if the slot is empty,
+ *         ESP_ERR_INVALID_ARG for a bad slot number
+ */
+esp_err_t recipe_load(uint8_t slot, recipe_t *out);
+
+/**
+ * @brief Bulk Gateway handler for WIRE_OBJ_RECIPE
+ *
+ * Matches ble_gatt_bulk_handler_t; register it with
+ * ble_gatt_register_bulk_handler(WIRE_OBJ_RECIPE, recipe_bulk_handler).
+ */
+esp_err_t recipe_bulk_handler(uint8_t object_type, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,110 @@
+#include "recipe.h"
+#include "wire_fragment.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+static const char *TAG = "recipe";
+
+/* NVS storage: one blob per slot, in the uploaded format */
+#define NVS_NAMESPACE       "recipe"
+#define NVS_KEY_FMT         "slot%u"
+
+static void slot_key(uint8_t slot, char *key, size_t size)
+{
+    snprintf(key, size, NVS_KEY_FMT, slot);
+}
+
+esp_err_t recipe_store(const uint8_t *data, size_t len)
+{
+    recipe_t recipe;
+    esp_err_t err = recipe_parse(data, len, &recipe);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Recipe rejected (%u bytes): %s", (unsigned)len, esp_err_to_name(err));
+        return err;
+    }
+
+    char key[8];
+    slot_key(recipe.header.slot, key, sizeof(key));
+
+    nvs_handle_t nvs;
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (recipe.header.segment_count == 0) {
+        err = nvs_erase_key(nvs, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(nvs, key, data, len);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save slot %u: %s", recipe.header.slot, esp_err_to_name(err));
+        return err;
+    }
+
+    if (recipe.header.segment_count == 0) {
+        ESP_LOGI(TAG, "Slot %u erased", recipe.header.slot);
+    } else {
+        ESP_LOGI(TAG, "Slot %u: recipe 0x%04X, %u segments, %lu ms planned",
+                 recipe.header.slot, recipe.header.recipe_id, recipe.header.segment_count,
+                 (unsigned long)recipe_planned_ms(&recipe, 0, recipe_precool_target(&recipe)));
+    }
+    return ESP_OK;
+}
+
+esp_err_t recipe_load(uint8_t slot, recipe_t *out)
+{
+    if (slot < 1 || slot > RECIPE_SLOT_COUNT || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char key[8];
+    slot_key(slot, key, sizeof(key));
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        return (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_ERR_NOT_FOUND : err;
+    }
+
+    uint8_t blob[RECIPE_BLOB_MAX];
+    size_t len = sizeof(blob);
+    err = nvs_get_blob(nvs, key, blob, &len);
+    nvs_close(nvs);
+
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read slot %u: %s", slot, esp_err_to_name(err));
+        return err;
+    }
+
+    /* Re-validate: the blob may predate a format change */
+    err = recipe_parse(blob, len, out);
+    if (err != ESP_OK || out->header.slot != slot || out->header.segment_count == 0) {
+        ESP_LOGW(TAG, "Slot %u holds an invalid recipe", slot);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t recipe_bulk_handler(uint8_t object_type, const uint8_t *data, size_t len)
+{
+    if (object_type != WIRE_OBJ_RECIPE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return recipe_store(data, len);
+}
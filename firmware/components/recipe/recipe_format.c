@@ -0,0 +1,81 @@
+#include "recipe.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(recipe_header_t) == 8, "recipe_header_t is part of the wire format");
+_Static_assert(sizeof(recipe_segment_t) == 14, "recipe_segment_t is part of the wire format");
+
+static bool sv_valid(int16_t sv_x10)
+{
+    return sv_x10 >= RECIPE_SV_MIN_X10 && sv_x10 <= RECIPE_SV_MAX_X10;
+}
+
+esp_err_t recipe_parse(const uint8_t *data, size_t len, recipe_t *out)
+{
+    recipe_header_t hdr;
+
+    if (data == NULL || out == NULL || len < sizeof(hdr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+
+    if (hdr.version != RECIPE_FORMAT_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (hdr.segment_count > RECIPE_MAX_SEGMENTS ||
+        len != sizeof(hdr) + hdr.segment_count * sizeof(recipe_segment_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (hdr.slot < 1 || hdr.slot > RECIPE_SLOT_COUNT || hdr.flags != 0 ||
+        (hdr.precool_x10 != 0 && !sv_valid(hdr.precool_x10))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->header = hdr;
+    memcpy(out->segments, data + sizeof(hdr), hdr.segment_count * sizeof(recipe_segment_t));
+
+    for (uint8_t i = 0; i < hdr.segment_count; i++) {
+        const recipe_segment_t *seg = &out->segments[i];
+        if (!sv_valid(seg->chamber_sv_x10) ||
+            (seg->flags & ~RECIPE_SEG_FLAGS_MASK) != 0 || seg->reserved != 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int h = 0; h < 2; h++) {
+            if (seg->heater_sv_x10[h] != RECIPE_SV_UNCHANGED && !sv_valid(seg->heater_sv_x10[h])) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+uint32_t recipe_ramp_ms(int16_t from_x10, const recipe_segment_t *seg)
+{
+    if (seg->ramp_x10_per_min == 0) {
+        return 0;
+    }
+    uint32_t delta = (uint32_t)(seg->chamber_sv_x10 > from_x10 ? seg->chamber_sv_x10 - from_x10
+                                                               : from_x10 - seg->chamber_sv_x10);
+    return delta * 60000u / seg->ramp_x10_per_min;
+}
+
+int16_t recipe_precool_target(const recipe_t *recipe)
+{
+    if (recipe->header.precool_x10 != 0 || recipe->header.segment_count == 0) {
+        return recipe->header.precool_x10;
+    }
+    return recipe->segments[0].chamber_sv_x10;
+}
+
+uint32_t recipe_planned_ms(const recipe_t *recipe, uint8_t first, int16_t from_x10)
+{
+    uint64_t total = 0;
+
+    for (uint8_t i = first; i < recipe->header.segment_count; i++) {
+        const recipe_segment_t *seg = &recipe->segments[i];
+        total += recipe_ramp_ms(from_x10, seg) + seg->hold_ms;
+        from_x10 = seg->chamber_sv_x10;
+    }
+    return total > UINT32_MAX ? UINT32_MAX : (uint32_t)total;
+}
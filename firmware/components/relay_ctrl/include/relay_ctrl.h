@@ -30,11 +30,67 @@ extern "C" {
 #define TCA9554_REG_POLARITY    0x02        /* Polarity inversion */
 #define TCA9554_REG_CONFIG      0x03        /* Configuration (0=output, 1=input) */
 
+#define RELAY_CTRL_CHANNELS     8
+
 /* Relay state values for relay_ctrl_set() */
 #define RELAY_STATE_OFF         0
 #define RELAY_STATE_ON          1
 #define RELAY_STATE_TOGGLE      2
 
+/* relay_ctrl_txn_commit() flags */
+#define RELAY_TXN_VERIFY        (1 << 0)    /* Read the output register back after the write */
+#define RELAY_TXN_FORCE         (1 << 1)    /* Write even if the image is unchanged */
+
+/*
+ * Output transaction: stage any number of channel changes, then commit them
+ * as one output register write. Lives on the caller's stack; nothing touches
+ * the hardware before commit.
+ */
+typedef struct {
+    uint8_t mask;               /* Channels staged (bit 0 = RO1) */
+    uint8_t values;             /* Staged level of each channel in mask */
+} relay_ctrl_txn_t;
+
+/* Actuation counters of one relay, kept across reboots */
+typedef struct {
+    uint32_t on_count;          /* OFF -> ON transitions */
+    uint32_t off_count;         /* ON -> OFF transitions */
+    uint64_t on_time_ms;        /* Accumulated ON time, including a current ON period */
+} relay_ctrl_wear_t;
+
+typedef struct {
+    relay_ctrl_wear_t channel[RELAY_CTRL_CHANNELS];     /* [0] = RO1 */
+    uint32_t flushes;           /* Counter saves to NVS since boot */
+    uint32_t flush_errors;      /* Failed saves since boot */
+    uint32_t unsaved_changes;   /* Output image changes not yet in NVS */
+    uint32_t last_flush_age_ms; /* Since the last save (UINT32_MAX: none since boot) */
+} relay_ctrl_wear_stats_t;
+
+/* Output register found differing from the shadow (see relay_ctrl_set_mismatch_cb()) */
+typedef struct {
+    uint8_t expected;           /* Shadow image (last written) */
+    uint8_t actual;             /* Output register read back */
+    uint8_t config;             /* Config register read back (0x00 = all outputs) */
+    bool    restored;           /* Shadow rewritten and read back correctly */
+} relay_ctrl_mismatch_t;
+
+/**
+ * @brief Mismatch callback
+ *
+ * Runs on the low-priority reconcile task after the restore attempt. Post
+ * a notification; do not call relay_ctrl from it.
+ */
+typedef void (*relay_ctrl_mismatch_cb_t)(const relay_ctrl_mismatch_t *m, void *ctx);
+
+typedef struct {
+    uint32_t checks;            /* Readbacks compared with the shadow */
+    uint32_t skipped;           /* Confirmations voided by a concurrent write */
+    uint32_t read_errors;       /* Readbacks that failed on the bus */
+    uint32_t mismatches;        /* Confirmed mismatches */
+    uint32_t restore_failures;  /* Restores that did not read back correctly */
+    bool     latched;           /* Mismatch seen since relay_ctrl_clear_mismatch() */
+} relay_ctrl_reconcile_stats_t;
+
 /**
  * @brief Initialize the relay control driver
  *
@@ -65,6 +121,41 @@ esp_err_t relay_ctrl_set(uint8_t relay_index, uint8_t state);
  */
 esp_err_t relay_ctrl_set_mask(uint8_t mask, uint8_t values);
 
+/**
+ * @brief Start an empty output transaction
+ */
+void relay_ctrl_txn_begin(relay_ctrl_txn_t *txn);
+
+/**
+ * @brief Stage one relay; a later stage of the same relay wins
+ *
+ * @param relay_index Relay number 1-8
+ * @param on Target state
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if relay_index out of range
+ */
+esp_err_t relay_ctrl_txn_set(relay_ctrl_txn_t *txn, uint8_t relay_index, bool on);
+
+/**
+ * @brief Stage several relays: (staged & ~mask) | (values & mask)
+ */
+void relay_ctrl_txn_set_mask(relay_ctrl_txn_t *txn, uint8_t mask, uint8_t values);
+
+/**
+ * @brief Apply a transaction with a single output register write
+ *
+ * The new image is computed from the cached state and written in one I2C
+ * transaction, so all staged relays switch together. Nothing is written if
+ * the image is unchanged (unless RELAY_TXN_FORCE). Commits, set*() and the
+ * reconciler's restore are serialized; a commit may wait for a restore in
+ * progress (a few OUTPUT-priority transfers).
+ *
+ * @param flags RELAY_TXN_* flags
+ * @return ESP_OK on success
+ *         ESP_ERR_INVALID_RESPONSE if RELAY_TXN_VERIFY read back a different
+ *         image (the cache then holds the read-back value)
+ */
+esp_err_t relay_ctrl_txn_commit(const relay_ctrl_txn_t *txn, uint8_t flags);
+
 /**
  * @brief Get current relay output state (cached)
  *
@@ -117,6 +208,48 @@ esp_err_t relay_ctrl_read_di(uint8_t *di_bits);
  */
 bool relay_ctrl_di_available(void);
 
+/**
+ * @brief Register the output mismatch callback (one; NULL to remove)
+ *
+ * Every CONFIG_RELAY_CTRL_RECONCILE_PERIOD_MS the output and config
+ * registers are read back at DIAG bus priority and compared with the
+ * shadow. A mismatch confirmed by a second read is restored at once
+ * (retried every 100 ms until it reads back correctly), then reported.
+ * The restore is dropped if a commit landed since the first read, so it
+ * never writes back an image older than the last commit.
+ */
+void relay_ctrl_set_mismatch_cb(relay_ctrl_mismatch_cb_t cb, void *ctx);
+
+/**
+ * @brief Reconciler counters since boot
+ */
+void relay_ctrl_get_reconcile_stats(relay_ctrl_reconcile_stats_t *out);
+
+/**
+ * @brief Acknowledge a latched mismatch (CLEAR_LATCHED_ALARMS)
+ */
+void relay_ctrl_clear_mismatch(void);
+
+/**
+ * @brief Relay actuation counters (cycle counts and ON time per channel)
+ *
+ * Counted in RAM from every output write and saved to NVS every
+ * CONFIG_RELAY_CTRL_WEAR_FLUSH_PERIOD_S when changed, so the totals
+ * survive reboots (less at most one period after a power loss).
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if out is NULL
+ */
+esp_err_t relay_ctrl_get_wear(relay_ctrl_wear_stats_t *out);
+
+/**
+ * @brief Save the actuation counters to NVS now
+ *
+ * Costs a flash write; for maintenance, not for regular use.
+ *
+ * @return ESP_OK, or the NVS error
+ */
+esp_err_t relay_ctrl_flush_wear(void);
+
 #ifdef __cplusplus
 }
 #endif
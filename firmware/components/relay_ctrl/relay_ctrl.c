@@ -1,19 +1,21 @@
 #include "relay_ctrl.h"
+#include "relay_wear.h"
 
 #include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
-#include "driver/i2c_master.h"
+#include "i2c_bus.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "relay_ctrl";
 
-/* I2C master bus handle */
-static i2c_master_bus_handle_t s_i2c_bus = NULL;
+/* TCA9554 (relay outputs) on the shared bus */
+static i2c_bus_dev_t *s_tca9554_dev = NULL;
 
-/* I2C device handle for TCA9554 (relay outputs) */
-static i2c_master_dev_handle_t s_tca9554_dev = NULL;
-
-/* I2C device handle for TCA9534 (digital inputs) */
-static i2c_master_dev_handle_t s_tca9534_dev = NULL;
+/* TCA9534 (digital inputs) on the shared bus */
+static i2c_bus_dev_t *s_tca9534_dev = NULL;
 
 /* Cached relay state (mirrors TCA9554 output register) */
 static uint8_t s_relay_state = 0x00;
@@ -24,44 +26,65 @@ static bool s_initialized = false;
 /* Flag to track if DI expander is available */
 static bool s_di_available = false;
 
+/* Bumped before and after every output register write (reconciler race check) */
+static uint32_t s_write_gen = 0;
+
+/*
+ * Serializes output image changes: s_relay_state read-modify-write, the
+ * register write and its verify, and the reconciler's restore. Held for a
+ * few OUTPUT-priority transfers at most; never held across logging.
+ */
+static SemaphoreHandle_t s_out_lock = NULL;
+
+/* Shadow reconciliation */
+#define RECONCILE_TASK_STACK    2560
+#define RECONCILE_TASK_PRIORITY 2
+#define RECONCILE_RETRY_MS      100
+
+static TaskHandle_t s_reconcile_task = NULL;
+static relay_ctrl_reconcile_stats_t s_reconcile = { 0 };
+static relay_ctrl_mismatch_cb_t s_mismatch_cb = NULL;
+static void *s_mismatch_ctx = NULL;
+
+/*
+ * Bus priorities: DI reads feed the E-stop poll (SAFETY), output writes and
+ * their verify readback come next (OUTPUT), configuration and status reads
+ * go last (DIAG).
+ * Transfer errors are logged by i2c_bus with the device name.
+ */
+
 /**
  * @brief Write a byte to a TCA9554 register
  */
-static esp_err_t tca9554_write_reg(uint8_t reg, uint8_t value)
+static esp_err_t tca9554_write_reg(uint8_t reg, uint8_t value, i2c_bus_prio_t prio)
 {
-    uint8_t write_buf[2] = { reg, value };
-    esp_err_t ret = i2c_master_transmit(s_tca9554_dev, write_buf, sizeof(write_buf), 100);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write reg 0x%02X: %s", reg, esp_err_to_name(ret));
+    if (reg != TCA9554_REG_OUTPUT) {
+        return i2c_bus_write(s_tca9554_dev, reg, &value, 1, prio);
     }
+
+    __atomic_fetch_add(&s_write_gen, 1, __ATOMIC_RELAXED);
+    esp_err_t ret = i2c_bus_write(s_tca9554_dev, reg, &value, 1, prio);
+    __atomic_fetch_add(&s_write_gen, 1, __ATOMIC_RELAXED);
     return ret;
 }
 
 /**
  * @brief Read a byte from a TCA9554 register
  */
-static esp_err_t tca9554_read_reg(uint8_t reg, uint8_t *value)
+static esp_err_t tca9554_read_reg(uint8_t reg, uint8_t *value, i2c_bus_prio_t prio)
 {
-    esp_err_t ret = i2c_master_transmit_receive(s_tca9554_dev, &reg, 1, value, 1, 100);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read reg 0x%02X: %s", reg, esp_err_to_name(ret));
-    }
-    return ret;
+    return i2c_bus_read(s_tca9554_dev, reg, value, 1, prio);
 }
 
 /**
  * @brief Read a byte from TCA9534 (digital input) register
  */
-static esp_err_t tca9534_di_read_reg(uint8_t reg, uint8_t *value)
+static esp_err_t tca9534_di_read_reg(uint8_t reg, uint8_t *value, i2c_bus_prio_t prio)
 {
     if (s_tca9534_dev == NULL) {
         return ESP_ERR_NOT_FOUND;
     }
-    esp_err_t ret = i2c_master_transmit_receive(s_tca9534_dev, &reg, 1, value, 1, 100);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "TCA9534: Failed to read reg 0x%02X: %s", reg, esp_err_to_name(ret));
-    }
-    return ret;
+    return i2c_bus_read(s_tca9534_dev, reg, value, 1, prio);
 }
 
 /**
@@ -72,14 +95,162 @@ static esp_err_t tca9534_di_write_reg(uint8_t reg, uint8_t value)
     if (s_tca9534_dev == NULL) {
         return ESP_ERR_NOT_FOUND;
     }
-    uint8_t write_buf[2] = { reg, value };
-    esp_err_t ret = i2c_master_transmit(s_tca9534_dev, write_buf, sizeof(write_buf), 100);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "TCA9534: Failed to write reg 0x%02X: %s", reg, esp_err_to_name(ret));
+    return i2c_bus_write(s_tca9534_dev, reg, &value, 1, I2C_BUS_PRIO_DIAG);
+}
+
+/* ===== Shadow reconciliation ===== */
+
+/*
+ * s_relay_state is what we last wrote. If the expander resets (brown-out
+ * on its supply, a bus glitch) its registers return to power-on defaults:
+ * output 0xFF, every pin an input, so the relays drop while the shadow
+ * still says ON. A low-priority task reads both registers back at DIAG
+ * priority and restores the shadow when they disagree.
+ */
+
+static esp_err_t read_back(uint8_t *output, uint8_t *config)
+{
+    esp_err_t ret = tca9554_read_reg(TCA9554_REG_OUTPUT, output, I2C_BUS_PRIO_DIAG);
+    if (ret == ESP_OK) {
+        ret = tca9554_read_reg(TCA9554_REG_CONFIG, config, I2C_BUS_PRIO_DIAG);
     }
     return ret;
 }
 
+/* Output before config: pins that turn back into outputs drive the shadow, never 0xFF */
+static bool restore_outputs(uint8_t expected, uint8_t config)
+{
+    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, expected, I2C_BUS_PRIO_OUTPUT);
+    if (ret == ESP_OK && config != 0x00) {
+        ret = tca9554_write_reg(TCA9554_REG_CONFIG, 0x00, I2C_BUS_PRIO_OUTPUT);
+    }
+
+    uint8_t output = 0;
+    if (ret == ESP_OK) {
+        ret = tca9554_read_reg(TCA9554_REG_OUTPUT, &output, I2C_BUS_PRIO_OUTPUT);
+    }
+    if (ret == ESP_OK) {
+        ret = tca9554_read_reg(TCA9554_REG_CONFIG, &config, I2C_BUS_PRIO_OUTPUT);
+    }
+    return ret == ESP_OK && output == expected && config == 0x00;
+}
+
+/*
+ * One check. Returns false when the outputs are still wrong (retry soon).
+ *
+ * The readbacks run unlocked at DIAG priority; only a confirmed mismatch
+ * takes s_out_lock, and the restore goes ahead only if no commit landed
+ * since the first read. A commit that arrives during the restore waits
+ * for it and then writes its own image.
+ */
+static bool reconcile_once(void)
+{
+    uint32_t gen = __atomic_load_n(&s_write_gen, __ATOMIC_RELAXED);
+    uint8_t output, config;
+
+    if (read_back(&output, &config) != ESP_OK) {
+        s_reconcile.read_errors++;
+        return true;
+    }
+    s_reconcile.checks++;
+    if (output == s_relay_state && config == 0x00) {
+        return true;
+    }
+
+    /*
+     * Confirm with a second read: a commit can land between our read and
+     * its shadow update. Any output write during either read voids the check.
+     */
+    if (read_back(&output, &config) != ESP_OK) {
+        s_reconcile.read_errors++;
+        return true;
+    }
+    uint8_t expected = s_relay_state;
+    if (__atomic_load_n(&s_write_gen, __ATOMIC_RELAXED) != gen) {
+        s_reconcile.skipped++;
+        return true;
+    }
+    if (output == expected && config == 0x00) {
+        return true;
+    }
+
+    xSemaphoreTake(s_out_lock, portMAX_DELAY);
+    if (s_relay_state != expected || __atomic_load_n(&s_write_gen, __ATOMIC_RELAXED) != gen) {
+        xSemaphoreGive(s_out_lock);
+        s_reconcile.skipped++;
+        return true;
+    }
+    bool restored = restore_outputs(expected, config);
+    xSemaphoreGive(s_out_lock);
+
+    s_reconcile.mismatches++;
+    s_reconcile.latched = true;
+    ESP_LOGE(TAG, "Output readback mismatch: shadow 0x%02X, output 0x%02X, config 0x%02X",
+             expected, output, config);
+
+    relay_ctrl_mismatch_t m = {
+        .expected = expected,
+        .actual = output,
+        .config = config,
+        .restored = restored,
+    };
+    if (m.restored) {
+        ESP_LOGW(TAG, "Outputs restored to 0x%02X", expected);
+    } else {
+        s_reconcile.restore_failures++;
+        ESP_LOGE(TAG, "Output restore failed, retrying in %d ms", RECONCILE_RETRY_MS);
+    }
+
+    if (s_mismatch_cb != NULL) {
+        s_mismatch_cb(&m, s_mismatch_ctx);
+    }
+    return m.restored;
+}
+
+static void reconcile_task(void *arg)
+{
+    bool clean = true;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(clean ? CONFIG_RELAY_CTRL_RECONCILE_PERIOD_MS : RECONCILE_RETRY_MS));
+        clean = reconcile_once();
+    }
+}
+
+static esp_err_t reconcile_start(void)
+{
+    if (CONFIG_RELAY_CTRL_RECONCILE_PERIOD_MS == 0 || s_reconcile_task != NULL) {
+        return ESP_OK;
+    }
+
+    BaseType_t ok = xTaskCreate(reconcile_task, "relay_recon", RECONCILE_TASK_STACK, NULL,
+                                RECONCILE_TASK_PRIORITY, &s_reconcile_task);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create reconcile task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Output readback every %d ms", CONFIG_RELAY_CTRL_RECONCILE_PERIOD_MS);
+    return ESP_OK;
+}
+
+void relay_ctrl_set_mismatch_cb(relay_ctrl_mismatch_cb_t cb, void *ctx)
+{
+    s_mismatch_ctx = ctx;
+    s_mismatch_cb = cb;
+}
+
+void relay_ctrl_get_reconcile_stats(relay_ctrl_reconcile_stats_t *out)
+{
+    *out = s_reconcile;
+}
+
+void relay_ctrl_clear_mismatch(void)
+{
+    s_reconcile.latched = false;
+}
+
+/* ===== Init ===== */
+
 esp_err_t relay_ctrl_init(void)
 {
     if (s_initialized) {
@@ -87,61 +258,50 @@ esp_err_t relay_ctrl_init(void)
         return ESP_OK;
     }
 
+    if (s_out_lock == NULL) {
+        s_out_lock = xSemaphoreCreateMutex();
+        if (s_out_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
     ESP_LOGI(TAG, "Initializing relay control (TCA9554 @ 0x%02X)", RELAY_TCA9554_ADDR);
     ESP_LOGI(TAG, "I2C: SDA=GPIO%d SCL=GPIO%d Freq=%dHz",
              RELAY_I2C_SDA_PIN, RELAY_I2C_SCL_PIN, RELAY_I2C_FREQ_HZ);
 
-    /* Configure I2C master bus */
-    i2c_master_bus_config_t bus_config = {
-        .i2c_port = I2C_NUM_0,
-        .sda_io_num = RELAY_I2C_SDA_PIN,
-        .scl_io_num = RELAY_I2C_SCL_PIN,
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .glitch_ignore_cnt = 7,
-        .intr_priority = 0,
-        .trans_queue_depth = 0,
-        .flags = {
-            .enable_internal_pullup = true,
-        },
+    /* The bus may already be up if another driver got there first */
+    i2c_bus_config_t bus_config = {
+        .port = 0,                      /* I2C_NUM_0 */
+        .sda_io = RELAY_I2C_SDA_PIN,
+        .scl_io = RELAY_I2C_SCL_PIN,
+        .internal_pullup = true,
     };
 
-    esp_err_t ret = i2c_new_master_bus(&bus_config, &s_i2c_bus);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+    esp_err_t ret = i2c_bus_init(&bus_config);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to start I2C bus: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    /* Add TCA9554 device to the bus (relay outputs) */
-    i2c_device_config_t dev_config = {
-        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = RELAY_TCA9554_ADDR,
-        .scl_speed_hz = RELAY_I2C_FREQ_HZ,
-    };
-
-    ret = i2c_master_bus_add_device(s_i2c_bus, &dev_config, &s_tca9554_dev);
+    /* Probe the device to verify it's present */
+    ret = i2c_bus_probe(RELAY_TCA9554_ADDR);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add TCA9554 device: %s", esp_err_to_name(ret));
-        i2c_del_master_bus(s_i2c_bus);
-        s_i2c_bus = NULL;
+        ESP_LOGE(TAG, "TCA9554 not found at address 0x%02X: %s",
+                 RELAY_TCA9554_ADDR, esp_err_to_name(ret));
         return ret;
     }
 
-    /* Probe the device to verify it's present */
-    ret = i2c_master_probe(s_i2c_bus, RELAY_TCA9554_ADDR, 100);
+    ret = i2c_bus_add_device("tca9554", RELAY_TCA9554_ADDR, RELAY_I2C_FREQ_HZ, 0,
+                             &s_tca9554_dev);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "TCA9554 not found at address 0x%02X: %s",
-                 RELAY_TCA9554_ADDR, esp_err_to_name(ret));
-        i2c_master_bus_rm_device(s_tca9554_dev);
-        i2c_del_master_bus(s_i2c_bus);
-        s_tca9554_dev = NULL;
-        s_i2c_bus = NULL;
+        ESP_LOGE(TAG, "Failed to add TCA9554 device: %s", esp_err_to_name(ret));
         return ret;
     }
 
     ESP_LOGI(TAG, "TCA9554 found at address 0x%02X", RELAY_TCA9554_ADDR);
 
     /* Configure all 8 pins as outputs FIRST (write 0x00 to config register) */
-    ret = tca9554_write_reg(TCA9554_REG_CONFIG, 0x00);
+    ret = tca9554_write_reg(TCA9554_REG_CONFIG, 0x00, I2C_BUS_PRIO_DIAG);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure pins as outputs");
         return ret;
@@ -149,7 +309,7 @@ esp_err_t relay_ctrl_init(void)
 
     /* Read the current output register state to see what hardware is doing */
     uint8_t current_output;
-    ret = tca9554_read_reg(TCA9554_REG_OUTPUT, &current_output);
+    ret = tca9554_read_reg(TCA9554_REG_OUTPUT, &current_output, I2C_BUS_PRIO_DIAG);
     if (ret != ESP_OK) {
         ESP_LOGW(TAG, "Failed to read current output state, assuming 0x00");
         current_output = 0x00;
@@ -162,7 +322,7 @@ esp_err_t relay_ctrl_init(void)
      * so we explicitly set to 0x00 for a known safe state.
      */
     s_relay_state = 0x00;
-    ret = tca9554_write_reg(TCA9554_REG_OUTPUT, s_relay_state);
+    ret = tca9554_write_reg(TCA9554_REG_OUTPUT, s_relay_state, I2C_BUS_PRIO_OUTPUT);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize output register");
         return ret;
@@ -170,7 +330,7 @@ esp_err_t relay_ctrl_init(void)
 
     /* Verify configuration */
     uint8_t config_readback;
-    ret = tca9554_read_reg(TCA9554_REG_CONFIG, &config_readback);
+    ret = tca9554_read_reg(TCA9554_REG_CONFIG, &config_readback, I2C_BUS_PRIO_DIAG);
     if (ret == ESP_OK && config_readback == 0x00) {
         ESP_LOGI(TAG, "TCA9554 configured: all pins as outputs");
     } else {
@@ -180,19 +340,23 @@ esp_err_t relay_ctrl_init(void)
     s_initialized = true;
     ESP_LOGI(TAG, "Relay control initialized - all relays OFF (ro_bits=0x00, convention: 1=ON, 0=OFF)");
 
+    /* Counting starts from the all-OFF image just written */
+    if (relay_wear_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Relay counters will not be saved");
+    }
+
+    if (reconcile_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Relay outputs will not be checked against the shadow");
+    }
+
     /* Now try to initialize the digital input expander (TCA9534 @ 0x21) */
     ESP_LOGI(TAG, "Probing for TCA9534 digital input expander @ 0x%02X", DI_TCA9534_ADDR);
 
-    ret = i2c_master_probe(s_i2c_bus, DI_TCA9534_ADDR, 100);
+    ret = i2c_bus_probe(DI_TCA9534_ADDR);
     if (ret == ESP_OK) {
         /* Add TCA9534 device */
-        i2c_device_config_t di_dev_config = {
-            .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-            .device_address = DI_TCA9534_ADDR,
-            .scl_speed_hz = RELAY_I2C_FREQ_HZ,
-        };
-
-        ret = i2c_master_bus_add_device(s_i2c_bus, &di_dev_config, &s_tca9534_dev);
+        ret = i2c_bus_add_device("tca9534", DI_TCA9534_ADDR, RELAY_I2C_FREQ_HZ, 0,
+                                 &s_tca9534_dev);
         if (ret == ESP_OK) {
             /* Configure all pins as inputs (write 0xFF to config register) */
             ret = tca9534_di_write_reg(TCA9554_REG_CONFIG, 0xFF);
@@ -202,7 +366,7 @@ esp_err_t relay_ctrl_init(void)
 
                 /* Read initial state */
                 uint8_t di_state;
-                if (tca9534_di_read_reg(TCA9554_REG_INPUT, &di_state) == ESP_OK) {
+                if (tca9534_di_read_reg(TCA9554_REG_INPUT, &di_state, I2C_BUS_PRIO_DIAG) == ESP_OK) {
                     ESP_LOGI(TAG, "Initial DI state: 0x%02X", di_state);
                 }
             } else {
@@ -218,6 +382,78 @@ esp_err_t relay_ctrl_init(void)
     return ESP_OK;
 }
 
+/* ===== Output transactions ===== */
+
+void relay_ctrl_txn_begin(relay_ctrl_txn_t *txn)
+{
+    txn->mask = 0;
+    txn->values = 0;
+}
+
+esp_err_t relay_ctrl_txn_set(relay_ctrl_txn_t *txn, uint8_t relay_index, bool on)
+{
+    if (relay_index < 1 || relay_index > 8) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t bit = (uint8_t)(1 << (relay_index - 1));
+    relay_ctrl_txn_set_mask(txn, bit, on ? bit : 0);
+    return ESP_OK;
+}
+
+void relay_ctrl_txn_set_mask(relay_ctrl_txn_t *txn, uint8_t mask, uint8_t values)
+{
+    txn->mask |= mask;
+    txn->values = (txn->values & ~mask) | (values & mask);
+}
+
+esp_err_t relay_ctrl_txn_commit(const relay_ctrl_txn_t *txn, uint8_t flags)
+{
+    if (!s_initialized) {
+        ESP_LOGE(TAG, "Not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_out_lock, portMAX_DELAY);
+
+    uint8_t old_state = s_relay_state;
+    uint8_t new_state = (old_state & ~txn->mask) | (txn->values & txn->mask);
+    if (new_state == old_state && !(flags & RELAY_TXN_FORCE)) {
+        xSemaphoreGive(s_out_lock);
+        return ESP_OK;
+    }
+
+    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, new_state, I2C_BUS_PRIO_OUTPUT);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(s_out_lock);
+        return ret;
+    }
+    s_relay_state = new_state;
+    relay_wear_note(old_state, new_state);
+
+    /* Verify belongs to the write: same priority, not behind diagnostics */
+    uint8_t readback = new_state;
+    if (flags & RELAY_TXN_VERIFY) {
+        ret = tca9554_read_reg(TCA9554_REG_OUTPUT, &readback, I2C_BUS_PRIO_OUTPUT);
+        if (ret == ESP_OK && readback != new_state) {
+            s_relay_state = readback;
+            relay_wear_note(new_state, readback);
+            ret = ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    xSemaphoreGive(s_out_lock);
+
+    if (ret == ESP_ERR_INVALID_RESPONSE) {
+        ESP_LOGE(TAG, "Output readback mismatch: wrote 0x%02X, read 0x%02X",
+                 new_state, readback);
+    } else if (ret == ESP_OK) {
+        /* Debug only: commits sit on the E-stop path */
+        ESP_LOGD(TAG, "Relay commit: 0x%02X -> 0x%02X", old_state, new_state);
+    }
+    return ret;
+}
+
+/* ===== Single relay / whole image ===== */
+
 esp_err_t relay_ctrl_set(uint8_t relay_index, uint8_t state)
 {
     if (!s_initialized) {
@@ -236,7 +472,10 @@ esp_err_t relay_ctrl_set(uint8_t relay_index, uint8_t state)
     }
 
     uint8_t bit_mask = (1 << (relay_index - 1));
-    uint8_t new_state = s_relay_state;
+
+    xSemaphoreTake(s_out_lock, portMAX_DELAY);
+    uint8_t old_state = s_relay_state;
+    uint8_t new_state = old_state;
 
     switch (state) {
         case RELAY_STATE_OFF:
@@ -250,10 +489,16 @@ esp_err_t relay_ctrl_set(uint8_t relay_index, uint8_t state)
             break;
     }
 
-    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, new_state);
+    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, new_state, I2C_BUS_PRIO_OUTPUT);
     if (ret == ESP_OK) {
+        relay_wear_note(old_state, new_state);
         s_relay_state = new_state;
-        ESP_LOGI(TAG, "Relay %u -> %s (ro_bits=0x%02X)",
+    }
+    xSemaphoreGive(s_out_lock);
+
+    /* Debug only: callers on the command path trace the change themselves */
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Relay %u -> %s (ro_bits=0x%02X)",
                  relay_index,
                  (new_state & bit_mask) ? "ON" : "OFF",
                  new_state);
@@ -275,14 +520,21 @@ esp_err_t relay_ctrl_set_mask(uint8_t mask, uint8_t values)
     }
 
     /* Atomic update: new = (current & ~mask) | (values & mask) */
-    uint8_t new_state = (s_relay_state & ~mask) | (values & mask);
+    xSemaphoreTake(s_out_lock, portMAX_DELAY);
+    uint8_t old_state = s_relay_state;
+    uint8_t new_state = (old_state & ~mask) | (values & mask);
 
-    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, new_state);
+    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, new_state, I2C_BUS_PRIO_OUTPUT);
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Relay mask update: 0x%02X -> 0x%02X (mask=0x%02X values=0x%02X)",
-                 s_relay_state, new_state, mask, values);
+        relay_wear_note(old_state, new_state);
         s_relay_state = new_state;
     }
+    xSemaphoreGive(s_out_lock);
+
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Relay mask update: 0x%02X -> 0x%02X (mask=0x%02X values=0x%02X)",
+                 old_state, new_state, mask, values);
+    }
 
     return ret;
 }
@@ -304,7 +556,7 @@ esp_err_t relay_ctrl_read_hw_state(uint8_t *state)
     }
 
     /* Read from output register to see what we're driving */
-    esp_err_t ret = tca9554_read_reg(TCA9554_REG_OUTPUT, state);
+    esp_err_t ret = tca9554_read_reg(TCA9554_REG_OUTPUT, state, I2C_BUS_PRIO_DIAG);
     if (ret == ESP_OK) {
         ESP_LOGD(TAG, "Hardware output state: 0x%02X (cached: 0x%02X)", *state, s_relay_state);
     }
@@ -318,11 +570,18 @@ esp_err_t relay_ctrl_set_all(uint8_t state)
         return ESP_ERR_INVALID_STATE;
     }
 
-    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, state);
+    xSemaphoreTake(s_out_lock, portMAX_DELAY);
+    uint8_t old_state = s_relay_state;
+    esp_err_t ret = tca9554_write_reg(TCA9554_REG_OUTPUT, state, I2C_BUS_PRIO_OUTPUT);
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "All relays set: 0x%02X -> 0x%02X", s_relay_state, state);
+        relay_wear_note(old_state, state);
         s_relay_state = state;
     }
+    xSemaphoreGive(s_out_lock);
+
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "All relays set: 0x%02X -> 0x%02X", old_state, state);
+    }
 
     return ret;
 }
@@ -355,7 +614,7 @@ esp_err_t relay_ctrl_read_di(uint8_t *di_bits)
     }
 
     /* Read from TCA9534 input register */
-    return tca9534_di_read_reg(TCA9554_REG_INPUT, di_bits);
+    return tca9534_di_read_reg(TCA9554_REG_INPUT, di_bits, I2C_BUS_PRIO_SAFETY);
 }
 
 bool relay_ctrl_di_available(void)
@@ -0,0 +1,232 @@
+#include "relay_wear.h"
+#include "relay_ctrl.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "relay_wear";
+
+#define NVS_NAMESPACE       "relay_ctrl"
+#define NVS_KEY_WEAR        "wear"
+#define WEAR_BLOB_VERSION   1
+
+#define FLUSH_TASK_STACK    3072
+#define FLUSH_TASK_PRIORITY 1
+
+typedef struct {
+    uint32_t on_count;
+    uint32_t off_count;
+    uint64_t on_us;             /* Closed ON periods only */
+} wear_channel_t;
+
+/* NVS blob; bump WEAR_BLOB_VERSION if the layout changes */
+typedef struct {
+    uint16_t       version;
+    uint16_t       channels;
+    wear_channel_t ch[RELAY_CTRL_CHANNELS];
+} wear_blob_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static wear_channel_t s_ch[RELAY_CTRL_CHANNELS];
+static int64_t s_on_since_us[RELAY_CTRL_CHANNELS];
+static uint8_t s_state = 0x00;          /* Image the counters have seen */
+static uint32_t s_changes = 0;          /* Bumped by every note */
+static uint32_t s_saved_changes = 0;    /* s_changes at the last good flush */
+
+static uint32_t s_flushes = 0;
+static uint32_t s_flush_errors = 0;
+static int64_t s_last_flush_us = 0;
+
+static TaskHandle_t s_flush_task = NULL;
+
+/* ===== Accounting ===== */
+
+void relay_wear_note(uint8_t old_state, uint8_t new_state)
+{
+    uint8_t changed = old_state ^ new_state;
+    if (changed == 0) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; changed != 0; i++, changed >>= 1) {
+        if (!(changed & 1)) {
+            continue;
+        }
+        if (new_state & (1 << i)) {
+            s_ch[i].on_count++;
+            s_on_since_us[i] = now;
+        } else {
+            s_ch[i].off_count++;
+            s_ch[i].on_us += (uint64_t)(now - s_on_since_us[i]);
+        }
+    }
+    s_state = new_state;
+    s_changes++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* Counters with the running ON periods closed at now */
+static uint32_t snapshot(wear_channel_t out[RELAY_CTRL_CHANNELS], int64_t now)
+{
+    portENTER_CRITICAL(&s_lock);
+    memcpy(out, s_ch, sizeof(s_ch));
+    for (int i = 0; i < RELAY_CTRL_CHANNELS; i++) {
+        if (s_state & (1 << i)) {
+            out[i].on_us += (uint64_t)(now - s_on_since_us[i]);
+        }
+    }
+    uint32_t changes = s_changes;
+    portEXIT_CRITICAL(&s_lock);
+    return changes;
+}
+
+/* ===== Persistence ===== */
+
+static void load_from_nvs(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "No saved relay counters (%s), starting from zero", esp_err_to_name(err));
+        return;
+    }
+
+    wear_blob_t blob;
+    size_t len = sizeof(blob);
+    err = nvs_get_blob(nvs, NVS_KEY_WEAR, &blob, &len);
+    nvs_close(nvs);
+
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "No saved relay counters (%s), starting from zero", esp_err_to_name(err));
+        return;
+    }
+    if (len != sizeof(blob) || blob.version != WEAR_BLOB_VERSION ||
+        blob.channels != RELAY_CTRL_CHANNELS) {
+        ESP_LOGW(TAG, "Saved relay counters unreadable (len %u, version %u), starting from zero",
+                 (unsigned)len, blob.version);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(s_ch, blob.ch, sizeof(s_ch));
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < RELAY_CTRL_CHANNELS; i++) {
+        ESP_LOGI(TAG, "RO%d: %lu on / %lu off, %llu s on", i + 1,
+                 (unsigned long)blob.ch[i].on_count, (unsigned long)blob.ch[i].off_count,
+                 (unsigned long long)(blob.ch[i].on_us / 1000000));
+    }
+}
+
+static esp_err_t flush(bool force)
+{
+    wear_blob_t blob = {
+        .version = WEAR_BLOB_VERSION,
+        .channels = RELAY_CTRL_CHANNELS,
+    };
+    uint32_t changes = snapshot(blob.ch, esp_timer_get_time());
+
+    /* Nothing switched and nothing is accumulating ON time */
+    if (!force && changes == s_saved_changes && s_state == 0) {
+        return ESP_OK;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, NVS_KEY_WEAR, &blob, sizeof(blob));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (err != ESP_OK) {
+        s_flush_errors++;
+        ESP_LOGW(TAG, "Failed to save relay counters: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_saved_changes = changes;
+    s_last_flush_us = esp_timer_get_time();
+    s_flushes++;
+    ESP_LOGD(TAG, "Relay counters saved (%lu changes)", (unsigned long)changes);
+    return ESP_OK;
+}
+
+static void flush_task(void *arg)
+{
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_RELAY_CTRL_WEAR_FLUSH_PERIOD_S * 1000));
+        flush(false);
+    }
+}
+
+/* esp_restart() (OTA, switch to recovery): keep the last period */
+static void flush_on_shutdown(void)
+{
+    flush(false);
+}
+
+/* ===== Public API ===== */
+
+esp_err_t relay_wear_init(void)
+{
+    if (s_flush_task != NULL) {
+        return ESP_OK;
+    }
+
+    load_from_nvs();
+
+    BaseType_t ok = xTaskCreate(flush_task, "relay_wear", FLUSH_TASK_STACK, NULL,
+                                FLUSH_TASK_PRIORITY, &s_flush_task);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create flush task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = esp_register_shutdown_handler(flush_on_shutdown);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No flush on restart: %s", esp_err_to_name(err));
+    }
+
+    ESP_LOGI(TAG, "Relay counters saved every %d s when changed",
+             CONFIG_RELAY_CTRL_WEAR_FLUSH_PERIOD_S);
+    return ESP_OK;
+}
+
+esp_err_t relay_ctrl_get_wear(relay_ctrl_wear_stats_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t now = esp_timer_get_time();
+    wear_channel_t ch[RELAY_CTRL_CHANNELS];
+    uint32_t changes = snapshot(ch, now);
+
+    for (int i = 0; i < RELAY_CTRL_CHANNELS; i++) {
+        out->channel[i].on_count = ch[i].on_count;
+        out->channel[i].off_count = ch[i].off_count;
+        out->channel[i].on_time_ms = ch[i].on_us / 1000;
+    }
+    out->flushes = s_flushes;
+    out->flush_errors = s_flush_errors;
+    out->unsaved_changes = changes - s_saved_changes;
+    out->last_flush_age_ms = s_flushes ? (uint32_t)((now - s_last_flush_us) / 1000) : UINT32_MAX;
+    return ESP_OK;
+}
+
+esp_err_t relay_ctrl_flush_wear(void)
+{
+    return flush(true);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+/*
+ * Relay actuation counters (component-private)
+ * ============================================
+ *
+ * Counts ON and OFF transitions and accumulated ON time per channel in
+ * RAM, from every output image relay_ctrl writes. A low-priority task
+ * saves them to NVS as one blob every CONFIG_RELAY_CTRL_WEAR_FLUSH_PERIOD_S
+ * when something changed, and once more on a planned restart, so a relay
+ * toggling at 1 Hz costs one flash write per period, not one per toggle.
+ * Power loss forgets at most one period.
+ */
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Load the saved counters and start the flush task
+ *
+ * Call once from relay_ctrl_init(), with NVS initialised and all outputs
+ * OFF. Without NVS the counters still run, starting from zero.
+ */
+esp_err_t relay_wear_init(void);
+
+/**
+ * @brief Account for an output image change
+ *
+ * Called after each successful output register write. RAM only: a few
+ * additions per changed channel under a spinlock, no flash, no logging.
+ */
+void relay_wear_note(uint8_t old_state, uint8_t new_state);
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "wire_protocol.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,7 +22,8 @@ extern "C" {
  *   REQUIRED (2)    - Critical for operation, faults block start/trigger E-stop
  *
  * Safety Gates:
- *   Each gate is a condition that must pass for certain operations.
+ *   Each gate is a condition that must pass for certain operations, defined
+ *   by one row of SAFETY_GATE_TABLE below.
  *   Gates can be ENABLED (checked) or BYPASSED (skipped) for development.
  *   E-Stop gate (ID 0) can NEVER be bypassed.
  */
@@ -52,21 +54,80 @@ typedef enum {
  * SAFETY GATES
  * ============================================================================ */
 
+/* Source signals, sampled once per tick (bit N of the signal word) */
+typedef enum {
+    GATE_SIG_NONE = 0,          /* Always 0 */
+    GATE_SIG_ESTOP_ACTIVE,      /* INTERLOCK_BIT_ESTOP */
+    GATE_SIG_DOOR_OPEN,         /* INTERLOCK_BIT_DOOR_OPEN */
+    GATE_SIG_MOTOR_FAULT,       /* INTERLOCK_BIT_MOTOR_FAULT */
+    GATE_SIG_HMI_LIVE,          /* BLE session live */
+    GATE_SIG_PID1_ONLINE,       /* PID responding (ONLINE or STALE) */
+    GATE_SIG_PID2_ONLINE,
+    GATE_SIG_PID3_ONLINE,
+    GATE_SIG_PID1_PROBE_ERR,    /* Online PID reading HHHH/LLLL */
+    GATE_SIG_PID2_PROBE_ERR,
+    GATE_SIG_PID3_PROBE_ERR,
+    GATE_SIG_MAX
+} gate_signal_t;
+
+/* How a rule reads its signal */
+typedef enum {
+    GATE_CMP_SET = 0,           /* Passes while the signal is 1 */
+    GATE_CMP_CLEAR,             /* Passes while the signal is 0 */
+    GATE_CMP_ALWAYS,            /* Always passes (placeholder gate) */
+} gate_cmp_t;
+
+/* Which gates START_RUN checks */
+typedef enum {
+    GATE_START_NEVER = 0,
+    GATE_START_ALWAYS,          /* Unless bypassed or N/A */
+    GATE_START_IF_REQUIRED,     /* Only while the subsystem is CAP_REQUIRED */
+} gate_start_t;
+
+/* No capability dependency */
+#define SUBSYS_NONE     SUBSYS_MAX
+
+/*
+ * Gate rules
+ *
+ * X(NAME, id, signal, cmp, subsys, bypassable, start, fail_alarm, bypass_alarm)
+ *   id           Gate ID on the wire and bit in every gate mask (dense, < 32)
+ *   signal, cmp  Condition: GATE_SIG_<signal> compared per GATE_CMP_<cmp>
+ *   subsys       Gate is N/A while this subsystem is CAP_NOT_PRESENT
+ *   bypassable   SET_SAFETY_GATE may bypass it
+ *   start        GATE_START_<start>
+ *   fail_alarm   alarm_bits set while the condition fails (bypass or not)
+ *   bypass_alarm alarm_bits set while the gate is bypassed (may be shared)
+ *
+ * Rows are evaluated, and START_RUN reports its first blocking gate, in
+ * table order. Adding a gate is one row; safety_gate.c checks IDs and
+ * alarm bits for collisions at compile time.
+ */
+#define SAFETY_GATE_TABLE(X) \
+    X(ESTOP,             0, ESTOP_ACTIVE,  CLEAR,  SUBSYS_DI_ESTOP, false, ALWAYS,      0,                          0) \
+    X(DOOR_CLOSED,       1, DOOR_OPEN,     CLEAR,  SUBSYS_DI_DOOR,  true,  ALWAYS,      0,                          ALARM_BIT_GATE_DOOR_BYPASSED) \
+    X(HMI_LIVE,          2, HMI_LIVE,      SET,    SUBSYS_NONE,     true,  ALWAYS,      0,                          ALARM_BIT_GATE_HMI_BYPASSED) \
+    X(PID1_ONLINE,       3, PID1_ONLINE,   SET,    SUBSYS_PID1,     true,  IF_REQUIRED, 0,                          ALARM_BIT_GATE_PID_BYPASSED) \
+    X(PID1_NO_PROBE_ERR, 6, PID1_PROBE_ERR, CLEAR, SUBSYS_PID1,     true,  IF_REQUIRED, ALARM_BIT_PID1_PROBE_ERROR, ALARM_BIT_GATE_PID_BYPASSED) \
+    X(PID2_ONLINE,       4, PID2_ONLINE,   SET,    SUBSYS_PID2,     true,  IF_REQUIRED, 0,                          ALARM_BIT_GATE_PID_BYPASSED) \
+    X(PID2_NO_PROBE_ERR, 7, PID2_PROBE_ERR, CLEAR, SUBSYS_PID2,     true,  IF_REQUIRED, ALARM_BIT_PID2_PROBE_ERROR, ALARM_BIT_GATE_PID_BYPASSED) \
+    X(PID3_ONLINE,       5, PID3_ONLINE,   SET,    SUBSYS_PID3,     true,  IF_REQUIRED, 0,                          ALARM_BIT_GATE_PID_BYPASSED) \
+    X(PID3_NO_PROBE_ERR, 8, PID3_PROBE_ERR, CLEAR, SUBSYS_PID3,     true,  IF_REQUIRED, ALARM_BIT_PID3_PROBE_ERROR, ALARM_BIT_GATE_PID_BYPASSED) \
+    X(RESERVED,          9, NONE,          ALWAYS, SUBSYS_NONE,     true,  NEVER,       0,                          0)
+
+#define SAFETY_GATE_ID(name, id, ...)       GATE_##name = (id),
+#define SAFETY_GATE_COUNT(name, id, ...)    + 1
+#define SAFETY_GATE_ALARMS(name, id, sig, cmp, subsys, byp, start, fail, bypass) | (fail) | (bypass)
+
 /* Gate IDs */
 typedef enum {
-    GATE_ESTOP              = 0,    /* E-Stop not active (NEVER bypassable) */
-    GATE_DOOR_CLOSED        = 1,    /* Door is closed */
-    GATE_HMI_LIVE           = 2,    /* BLE session is active */
-    GATE_PID1_ONLINE        = 3,    /* PID1 responding to RS-485 */
-    GATE_PID2_ONLINE        = 4,    /* PID2 responding to RS-485 */
-    GATE_PID3_ONLINE        = 5,    /* PID3 responding to RS-485 */
-    GATE_PID1_NO_PROBE_ERR  = 6,    /* PID1 PV in valid range */
-    GATE_PID2_NO_PROBE_ERR  = 7,    /* PID2 PV in valid range */
-    GATE_PID3_NO_PROBE_ERR  = 8,    /* PID3 PV in valid range */
-    GATE_RESERVED           = 9,    /* Reserved for future (motor fault) */
-    GATE_MAX
+    SAFETY_GATE_TABLE(SAFETY_GATE_ID)
+    GATE_MAX = 0 SAFETY_GATE_TABLE(SAFETY_GATE_COUNT)
 } gate_id_t;
 
+/* Every alarm bit the gate rules own (telemetry replaces exactly these) */
+#define SAFETY_GATE_ALARM_MASK  (0u SAFETY_GATE_TABLE(SAFETY_GATE_ALARMS))
+
 /* Gate status (result of checking a gate condition) */
 typedef enum {
     GATE_STATUS_PASSING     = 0,    /* Condition is met */
@@ -75,6 +136,20 @@ typedef enum {
     GATE_STATUS_NA          = 3,    /* Not applicable (subsystem NOT_PRESENT) */
 } gate_status_t;
 
+/* Per-tick evaluation cost (safety_gate_evaluate()) */
+typedef struct {
+    uint32_t evaluations;       /* Ticks evaluated */
+    uint32_t last_cycles;       /* CPU cycles, last evaluation */
+    uint32_t max_cycles;
+    uint32_t avg_cycles;
+} safety_gate_eval_stats_t;
+
+/* safety_gate_benchmark() result, best of several runs */
+typedef struct {
+    uint32_t eval_cycles;       /* One evaluation of every gate */
+    uint32_t read_cycles;       /* Status mask + START check + probe flags from the cached word */
+} safety_gate_bench_t;
+
 /* ============================================================================
  * PROBE ERROR THRESHOLDS
  * ============================================================================ */
@@ -100,6 +175,32 @@ typedef enum {
  */
 esp_err_t safety_gate_init(void);
 
+/**
+ * @brief Evaluate every gate and publish the result
+ *
+ * Called once per control tick by the machine_state task with the tick's
+ * interlock bits. Reads the HMI session and one copy of each PID, runs the
+ * rule table and publishes the status, raw condition, START-blocking and
+ * alarm masks together under a spinlock. The status, check, probe,
+ * START/PID and alarm queries below read that result in O(1); before the
+ * first call they evaluate on the spot.
+ *
+ * @param interlocks INTERLOCK_BIT_* from machine_state
+ */
+void safety_gate_evaluate(uint8_t interlocks);
+
+/**
+ * @brief Evaluation cost since boot
+ */
+void safety_gate_get_eval_stats(safety_gate_eval_stats_t *out);
+
+/**
+ * @brief Time one evaluation against one pass of cached reads, and log both
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if out is NULL
+ */
+esp_err_t safety_gate_benchmark(safety_gate_bench_t *out);
+
 /* ===== Capability Management ===== */
 
 /**
@@ -143,11 +244,11 @@ bool safety_gate_is_enabled(gate_id_t gate);
  * @brief Enable or bypass a safety gate
  *
  * Gate bypasses do NOT persist to NVS (reset on reboot for safety).
- * E-Stop gate (GATE_ESTOP) cannot be bypassed.
+ * Only gates whose rule is bypassable may be bypassed; E-Stop never is.
  *
  * @param gate Gate ID
  * @param enabled true to enable gate, false to bypass
- * @return ESP_OK on success, ESP_ERR_INVALID_ARG for E-Stop bypass attempt
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a non-bypassable gate
  */
 esp_err_t safety_gate_set_enabled(gate_id_t gate, bool enabled);
 
@@ -156,17 +257,26 @@ esp_err_t safety_gate_set_enabled(gate_id_t gate, bool enabled);
  *
  * @return Bitmask where bit N = gate N enabled (1) or bypassed (0)
  */
-uint16_t safety_gate_get_enable_mask(void);
+uint32_t safety_gate_get_enable_mask(void);
 
 /**
- * @brief Get gate status bitmask (current pass/fail state)
+ * @brief Get gate status bitmask (as of the last tick's evaluation)
  *
- * This evaluates all gates and returns their current status.
  * Bit N = 1 means gate N is passing (or bypassed), 0 means blocking.
  *
  * @return Bitmask where bit N = gate N passing/bypassed (1) or blocking (0)
  */
-uint16_t safety_gate_get_status_mask(void);
+uint32_t safety_gate_get_status_mask(void);
+
+/**
+ * @brief Get the alarm bits the gate rules raise (as of the last tick)
+ *
+ * Only bits within SAFETY_GATE_ALARM_MASK are ever set: a rule's fail
+ * alarm while its condition fails, its bypass alarm while it is bypassed.
+ *
+ * @return ALARM_BIT_* flags
+ */
+uint32_t safety_gate_get_alarm_bits(void);
 
 /**
  * @brief Check a specific gate's current status
@@ -3,6 +3,9 @@
 #include "machine_state.h"
 #include "session_mgr.h"
 
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -18,6 +21,9 @@ static const char *TAG = "safety_gate";
 #define NVS_KEY_CAP_DI_LN2  "cap_di_ln2"
 #define NVS_KEY_CAP_DI_MOT  "cap_di_motor"
 
+/* safety_gate_benchmark(): best of this many runs */
+#define BENCH_RUNS          16
+
 /* Default capability levels */
 static const capability_level_t s_default_caps[SUBSYS_MAX] = {
     [SUBSYS_PID1]       = CAP_OPTIONAL,     /* LN2 PID - monitoring only */
@@ -34,7 +40,7 @@ static capability_level_t s_caps[SUBSYS_MAX];
 
 /* Gate enable flags (bit N = gate N enabled) */
 /* All gates enabled by default, bypasses do NOT persist */
-static uint16_t s_gate_enable_mask = 0xFFFF;
+static uint32_t s_gate_enable_mask = UINT32_MAX;
 
 /* Initialized flag */
 static bool s_initialized = false;
@@ -142,103 +148,256 @@ static esp_err_t save_capability_to_nvs(subsystem_id_t subsys, capability_level_
 }
 
 /* ============================================================================
- * PROBE ERROR DETECTION
+ * GATE EVALUATION
  * ============================================================================ */
 
-bool safety_gate_pid_has_probe_error(uint8_t pid_id)
+/*
+ * Rule table
+ *
+ * SAFETY_GATE_TABLE (safety_gate.h) is expanded twice: into s_rules[] for
+ * the per-rule loops below, and into constant masks, one bit per gate, so
+ * the tick evaluates every condition with a handful of word operations.
+ */
+typedef struct {
+    uint8_t  id;
+    uint8_t  signal;            /* gate_signal_t */
+    uint8_t  subsys;            /* subsystem_id_t or SUBSYS_NONE */
+    uint8_t  start;             /* gate_start_t */
+    uint32_t fail_alarm;
+    uint32_t bypass_alarm;
+} gate_rule_t;
+
+#define GATE_BIT(g)         (1u << (g))
+#define GATE_BITS           ((uint32_t)((1ull << GATE_MAX) - 1))
+
+#define RULE_ROW(name, id, sig, cmp, subsys, byp, start, fail, bypass) \
+    { (id), GATE_SIG_##sig, (subsys), GATE_START_##start, (fail), (bypass) },
+
+/* In table order, which is also START_RUN's reporting order */
+static const gate_rule_t s_rules[] = { SAFETY_GATE_TABLE(RULE_ROW) };
+
+#define MASK_CMP_SET(name, id, sig, cmp, ...)   | (GATE_CMP_##cmp == GATE_CMP_SET ? GATE_BIT(id) : 0u)
+#define MASK_CMP_CLEAR(name, id, sig, cmp, ...) | (GATE_CMP_##cmp == GATE_CMP_CLEAR ? GATE_BIT(id) : 0u)
+#define MASK_CMP_ALWAYS(name, id, sig, cmp, ...) | (GATE_CMP_##cmp == GATE_CMP_ALWAYS ? GATE_BIT(id) : 0u)
+#define MASK_BYPASSABLE(name, id, sig, cmp, subsys, byp, ...) | ((byp) ? GATE_BIT(id) : 0u)
+
+#define CMP_SET_MASK        (0u SAFETY_GATE_TABLE(MASK_CMP_SET))
+#define CMP_CLEAR_MASK      (0u SAFETY_GATE_TABLE(MASK_CMP_CLEAR))
+#define CMP_ALWAYS_MASK     (0u SAFETY_GATE_TABLE(MASK_CMP_ALWAYS))
+#define BYPASSABLE_MASK     (0u SAFETY_GATE_TABLE(MASK_BYPASSABLE))
+
+/* ===== Compile-time table checks ===== */
+
+#define SUM_ID(name, id, ...)   + (1ull << (id))
+#define OR_ID(name, id, ...)    | (1ull << (id))
+#define SUM_FAIL(name, id, sig, cmp, subsys, byp, start, fail, bypass)  + (uint64_t)(fail)
+#define OR_FAIL(name, id, sig, cmp, subsys, byp, start, fail, bypass)   | (uint64_t)(fail)
+#define OR_BYPASS(name, id, sig, cmp, subsys, byp, start, fail, bypass) | (uint64_t)(bypass)
+
+#define CHECK_ROW(name, id, sig, cmp, subsys, byp, start, fail, bypass) \
+    _Static_assert((id) >= 0 && (id) < 32, "gate " #name ": ID must be 0..31"); \
+    _Static_assert(GATE_SIG_##sig < GATE_SIG_MAX, "gate " #name ": unknown signal"); \
+    _Static_assert((subsys) <= SUBSYS_NONE, "gate " #name ": unknown subsystem"); \
+    _Static_assert(((fail) & ((fail) - 1)) == 0, "gate " #name ": fail alarm must be one bit"); \
+    _Static_assert(((bypass) & ((bypass) - 1)) == 0, "gate " #name ": bypass alarm must be one bit"); \
+    _Static_assert((id) != GATE_ESTOP || !(byp), "E-Stop gate must not be bypassable");
+
+SAFETY_GATE_TABLE(CHECK_ROW)
+
+_Static_assert(GATE_MAX <= 32, "gate masks are 32 bits wide");
+_Static_assert(GATE_SIG_MAX <= 32, "signal word is 32 bits wide");
+_Static_assert((0ull SAFETY_GATE_TABLE(SUM_ID)) == (0ull SAFETY_GATE_TABLE(OR_ID)),
+               "two gates share an ID");
+_Static_assert((0ull SAFETY_GATE_TABLE(OR_ID)) == (1ull << GATE_MAX) - 1,
+               "gate IDs must be dense from 0");
+_Static_assert((0ull SAFETY_GATE_TABLE(SUM_FAIL)) == (0ull SAFETY_GATE_TABLE(OR_FAIL)),
+               "two gates share a fail alarm bit");
+_Static_assert(((0ull SAFETY_GATE_TABLE(OR_FAIL)) & (0ull SAFETY_GATE_TABLE(OR_BYPASS))) == 0,
+               "a fail alarm bit is also used as a bypass alarm");
+_Static_assert((SAFETY_GATE_ALARM_MASK &
+                (ALARM_BIT_ESTOP_ACTIVE | ALARM_BIT_DOOR_INTERLOCK | ALARM_BIT_OVER_TEMP |
+                 ALARM_BIT_RS485_FAULT | ALARM_BIT_POWER_FAULT | ALARM_BIT_HMI_NOT_LIVE |
+                 ALARM_BIT_PID1_FAULT | ALARM_BIT_PID2_FAULT | ALARM_BIT_PID3_FAULT |
+                 ALARM_BIT_RELAY_MISMATCH)) == 0,
+               "gate alarm bit collides with an alarm owned elsewhere");
+
+/* ===== Evaluation ===== */
+
+/*
+ * Result of the last evaluation, rebuilt once per machine_state tick by
+ * safety_gate_evaluate(). Every query below reads it instead of
+ * re-checking interlocks, the session and three PID copies. Bit N = gate N.
+ */
+typedef struct {
+    uint32_t status;            /* Passing, bypassed or N/A (get_status_mask) */
+    uint32_t cond;              /* Condition met, ignoring bypass and capability */
+    uint32_t block;             /* Blocks START_RUN under the current capabilities */
+    uint32_t alarms;            /* ALARM_BIT_* within SAFETY_GATE_ALARM_MASK */
+} gate_result_t;
+
+static portMUX_TYPE s_result_lock = portMUX_INITIALIZER_UNLOCKED;
+static gate_result_t s_result = { 0 };
+static bool s_result_valid = false;
+static uint32_t s_last_signals = 0;
+
+/* Rebuilt from s_caps whenever a capability changes */
+static uint32_t s_na_mask = 0;      /* Subsystem NOT_PRESENT */
+static uint32_t s_start_mask = 0;   /* Checked by START_RUN */
+
+/* Per-tick evaluation cost */
+static safety_gate_eval_stats_t s_eval_stats = { 0 };
+static uint64_t s_eval_cycles_sum = 0;
+
+/* HHHH over-range on any PID; LLLL under-range only on the heater PIDs (2, 3) */
+static bool pv_is_probe_error(uint8_t pid_id, float pv)
 {
-    if (pid_id < 1 || pid_id > 3) {
-        return false;
-    }
+    int16_t pv_x10 = (int16_t)(pv * 10.0f);
 
-    pid_controller_t ctrl;
-    if (pid_controller_get_by_addr(pid_id, &ctrl) != ESP_OK) {
-        /* Can't read PID - not a probe error per se */
-        return false;
+    if (pv_x10 >= PROBE_ERROR_HIGH_THRESHOLD_X10) {
+        return true;
     }
+    return pid_id != 1 && pv_x10 <= PROBE_ERROR_LOW_THRESHOLD_X10;
+}
 
-    /* Check if PID is even online */
-    if (ctrl.state != PID_STATE_ONLINE && ctrl.state != PID_STATE_STALE) {
-        return false;  /* Offline is handled by PID_ONLINE gate */
-    }
+/* All the I/O: sample every source signal once, one PID copy per controller */
+static uint32_t read_signals(uint8_t interlocks)
+{
+    uint32_t sig = 0;
 
-    int16_t pv_x10 = (int16_t)(ctrl.data.pv * 10.0f);
+    sig |= (uint32_t)((interlocks & INTERLOCK_BIT_ESTOP) != 0) << GATE_SIG_ESTOP_ACTIVE;
+    sig |= (uint32_t)((interlocks & INTERLOCK_BIT_DOOR_OPEN) != 0) << GATE_SIG_DOOR_OPEN;
+    sig |= (uint32_t)((interlocks & INTERLOCK_BIT_MOTOR_FAULT) != 0) << GATE_SIG_MOTOR_FAULT;
+    sig |= (uint32_t)session_mgr_is_live() << GATE_SIG_HMI_LIVE;
 
-    /* Over-range (HHHH) - applies to all PIDs */
-    if (pv_x10 >= PROBE_ERROR_HIGH_THRESHOLD_X10) {
-        return true;
-    }
+    for (uint8_t i = 0; i < 3; i++) {
+        pid_controller_t ctrl;
+        bool online = pid_controller_get_by_addr(i + 1, &ctrl) == ESP_OK &&
+                      (ctrl.state == PID_STATE_ONLINE || ctrl.state == PID_STATE_STALE);
+        /* Offline is the online gate's business, not a probe error */
+        bool probe_err = online && pv_is_probe_error(i + 1, ctrl.data.pv);
 
-    /* Under-range (LLLL) - only for heater PIDs (2, 3), not LN2 PID (1) */
-    if (pid_id != 1 && pv_x10 <= PROBE_ERROR_LOW_THRESHOLD_X10) {
-        return true;
+        sig |= (uint32_t)online << (GATE_SIG_PID1_ONLINE + i);
+        sig |= (uint32_t)probe_err << (GATE_SIG_PID1_PROBE_ERR + i);
     }
 
-    return false;
+    return sig;
 }
 
-uint8_t safety_gate_get_probe_error_flags(void)
+static void rebuild_cap_masks(void)
 {
-    uint8_t flags = 0;
+    uint32_t na = 0;
+    uint32_t start = 0;
 
-    if (safety_gate_pid_has_probe_error(1)) flags |= (1 << 0);
-    if (safety_gate_pid_has_probe_error(2)) flags |= (1 << 1);
-    if (safety_gate_pid_has_probe_error(3)) flags |= (1 << 2);
+    for (size_t i = 0; i < sizeof(s_rules) / sizeof(s_rules[0]); i++) {
+        const gate_rule_t *r = &s_rules[i];
+        capability_level_t cap = r->subsys < SUBSYS_MAX ? s_caps[r->subsys] : CAP_REQUIRED;
 
-    return flags;
-}
+        na |= (uint32_t)(cap == CAP_NOT_PRESENT) << r->id;
+        start |= (uint32_t)(r->start == GATE_START_ALWAYS ||
+                            (r->start == GATE_START_IF_REQUIRED && cap == CAP_REQUIRED)) << r->id;
+    }
 
-/* ============================================================================
- * GATE CHECKING
- * ============================================================================ */
+    s_na_mask = na;
+    s_start_mask = start;
+}
 
-static bool check_gate_condition(gate_id_t gate)
+/* The interpreter: signal word in, every gate mask out, no per-gate code */
+static gate_result_t interpret(uint32_t sig)
 {
-    uint8_t interlocks = machine_state_get_interlocks();
+    uint32_t at_gate = 0;
+    for (size_t i = 0; i < sizeof(s_rules) / sizeof(s_rules[0]); i++) {
+        at_gate |= ((sig >> s_rules[i].signal) & 1u) << s_rules[i].id;
+    }
 
-    switch (gate) {
-        case GATE_ESTOP:
-            return (interlocks & INTERLOCK_BIT_ESTOP) == 0;
+    uint32_t cond = ((at_gate & CMP_SET_MASK) | (~at_gate & CMP_CLEAR_MASK) | CMP_ALWAYS_MASK);
+    uint32_t bypassed = ~s_gate_enable_mask & BYPASSABLE_MASK;
 
-        case GATE_DOOR_CLOSED:
-            return (interlocks & INTERLOCK_BIT_DOOR_OPEN) == 0;
+    gate_result_t res = {
+        .status = (cond | bypassed | s_na_mask) & GATE_BITS,
+        .cond = cond,
+    };
+    res.block = ~res.status & s_start_mask & GATE_BITS;
 
-        case GATE_HMI_LIVE:
-            return session_mgr_is_live();
+    for (size_t i = 0; i < sizeof(s_rules) / sizeof(s_rules[0]); i++) {
+        const gate_rule_t *r = &s_rules[i];
+        res.alarms |= r->fail_alarm & -((~cond >> r->id) & 1u);
+        res.alarms |= r->bypass_alarm & -((bypassed >> r->id) & 1u);
+    }
 
-        case GATE_PID1_ONLINE: {
-            pid_controller_t ctrl;
-            if (pid_controller_get_by_addr(1, &ctrl) != ESP_OK) return false;
-            return ctrl.state == PID_STATE_ONLINE || ctrl.state == PID_STATE_STALE;
-        }
+    return res;
+}
 
-        case GATE_PID2_ONLINE: {
-            pid_controller_t ctrl;
-            if (pid_controller_get_by_addr(2, &ctrl) != ESP_OK) return false;
-            return ctrl.state == PID_STATE_ONLINE || ctrl.state == PID_STATE_STALE;
-        }
+static gate_result_t publish(uint32_t sig)
+{
+    gate_result_t res = interpret(sig);
+
+    portENTER_CRITICAL(&s_result_lock);
+    s_result = res;
+    s_result_valid = true;
+    s_last_signals = sig;
+    portEXIT_CRITICAL(&s_result_lock);
+    return res;
+}
 
-        case GATE_PID3_ONLINE: {
-            pid_controller_t ctrl;
-            if (pid_controller_get_by_addr(3, &ctrl) != ESP_OK) return false;
-            return ctrl.state == PID_STATE_ONLINE || ctrl.state == PID_STATE_STALE;
-        }
+/* Before the first tick (or without machine_state) evaluate on the spot */
+static gate_result_t gate_result(void)
+{
+    portENTER_CRITICAL(&s_result_lock);
+    gate_result_t res = s_result;
+    bool valid = s_result_valid;
+    portEXIT_CRITICAL(&s_result_lock);
 
-        case GATE_PID1_NO_PROBE_ERR:
-            return !safety_gate_pid_has_probe_error(1);
+    if (!valid) {
+        res = publish(read_signals(machine_state_get_interlocks()));
+    }
+    return res;
+}
 
-        case GATE_PID2_NO_PROBE_ERR:
-            return !safety_gate_pid_has_probe_error(2);
+/* Capability or bypass changed: reinterpret the last tick's signals */
+static void republish(void)
+{
+    portENTER_CRITICAL(&s_result_lock);
+    bool valid = s_result_valid;
+    uint32_t sig = s_last_signals;
+    portEXIT_CRITICAL(&s_result_lock);
 
-        case GATE_PID3_NO_PROBE_ERR:
-            return !safety_gate_pid_has_probe_error(3);
+    if (valid) {
+        publish(sig);
+    }
+}
 
-        case GATE_RESERVED:
-            return true;  /* Reserved gate always passes */
+static gate_status_t status_from_result(const gate_result_t *res, gate_id_t gate)
+{
+    if (~s_gate_enable_mask & BYPASSABLE_MASK & GATE_BIT(gate)) {
+        return GATE_STATUS_BYPASSED;
+    }
+    if (s_na_mask & GATE_BIT(gate)) {
+        return GATE_STATUS_NA;
+    }
+    return (res->cond & GATE_BIT(gate)) ? GATE_STATUS_PASSING : GATE_STATUS_BLOCKING;
+}
 
-        default:
-            return true;
+/* ============================================================================
+ * PROBE ERROR DETECTION
+ * ============================================================================ */
+
+bool safety_gate_pid_has_probe_error(uint8_t pid_id)
+{
+    if (pid_id < 1 || pid_id > 3) {
+        return false;
     }
+    return (safety_gate_get_probe_error_flags() & (1 << (pid_id - 1))) != 0;
+}
+
+uint8_t safety_gate_get_probe_error_flags(void)
+{
+    uint32_t cond = gate_result().cond;
+    uint8_t flags = 0;
+
+    flags |= !(cond & GATE_BIT(GATE_PID1_NO_PROBE_ERR)) << 0;
+    flags |= !(cond & GATE_BIT(GATE_PID2_NO_PROBE_ERR)) << 1;
+    flags |= !(cond & GATE_BIT(GATE_PID3_NO_PROBE_ERR)) << 2;
+    return flags;
 }
 
 /* ============================================================================
@@ -256,7 +415,8 @@ esp_err_t safety_gate_init(void)
     load_capabilities_from_nvs();
 
     /* All gates start enabled (bypasses reset on boot for safety) */
-    s_gate_enable_mask = 0xFFFF;
+    s_gate_enable_mask = UINT32_MAX;
+    rebuild_cap_masks();
 
     s_initialized = true;
 
@@ -297,6 +457,8 @@ esp_err_t safety_gate_set_capability(subsystem_id_t subsys, capability_level_t l
 
     /* Update in-memory value */
     s_caps[subsys] = level;
+    rebuild_cap_masks();
+    republish();
 
     ESP_LOGI(TAG, "Set capability: subsys=%d level=%d", subsys, level);
     return ESP_OK;
@@ -314,7 +476,7 @@ bool safety_gate_is_enabled(gate_id_t gate)
     if (gate >= GATE_MAX) {
         return true;
     }
-    return (s_gate_enable_mask & (1 << gate)) != 0;
+    return (s_gate_enable_mask & GATE_BIT(gate)) != 0;
 }
 
 esp_err_t safety_gate_set_enabled(gate_id_t gate, bool enabled)
@@ -323,40 +485,37 @@ esp_err_t safety_gate_set_enabled(gate_id_t gate, bool enabled)
         return ESP_ERR_INVALID_ARG;
     }
 
-    /* E-Stop gate cannot be bypassed */
-    if (gate == GATE_ESTOP && !enabled) {
-        ESP_LOGW(TAG, "Cannot bypass E-Stop gate");
+    /* E-Stop (and any other rule marked so) cannot be bypassed */
+    if (!(BYPASSABLE_MASK & GATE_BIT(gate)) && !enabled) {
+        ESP_LOGW(TAG, "Cannot bypass gate %d", gate);
         return ESP_ERR_INVALID_ARG;
     }
 
     if (enabled) {
-        s_gate_enable_mask |= (1 << gate);
+        s_gate_enable_mask |= GATE_BIT(gate);
         ESP_LOGI(TAG, "Gate %d enabled", gate);
     } else {
-        s_gate_enable_mask &= ~(1 << gate);
+        s_gate_enable_mask &= ~GATE_BIT(gate);
         ESP_LOGW(TAG, "Gate %d BYPASSED (development mode)", gate);
     }
+    republish();
 
     return ESP_OK;
 }
 
-uint16_t safety_gate_get_enable_mask(void)
+uint32_t safety_gate_get_enable_mask(void)
 {
-    return s_gate_enable_mask;
+    return s_gate_enable_mask & GATE_BITS;
 }
 
-uint16_t safety_gate_get_status_mask(void)
+uint32_t safety_gate_get_status_mask(void)
 {
-    uint16_t status = 0;
-
-    for (int i = 0; i < GATE_MAX; i++) {
-        gate_status_t gs = safety_gate_check((gate_id_t)i);
-        if (gs == GATE_STATUS_PASSING || gs == GATE_STATUS_BYPASSED || gs == GATE_STATUS_NA) {
-            status |= (1 << i);
-        }
-    }
+    return gate_result().status;
+}
 
-    return status;
+uint32_t safety_gate_get_alarm_bits(void)
+{
+    return gate_result().alarms;
 }
 
 gate_status_t safety_gate_check(gate_id_t gate)
@@ -364,92 +523,20 @@ gate_status_t safety_gate_check(gate_id_t gate)
     if (gate >= GATE_MAX) {
         return GATE_STATUS_NA;
     }
-
-    /* Check if gate is bypassed (except E-Stop which is never bypassable) */
-    if (gate != GATE_ESTOP && !safety_gate_is_enabled(gate)) {
-        return GATE_STATUS_BYPASSED;
-    }
-
-    /* For PID gates, check if subsystem is NOT_PRESENT */
-    subsystem_id_t related_subsys = SUBSYS_MAX;
-    switch (gate) {
-        case GATE_PID1_ONLINE:
-        case GATE_PID1_NO_PROBE_ERR:
-            related_subsys = SUBSYS_PID1;
-            break;
-        case GATE_PID2_ONLINE:
-        case GATE_PID2_NO_PROBE_ERR:
-            related_subsys = SUBSYS_PID2;
-            break;
-        case GATE_PID3_ONLINE:
-        case GATE_PID3_NO_PROBE_ERR:
-            related_subsys = SUBSYS_PID3;
-            break;
-        case GATE_DOOR_CLOSED:
-            related_subsys = SUBSYS_DI_DOOR;
-            break;
-        default:
-            break;
-    }
-
-    if (related_subsys < SUBSYS_MAX && s_caps[related_subsys] == CAP_NOT_PRESENT) {
-        return GATE_STATUS_NA;
-    }
-
-    /* Check the actual condition */
-    if (check_gate_condition(gate)) {
-        return GATE_STATUS_PASSING;
-    } else {
-        return GATE_STATUS_BLOCKING;
-    }
+    gate_result_t res = gate_result();
+    return status_from_result(&res, gate);
 }
 
 bool safety_gate_can_start_run(int8_t *out_blocking_gate)
 {
-    /* E-Stop always checked (never bypassable) */
-    if (safety_gate_check(GATE_ESTOP) == GATE_STATUS_BLOCKING) {
-        if (out_blocking_gate) *out_blocking_gate = GATE_ESTOP;
-        return false;
-    }
-
-    /* Door gate */
-    if (s_caps[SUBSYS_DI_DOOR] != CAP_NOT_PRESENT) {
-        gate_status_t gs = safety_gate_check(GATE_DOOR_CLOSED);
-        if (gs == GATE_STATUS_BLOCKING) {
-            if (out_blocking_gate) *out_blocking_gate = GATE_DOOR_CLOSED;
-            return false;
-        }
-    }
-
-    /* HMI gate */
-    gate_status_t hmi_gs = safety_gate_check(GATE_HMI_LIVE);
-    if (hmi_gs == GATE_STATUS_BLOCKING) {
-        if (out_blocking_gate) *out_blocking_gate = GATE_HMI_LIVE;
-        return false;
-    }
-
-    /* PID gates - only check if subsystem is REQUIRED */
-    for (int pid_id = 1; pid_id <= 3; pid_id++) {
-        subsystem_id_t subsys = SUBSYS_PID1 + (pid_id - 1);
-
-        if (s_caps[subsys] != CAP_REQUIRED) {
-            continue;  /* Skip if NOT_PRESENT or OPTIONAL */
-        }
-
-        /* Check online gate */
-        gate_id_t online_gate = GATE_PID1_ONLINE + (pid_id - 1);
-        gate_status_t gs = safety_gate_check(online_gate);
-        if (gs == GATE_STATUS_BLOCKING) {
-            if (out_blocking_gate) *out_blocking_gate = (int8_t)online_gate;
-            return false;
-        }
-
-        /* Check probe error gate */
-        gate_id_t probe_gate = GATE_PID1_NO_PROBE_ERR + (pid_id - 1);
-        gs = safety_gate_check(probe_gate);
-        if (gs == GATE_STATUS_BLOCKING) {
-            if (out_blocking_gate) *out_blocking_gate = (int8_t)probe_gate;
-            return false;
+    uint32_t block = gate_result().block;
+
+    if (block != 0) {
+        for (size_t i = 0; i < sizeof(s_rules) / sizeof(s_rules[0]); i++) {
+            if (block & GATE_BIT(s_rules[i].id)) {
+                if (out_blocking_gate) *out_blocking_gate = (int8_t)s_rules[i].id;
+                return false;
+            }
         }
     }
 
@@ -464,23 +551,25 @@ bool safety_gate_can_enable_pid(uint8_t pid_id, int8_t *out_blocking_gate)
         return false;
     }
 
+    gate_result_t res = gate_result();
+    uint32_t cond = res.cond;
+
     /* E-Stop always checked */
-    if (safety_gate_check(GATE_ESTOP) == GATE_STATUS_BLOCKING) {
+    if (!(cond & GATE_BIT(GATE_ESTOP))) {
         if (out_blocking_gate) *out_blocking_gate = GATE_ESTOP;
         return false;
     }
 
-    /* Check online gate (must be online to enable) */
+    /* Must be online to enable, bypass or not */
     gate_id_t online_gate = GATE_PID1_ONLINE + (pid_id - 1);
-    if (check_gate_condition(online_gate) == false) {
+    if (!(cond & GATE_BIT(online_gate))) {
         if (out_blocking_gate) *out_blocking_gate = (int8_t)online_gate;
         return false;
     }
 
     /* Check probe error gate (if enabled) */
     gate_id_t probe_gate = GATE_PID1_NO_PROBE_ERR + (pid_id - 1);
-    gate_status_t gs = safety_gate_check(probe_gate);
-    if (gs == GATE_STATUS_BLOCKING) {
+    if (status_from_result(&res, probe_gate) == GATE_STATUS_BLOCKING) {
         if (out_blocking_gate) *out_blocking_gate = (int8_t)probe_gate;
         return false;
     }
@@ -488,3 +577,65 @@ bool safety_gate_can_enable_pid(uint8_t pid_id, int8_t *out_blocking_gate)
     if (out_blocking_gate) *out_blocking_gate = -1;
     return true;
 }
+
+/* ===== Per-tick evaluation ===== */
+
+void safety_gate_evaluate(uint8_t interlocks)
+{
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    publish(read_signals(interlocks));
+    uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+
+    s_eval_stats.evaluations++;
+    s_eval_stats.last_cycles = cycles;
+    if (cycles > s_eval_stats.max_cycles) {
+        s_eval_stats.max_cycles = cycles;
+    }
+    s_eval_cycles_sum += cycles;
+}
+
+void safety_gate_get_eval_stats(safety_gate_eval_stats_t *out)
+{
+    *out = s_eval_stats;
+    out->avg_cycles = s_eval_stats.evaluations ?
+                      (uint32_t)(s_eval_cycles_sum / s_eval_stats.evaluations) : 0;
+}
+
+esp_err_t safety_gate_benchmark(safety_gate_bench_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t interlocks = machine_state_get_interlocks();
+    uint32_t eval_best = UINT32_MAX;
+    uint32_t read_best = UINT32_MAX;
+    volatile uint32_t sink = 0;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        publish(read_signals(interlocks));
+        uint32_t dt = esp_cpu_get_cycle_count() - t0;
+        if (dt < eval_best) {
+            eval_best = dt;
+        }
+
+        /* What one consumer pass costs now: status, start check, probe flags */
+        t0 = esp_cpu_get_cycle_count();
+        sink += safety_gate_get_status_mask();
+        sink += safety_gate_can_start_run(NULL);
+        sink += safety_gate_get_probe_error_flags();
+        dt = esp_cpu_get_cycle_count() - t0;
+        if (dt < read_best) {
+            read_best = dt;
+        }
+    }
+    (void)sink;
+
+    out->eval_cycles = eval_best;
+    out->read_cycles = read_best;
+
+    ESP_LOGI(TAG, "Gate evaluation %lu cycles per tick; status + start + probe reads %lu cycles",
+             (unsigned long)eval_best, (unsigned long)read_best);
+    return ESP_OK;
+}
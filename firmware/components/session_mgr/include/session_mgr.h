@@ -14,14 +14,33 @@ extern "C" {
  * Manages HMI session lifecycle with lease-based heartbeat.
  *
  * Flow:
- * 1. App sends OPEN_SESSION with client_nonce
+ * 1. App sends OPEN_SESSION with client_nonce (and optionally a role)
  * 2. ESP responds with session_id + lease_ms
  * 3. App sends KEEPALIVE every ~1 second to refresh lease
  * 4. If lease expires, session becomes stale (HMI_NOT_LIVE alarm)
+ *
+ * Every OPEN_SESSION and KEEPALIVE re-arms a one-shot esp_timer for
+ * lease + grace. When it fires the session goes STALE at once and
+ * subscribers are told; nobody has to poll for expiry.
+ *
+ * Roles:
+ *   Up to SESSION_MGR_MAX_SESSIONS sessions exist at once, each with its
+ *   own lease. At most one is the CONTROLLER: it alone makes the HMI
+ *   "live" and passes session_mgr_is_valid() for run control. OBSERVER
+ *   sessions (supervisors) watch telemetry and events and may only send
+ *   read-only commands. A new controller cannot displace a LIVE one held
+ *   by another connection, only a STALE one. Each connection holds at
+ *   most one session; re-opening replaces it.
+ *
+ *   The session slot is encoded in the low bits of session_id, so every
+ *   lookup by ID is O(1).
  */
 
 #define SESSION_DEFAULT_LEASE_MS    3000    // Default lease duration
 #define SESSION_GRACE_PERIOD_MS     500     // Grace period before declaring stale
+#define SESSION_MGR_MAX_SUBSCRIBERS 4       // session_mgr_subscribe() slots
+#define SESSION_MGR_MAX_SESSIONS    4       // Concurrent sessions (power of two)
+#define SESSION_CONN_NONE           0xFFFF  // Session not bound to a connection
 
 typedef enum {
     SESSION_STATE_NONE,         // No active session
@@ -29,14 +48,33 @@ typedef enum {
     SESSION_STATE_STALE,        // Lease expired, but session still exists
 } session_state_t;
 
+typedef enum {
+    SESSION_ROLE_NONE,          // No such session
+    SESSION_ROLE_CONTROLLER,    // Commands the machine (at most one)
+    SESSION_ROLE_OBSERVER,      // Read-only supervisor
+} session_role_t;
+
 typedef struct {
     uint32_t        session_id;
     uint32_t        client_nonce;
     uint16_t        lease_ms;
+    uint16_t        conn_handle;
     int64_t         last_keepalive_us;
     session_state_t state;
+    session_role_t  role;
 } session_info_t;
 
+/**
+ * @brief Controller session state change callback
+ *
+ * Called on every change of the controller session: NONE/STALE -> LIVE
+ * (open, revive, takeover), LIVE -> STALE (lease expiry, from the
+ * esp_timer task), any -> NONE (close, disconnect, from the caller's
+ * task). Observer sessions do not raise it. Keep it short: set a flag or
+ * notify a task, do not block and do not call back into session_mgr.
+ */
+typedef void (*session_mgr_cb_t)(session_state_t old_state, session_state_t new_state, void *ctx);
+
 /**
  * @brief Initialize the session manager
  */
@@ -45,12 +83,19 @@ esp_err_t session_mgr_init(void);
 /**
  * @brief Open a new session
  *
+ * Replaces any session conn_handle already holds.
+ *
+ * @param conn_handle Connection the session belongs to (freed by session_mgr_drop_conn())
+ * @param role SESSION_ROLE_CONTROLLER or SESSION_ROLE_OBSERVER
  * @param client_nonce Nonce provided by the client
  * @param out_session_id Pointer to receive the generated session_id
  * @param out_lease_ms Pointer to receive the lease duration
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if another connection holds a
+ *         LIVE controller session, ESP_ERR_NO_MEM if every slot is in use,
+ *         ESP_ERR_INVALID_ARG for a bad role
  */
-esp_err_t session_mgr_open(uint32_t client_nonce, uint32_t *out_session_id, uint16_t *out_lease_ms);
+esp_err_t session_mgr_open(uint16_t conn_handle, session_role_t role, uint32_t client_nonce,
+                           uint32_t *out_session_id, uint16_t *out_lease_ms);
 
 /**
  * @brief Refresh an existing session (KEEPALIVE)
@@ -61,55 +106,68 @@ esp_err_t session_mgr_open(uint32_t client_nonce, uint32_t *out_session_id, uint
 esp_err_t session_mgr_keepalive(uint32_t session_id);
 
 /**
- * @brief Close the current session
+ * @brief Close a session
  *
- * @param session_id The session ID to close (must match current)
+ * @param session_id The session ID to close
  * @return ESP_OK on success
  */
 esp_err_t session_mgr_close(uint32_t session_id);
 
 /**
- * @brief Check if the current session is valid (for gating commands)
+ * @brief Check if a session may run controller commands (for gating commands)
  *
  * @param session_id The session ID to validate
- * @return true if session is LIVE and matches
+ * @return true if it is the LIVE controller session
  */
 bool session_mgr_is_valid(uint32_t session_id);
 
 /**
- * @brief Check if any session is currently live
+ * @brief Role of a session (LIVE or STALE), O(1)
  *
- * @return true if there's an active, non-stale session
+ * @return SESSION_ROLE_NONE if session_id names no current session
+ */
+session_role_t session_mgr_get_role(uint32_t session_id);
+
+/**
+ * @brief Check if a controller session exists (LIVE or STALE)
+ */
+bool session_mgr_has_controller(void);
+
+/**
+ * @brief Check if the controller session is live
+ *
+ * @return true if there's an active, non-stale controller session
  */
 bool session_mgr_is_live(void);
 
 /**
- * @brief Get current session state
+ * @brief Get the controller session state
  *
- * @return Current session state
+ * @return Current controller session state
  */
 session_state_t session_mgr_get_state(void);
 
 /**
- * @brief Get current session info (for debugging/telemetry)
+ * @brief Get the controller session info (for debugging/telemetry)
  *
  * @param out_info Pointer to receive session info
- * @return ESP_OK if session exists, ESP_ERR_NOT_FOUND otherwise
+ * @return ESP_OK if a controller session exists, ESP_ERR_NOT_FOUND otherwise
  */
 esp_err_t session_mgr_get_info(session_info_t *out_info);
 
 /**
- * @brief Check for lease expiry and update state
+ * @brief Register a controller state change callback
+ *
+ * May be called before session_mgr_init().
  *
- * Call this periodically (e.g., from telemetry task) to detect stale sessions.
- * Returns true if state changed from LIVE to STALE.
+ * @return ESP_OK, ESP_ERR_NO_MEM when SESSION_MGR_MAX_SUBSCRIBERS are registered
  */
-bool session_mgr_check_expiry(void);
+esp_err_t session_mgr_subscribe(session_mgr_cb_t cb, void *ctx);
 
 /**
- * @brief Force-expire the current session (e.g., on BLE disconnect)
+ * @brief End every session of a connection (on BLE disconnect)
  */
-void session_mgr_force_expire(void);
+void session_mgr_drop_conn(uint16_t conn_handle);
 
 #ifdef __cplusplus
 }
@@ -1,104 +1,361 @@
 #include "session_mgr.h"
 
 #include <string.h>
+#include "freertos/FreeRTOS.h"
 #include "esp_log.h"
 #include "esp_random.h"
 #include "esp_timer.h"
 
 static const char *TAG = "session_mgr";
 
-static session_info_t s_session = {0};
+#define SLOT_MASK           (SESSION_MGR_MAX_SESSIONS - 1)
+#define SLOT_OF(id)         ((id) & SLOT_MASK)
+#define NO_CONTROLLER       (-1)
+
+_Static_assert((SESSION_MGR_MAX_SESSIONS & SLOT_MASK) == 0,
+               "SESSION_MGR_MAX_SESSIONS must be a power of two");
+
+typedef struct {
+    session_mgr_cb_t cb;
+    void *ctx;
+} subscriber_t;
+
+/* BLE host, command worker and esp_timer task all touch the sessions */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static session_info_t s_slots[SESSION_MGR_MAX_SESSIONS];
+static int s_controller = NO_CONTROLLER;    /* Slot of the controller session */
+
+static subscriber_t s_subs[SESSION_MGR_MAX_SUBSCRIBERS];
+static uint8_t s_sub_count = 0;
+
+/*
+ * One-shot per slot, re-armed by every open/keepalive for lease + grace.
+ * Never stopped when a slot is freed: the free happens under s_lock but
+ * the timer call cannot, so a late stop could cancel the lease of a new
+ * session that took the slot meanwhile. A timer left running on a freed
+ * slot finds it not LIVE and does nothing; arming only ever pushes the
+ * deadline out, so an arm that races another is harmless too.
+ */
+static esp_timer_handle_t s_lease_timers[SESSION_MGR_MAX_SESSIONS];
+
+/* ===== Slots (call with s_lock held) ===== */
+
+/* O(1): the slot is in the ID, the rest of the ID must match */
+static session_info_t *find_locked(uint32_t session_id)
+{
+    session_info_t *s = &s_slots[SLOT_OF(session_id)];
+    if (session_id == 0 || s->state == SESSION_STATE_NONE || s->session_id != session_id) {
+        return NULL;
+    }
+    return s;
+}
+
+static void free_locked(int slot)
+{
+    memset(&s_slots[slot], 0, sizeof(s_slots[slot]));
+    s_slots[slot].state = SESSION_STATE_NONE;
+    s_slots[slot].conn_handle = SESSION_CONN_NONE;
+    if (s_controller == slot) {
+        s_controller = NO_CONTROLLER;
+    }
+}
+
+static session_state_t controller_state_locked(void)
+{
+    return s_controller == NO_CONTROLLER ? SESSION_STATE_NONE : s_slots[s_controller].state;
+}
+
+/* ===== Lease timers ===== */
+
+static int64_t lease_deadline_us(uint16_t lease_ms)
+{
+    return ((int64_t)lease_ms + SESSION_GRACE_PERIOD_MS) * 1000;
+}
+
+static void arm_lease_timer(int slot)
+{
+    if (s_lease_timers[slot] == NULL) {
+        return;
+    }
+    esp_timer_stop(s_lease_timers[slot]);
+    esp_timer_start_once(s_lease_timers[slot],
+                         (uint64_t)lease_deadline_us(SESSION_DEFAULT_LEASE_MS));
+}
+
+/* Outside s_lock: subscribers may read the session */
+static void notify(session_state_t old_state, session_state_t new_state)
+{
+    if (old_state == new_state) {
+        return;
+    }
+
+    subscriber_t subs[SESSION_MGR_MAX_SUBSCRIBERS];
+    taskENTER_CRITICAL(&s_lock);
+    uint8_t sub_count = s_sub_count;
+    memcpy(subs, s_subs, sizeof(subs[0]) * sub_count);
+    taskEXIT_CRITICAL(&s_lock);
+
+    for (uint8_t i = 0; i < sub_count; i++) {
+        subs[i].cb(old_state, new_state, subs[i].ctx);
+    }
+}
+
+/* esp_timer task; arg is the slot */
+static void lease_timer_cb(void *arg)
+{
+    int slot = (int)(uintptr_t)arg;
+
+    taskENTER_CRITICAL(&s_lock);
+    session_info_t *s = &s_slots[slot];
+    int64_t elapsed_us = esp_timer_get_time() - s->last_keepalive_us;
+    /* A keepalive that raced the timer has already re-armed it */
+    bool expired = s->state == SESSION_STATE_LIVE && elapsed_us >= lease_deadline_us(s->lease_ms);
+    if (expired) {
+        s->state = SESSION_STATE_STALE;
+    }
+    bool controller = slot == s_controller;
+    uint32_t session_id = s->session_id;
+    uint16_t lease_ms = s->lease_ms;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (!expired) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "%s session expired: id=0x%08lx (elapsed=%lldms, lease=%ums)",
+             controller ? "Controller" : "Observer", (unsigned long)session_id,
+             (long long)(elapsed_us / 1000), lease_ms);
+    if (controller) {
+        notify(SESSION_STATE_LIVE, SESSION_STATE_STALE);
+    }
+}
+
+/* ===== Public API ===== */
 
 esp_err_t session_mgr_init(void)
 {
-    memset(&s_session, 0, sizeof(s_session));
-    s_session.state = SESSION_STATE_NONE;
-    ESP_LOGI(TAG, "Session manager initialized");
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < SESSION_MGR_MAX_SESSIONS; i++) {
+        free_locked(i);
+    }
+    s_controller = NO_CONTROLLER;
+    taskEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < SESSION_MGR_MAX_SESSIONS; i++) {
+        if (s_lease_timers[i] != NULL) {
+            continue;
+        }
+        const esp_timer_create_args_t args = {
+            .callback = lease_timer_cb,
+            .arg = (void *)(uintptr_t)i,
+            .name = "session_lease",
+        };
+        esp_err_t err = esp_timer_create(&args, &s_lease_timers[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create lease timer: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    ESP_LOGI(TAG, "Session manager initialized (%d sessions)", SESSION_MGR_MAX_SESSIONS);
     return ESP_OK;
 }
 
-esp_err_t session_mgr_open(uint32_t client_nonce, uint32_t *out_session_id, uint16_t *out_lease_ms)
+esp_err_t session_mgr_subscribe(session_mgr_cb_t cb, void *ctx)
+{
+    if (cb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_sub_count < SESSION_MGR_MAX_SUBSCRIBERS) {
+        s_subs[s_sub_count++] = (subscriber_t){ .cb = cb, .ctx = ctx };
+    } else {
+        err = ESP_ERR_NO_MEM;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return err;
+}
+
+esp_err_t session_mgr_open(uint16_t conn_handle, session_role_t role, uint32_t client_nonce,
+                           uint32_t *out_session_id, uint16_t *out_lease_ms)
 {
-    // Generate random session ID
-    uint32_t new_id;
-    do {
-        new_id = esp_random();
-    } while (new_id == 0);  // Avoid 0 as session ID
+    if (role != SESSION_ROLE_CONTROLLER && role != SESSION_ROLE_OBSERVER) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    s_session.session_id = new_id;
-    s_session.client_nonce = client_nonce;
-    s_session.lease_ms = SESSION_DEFAULT_LEASE_MS;
-    s_session.last_keepalive_us = esp_timer_get_time();
-    s_session.state = SESSION_STATE_LIVE;
+    uint32_t random = esp_random() & ~(uint32_t)SLOT_MASK;
+    esp_err_t err = ESP_OK;
+    int slot = -1;
+    uint16_t holder = SESSION_CONN_NONE;
+
+    taskENTER_CRITICAL(&s_lock);
+    session_state_t old_ctrl = controller_state_locked();
+
+    /* A LIVE controller on another connection is never displaced */
+    if (role == SESSION_ROLE_CONTROLLER && s_controller != NO_CONTROLLER &&
+        s_slots[s_controller].conn_handle != conn_handle &&
+        s_slots[s_controller].state == SESSION_STATE_LIVE) {
+        err = ESP_ERR_INVALID_STATE;
+        holder = s_slots[s_controller].conn_handle;
+    } else {
+        /* Re-open replaces this connection's session; a STALE controller is taken over */
+        for (int i = 0; i < SESSION_MGR_MAX_SESSIONS; i++) {
+            if (s_slots[i].state != SESSION_STATE_NONE &&
+                (s_slots[i].conn_handle == conn_handle ||
+                 (role == SESSION_ROLE_CONTROLLER && i == s_controller))) {
+                free_locked(i);
+            }
+        }
+
+        /* A free slot, else the first STALE observer's */
+        for (int i = 0; i < SESSION_MGR_MAX_SESSIONS && slot < 0; i++) {
+            if (s_slots[i].state == SESSION_STATE_NONE) {
+                slot = i;
+            }
+        }
+        for (int i = 0; i < SESSION_MGR_MAX_SESSIONS && slot < 0; i++) {
+            if (s_slots[i].state == SESSION_STATE_STALE && i != s_controller) {
+                slot = i;
+            }
+        }
+
+        if (slot < 0) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            session_info_t *s = &s_slots[slot];
+            // Slot in the low bits; never 0
+            s->session_id = (random != 0 || slot != 0) ? (random | (uint32_t)slot)
+                                                       : SESSION_MGR_MAX_SESSIONS;
+            s->client_nonce = client_nonce;
+            s->lease_ms = SESSION_DEFAULT_LEASE_MS;
+            s->conn_handle = conn_handle;
+            s->last_keepalive_us = esp_timer_get_time();
+            s->state = SESSION_STATE_LIVE;
+            s->role = role;
+            if (role == SESSION_ROLE_CONTROLLER) {
+                s_controller = slot;
+            }
+        }
+    }
+    session_state_t new_ctrl = controller_state_locked();
+    uint32_t new_id = slot >= 0 ? s_slots[slot].session_id : 0;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (err == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "OPEN_SESSION (controller) rejected: conn %u holds a live controller",
+                 holder);
+        return err;
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "OPEN_SESSION rejected: all %d sessions in use", SESSION_MGR_MAX_SESSIONS);
+        notify(old_ctrl, new_ctrl);
+        return err;
+    }
+
+    arm_lease_timer(slot);
 
     if (out_session_id) {
         *out_session_id = new_id;
     }
     if (out_lease_ms) {
-        *out_lease_ms = s_session.lease_ms;
+        *out_lease_ms = SESSION_DEFAULT_LEASE_MS;
     }
 
-    ESP_LOGI(TAG, "Session opened: id=0x%08lx nonce=0x%08lx lease=%ums",
-             (unsigned long)new_id, (unsigned long)client_nonce, s_session.lease_ms);
+    ESP_LOGI(TAG, "Session opened: id=0x%08lx role=%s conn=%u nonce=0x%08lx lease=%ums",
+             (unsigned long)new_id, role == SESSION_ROLE_CONTROLLER ? "controller" : "observer",
+             conn_handle, (unsigned long)client_nonce, SESSION_DEFAULT_LEASE_MS);
 
+    notify(old_ctrl, new_ctrl);
     return ESP_OK;
 }
 
 esp_err_t session_mgr_keepalive(uint32_t session_id)
 {
-    if (s_session.state == SESSION_STATE_NONE) {
-        ESP_LOGW(TAG, "KEEPALIVE rejected: no active session");
-        return ESP_ERR_INVALID_STATE;
+    taskENTER_CRITICAL(&s_lock);
+    session_info_t *s = find_locked(session_id);
+    session_state_t old_state = s ? s->state : SESSION_STATE_NONE;
+    bool controller = s != NULL && SLOT_OF(session_id) == (uint32_t)s_controller;
+    if (s != NULL) {
+        s->last_keepalive_us = esp_timer_get_time();
+        // Revive stale session on valid keepalive
+        s->state = SESSION_STATE_LIVE;
     }
+    taskEXIT_CRITICAL(&s_lock);
 
-    if (s_session.session_id != session_id) {
-        ESP_LOGW(TAG, "KEEPALIVE rejected: session mismatch (got 0x%08lx, expected 0x%08lx)",
-                 (unsigned long)session_id, (unsigned long)s_session.session_id);
+    if (s == NULL) {
+        ESP_LOGW(TAG, "KEEPALIVE rejected: no session 0x%08lx", (unsigned long)session_id);
         return ESP_ERR_INVALID_ARG;
     }
 
-    s_session.last_keepalive_us = esp_timer_get_time();
+    arm_lease_timer(SLOT_OF(session_id));
 
-    // Revive stale session on valid keepalive
-    if (s_session.state == SESSION_STATE_STALE) {
-        ESP_LOGI(TAG, "Session revived from STALE to LIVE");
-        s_session.state = SESSION_STATE_LIVE;
+    if (old_state == SESSION_STATE_STALE) {
+        ESP_LOGI(TAG, "Session 0x%08lx revived from STALE to LIVE", (unsigned long)session_id);
+    }
+    if (controller) {
+        notify(old_state, SESSION_STATE_LIVE);
     }
-
     return ESP_OK;
 }
 
 esp_err_t session_mgr_close(uint32_t session_id)
 {
-    if (s_session.state == SESSION_STATE_NONE) {
-        return ESP_ERR_INVALID_STATE;
+    taskENTER_CRITICAL(&s_lock);
+    session_state_t old_ctrl = controller_state_locked();
+    bool found = find_locked(session_id) != NULL;
+    if (found) {
+        free_locked(SLOT_OF(session_id));
     }
+    session_state_t new_ctrl = controller_state_locked();
+    taskEXIT_CRITICAL(&s_lock);
 
-    if (s_session.session_id != session_id) {
+    if (!found) {
         return ESP_ERR_INVALID_ARG;
     }
 
     ESP_LOGI(TAG, "Session closed: id=0x%08lx", (unsigned long)session_id);
-    memset(&s_session, 0, sizeof(s_session));
-    s_session.state = SESSION_STATE_NONE;
 
+    notify(old_ctrl, new_ctrl);
     return ESP_OK;
 }
 
 bool session_mgr_is_valid(uint32_t session_id)
 {
-    return (s_session.state == SESSION_STATE_LIVE &&
-            s_session.session_id == session_id);
+    taskENTER_CRITICAL(&s_lock);
+    session_info_t *s = find_locked(session_id);
+    bool valid = s != NULL && s->role == SESSION_ROLE_CONTROLLER && s->state == SESSION_STATE_LIVE;
+    taskEXIT_CRITICAL(&s_lock);
+    return valid;
+}
+
+session_role_t session_mgr_get_role(uint32_t session_id)
+{
+    taskENTER_CRITICAL(&s_lock);
+    session_info_t *s = find_locked(session_id);
+    session_role_t role = s ? s->role : SESSION_ROLE_NONE;
+    taskEXIT_CRITICAL(&s_lock);
+    return role;
+}
+
+bool session_mgr_has_controller(void)
+{
+    return s_controller != NO_CONTROLLER;
 }
 
 bool session_mgr_is_live(void)
 {
-    return (s_session.state == SESSION_STATE_LIVE);
+    return session_mgr_get_state() == SESSION_STATE_LIVE;
 }
 
 session_state_t session_mgr_get_state(void)
 {
-    return s_session.state;
+    taskENTER_CRITICAL(&s_lock);
+    session_state_t state = controller_state_locked();
+    taskEXIT_CRITICAL(&s_lock);
+    return state;
 }
 
 esp_err_t session_mgr_get_info(session_info_t *out_info)
@@ -107,42 +364,35 @@ esp_err_t session_mgr_get_info(session_info_t *out_info)
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (s_session.state == SESSION_STATE_NONE) {
-        return ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    bool found = s_controller != NO_CONTROLLER;
+    if (found) {
+        *out_info = s_slots[s_controller];
     }
+    taskEXIT_CRITICAL(&s_lock);
 
-    memcpy(out_info, &s_session, sizeof(session_info_t));
-    return ESP_OK;
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
-bool session_mgr_check_expiry(void)
+void session_mgr_drop_conn(uint16_t conn_handle)
 {
-    if (s_session.state != SESSION_STATE_LIVE) {
-        return false;
-    }
+    uint32_t dropped = 0;
 
-    int64_t now_us = esp_timer_get_time();
-    int64_t elapsed_us = now_us - s_session.last_keepalive_us;
-    int64_t lease_us = (int64_t)s_session.lease_ms * 1000;
-    int64_t grace_us = (int64_t)SESSION_GRACE_PERIOD_MS * 1000;
-
-    if (elapsed_us > (lease_us + grace_us)) {
-        ESP_LOGW(TAG, "Session expired: id=0x%08lx (elapsed=%lldms, lease=%ums)",
-                 (unsigned long)s_session.session_id,
-                 (long long)(elapsed_us / 1000),
-                 s_session.lease_ms);
-        s_session.state = SESSION_STATE_STALE;
-        return true;
+    taskENTER_CRITICAL(&s_lock);
+    session_state_t old_ctrl = controller_state_locked();
+    for (int i = 0; i < SESSION_MGR_MAX_SESSIONS; i++) {
+        if (s_slots[i].state != SESSION_STATE_NONE && s_slots[i].conn_handle == conn_handle) {
+            free_locked(i);
+            dropped |= 1u << i;
+        }
     }
+    session_state_t new_ctrl = controller_state_locked();
+    taskEXIT_CRITICAL(&s_lock);
 
-    return false;
-}
-
-void session_mgr_force_expire(void)
-{
-    if (s_session.state != SESSION_STATE_NONE) {
-        ESP_LOGW(TAG, "Session force-expired: id=0x%08lx", (unsigned long)s_session.session_id);
-        memset(&s_session, 0, sizeof(s_session));
-        s_session.state = SESSION_STATE_NONE;
+    for (int i = 0; i < SESSION_MGR_MAX_SESSIONS; i++) {
+        if (dropped & (1u << i)) {
+            ESP_LOGW(TAG, "Session force-expired: slot %d (conn %u disconnected)", i, conn_handle);
+        }
     }
+    notify(old_ctrl, new_ctrl);
 }
@@ -13,6 +13,9 @@ extern "C" {
  * ===================
  * Generates TELEMETRY_SNAPSHOT frames at 10Hz and sends them via BLE.
  * For initial testing, generates mock data.
+ *
+ * Clients that negotiate telemetry_ver 2 at OPEN_SESSION receive
+ * TELEMETRY_COMPACT frames instead (keyframes + deltas, see wire_compact.h).
  */
 
 #define TELEMETRY_INTERVAL_MS   100     // 10 Hz
@@ -84,6 +87,42 @@ uint32_t telemetry_get_alarm_bits(void);
  */
 uint16_t telemetry_get_di_bits(void);
 
+/* Compact encoding counters (since the last telemetry_set_version()) */
+typedef struct {
+    uint32_t frames;            /* TELEMETRY_COMPACT frames sent */
+    uint32_t keyframes;         /* ...of which were keyframes */
+    uint32_t fallbacks;         /* Ticks sent as TELEMETRY_SNAPSHOT (not representable) */
+    uint32_t bytes;             /* Compact payload bytes sent */
+    uint32_t snapshot_bytes;    /* Payload bytes the same frames take as TELEMETRY_SNAPSHOT */
+    uint32_t encode_cycles_max; /* Worst-case encode cost (CPU cycles) */
+} telemetry_stats_t;
+
+/**
+ * @brief Select the telemetry encoding for the current connection
+ *
+ * Called with the telemetry_ver accepted at OPEN_SESSION, and with
+ * WIRE_TELEMETRY_VER_SNAPSHOT on disconnect. Resets the compact encoder
+ * (the next compact frame is a keyframe) and the statistics.
+ *
+ * @param version WIRE_TELEMETRY_VER_SNAPSHOT or WIRE_TELEMETRY_VER_COMPACT
+ */
+void telemetry_set_version(uint8_t version);
+
+/**
+ * @brief Get the active telemetry encoding
+ */
+uint8_t telemetry_get_version(void);
+
+/**
+ * @brief Make the next compact frame a keyframe (REQUEST_SNAPSHOT_NOW)
+ */
+void telemetry_request_keyframe(void);
+
+/**
+ * @brief Get compact encoding statistics
+ */
+void telemetry_get_stats(telemetry_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,12 +1,17 @@
 #include "telemetry.h"
 #include "wire_protocol.h"
+#include "wire_compact.h"
 #include "ble_gatt.h"
 #include "session_mgr.h"
 #include "pid_controller.h"
 #include "safety_gate.h"
+#include "relay_ctrl.h"
 
+#include <string.h>
+#include "esp_cpu.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -28,6 +33,19 @@ static bool s_use_real_pid = false;
 /* Use machine state in telemetry when available */
 static bool s_use_machine_state = false;
 
+/* Lease lapsed and not yet revived (written from session_mgr callbacks) */
+static volatile bool s_hmi_stale = false;
+static bool s_session_subscribed = false;
+
+/* Negotiated encoding (written from the BLE command task) */
+static volatile uint8_t s_version = WIRE_TELEMETRY_VER_SNAPSHOT;
+static volatile bool s_version_changed = false;
+static volatile bool s_key_requested = false;
+
+/* Compact encoder state - owned by the telemetry task */
+static wire_compact_enc_t s_enc;
+static telemetry_stats_t s_stats;
+
 /* Forward declaration for machine state integration */
 /* These are weak symbols that will resolve to actual functions when machine_state is linked */
 __attribute__((weak)) void machine_state_get_run_info(void *out_info) {
@@ -110,43 +128,110 @@ static void update_pid_alarm_bits(void)
     }
 }
 
+/* Relay readback mismatch stays set until CLEAR_LATCHED_ALARMS */
+static void update_relay_alarm_bits(void)
+{
+    relay_ctrl_reconcile_stats_t recon;
+    relay_ctrl_get_reconcile_stats(&recon);
+
+    if (recon.latched) {
+        s_alarm_bits |= ALARM_BIT_RELAY_MISMATCH;
+    } else {
+        s_alarm_bits &= ~ALARM_BIT_RELAY_MISMATCH;
+    }
+}
+
 /* Update alarm bits for safety gate status (probe errors, gate bypasses) */
 static void update_safety_gate_alarm_bits(void)
 {
-    /* Clear safety gate alarm bits first */
-    s_alarm_bits &= ~(ALARM_BIT_GATE_DOOR_BYPASSED |
-                      ALARM_BIT_GATE_HMI_BYPASSED |
-                      ALARM_BIT_GATE_PID_BYPASSED |
-                      ALARM_BIT_PID1_PROBE_ERROR |
-                      ALARM_BIT_PID2_PROBE_ERROR |
-                      ALARM_BIT_PID3_PROBE_ERROR);
-
-    /* Check gate bypass status */
-    if (!safety_gate_is_enabled(GATE_DOOR_CLOSED)) {
-        s_alarm_bits |= ALARM_BIT_GATE_DOOR_BYPASSED;
+    /* Bypass and probe-error alarms come straight from the gate rules */
+    s_alarm_bits = (s_alarm_bits & ~SAFETY_GATE_ALARM_MASK) | safety_gate_get_alarm_bits();
+}
+
+/*
+ * esp_timer task (expiry) or BLE tasks (open, keepalive, disconnect).
+ * HMI_NOT_LIVE is set when a lease lapses and cleared when a session is
+ * live again; a disconnect leaves it as it was.
+ */
+static void on_session_state(session_state_t old_state, session_state_t new_state, void *ctx)
+{
+    (void)ctx;
+
+    if (new_state == SESSION_STATE_STALE) {
+        s_hmi_stale = true;
+        ESP_LOGW(TAG, "Session expired - HMI_NOT_LIVE set");
+    } else if (new_state == SESSION_STATE_LIVE) {
+        s_hmi_stale = false;
     }
-    if (!safety_gate_is_enabled(GATE_HMI_LIVE)) {
-        s_alarm_bits |= ALARM_BIT_GATE_HMI_BYPASSED;
+}
+
+static void log_compact_stats(void)
+{
+    if (s_stats.frames == 0) {
+        return;
     }
-    if (!safety_gate_is_enabled(GATE_PID1_ONLINE) ||
-        !safety_gate_is_enabled(GATE_PID2_ONLINE) ||
-        !safety_gate_is_enabled(GATE_PID3_ONLINE) ||
-        !safety_gate_is_enabled(GATE_PID1_NO_PROBE_ERR) ||
-        !safety_gate_is_enabled(GATE_PID2_NO_PROBE_ERR) ||
-        !safety_gate_is_enabled(GATE_PID3_NO_PROBE_ERR)) {
-        s_alarm_bits |= ALARM_BIT_GATE_PID_BYPASSED;
+    ESP_LOGI(TAG, "Compact telemetry: %lu frames (%lu key, %lu fallback), %lu bytes vs %lu "
+             "snapshot bytes, encode max %lu cycles",
+             (unsigned long)s_stats.frames, (unsigned long)s_stats.keyframes,
+             (unsigned long)s_stats.fallbacks, (unsigned long)s_stats.bytes,
+             (unsigned long)s_stats.snapshot_bytes, (unsigned long)s_stats.encode_cycles_max);
+}
+
+/*
+ * Send one sample in the negotiated encoding. Any tick that does not reach
+ * every subscribed client forces the next compact frame to be a keyframe.
+ */
+static void send_sample(const wire_telemetry_sample_t *sample)
+{
+    uint8_t payload[WIRE_COMPACT_MAX_PAYLOAD];
+    size_t payload_len = 0;
+    bool is_key = false;
+
+    if (s_version == WIRE_TELEMETRY_VER_COMPACT) {
+        if (s_key_requested) {
+            s_key_requested = false;
+            wire_compact_enc_force_key(&s_enc);
+        }
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        payload_len = wire_compact_encode(&s_enc, sample, payload, sizeof(payload), &is_key);
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+        if (cycles > s_stats.encode_cycles_max) {
+            s_stats.encode_cycles_max = cycles;
+        }
+        if (payload_len == 0) {
+            s_stats.fallbacks++;
+        }
     }
 
-    /* Check probe error status */
-    uint8_t probe_errors = safety_gate_get_probe_error_flags();
-    if (probe_errors & (1 << 0)) {
-        s_alarm_bits |= ALARM_BIT_PID1_PROBE_ERROR;
+    /* Build straight into the outgoing mbuf (no flat frame copy) */
+    wire_writer_t w;
+    esp_err_t err = ble_gatt_frame_begin(&w);
+    if (err == ESP_OK) {
+        if (payload_len > 0) {
+            wire_write_frame(&w, MSG_TYPE_TELEMETRY_COMPACT, s_tx_seq++,
+                             payload, (uint16_t)payload_len);
+        } else {
+            wire_write_telemetry(&w, s_tx_seq++, sample->timestamp_ms,
+                                 sample->di_bits, sample->ro_bits, sample->alarm_bits,
+                                 sample->controllers, sample->controller_count,
+                                 sample->has_run_state ? &sample->run_state : NULL);
+        }
+        err = ble_gatt_frame_send_telemetry(&w);
     }
-    if (probe_errors & (1 << 1)) {
-        s_alarm_bits |= ALARM_BIT_PID2_PROBE_ERROR;
+
+    if (err != ESP_OK) {
+        /* Partly delivered (ESP_ERR_NOT_FINISHED) too: a client that missed
+         * this frame cannot apply the next delta. ble_gatt logged which. */
+        wire_compact_enc_force_key(&s_enc);
+        if (err != ESP_ERR_INVALID_STATE && err != ESP_ERR_NOT_FINISHED) {
+            ESP_LOGW(TAG, "Failed to send telemetry: %s", esp_err_to_name(err));
+        }
     }
-    if (probe_errors & (1 << 2)) {
-        s_alarm_bits |= ALARM_BIT_PID3_PROBE_ERROR;
+    if ((err == ESP_OK || err == ESP_ERR_NOT_FINISHED) && payload_len > 0) {
+        s_stats.frames++;
+        s_stats.keyframes += is_key ? 1 : 0;
+        s_stats.bytes += payload_len;
+        s_stats.snapshot_bytes += wire_compact_snapshot_size(sample);
     }
 }
 
@@ -154,23 +239,17 @@ static void telemetry_task(void *arg)
 {
     (void)arg;
 
-    uint8_t frame[WIRE_MAX_FRAME_SIZE];
-    wire_controller_data_t controllers[3];
+    wire_telemetry_sample_t sample;
     TickType_t last_wake = xTaskGetTickCount();
 
     ESP_LOGI(TAG, "Telemetry task started (real_pid=%d, machine_state=%d)",
              s_use_real_pid, s_use_machine_state);
 
     while (s_running) {
-        /* Check session expiry */
-        if (session_mgr_check_expiry()) {
-            /* Session became stale - set HMI_NOT_LIVE alarm */
+        /* HMI_NOT_LIVE follows session_mgr's lease timer, see on_session_state() */
+        if (s_hmi_stale) {
             s_alarm_bits |= ALARM_BIT_HMI_NOT_LIVE;
-            ESP_LOGW(TAG, "Session expired - HMI_NOT_LIVE set");
-        }
-
-        /* Clear HMI_NOT_LIVE if session is live */
-        if (session_mgr_is_live()) {
+        } else {
             s_alarm_bits &= ~ALARM_BIT_HMI_NOT_LIVE;
         }
 
@@ -180,20 +259,32 @@ static void telemetry_task(void *arg)
         /* Update safety gate alarm bits (probe errors, gate bypasses) */
         update_safety_gate_alarm_bits();
 
+        /* Relay outputs found differing from what was written */
+        update_relay_alarm_bits();
+
+        /* Pick up an encoding change from OPEN_SESSION / disconnect */
+        if (s_version_changed) {
+            s_version_changed = false;
+            log_compact_stats();
+            memset(&s_stats, 0, sizeof(s_stats));
+            wire_compact_enc_init(&s_enc, CONFIG_TELEMETRY_COMPACT_KEYFRAME_INTERVAL);
+        }
+
         /* Only send telemetry if connected and subscribed */
         if (ble_gatt_is_connected() && ble_gatt_telemetry_subscribed()) {
+            memset(&sample, 0, sizeof(sample));
+
             /* Get timestamp in milliseconds */
-            uint32_t timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            sample.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            sample.di_bits = s_di_bits;
+            sample.ro_bits = s_ro_bits;
+            sample.alarm_bits = s_alarm_bits;
 
             /* Get controller data */
-            uint8_t controller_count = build_controller_data(controllers, 3);
-
-            size_t frame_len;
+            sample.controller_count = build_controller_data(sample.controllers,
+                                                            WIRE_COMPACT_MAX_CONTROLLERS);
 
             if (s_use_machine_state) {
-                /* Build extended telemetry with machine state */
-                wire_telemetry_run_state_t run_state = {0};
-
                 /* Get machine state info - use the actual struct type */
                 /* We cast to void* because the weak symbol doesn't know the type */
                 typedef struct {
@@ -204,51 +295,30 @@ static void telemetry_task(void *arg)
                     int16_t  target_temp_x10;
                     uint8_t  recipe_step;
                     uint8_t  interlock_bits;
+                    uint8_t  precool_eta;
                 } machine_run_info_internal_t;
 
                 machine_run_info_internal_t info = {0};
                 machine_state_get_run_info(&info);
 
-                run_state.machine_state = info.state;
-                run_state.run_elapsed_ms = info.run_elapsed_ms;
-                run_state.run_remaining_ms = info.run_remaining_ms;
-                run_state.target_temp_x10 = info.target_temp_x10;
-                run_state.recipe_step = info.recipe_step;
-                run_state.interlock_bits = info.interlock_bits;
-                run_state.lazy_poll_active = pid_controller_is_lazy_polling() ? 1 : 0;
-                run_state.idle_timeout_min = pid_controller_get_idle_timeout();
-
-                frame_len = wire_build_telemetry_ext(
-                    frame, sizeof(frame),
-                    s_tx_seq++,
-                    timestamp_ms,
-                    s_di_bits,
-                    s_ro_bits,
-                    s_alarm_bits,
-                    controllers,
-                    controller_count,
-                    &run_state
-                );
-            } else {
-                /* Build basic telemetry */
-                frame_len = wire_build_telemetry(
-                    frame, sizeof(frame),
-                    s_tx_seq++,
-                    timestamp_ms,
-                    s_di_bits,
-                    s_ro_bits,
-                    s_alarm_bits,
-                    controllers,
-                    controller_count
-                );
+                wire_telemetry_run_state_t *run_state = &sample.run_state;
+                run_state->machine_state = info.state;
+                run_state->run_elapsed_ms = info.run_elapsed_ms;
+                run_state->run_remaining_ms = info.run_remaining_ms;
+                run_state->target_temp_x10 = info.target_temp_x10;
+                run_state->recipe_step = info.recipe_step;
+                run_state->interlock_bits = info.interlock_bits;
+                run_state->precool_eta = info.precool_eta;
+                run_state->lazy_poll_active = pid_controller_is_lazy_polling() ? 1 : 0;
+                run_state->idle_timeout_min = pid_controller_get_idle_timeout();
+
+                sample.has_run_state = true;
             }
 
-            if (frame_len > 0) {
-                esp_err_t err = ble_gatt_send_telemetry(frame, frame_len);
-                if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
-                    ESP_LOGW(TAG, "Failed to send telemetry: %s", esp_err_to_name(err));
-                }
-            }
+            send_sample(&sample);
+        } else {
+            /* Client missed this tick - resume with a keyframe */
+            wire_compact_enc_force_key(&s_enc);
         }
 
         /* Sleep until next interval */
@@ -267,8 +337,13 @@ esp_err_t telemetry_init(void)
         return ESP_ERR_INVALID_STATE;
     }
 
+    if (!s_session_subscribed) {
+        s_session_subscribed = session_mgr_subscribe(on_session_state, NULL) == ESP_OK;
+    }
+
     s_running = true;
     s_tx_seq = 0;
+    wire_compact_enc_init(&s_enc, CONFIG_TELEMETRY_COMPACT_KEYFRAME_INTERVAL);
 
     BaseType_t ok = xTaskCreatePinnedToCore(
         telemetry_task,
@@ -337,3 +412,31 @@ void telemetry_use_machine_state(bool enable)
     s_use_machine_state = enable;
     ESP_LOGI(TAG, "Machine state in telemetry: %s", enable ? "enabled" : "disabled");
 }
+
+void telemetry_set_version(uint8_t version)
+{
+    if (version != WIRE_TELEMETRY_VER_COMPACT) {
+        version = WIRE_TELEMETRY_VER_SNAPSHOT;
+    }
+    s_version = version;
+    s_version_changed = true;
+    ESP_LOGI(TAG, "Telemetry encoding: %s",
+             version == WIRE_TELEMETRY_VER_COMPACT ? "compact (v2)" : "snapshot (v1)");
+}
+
+uint8_t telemetry_get_version(void)
+{
+    return s_version;
+}
+
+void telemetry_request_keyframe(void)
+{
+    s_key_requested = true;
+}
+
+void telemetry_get_stats(telemetry_stats_t *out)
+{
+    if (out) {
+        *out = s_stats;
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Deferred binary trace log
+ *
+ * Hot-path log sites store a format ID plus up to TRACE_LOG_MAX_ARGS raw
+ * 32-bit arguments into a per-core ring buffer. No string formatting or
+ * UART I/O happens at the call site. A low-priority drain task formats the
+ * records later and hands them to the regular ESP-IDF logger, so console
+ * output looks the same as before (with the original capture timestamp).
+ *
+ * Verbosity is selectable at runtime per module. Records below the module
+ * level cost a single table lookup and compare.
+ *
+ * Usage:
+ *   TRACE_LOGI(TRACE_FMT_BLE_CMD_RX, len, cmd_id, seq, payload_len);
+ *
+ * Format strings live in trace_log_fmt.h and may only use 32-bit integer
+ * conversions (%u, %d, %X, %02X, %08X, ...). Temperatures are logged
+ * as ×10 integers instead of floats.
+ */
+
+/* Maximum raw arguments per record */
+#define TRACE_LOG_MAX_ARGS      6
+
+/* Trace modules (each has its own runtime verbosity) */
+typedef enum {
+    TRACE_MOD_BLE           = 0,    /* ble_gatt command/ACK path */
+    TRACE_MOD_PID           = 1,    /* pid_controller polling */
+    TRACE_MOD_STATE         = 2,    /* machine_state */
+    TRACE_MOD_RELAY         = 3,    /* relay_ctrl */
+    TRACE_MOD_TELEMETRY     = 4,    /* telemetry */
+    TRACE_MOD_MAX
+} trace_module_t;
+
+#include "trace_log_fmt.h"
+
+/* Format IDs, generated from TRACE_FMT_LIST */
+typedef enum {
+#define TRACE_FMT_ENUM(id, mod, fmt) id,
+    TRACE_FMT_LIST(TRACE_FMT_ENUM)
+#undef TRACE_FMT_ENUM
+    TRACE_FMT_MAX
+} trace_fmt_id_t;
+
+/* Per-site cost statistics (CPU cycles) */
+typedef struct {
+    uint32_t count;             /* Records captured at this site */
+    uint32_t record_cycles_avg; /* Average hot-path cost of trace_log_record() */
+    uint32_t record_cycles_max; /* Worst-case hot-path cost */
+    uint32_t format_cycles_avg; /* Average deferred format + console cost */
+} trace_log_site_stats_t;
+
+/* Global statistics */
+typedef struct {
+    uint32_t recorded;          /* Records captured (all cores) */
+    uint32_t drained;           /* Records formatted by the drain task */
+    uint32_t dropped;           /* Records overwritten before drain */
+} trace_log_stats_t;
+
+/* Runtime state used by the inline level check (do not write directly) */
+extern uint8_t trace_log_module_level[TRACE_MOD_MAX];
+extern const uint8_t trace_log_fmt_module[TRACE_FMT_MAX];
+
+/**
+ * @brief Check whether a format ID is enabled at the given level
+ */
+static inline bool trace_log_enabled(esp_log_level_t level, trace_fmt_id_t id)
+{
+    return (uint8_t)level <= trace_log_module_level[trace_log_fmt_module[id]];
+}
+
+/**
+ * @brief Capture one record (use the TRACE_LOGx macros instead)
+ *
+ * Safe to call from any task on either core, before or after
+ * trace_log_init(). Never blocks. Not ISR-safe.
+ */
+void trace_log_record(esp_log_level_t level, trace_fmt_id_t id,
+                      const uint32_t args[TRACE_LOG_MAX_ARGS]);
+
+#define TRACE_LOG(level, id, ...) do { \
+        if (trace_log_enabled((level), (id))) { \
+            trace_log_record((level), (id), \
+                (const uint32_t[TRACE_LOG_MAX_ARGS]){ __VA_ARGS__ }); \
+        } \
+    } while (0)
+
+#define TRACE_LOGE(id, ...) TRACE_LOG(ESP_LOG_ERROR,   id, __VA_ARGS__)
+#define TRACE_LOGW(id, ...) TRACE_LOG(ESP_LOG_WARN,    id, __VA_ARGS__)
+#define TRACE_LOGI(id, ...) TRACE_LOG(ESP_LOG_INFO,    id, __VA_ARGS__)
+#define TRACE_LOGD(id, ...) TRACE_LOG(ESP_LOG_DEBUG,   id, __VA_ARGS__)
+#define TRACE_LOGV(id, ...) TRACE_LOG(ESP_LOG_VERBOSE, id, __VA_ARGS__)
+
+/**
+ * @brief Pack up to 4 bytes big-endian so "%08X" prints them in wire order
+ *
+ * Used for raw frame dumps (replacement for ESP_LOG_BUFFER_HEX).
+ */
+uint32_t trace_log_pack_bytes(const uint8_t *data, size_t len, size_t offset);
+
+/**
+ * @brief Initialize trace log and start the drain task
+ *
+ * Records captured before init are kept and drained once the task starts.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t trace_log_init(void);
+
+/**
+ * @brief Set runtime verbosity for a module
+ *
+ * @param module Trace module
+ * @param level  ESP_LOG_NONE..ESP_LOG_VERBOSE
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for unknown module/level
+ */
+esp_err_t trace_log_set_level(trace_module_t module, esp_log_level_t level);
+
+/**
+ * @brief Get runtime verbosity for a module
+ */
+esp_log_level_t trace_log_get_level(trace_module_t module);
+
+/**
+ * @brief Get global trace statistics
+ */
+void trace_log_get_stats(trace_log_stats_t *out_stats);
+
+/**
+ * @brief Get measured cost for one log site
+ *
+ * record_cycles_* is what the call site pays now; format_cycles_avg is
+ * what the same site used to pay inline with ESP_LOGx (measured on the
+ * drain task, which does the identical formatting work).
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for unknown format ID
+ */
+esp_err_t trace_log_get_site_stats(trace_fmt_id_t id, trace_log_site_stats_t *out_stats);
+
+/**
+ * @brief Get the module name (same string as the component's log TAG)
+ */
+const char *trace_log_module_name(trace_module_t module);
+
+#ifdef __cplusplus
+}
+#endif
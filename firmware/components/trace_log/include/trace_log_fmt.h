@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+ * Trace format table
+ * ==================
+ *
+ * X(id, module, format)
+ *
+ * Format IDs are stable wire values for host-side decoding: append new
+ * entries at the end of the list and never reorder or reuse IDs.
+ * Only 32-bit integer conversions are allowed (no %f, %s, %ll).
+ */
+#define TRACE_FMT_LIST(X) \
+    X(TRACE_FMT_BLE_CMD_RX,        TRACE_MOD_BLE, \
+      "Command rx: len=%u cmd_id=0x%04X seq=%u payload_len=%u") \
+    X(TRACE_FMT_BLE_FRAME_HEX,     TRACE_MOD_BLE, \
+      "  %08X %08X %08X %08X %08X %08X") \
+    X(TRACE_FMT_BLE_FRAME_INVALID, TRACE_MOD_BLE, \
+      "Invalid frame (len=%u)") \
+    X(TRACE_FMT_BLE_BAD_MSG_TYPE,  TRACE_MOD_BLE, \
+      "Unexpected msg_type: 0x%02X") \
+    X(TRACE_FMT_BLE_CMD_SHORT,     TRACE_MOD_BLE, \
+      "Command payload too short (payload_len=%u)") \
+    X(TRACE_FMT_BLE_ACK_TX,        TRACE_MOD_BLE, \
+      "ACK tx: acked_seq=%u cmd_id=0x%04X status=%u len=%u indicate=%u rc=%d") \
+    X(TRACE_FMT_BLE_ACK_NO_CONN,   TRACE_MOD_BLE, \
+      "send_ack: no connection (acked_seq=%u cmd_id=0x%04X)") \
+    X(TRACE_FMT_BLE_ACK_FAIL,      TRACE_MOD_BLE, \
+      "Failed to send ACK: cmd_id=0x%04X rc=%d (6=not subscribed, 14=no resources)") \
+    X(TRACE_FMT_PID_POLL,          TRACE_MOD_PID, \
+      "[%u] PV=%d SV=%d OUT=%d (x10) ST=0x%04X MODE=%u") \
+    X(TRACE_FMT_BLE_CMD_REPLAY,    TRACE_MOD_BLE, \
+      "Duplicate command seq=%u cmd_id=0x%04X: replaying ACK status=%u") \
+    X(TRACE_FMT_BLE_CMD_BUSY,      TRACE_MOD_BLE, \
+      "Command window full: seq=%u cmd_id=0x%04X rejected BUSY (window=%u)") \
+    X(TRACE_FMT_BLE_CMD_STALE,     TRACE_MOD_BLE, \
+      "Dropped command from previous connection (len=%u)") \
+    X(TRACE_FMT_BLE_CMD_PENDING,   TRACE_MOD_BLE, \
+      "Duplicate command seq=%u cmd_id=0x%04X: still executing, dropped") \
+    X(TRACE_FMT_BLE_ACK_STALE,     TRACE_MOD_BLE, \
+      "Deferred ACK dropped: connection gone (acked_seq=%u cmd_id=0x%04X)") \
+    X(TRACE_FMT_STATE_SEQ_STEP,    TRACE_MOD_STATE, \
+      "Relay seq %u step %u/%u: ro=0x%02X at %u us (+%u us from seq start)") \
+    X(TRACE_FMT_BLE_OPEN_SESSION,  TRACE_MOD_BLE, \
+      "OPEN_SESSION OK: session=0x%08X role=%u lease=%ums telemetry_ver=%u") \
+    X(TRACE_FMT_BLE_START_RUN,     TRACE_MOD_BLE, \
+      "START_RUN: session=0x%08X mode=%u target=%d (x10) duration=%ums recipe=%u") \
+    X(TRACE_FMT_BLE_STATE_CMD,     TRACE_MOD_BLE, \
+      "State command 0x%04X: session=0x%08X mode=%u") \
+    X(TRACE_FMT_BLE_SET_RELAY,     TRACE_MOD_BLE, \
+      "SET_RELAY OK: relay %u state=%u (ro_bits=0x%02X)") \
+    X(TRACE_FMT_BLE_SET_RELAY_MASK, TRACE_MOD_BLE, \
+      "SET_RELAY_MASK OK: ro_bits 0x%02X -> 0x%02X (mask=0x%02X values=0x%02X)") \
+    X(TRACE_FMT_BLE_SET_SV,        TRACE_MOD_BLE, \
+      "SET_SV: controller=%u sv=%d (x10)") \
+    X(TRACE_FMT_BLE_SET_MODE,      TRACE_MOD_BLE, \
+      "SET_MODE: controller=%u mode=%u") \
+    X(TRACE_FMT_BLE_SET_PID_PARAMS, TRACE_MOD_BLE, \
+      "SET_PID_PARAMS: controller=%u P=%d (x10) I=%u D=%u") \
+    X(TRACE_FMT_BLE_SET_ALARMS,    TRACE_MOD_BLE, \
+      "SET_ALARM_LIMITS: controller=%u AL1=%d AL2=%d (x10)") \
+    X(TRACE_FMT_BLE_WRITE_REG,     TRACE_MOD_BLE, \
+      "WRITE_REGISTER: controller=%u addr=%u value=0x%04X") \
+    X(TRACE_FMT_BLE_SET_CAPABILITY, TRACE_MOD_BLE, \
+      "SET_CAPABILITY: subsys=%u cap=%u") \
+    X(TRACE_FMT_BLE_SET_GATE,      TRACE_MOD_BLE, \
+      "SET_SAFETY_GATE: gate=%u enabled=%u")
@@ -0,0 +1,290 @@
+#include "trace_log.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "trace_log";
+
+#define RING_ENTRIES        CONFIG_TRACE_LOG_RING_ENTRIES
+#define RING_MASK           (RING_ENTRIES - 1)
+
+_Static_assert((RING_ENTRIES & RING_MASK) == 0,
+               "CONFIG_TRACE_LOG_RING_ENTRIES must be a power of two");
+_Static_assert(TRACE_FMT_MAX <= 256, "trace format IDs must fit in a byte");
+
+/* Drain task configuration */
+#define DRAIN_TASK_STACK    3072
+#define DRAIN_LINE_MAX      160
+
+/*
+ * One binary record. seq is written last (release) and holds index + 1
+ * of the slot's current occupant; 0 means a writer is mid-update.
+ */
+typedef struct {
+    _Atomic uint32_t seq;
+    uint32_t timestamp_ms;
+    uint8_t  fmt_id;
+    uint8_t  level;
+    uint8_t  core;
+    uint8_t  reserved;
+    uint32_t args[TRACE_LOG_MAX_ARGS];
+} trace_record_t;
+
+/* Per-core ring. head is shared by producers; tail is owned by the drain task. */
+typedef struct {
+    _Atomic uint32_t head;
+    uint32_t tail;
+    trace_record_t records[RING_ENTRIES];
+} trace_ring_t;
+
+/* Per-site cost accounting (approximate under cross-core contention) */
+typedef struct {
+    uint32_t count;
+    uint64_t record_cycles_sum;
+    uint32_t record_cycles_max;
+    uint32_t format_count;
+    uint64_t format_cycles_sum;
+} trace_site_t;
+
+static trace_ring_t s_rings[portNUM_PROCESSORS];
+static trace_site_t s_sites[TRACE_FMT_MAX];
+static _Atomic uint32_t s_recorded = 0;
+static uint32_t s_drained = 0;
+static uint32_t s_dropped = 0;
+static TaskHandle_t s_drain_task = NULL;
+
+uint8_t trace_log_module_level[TRACE_MOD_MAX] = {
+    [0 ... TRACE_MOD_MAX - 1] = CONFIG_TRACE_LOG_DEFAULT_LEVEL,
+};
+
+const uint8_t trace_log_fmt_module[TRACE_FMT_MAX] = {
+#define TRACE_FMT_MOD(id, mod, fmt) [id] = mod,
+    TRACE_FMT_LIST(TRACE_FMT_MOD)
+#undef TRACE_FMT_MOD
+};
+
+static const char *const s_fmt_strings[TRACE_FMT_MAX] = {
+#define TRACE_FMT_STR(id, mod, fmt) [id] = fmt,
+    TRACE_FMT_LIST(TRACE_FMT_STR)
+#undef TRACE_FMT_STR
+};
+
+/* Module names match the owning component's log TAG */
+static const char *const s_module_names[TRACE_MOD_MAX] = {
+    [TRACE_MOD_BLE]       = "ble_gatt",
+    [TRACE_MOD_PID]       = "pid_ctrl",
+    [TRACE_MOD_STATE]     = "machine_state",
+    [TRACE_MOD_RELAY]     = "relay_ctrl",
+    [TRACE_MOD_TELEMETRY] = "telemetry",
+};
+
+/* ===== Hot path ===== */
+
+void trace_log_record(esp_log_level_t level, trace_fmt_id_t id,
+                      const uint32_t args[TRACE_LOG_MAX_ARGS])
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    int core = esp_cpu_get_core_id();
+    trace_ring_t *ring = &s_rings[core];
+
+    /* Reserve a slot. fetch_add keeps this correct even if the task
+     * migrates cores between reading core_id and reserving. */
+    uint32_t idx = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    trace_record_t *rec = &ring->records[idx & RING_MASK];
+
+    atomic_store_explicit(&rec->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    rec->timestamp_ms = esp_log_timestamp();
+    rec->fmt_id = (uint8_t)id;
+    rec->level = (uint8_t)level;
+    rec->core = (uint8_t)core;
+    memcpy(rec->args, args, sizeof(rec->args));
+
+    atomic_store_explicit(&rec->seq, idx + 1, memory_order_release);
+    atomic_fetch_add_explicit(&s_recorded, 1, memory_order_relaxed);
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    trace_site_t *site = &s_sites[id];
+    site->count++;
+    site->record_cycles_sum += cycles;
+    if (cycles > site->record_cycles_max) {
+        site->record_cycles_max = cycles;
+    }
+}
+
+uint32_t trace_log_pack_bytes(const uint8_t *data, size_t len, size_t offset)
+{
+    uint32_t packed = 0;
+    for (size_t i = 0; i < 4; i++) {
+        packed <<= 8;
+        if (offset + i < len) {
+            packed |= data[offset + i];
+        }
+    }
+    return packed;
+}
+
+/* ===== Drain task ===== */
+
+static void format_record(const trace_record_t *rec)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    const char *tag = s_module_names[trace_log_fmt_module[rec->fmt_id]];
+    char line[DRAIN_LINE_MAX];
+
+    /* All trace formats use int-sized conversions; int is 32-bit here */
+    snprintf(line, sizeof(line), s_fmt_strings[rec->fmt_id],
+             (unsigned)rec->args[0], (unsigned)rec->args[1],
+             (unsigned)rec->args[2], (unsigned)rec->args[3],
+             (unsigned)rec->args[4], (unsigned)rec->args[5]);
+
+    ESP_LOG_LEVEL((esp_log_level_t)rec->level, tag, "[@%lu c%u] %s",
+                  (unsigned long)rec->timestamp_ms, rec->core, line);
+
+    trace_site_t *site = &s_sites[rec->fmt_id];
+    site->format_count++;
+    site->format_cycles_sum += esp_cpu_get_cycle_count() - start;
+}
+
+static void drain_ring(trace_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (ring->tail != head) {
+        /* Writers lapped us - skip to the oldest record still in the ring */
+        if (head - ring->tail > RING_ENTRIES) {
+            s_dropped += head - ring->tail - RING_ENTRIES;
+            ring->tail = head - RING_ENTRIES;
+        }
+
+        trace_record_t *slot = &ring->records[ring->tail & RING_MASK];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+        if (seq == 0 || seq < ring->tail + 1) {
+            /* Writer still filling this slot - retry next period */
+            break;
+        }
+        if (seq != ring->tail + 1) {
+            /* Slot already reused by a newer record */
+            s_dropped++;
+            ring->tail++;
+            continue;
+        }
+
+        trace_record_t copy;
+        memcpy(&copy.timestamp_ms, &slot->timestamp_ms,
+               sizeof(copy) - offsetof(trace_record_t, timestamp_ms));
+
+        /* Re-check: the slot may have been overwritten during the copy */
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+            s_dropped++;
+            ring->tail++;
+            continue;
+        }
+
+        ring->tail++;
+        if (copy.fmt_id < TRACE_FMT_MAX) {
+            format_record(&copy);
+            s_drained++;
+        }
+    }
+}
+
+static void drain_task(void *arg)
+{
+    (void)arg;
+    ESP_LOGI(TAG, "Drain task started (%d entries/core, %dms period)",
+             RING_ENTRIES, CONFIG_TRACE_LOG_DRAIN_PERIOD_MS);
+
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_TRACE_LOG_DRAIN_PERIOD_MS));
+
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            drain_ring(&s_rings[i]);
+        }
+    }
+}
+
+/* ===== Public API ===== */
+
+esp_err_t trace_log_init(void)
+{
+    if (s_drain_task != NULL) {
+        return ESP_OK;
+    }
+
+    BaseType_t ret = xTaskCreate(drain_task, "trace_drain", DRAIN_TASK_STACK,
+                                 NULL, CONFIG_TRACE_LOG_DRAIN_TASK_PRIORITY,
+                                 &s_drain_task);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create drain task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Trace log initialized: %d formats, default level %d",
+             TRACE_FMT_MAX, CONFIG_TRACE_LOG_DEFAULT_LEVEL);
+    return ESP_OK;
+}
+
+esp_err_t trace_log_set_level(trace_module_t module, esp_log_level_t level)
+{
+    if (module >= TRACE_MOD_MAX || level > ESP_LOG_VERBOSE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    trace_log_module_level[module] = (uint8_t)level;
+    ESP_LOGI(TAG, "Module %s trace level -> %d", s_module_names[module], level);
+    return ESP_OK;
+}
+
+esp_log_level_t trace_log_get_level(trace_module_t module)
+{
+    if (module >= TRACE_MOD_MAX) {
+        return ESP_LOG_NONE;
+    }
+    return (esp_log_level_t)trace_log_module_level[module];
+}
+
+void trace_log_get_stats(trace_log_stats_t *out_stats)
+{
+    if (out_stats == NULL) {
+        return;
+    }
+    out_stats->recorded = atomic_load_explicit(&s_recorded, memory_order_relaxed);
+    out_stats->drained = s_drained;
+    out_stats->dropped = s_dropped;
+}
+
+esp_err_t trace_log_get_site_stats(trace_fmt_id_t id, trace_log_site_stats_t *out_stats)
+{
+    if (id >= TRACE_FMT_MAX || out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const trace_site_t *site = &s_sites[id];
+    out_stats->count = site->count;
+    out_stats->record_cycles_avg = site->count ?
+                                   (uint32_t)(site->record_cycles_sum / site->count) : 0;
+    out_stats->record_cycles_max = site->record_cycles_max;
+    out_stats->format_cycles_avg = site->format_count ?
+                                   (uint32_t)(site->format_cycles_sum / site->format_count) : 0;
+    return ESP_OK;
+}
+
+const char *trace_log_module_name(trace_module_t module)
+{
+    return module < TRACE_MOD_MAX ? s_module_names[module] : "?";
+}
@@ -0,0 +1,518 @@
+#pragma once
+
+/*
+ * COMMAND payload decoders
+ *
+ * GENERATED by firmware/tools/gen_wire_schema.py from schema/commands.json - do not edit.
+ *
+ * One struct + decoder per command that carries a payload. Decoders
+ * read through wire_reader_t, so a short payload fails cleanly instead
+ * of reading past the frame. Trailing bytes beyond the schema are ignored.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wire_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Command may be sent by an observer session (read-only) */
+#define WIRE_CMD_F_OBSERVER     (1 << 0)
+
+/* X(NAME, cmd_id, lower_name, min_len, max_len, flags) - sorted by cmd_id */
+#define WIRE_CMD_TABLE(X) \
+    X(SET_RELAY, 0x0001, set_relay, 2, 2, 0) \
+    X(SET_RELAY_MASK, 0x0002, set_relay_mask, 2, 2, 0) \
+    X(SET_SV, 0x0020, set_sv, 3, 3, 0) \
+    X(SET_MODE, 0x0021, set_mode, 2, 2, 0) \
+    X(REQUEST_PV_SV_REFRESH, 0x0022, request_pv_sv_refresh, 1, 1, WIRE_CMD_F_OBSERVER) \
+    X(SET_PID_PARAMS, 0x0023, set_pid_params, 7, 7, 0) \
+    X(READ_PID_PARAMS, 0x0024, read_pid_params, 1, 1, WIRE_CMD_F_OBSERVER) \
+    X(START_AUTOTUNE, 0x0025, start_autotune, 1, 1, 0) \
+    X(STOP_AUTOTUNE, 0x0026, stop_autotune, 1, 1, 0) \
+    X(SET_ALARM_LIMITS, 0x0027, set_alarm_limits, 5, 5, 0) \
+    X(READ_ALARM_LIMITS, 0x0028, read_alarm_limits, 1, 1, WIRE_CMD_F_OBSERVER) \
+    X(READ_REGISTERS, 0x0030, read_registers, 4, 4, WIRE_CMD_F_OBSERVER) \
+    X(WRITE_REGISTER, 0x0031, write_register, 5, 5, 0) \
+    X(SET_IDLE_TIMEOUT, 0x0040, set_idle_timeout, 1, 1, 0) \
+    X(GET_IDLE_TIMEOUT, 0x0041, get_idle_timeout, 0, 0, WIRE_CMD_F_OBSERVER) \
+    X(GET_CAPABILITIES, 0x0070, get_capabilities, 0, 0, WIRE_CMD_F_OBSERVER) \
+    X(SET_CAPABILITY, 0x0071, set_capability, 2, 2, 0) \
+    X(GET_SAFETY_GATES, 0x0072, get_safety_gates, 0, 0, WIRE_CMD_F_OBSERVER) \
+    X(SET_SAFETY_GATE, 0x0073, set_safety_gate, 2, 2, 0) \
+    X(REQUEST_SNAPSHOT_NOW, 0x00F0, request_snapshot_now, 0, 0, WIRE_CMD_F_OBSERVER) \
+    X(CLEAR_WARNINGS, 0x00F1, clear_warnings, 0, 0, 0) \
+    X(CLEAR_LATCHED_ALARMS, 0x00F2, clear_latched_alarms, 4, 4, 0) \
+    X(SET_TRACE_LEVEL, 0x00F3, set_trace_level, 2, 2, 0) \
+    X(GET_TRACE_STATS, 0x00F4, get_trace_stats, 0, 1, WIRE_CMD_F_OBSERVER) \
+    X(SET_LINK_PROFILE, 0x00F5, set_link_profile, 1, 1, 0) \
+    X(LINK_BENCHMARK, 0x00F6, link_benchmark, 5, 5, 0) \
+    X(GET_RELAY_STATS, 0x00F7, get_relay_stats, 0, 1, WIRE_CMD_F_OBSERVER) \
+    X(OPEN_SESSION, 0x0100, open_session, 4, 6, WIRE_CMD_F_OBSERVER) \
+    X(KEEPALIVE, 0x0101, keepalive, 4, 4, WIRE_CMD_F_OBSERVER) \
+    X(START_RUN, 0x0102, start_run, 5, 12, 0) \
+    X(STOP_RUN, 0x0103, stop_run, 5, 5, 0) \
+    X(PAUSE_RUN, 0x0104, pause_run, 5, 5, 0) \
+    X(RESUME_RUN, 0x0105, resume_run, 4, 4, 0) \
+    X(ENABLE_SERVICE_MODE, 0x0110, enable_service_mode, 4, 4, 0) \
+    X(DISABLE_SERVICE_MODE, 0x0111, disable_service_mode, 4, 4, 0) \
+    X(CLEAR_ESTOP, 0x0112, clear_estop, 4, 4, 0) \
+    X(CLEAR_FAULT, 0x0113, clear_fault, 4, 4, 0)
+
+/* X(NAME, lower_name, min_len, max_len) - commands with a wire_decode_<lower_name>() */
+#define WIRE_CMD_DECODERS(X) \
+    X(SET_RELAY, set_relay, 2, 2) \
+    X(SET_RELAY_MASK, set_relay_mask, 2, 2) \
+    X(SET_SV, set_sv, 3, 3) \
+    X(SET_MODE, set_mode, 2, 2) \
+    X(REQUEST_PV_SV_REFRESH, request_pv_sv_refresh, 1, 1) \
+    X(SET_PID_PARAMS, set_pid_params, 7, 7) \
+    X(READ_PID_PARAMS, read_pid_params, 1, 1) \
+    X(START_AUTOTUNE, start_autotune, 1, 1) \
+    X(STOP_AUTOTUNE, stop_autotune, 1, 1) \
+    X(SET_ALARM_LIMITS, set_alarm_limits, 5, 5) \
+    X(READ_ALARM_LIMITS, read_alarm_limits, 1, 1) \
+    X(READ_REGISTERS, read_registers, 4, 4) \
+    X(WRITE_REGISTER, write_register, 5, 5) \
+    X(SET_IDLE_TIMEOUT, set_idle_timeout, 1, 1) \
+    X(SET_CAPABILITY, set_capability, 2, 2) \
+    X(SET_SAFETY_GATE, set_safety_gate, 2, 2) \
+    X(CLEAR_LATCHED_ALARMS, clear_latched_alarms, 4, 4) \
+    X(SET_TRACE_LEVEL, set_trace_level, 2, 2) \
+    X(GET_TRACE_STATS, get_trace_stats, 0, 1) \
+    X(SET_LINK_PROFILE, set_link_profile, 1, 1) \
+    X(LINK_BENCHMARK, link_benchmark, 5, 5) \
+    X(GET_RELAY_STATS, get_relay_stats, 0, 1) \
+    X(OPEN_SESSION, open_session, 4, 6) \
+    X(KEEPALIVE, keepalive, 4, 4) \
+    X(START_RUN, start_run, 5, 12) \
+    X(STOP_RUN, stop_run, 5, 5) \
+    X(PAUSE_RUN, pause_run, 5, 5) \
+    X(RESUME_RUN, resume_run, 4, 4) \
+    X(ENABLE_SERVICE_MODE, enable_service_mode, 4, 4) \
+    X(DISABLE_SERVICE_MODE, disable_service_mode, 4, 4) \
+    X(CLEAR_ESTOP, clear_estop, 4, 4) \
+    X(CLEAR_FAULT, clear_fault, 4, 4)
+
+typedef struct {
+    uint16_t    cmd_id;
+    uint8_t     min_len;        /* Payload bytes required (after cmd_id + flags) */
+    uint8_t     max_len;        /* Payload bytes decoded incl. optional fields */
+    uint8_t     flags;          /* WIRE_CMD_F_* */
+    const char *name;
+} wire_cmd_desc_t;
+
+/**
+ * @brief Look up a command in the schema table
+ *
+ * @return Descriptor, or NULL for an unknown cmd_id
+ */
+const wire_cmd_desc_t *wire_cmd_lookup(uint16_t cmd_id);
+
+/* SET_RELAY (0x0001) */
+typedef struct {
+    uint8_t relay_index;
+    uint8_t state;
+} wire_req_set_relay_t;
+
+static inline bool wire_decode_set_relay(wire_reader_t *r, wire_req_set_relay_t *out)
+{
+    out->relay_index = wire_get_u8(r);
+    out->state = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_RELAY_MASK (0x0002) */
+typedef struct {
+    uint8_t mask;
+    uint8_t values;
+} wire_req_set_relay_mask_t;
+
+static inline bool wire_decode_set_relay_mask(wire_reader_t *r, wire_req_set_relay_mask_t *out)
+{
+    out->mask = wire_get_u8(r);
+    out->values = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_SV (0x0020) */
+typedef struct {
+    uint8_t controller_id;
+    int16_t sv_x10;
+} wire_req_set_sv_t;
+
+static inline bool wire_decode_set_sv(wire_reader_t *r, wire_req_set_sv_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    out->sv_x10 = wire_get_i16(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_MODE (0x0021) */
+typedef struct {
+    uint8_t controller_id;
+    uint8_t mode;
+} wire_req_set_mode_t;
+
+static inline bool wire_decode_set_mode(wire_reader_t *r, wire_req_set_mode_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    out->mode = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* REQUEST_PV_SV_REFRESH (0x0022) */
+typedef struct {
+    uint8_t controller_id;
+} wire_req_request_pv_sv_refresh_t;
+
+static inline bool wire_decode_request_pv_sv_refresh(wire_reader_t *r, wire_req_request_pv_sv_refresh_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_PID_PARAMS (0x0023) */
+typedef struct {
+    uint8_t controller_id;
+    int16_t p_gain_x10;
+    uint16_t i_time;
+    uint16_t d_time;
+} wire_req_set_pid_params_t;
+
+static inline bool wire_decode_set_pid_params(wire_reader_t *r, wire_req_set_pid_params_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    out->p_gain_x10 = wire_get_i16(r);
+    out->i_time = wire_get_u16(r);
+    out->d_time = wire_get_u16(r);
+    return wire_reader_ok(r);
+}
+
+/* READ_PID_PARAMS (0x0024) */
+typedef struct {
+    uint8_t controller_id;
+} wire_req_read_pid_params_t;
+
+static inline bool wire_decode_read_pid_params(wire_reader_t *r, wire_req_read_pid_params_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* START_AUTOTUNE (0x0025) */
+typedef struct {
+    uint8_t controller_id;
+} wire_req_start_autotune_t;
+
+static inline bool wire_decode_start_autotune(wire_reader_t *r, wire_req_start_autotune_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* STOP_AUTOTUNE (0x0026) */
+typedef struct {
+    uint8_t controller_id;
+} wire_req_stop_autotune_t;
+
+static inline bool wire_decode_stop_autotune(wire_reader_t *r, wire_req_stop_autotune_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_ALARM_LIMITS (0x0027) */
+typedef struct {
+    uint8_t controller_id;
+    int16_t alarm1_x10;
+    int16_t alarm2_x10;
+} wire_req_set_alarm_limits_t;
+
+static inline bool wire_decode_set_alarm_limits(wire_reader_t *r, wire_req_set_alarm_limits_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    out->alarm1_x10 = wire_get_i16(r);
+    out->alarm2_x10 = wire_get_i16(r);
+    return wire_reader_ok(r);
+}
+
+/* READ_ALARM_LIMITS (0x0028) */
+typedef struct {
+    uint8_t controller_id;
+} wire_req_read_alarm_limits_t;
+
+static inline bool wire_decode_read_alarm_limits(wire_reader_t *r, wire_req_read_alarm_limits_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* READ_REGISTERS (0x0030) */
+typedef struct {
+    uint8_t controller_id;
+    uint16_t start_address;
+    uint8_t count;
+} wire_req_read_registers_t;
+
+static inline bool wire_decode_read_registers(wire_reader_t *r, wire_req_read_registers_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    out->start_address = wire_get_u16(r);
+    out->count = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* WRITE_REGISTER (0x0031) */
+typedef struct {
+    uint8_t controller_id;
+    uint16_t address;
+    uint16_t value;
+} wire_req_write_register_t;
+
+static inline bool wire_decode_write_register(wire_reader_t *r, wire_req_write_register_t *out)
+{
+    out->controller_id = wire_get_u8(r);
+    out->address = wire_get_u16(r);
+    out->value = wire_get_u16(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_IDLE_TIMEOUT (0x0040) */
+typedef struct {
+    uint8_t timeout_minutes;
+} wire_req_set_idle_timeout_t;
+
+static inline bool wire_decode_set_idle_timeout(wire_reader_t *r, wire_req_set_idle_timeout_t *out)
+{
+    out->timeout_minutes = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_CAPABILITY (0x0071) */
+typedef struct {
+    uint8_t subsystem_id;
+    uint8_t capability;
+} wire_req_set_capability_t;
+
+static inline bool wire_decode_set_capability(wire_reader_t *r, wire_req_set_capability_t *out)
+{
+    out->subsystem_id = wire_get_u8(r);
+    out->capability = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_SAFETY_GATE (0x0073) */
+typedef struct {
+    uint8_t gate_id;
+    uint8_t enabled;
+} wire_req_set_safety_gate_t;
+
+static inline bool wire_decode_set_safety_gate(wire_reader_t *r, wire_req_set_safety_gate_t *out)
+{
+    out->gate_id = wire_get_u8(r);
+    out->enabled = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* CLEAR_LATCHED_ALARMS (0x00F2) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_clear_latched_alarms_t;
+
+static inline bool wire_decode_clear_latched_alarms(wire_reader_t *r, wire_req_clear_latched_alarms_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+/* SET_TRACE_LEVEL (0x00F3) */
+typedef struct {
+    uint8_t module;
+    uint8_t level;
+} wire_req_set_trace_level_t;
+
+static inline bool wire_decode_set_trace_level(wire_reader_t *r, wire_req_set_trace_level_t *out)
+{
+    out->module = wire_get_u8(r);
+    out->level = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* GET_TRACE_STATS (0x00F4) */
+typedef struct {
+    uint8_t first_fmt_id;           /* Optional, default 0 */
+} wire_req_get_trace_stats_t;
+
+static inline bool wire_decode_get_trace_stats(wire_reader_t *r, wire_req_get_trace_stats_t *out)
+{
+    out->first_fmt_id = (wire_reader_remaining(r) >= 1) ? wire_get_u8(r) : 0;
+    return wire_reader_ok(r);
+}
+
+/* SET_LINK_PROFILE (0x00F5) */
+typedef struct {
+    uint8_t profile;
+} wire_req_set_link_profile_t;
+
+static inline bool wire_decode_set_link_profile(wire_reader_t *r, wire_req_set_link_profile_t *out)
+{
+    out->profile = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* LINK_BENCHMARK (0x00F6) */
+typedef struct {
+    uint32_t total_bytes;
+    uint8_t rtt_samples;
+} wire_req_link_benchmark_t;
+
+static inline bool wire_decode_link_benchmark(wire_reader_t *r, wire_req_link_benchmark_t *out)
+{
+    out->total_bytes = wire_get_u32(r);
+    out->rtt_samples = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* GET_RELAY_STATS (0x00F7) */
+typedef struct {
+    uint8_t first_channel;          /* Optional, default 1 */
+} wire_req_get_relay_stats_t;
+
+static inline bool wire_decode_get_relay_stats(wire_reader_t *r, wire_req_get_relay_stats_t *out)
+{
+    out->first_channel = (wire_reader_remaining(r) >= 1) ? wire_get_u8(r) : 1;
+    return wire_reader_ok(r);
+}
+
+/* OPEN_SESSION (0x0100) */
+typedef struct {
+    uint32_t client_nonce;
+    uint8_t telemetry_ver;          /* Optional, default 1 */
+    uint8_t role;                   /* Optional, default 0 */
+} wire_req_open_session_t;
+
+static inline bool wire_decode_open_session(wire_reader_t *r, wire_req_open_session_t *out)
+{
+    out->client_nonce = wire_get_u32(r);
+    out->telemetry_ver = (wire_reader_remaining(r) >= 1) ? wire_get_u8(r) : 1;
+    out->role = (wire_reader_remaining(r) >= 1) ? wire_get_u8(r) : 0;
+    return wire_reader_ok(r);
+}
+
+/* KEEPALIVE (0x0101) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_keepalive_t;
+
+static inline bool wire_decode_keepalive(wire_reader_t *r, wire_req_keepalive_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+/* START_RUN (0x0102) */
+typedef struct {
+    uint32_t session_id;
+    uint8_t run_mode;
+    int16_t target_temp_x10;        /* Optional, default 0 */
+    uint32_t run_duration_ms;       /* Optional, default 0 */
+    uint8_t recipe_slot;            /* Optional, default 0 */
+} wire_req_start_run_t;
+
+static inline bool wire_decode_start_run(wire_reader_t *r, wire_req_start_run_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    out->run_mode = wire_get_u8(r);
+    out->target_temp_x10 = (wire_reader_remaining(r) >= 2) ? wire_get_i16(r) : 0;
+    out->run_duration_ms = (wire_reader_remaining(r) >= 4) ? wire_get_u32(r) : 0;
+    out->recipe_slot = (wire_reader_remaining(r) >= 1) ? wire_get_u8(r) : 0;
+    return wire_reader_ok(r);
+}
+
+/* STOP_RUN (0x0103) */
+typedef struct {
+    uint32_t session_id;
+    uint8_t stop_mode;
+} wire_req_stop_run_t;
+
+static inline bool wire_decode_stop_run(wire_reader_t *r, wire_req_stop_run_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    out->stop_mode = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* PAUSE_RUN (0x0104) */
+typedef struct {
+    uint32_t session_id;
+    uint8_t pause_mode;
+} wire_req_pause_run_t;
+
+static inline bool wire_decode_pause_run(wire_reader_t *r, wire_req_pause_run_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    out->pause_mode = wire_get_u8(r);
+    return wire_reader_ok(r);
+}
+
+/* RESUME_RUN (0x0105) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_resume_run_t;
+
+static inline bool wire_decode_resume_run(wire_reader_t *r, wire_req_resume_run_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+/* ENABLE_SERVICE_MODE (0x0110) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_enable_service_mode_t;
+
+static inline bool wire_decode_enable_service_mode(wire_reader_t *r, wire_req_enable_service_mode_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+/* DISABLE_SERVICE_MODE (0x0111) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_disable_service_mode_t;
+
+static inline bool wire_decode_disable_service_mode(wire_reader_t *r, wire_req_disable_service_mode_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+/* CLEAR_ESTOP (0x0112) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_clear_estop_t;
+
+static inline bool wire_decode_clear_estop(wire_reader_t *r, wire_req_clear_estop_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+/* CLEAR_FAULT (0x0113) */
+typedef struct {
+    uint32_t session_id;
+} wire_req_clear_fault_t;
+
+static inline bool wire_decode_clear_fault(wire_reader_t *r, wire_req_clear_fault_t *out)
+{
+    out->session_id = wire_get_u32(r);
+    return wire_reader_ok(r);
+}
+
+#ifdef __cplusplus
+}
+#endif
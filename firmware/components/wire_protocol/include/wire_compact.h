@@ -0,0 +1,181 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "wire_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compact Telemetry (telemetry_ver 2)
+ * ===================================
+ *
+ * TELEMETRY_SNAPSHOT spends 59 bytes per frame on a 3-controller machine,
+ * most of it on values that did not change since the previous frame. The
+ * compact encoding (MSG_TYPE_TELEMETRY_COMPACT) sends:
+ *
+ *   - keyframes: every field, absolute, as varints
+ *   - delta frames: only fields that changed, as zigzag varints relative
+ *     to the previous frame; unchanged fields cost nothing but a flag bit
+ *
+ * run_elapsed_ms / run_remaining_ms are predicted from the timestamp delta
+ * (elapsed counts up, remaining counts down), so a running timer costs
+ * nothing either. controller_id, mode and the per-field change flags share
+ * one byte per controller; di/ro are sent as 8 bits each.
+ *
+ * A delta frame is only meaningful on top of the frame with seq - 1. The
+ * encoder emits a keyframe first, every key_interval frames, and whenever
+ * the caller reports a lost frame; the decoder refuses deltas after a seq
+ * gap until the next keyframe. The client negotiates the encoding with the
+ * optional telemetry_ver field of OPEN_SESSION.
+ *
+ * Payload layout:
+ *   flags u8            bits 0-1 controller_count, bit 2 KEY, bit 3 IO,
+ *                       bit 4 ALARM, bit 5 RUN, bit 6 ETA (RUN only)
+ *   timestamp varint    KEY: timestamp_ms, else ms since the previous frame
+ *   [IO]    di u8, ro u8
+ *   [ALARM] alarm_bits varint
+ *   controller_count x:
+ *     head u8           bits 0-1 controller_id, bits 2-3 mode,
+ *                       bit 4 PV, bit 5 SV, bit 6 OP, bit 7 AGE
+ *     [PV] [SV] [OP]    zigzag varint (KEY: value, else change)
+ *     [AGE]             age_ms varint
+ *   [RUN] mask u8       bit 0 STATE, 1 ELAPSED, 2 REMAINING, 3 TARGET,
+ *                       4 STEP, 5 INTERLOCK, 6 IDLE, 7 = lazy_poll_active
+ *     [STATE] u8, [ELAPSED] zigzag varint, [REMAINING] zigzag varint,
+ *     [TARGET] zigzag varint, [STEP] u8, [INTERLOCK] u8, [IDLE] u8
+ *     [ETA] precool_eta u8
+ *
+ * KEY frames set IO, ALARM and every controller/run field flag; ETA is
+ * set when precool_eta changed (in a KEY frame: when it is non-zero).
+ */
+
+#define WIRE_COMPACT_FLAG_COUNT_MASK    0x03
+#define WIRE_COMPACT_FLAG_KEY           (1 << 2)
+#define WIRE_COMPACT_FLAG_IO            (1 << 3)
+#define WIRE_COMPACT_FLAG_ALARM         (1 << 4)
+#define WIRE_COMPACT_FLAG_RUN           (1 << 5)
+#define WIRE_COMPACT_FLAG_ETA           (1 << 6)
+
+#define WIRE_COMPACT_CTRL_ID_MASK       0x03
+#define WIRE_COMPACT_CTRL_MODE_SHIFT    2
+#define WIRE_COMPACT_CTRL_MODE_MASK     0x03
+#define WIRE_COMPACT_CTRL_PV            (1 << 4)
+#define WIRE_COMPACT_CTRL_SV            (1 << 5)
+#define WIRE_COMPACT_CTRL_OP            (1 << 6)
+#define WIRE_COMPACT_CTRL_AGE           (1 << 7)
+
+#define WIRE_COMPACT_RUN_STATE          (1 << 0)
+#define WIRE_COMPACT_RUN_ELAPSED        (1 << 1)
+#define WIRE_COMPACT_RUN_REMAINING      (1 << 2)
+#define WIRE_COMPACT_RUN_TARGET         (1 << 3)
+#define WIRE_COMPACT_RUN_STEP           (1 << 4)
+#define WIRE_COMPACT_RUN_INTERLOCK      (1 << 5)
+#define WIRE_COMPACT_RUN_IDLE           (1 << 6)
+#define WIRE_COMPACT_RUN_LAZY           (1 << 7)
+
+#define WIRE_COMPACT_MAX_CONTROLLERS    3
+
+/* Worst case: 13 header + 3 x 13 controller + 19 run state */
+#define WIRE_COMPACT_MAX_PAYLOAD        71
+
+/* One telemetry sample, independent of encoding */
+typedef struct {
+    uint32_t timestamp_ms;
+    uint16_t di_bits;
+    uint16_t ro_bits;
+    uint32_t alarm_bits;
+    uint8_t  controller_count;
+    wire_controller_data_t controllers[WIRE_COMPACT_MAX_CONTROLLERS];
+    bool     has_run_state;
+    wire_telemetry_run_state_t run_state;
+} wire_telemetry_sample_t;
+
+typedef struct {
+    wire_telemetry_sample_t ref;    /* Last sample encoded */
+    bool     have_ref;
+    uint16_t key_interval;          /* Frames between keyframes (0 = only on demand) */
+    uint16_t since_key;
+} wire_compact_enc_t;
+
+typedef struct {
+    wire_telemetry_sample_t ref;    /* Last sample decoded */
+    bool     have_ref;
+    uint16_t last_seq;
+} wire_compact_dec_t;
+
+typedef enum {
+    WIRE_COMPACT_OK = 0,
+    WIRE_COMPACT_NEED_KEY,          /* Delta without a usable reference (seq gap) */
+    WIRE_COMPACT_MALFORMED,         /* Truncated, trailing bytes or inconsistent */
+} wire_compact_result_t;
+
+/**
+ * @brief Initialise an encoder; the first frame will be a keyframe
+ *
+ * @param enc Encoder state
+ * @param key_interval Frames between forced keyframes (0 = only on demand)
+ */
+void wire_compact_enc_init(wire_compact_enc_t *enc, uint16_t key_interval);
+
+/**
+ * @brief Make the next frame a keyframe
+ *
+ * Call when a frame may not have reached the client (send failure,
+ * dropped tick, client request).
+ */
+void wire_compact_enc_force_key(wire_compact_enc_t *enc);
+
+/**
+ * @brief Encode a sample as a compact payload
+ *
+ * The sample becomes the reference for the next delta. If the sample cannot
+ * be represented (controller_id > 3, mode > 3, more than 3 controllers),
+ * nothing is written, the next frame is forced to a keyframe and 0 is
+ * returned; send a TELEMETRY_SNAPSHOT for that tick instead.
+ *
+ * @param enc Encoder state
+ * @param sample Sample to encode
+ * @param out Payload buffer (WIRE_COMPACT_MAX_PAYLOAD bytes is always enough)
+ * @param out_size Size of out
+ * @param[out] is_key Set to true if a keyframe was produced (may be NULL)
+ * @return Payload length, or 0 if the sample was not encoded
+ */
+size_t wire_compact_encode(wire_compact_enc_t *enc, const wire_telemetry_sample_t *sample,
+                           uint8_t *out, size_t out_size, bool *is_key);
+
+/**
+ * @brief Initialise a decoder; deltas are refused until the first keyframe
+ */
+void wire_compact_dec_init(wire_compact_dec_t *dec);
+
+/**
+ * @brief Decode a TELEMETRY_COMPACT payload
+ *
+ * @param dec Decoder state
+ * @param seq Frame seq (used to detect lost frames)
+ * @param payload Payload bytes
+ * @param len Payload length
+ * @param[out] out Reconstructed sample (valid only on WIRE_COMPACT_OK)
+ * @return WIRE_COMPACT_OK, or why the frame could not be applied
+ */
+wire_compact_result_t wire_compact_decode(wire_compact_dec_t *dec, uint16_t seq,
+                                          const uint8_t *payload, size_t len,
+                                          wire_telemetry_sample_t *out);
+
+/**
+ * @brief Size of the equivalent TELEMETRY_SNAPSHOT payload (for statistics)
+ */
+static inline size_t wire_compact_snapshot_size(const wire_telemetry_sample_t *sample)
+{
+    return sizeof(wire_telemetry_header_t) +
+           sample->controller_count * sizeof(wire_controller_data_t) +
+           (sample->has_run_state ? sizeof(wire_telemetry_run_state_t) : 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
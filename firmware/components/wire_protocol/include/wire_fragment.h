@@ -0,0 +1,194 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "wire_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Wire Protocol Fragmentation
+ * ===========================
+ *
+ * Moves objects larger than one ATT write/notification (up to 4 GiB in
+ * principle, bounded in practice by the receiver's buffer) as a series of
+ * MSG_TYPE_FRAGMENT frames. Every fragment is a complete wire frame with
+ * its own CRC.
+ *
+ * FRAGMENT payload:
+ * | transfer_id (u16) | object_type (u8) | flags (u8) | chunk_size (u16) |
+ * | total_len (u32) | offset (u32) | data (<= chunk_size) |
+ *
+ * All fragments of a transfer share transfer_id, object_type, chunk_size
+ * and total_len. offset is a multiple of chunk_size, so fragment N is
+ * block N. Only the last block may be shorter than chunk_size.
+ *
+ * FRAGMENT_NACK payload (receiver -> sender):
+ * | transfer_id (u16) | status (u8) | missing_count (u8) | missing block index (u16) x N |
+ *
+ * The receiver sends a NACK listing missing blocks when fragments stop
+ * arriving for a gap timeout, and a final NACK with status COMPLETE (or
+ * an ABORT status) when the transfer ends. The sender retransmits only
+ * the listed blocks.
+ *
+ * This file is transport-agnostic: callers supply buffers and a
+ * millisecond clock.
+ */
+
+#define WIRE_FRAG_HEADER_SIZE       14
+#define WIRE_FRAG_NACK_HEADER_SIZE  4
+#define WIRE_FRAG_NACK_MAX_MISSING  32      /* Missing blocks listed per NACK */
+
+/* Bulk object types (what the reassembled bytes are) */
+typedef enum {
+    WIRE_OBJ_NONE               = 0x00,
+    WIRE_OBJ_RECIPE             = 0x01,     /* Run recipe (recipe.h), app -> device */
+} wire_obj_type_t;
+
+/* FRAGMENT_NACK status */
+typedef enum {
+    WIRE_FRAG_STATUS_MISSING    = 0x00,     /* Transfer open, listed blocks missing */
+    WIRE_FRAG_STATUS_COMPLETE   = 0x01,     /* All blocks received and accepted */
+    WIRE_FRAG_STATUS_TIMEOUT    = 0x02,     /* Aborted: transfer timed out */
+    WIRE_FRAG_STATUS_TOO_LARGE  = 0x03,     /* Aborted: exceeds receiver buffer */
+    WIRE_FRAG_STATUS_BUSY       = 0x04,     /* Aborted: another transfer is in progress */
+    WIRE_FRAG_STATUS_REJECTED   = 0x05,     /* Aborted: receiver refused the object */
+} wire_frag_status_t;
+
+/* FRAGMENT header */
+typedef struct __attribute__((packed)) {
+    uint16_t transfer_id;
+    uint8_t  object_type;       /* wire_obj_type_t */
+    uint8_t  flags;             /* Reserved, 0 */
+    uint16_t chunk_size;        /* Data bytes per fragment (all but the last) */
+    uint32_t total_len;         /* Object size in bytes */
+    uint32_t offset;            /* Byte offset of this fragment's data */
+} wire_frag_header_t;
+
+/* FRAGMENT_NACK header (followed by missing_count u16 block indices) */
+typedef struct __attribute__((packed)) {
+    uint16_t transfer_id;
+    uint8_t  status;            /* wire_frag_status_t */
+    uint8_t  missing_count;
+} wire_frag_nack_t;
+
+/* Reassembly state */
+typedef enum {
+    WIRE_REASM_IDLE             = 0,
+    WIRE_REASM_ACTIVE           = 1,
+    WIRE_REASM_COMPLETE         = 2,
+} wire_reasm_state_t;
+
+/* Result of feeding one fragment */
+typedef enum {
+    WIRE_REASM_OK               = 0,        /* Stored, more blocks needed */
+    WIRE_REASM_DONE             = 1,        /* Object complete in buffer */
+    WIRE_REASM_DUPLICATE        = 2,        /* Block already held (or transfer already complete) */
+    WIRE_REASM_ERR_MALFORMED    = 3,        /* Bad header / offset / length */
+    WIRE_REASM_ERR_TOO_LARGE    = 4,        /* total_len or block count exceeds buffers */
+    WIRE_REASM_ERR_BUSY         = 5,        /* Different transfer already active */
+} wire_reasm_result_t;
+
+/* What the caller should do after wire_reasm_poll() */
+typedef enum {
+    WIRE_REASM_POLL_IDLE        = 0,        /* Nothing in progress */
+    WIRE_REASM_POLL_WAIT        = 1,        /* Fragments still flowing */
+    WIRE_REASM_POLL_NACK        = 2,        /* Gap timeout: send a MISSING NACK */
+    WIRE_REASM_POLL_TIMEOUT     = 3,        /* Transfer timeout: abort (state reset) */
+} wire_reasm_poll_t;
+
+/* Reassembly context. Buffers are owned by the caller. */
+typedef struct {
+    uint8_t  *buf;
+    uint32_t buf_size;
+    uint8_t  *bitmap;           /* One bit per block */
+    uint16_t max_blocks;        /* bitmap capacity in bits */
+
+    uint8_t  state;             /* wire_reasm_state_t */
+    uint8_t  object_type;
+    uint16_t transfer_id;
+    uint16_t chunk_size;
+    uint32_t total_len;
+    uint16_t block_count;
+    uint16_t blocks_received;
+
+    uint32_t started_ms;
+    uint32_t last_rx_ms;        /* Last new block, or last NACK sent */
+} wire_reasm_t;
+
+/**
+ * @brief Bind buffers to a reassembly context
+ *
+ * @param buf         Object buffer (largest object accepted = buf_size)
+ * @param bitmap      Block bitmap, (max_blocks + 7) / 8 bytes
+ * @param max_blocks  Most blocks per transfer (limits the smallest chunk_size)
+ */
+void wire_reasm_init(wire_reasm_t *r, uint8_t *buf, uint32_t buf_size,
+                     uint8_t *bitmap, uint16_t max_blocks);
+
+/**
+ * @brief Drop any transfer in progress
+ */
+void wire_reasm_reset(wire_reasm_t *r);
+
+/**
+ * @brief Feed one FRAGMENT payload (the frame's payload, not the frame)
+ *
+ * A fragment with a new transfer_id starts a new transfer if the context
+ * is idle or holds a completed object.
+ */
+wire_reasm_result_t wire_reasm_accept(wire_reasm_t *r, const uint8_t *payload,
+                                      size_t len, uint32_t now_ms);
+
+/**
+ * @brief Check timeouts for the transfer in progress
+ *
+ * Returns NACK at most once per gap_timeout_ms while blocks are missing.
+ * On TIMEOUT the context is reset; the caller should send a TIMEOUT NACK
+ * for the returned transfer_id first (see wire_reasm_build_nack()).
+ */
+wire_reasm_poll_t wire_reasm_poll(wire_reasm_t *r, uint32_t now_ms,
+                                  uint32_t gap_timeout_ms, uint32_t transfer_timeout_ms);
+
+/**
+ * @brief Build a FRAGMENT_NACK payload for the current transfer
+ *
+ * For WIRE_FRAG_STATUS_MISSING, lists up to WIRE_FRAG_NACK_MAX_MISSING
+ * missing blocks (lowest first). Other statuses carry no block list.
+ *
+ * @return Payload length, or 0 if out_size is too small
+ */
+size_t wire_reasm_build_nack(const wire_reasm_t *r, uint16_t transfer_id, uint8_t status,
+                             uint8_t *out, size_t out_size);
+
+/**
+ * @brief Data bytes per fragment that fit one ATT PDU at the given MTU
+ *
+ * @return chunk size, or 0 if the MTU cannot carry a fragment
+ */
+uint16_t wire_frag_chunk_for_mtu(uint16_t mtu);
+
+/**
+ * @brief Build one FRAGMENT frame carrying block `block` of `object`
+ *
+ * @return Frame length, or 0 if the block is out of range or out_size too small
+ */
+size_t wire_build_fragment(uint8_t *out_buf, size_t out_buf_size, uint16_t seq,
+                           uint16_t transfer_id, uint8_t object_type, uint16_t chunk_size,
+                           const uint8_t *object, uint32_t total_len, uint16_t block);
+
+/**
+ * @brief Parse a FRAGMENT_NACK payload
+ *
+ * @param missing_out  Points at the first u16 block index (little-endian)
+ * @return true if the payload is well-formed
+ */
+bool wire_parse_frag_nack(const uint8_t *payload, size_t len, wire_frag_nack_t *out,
+                          const uint8_t **missing_out);
+
+#ifdef __cplusplus
+}
+#endif
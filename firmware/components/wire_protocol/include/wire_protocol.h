@@ -26,11 +26,24 @@ extern "C" {
 /* Message Types */
 typedef enum {
     MSG_TYPE_TELEMETRY_SNAPSHOT = 0x01,     // ESP -> App (Notify)
+    MSG_TYPE_TELEMETRY_COMPACT  = 0x02,     // ESP -> App (Notify), telemetry_ver 2 (wire_compact.h)
     MSG_TYPE_COMMAND            = 0x10,     // App -> ESP (Write)
     MSG_TYPE_COMMAND_ACK        = 0x11,     // ESP -> App (Notify/Indicate)
     MSG_TYPE_EVENT              = 0x20,     // ESP -> App (Notify/Indicate)
+    MSG_TYPE_FRAGMENT           = 0x30,     // Both (Bulk Gateway), one piece of a large object
+    MSG_TYPE_FRAGMENT_NACK      = 0x31,     // Both (Bulk Gateway), missing pieces / transfer status
+    MSG_TYPE_LINK_BENCH_DATA    = 0xF0,     // ESP -> App (Notify), link benchmark filler
 } wire_msg_type_t;
 
+/* Telemetry encodings, negotiated by OPEN_SESSION.telemetry_ver */
+#define WIRE_TELEMETRY_VER_SNAPSHOT 1       // TELEMETRY_SNAPSHOT (default)
+#define WIRE_TELEMETRY_VER_COMPACT  2       // TELEMETRY_COMPACT keyframes + deltas
+#define WIRE_TELEMETRY_VER_MAX      WIRE_TELEMETRY_VER_COMPACT
+
+/* Session roles, requested by OPEN_SESSION.role */
+#define WIRE_SESSION_ROLE_CONTROLLER 0      // Full command set (default), one at a time
+#define WIRE_SESSION_ROLE_OBSERVER   1      // Read-only commands, any number up to the link limit
+
 /* Command IDs */
 typedef enum {
     /* I/O Control (0x0001 - 0x000F) */
@@ -58,6 +71,11 @@ typedef enum {
     CMD_REQUEST_SNAPSHOT_NOW    = 0x00F0,
     CMD_CLEAR_WARNINGS          = 0x00F1,
     CMD_CLEAR_LATCHED_ALARMS    = 0x00F2,
+    CMD_SET_TRACE_LEVEL         = 0x00F3,   /* Set deferred trace verbosity per module */
+    CMD_GET_TRACE_STATS         = 0x00F4,   /* Get trace ring counters + per-site cost */
+    CMD_SET_LINK_PROFILE        = 0x00F5,   /* Select BLE link profile (latency vs bulk) */
+    CMD_LINK_BENCHMARK          = 0x00F6,   /* Stream N bytes, report throughput + RTT */
+    CMD_GET_RELAY_STATS         = 0x00F7,   /* Get relay cycle counts + ON time */
 
     /* Session Management (0x0100 - 0x010F) */
     CMD_OPEN_SESSION            = 0x0100,
@@ -104,13 +122,17 @@ typedef enum {
     EVENT_STATE_CHANGED         = 0x1204,
     EVENT_RUN_PAUSED            = 0x1205,
     EVENT_RUN_RESUMED           = 0x1206,
+    EVENT_RECIPE_STEP           = 0x1207,
+    EVENT_PRECOOL_AT_RISK       = 0x1208,
     EVENT_RS485_DEVICE_ONLINE   = 0x1300,
     EVENT_RS485_DEVICE_OFFLINE  = 0x1301,
     EVENT_ALARM_LATCHED         = 0x1400,
     EVENT_ALARM_CLEARED         = 0x1401,
+    EVENT_RELAY_MISMATCH        = 0x1402,
     EVENT_AUTOTUNE_STARTED      = 0x1500,
     EVENT_AUTOTUNE_COMPLETE     = 0x1501,
     EVENT_AUTOTUNE_FAILED       = 0x1502,
+    EVENT_LINK_BENCHMARK_RESULT = 0x1600,
 } wire_event_id_t;
 
 /* Event Severity */
@@ -138,6 +160,7 @@ typedef enum {
 #define ALARM_BIT_PID1_PROBE_ERROR      (1 << 12)   /* PID1 has probe error (HHHH/LLLL) */
 #define ALARM_BIT_PID2_PROBE_ERROR      (1 << 13)   /* PID2 has probe error (HHHH/LLLL) */
 #define ALARM_BIT_PID3_PROBE_ERROR      (1 << 14)   /* PID3 has probe error (HHHH/LLLL) */
+#define ALARM_BIT_RELAY_MISMATCH        (1 << 15)   /* Relay outputs read back wrong (latched) */
 
 /* Controller Modes */
 typedef enum {
@@ -175,9 +198,21 @@ typedef struct __attribute__((packed)) {
     uint8_t  interlock_bits;    // Which interlocks are blocking start (offset 12)
     uint8_t  lazy_poll_active;  // 1 if lazy polling active (offset 13)
     uint8_t  idle_timeout_min;  // Idle timeout in minutes, 0=disabled (offset 14)
-    uint8_t  reserved;          // Reserved for future use (offset 15)
+    uint8_t  precool_eta;       // WIRE_PRECOOL_ETA_* status | band (offset 15)
 } wire_telemetry_run_state_t;   // Total: 16 bytes
 
+/*
+ * precool_eta: PRECOOL time-to-target estimate quality. While it is not
+ * NONE, run_remaining_ms holds the predicted time until the chamber reaches
+ * its precool target (0xFFFFFFFF = not expected to reach it).
+ */
+#define WIRE_PRECOOL_ETA_STATUS_MASK    0x03
+#define WIRE_PRECOOL_ETA_NONE           0x00    // Not in PRECOOL, or still learning
+#define WIRE_PRECOOL_ETA_ON_TRACK       0x01    // Expected before PRECOOL_TIMEOUT_MS
+#define WIRE_PRECOOL_ETA_AT_RISK        0x02    // Even the optimistic bound misses it
+#define WIRE_PRECOOL_ETA_BAND_SHIFT     2       // Bits 2-7: ETA uncertainty, ±% (63 = 63% or worse)
+#define WIRE_PRECOOL_ETA_BAND_MAX       63
+
 typedef struct __attribute__((packed)) {
     uint8_t  controller_id;     // 1, 2, or 3
     int16_t  pv_x10;            // Process Variable × 10
@@ -226,12 +261,16 @@ typedef struct __attribute__((packed)) {
 /* OPEN_SESSION command payload */
 typedef struct __attribute__((packed)) {
     uint32_t client_nonce;
+    uint8_t  telemetry_ver;     // Optional: requested telemetry encoding (absent = 1)
+    uint8_t  role;              // Optional: WIRE_SESSION_ROLE_* (absent = controller)
 } wire_cmd_open_session_t;
 
 /* OPEN_SESSION ACK optional data */
 typedef struct __attribute__((packed)) {
     uint32_t session_id;
     uint16_t lease_ms;
+    uint8_t  telemetry_ver;     // Accepted encoding; only sent if the client asked
+    uint8_t  role;              // Granted role; only sent if the client asked
 } wire_ack_open_session_t;
 
 /* KEEPALIVE command payload */
@@ -353,12 +392,240 @@ typedef struct __attribute__((packed)) {
     uint8_t  enabled;           /* 1=enable gate, 0=bypass gate */
 } wire_cmd_set_safety_gate_t;
 
+/* SET_TRACE_LEVEL command payload */
+typedef struct __attribute__((packed)) {
+    uint8_t  module;            /* trace_module_t (0xFF = all modules) */
+    uint8_t  level;             /* 0=none .. 5=verbose */
+} wire_cmd_set_trace_level_t;
+
+/* GET_TRACE_STATS ACK optional data (header) */
+typedef struct __attribute__((packed)) {
+    uint32_t recorded;          /* Records captured */
+    uint32_t dropped;           /* Records overwritten before drain */
+    uint8_t  site_count;        /* Number of wire_trace_site_stats_t that follow */
+} wire_ack_trace_stats_t;
+
+/* GET_TRACE_STATS per-site entry */
+typedef struct __attribute__((packed)) {
+    uint8_t  fmt_id;            /* Trace format ID */
+    uint32_t count;             /* Records captured at this site */
+    uint16_t record_cycles_avg; /* Hot-path cost (CPU cycles, saturated) */
+    uint32_t format_cycles_avg; /* Deferred format + console cost (CPU cycles) */
+} wire_trace_site_stats_t;
+
+/* EVENT_RELAY_MISMATCH event data */
+typedef struct __attribute__((packed)) {
+    uint8_t  expected;          /* Relay image last written (bit 0 = RO1) */
+    uint8_t  actual;            /* TCA9554 output register read back */
+    uint8_t  config;            /* TCA9554 config register read back (0x00 = all outputs) */
+    uint8_t  restored;          /* 1 = expected image rewritten and verified */
+} wire_event_relay_mismatch_t;
+
+/* GET_RELAY_STATS ACK optional data (header) */
+typedef struct __attribute__((packed)) {
+    uint32_t flushes;           /* Counter saves to NVS since boot */
+    uint32_t unsaved_changes;   /* Output changes not yet saved */
+    uint8_t  channel_count;     /* Number of wire_relay_channel_stats_t that follow */
+} wire_ack_relay_stats_t;
+
+/* GET_RELAY_STATS per-channel entry */
+typedef struct __attribute__((packed)) {
+    uint8_t  channel;           /* 1..8 (RO1..RO8) */
+    uint32_t on_count;          /* OFF -> ON transitions, lifetime */
+    uint32_t off_count;         /* ON -> OFF transitions, lifetime */
+    uint32_t on_time_s;         /* Accumulated ON time, lifetime */
+} wire_relay_channel_stats_t;
+
+/* SET_LINK_PROFILE command payload */
+typedef struct __attribute__((packed)) {
+    uint8_t  profile;           /* 0=LOW_LATENCY, 1=BULK */
+} wire_cmd_set_link_profile_t;
+
+/* LINK_BENCHMARK command payload */
+typedef struct __attribute__((packed)) {
+    uint32_t total_bytes;       /* Filler bytes to stream (1..1048576) */
+    uint8_t  rtt_samples;       /* Indication round trips to time (0..64) */
+} wire_cmd_link_benchmark_t;
+
+/* LINK_BENCH_DATA payload header (followed by filler bytes) */
+typedef struct __attribute__((packed)) {
+    uint32_t offset;            /* Byte offset of the first filler byte */
+} wire_link_bench_data_t;
+
+/* EVENT_LINK_BENCHMARK_RESULT event data */
+typedef struct __attribute__((packed)) {
+    uint32_t bytes_sent;        /* Filler bytes delivered to the controller */
+    uint32_t duration_ms;       /* First notify to last TX complete */
+    uint32_t throughput_bps;    /* Bytes per second */
+    uint16_t mtu;               /* ATT MTU during the run */
+    uint8_t  rtt_count;         /* RTT samples collected */
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p90_us;
+    uint32_t rtt_p99_us;
+    uint32_t rtt_max_us;
+} wire_event_link_benchmark_t;
+
 /*
  * CRC-16/CCITT-FALSE
  * Poly: 0x1021, Init: 0xFFFF, RefIn: false, RefOut: false, XorOut: 0x0000
  */
 uint16_t wire_crc16(const uint8_t *data, size_t len);
 
+/*
+ * Continue a CRC-16/CCITT-FALSE over more bytes.
+ * wire_crc16(d, n) == wire_crc16_update(0xFFFF, d, n)
+ */
+uint16_t wire_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/*
+ * Streaming frame writer
+ * ======================
+ * Writes header, payload fields and CRC in one pass, either into a flat
+ * buffer or through a sink callback (e.g. straight into a NimBLE mbuf).
+ * The CRC is updated as each field is appended, so no intermediate
+ * payload buffer or second copy is needed.
+ *
+ * payload_len must be known up front (it is in the header). Appends are
+ * batched through a small staging area before reaching the sink.
+ *
+ *   wire_writer_t w;
+ *   wire_writer_init_buf(&w, buf, sizeof(buf));
+ *   wire_writer_begin(&w, MSG_TYPE_EVENT, seq, 6);
+ *   wire_writer_put_u16(&w, event_id); ...
+ *   size_t len = wire_writer_finish(&w);     // 0 on any error
+ */
+
+#define WIRE_WRITER_STAGE_SIZE  32
+
+/* Sink: append len bytes, return false on failure (e.g. out of mbufs) */
+typedef bool (*wire_sink_fn_t)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct {
+    wire_sink_fn_t sink;        /* NULL = flat buffer mode */
+    void    *sink_ctx;
+    uint8_t *buf;               /* Flat buffer mode target */
+    size_t   buf_size;
+    size_t   len;               /* Frame bytes committed so far */
+    uint16_t payload_len;       /* Declared in header */
+    uint16_t payload_written;
+    uint16_t crc;
+    bool     error;
+    uint8_t  stage_len;
+    uint8_t  stage[WIRE_WRITER_STAGE_SIZE];
+} wire_writer_t;
+
+void wire_writer_init_buf(wire_writer_t *w, uint8_t *buf, size_t buf_size);
+void wire_writer_init_sink(wire_writer_t *w, wire_sink_fn_t sink, void *ctx);
+
+/* Write the 6-byte header. Returns false if payload_len > WIRE_MAX_PAYLOAD. */
+bool wire_writer_begin(wire_writer_t *w, uint8_t msg_type, uint16_t seq, uint16_t payload_len);
+
+void wire_writer_put_u8(wire_writer_t *w, uint8_t v);
+void wire_writer_put_u16(wire_writer_t *w, uint16_t v);
+void wire_writer_put_u32(wire_writer_t *w, uint32_t v);
+void wire_writer_put_bytes(wire_writer_t *w, const uint8_t *data, size_t len);
+
+/*
+ * Append the CRC and flush. Returns the total frame length, or 0 if any
+ * append failed or the payload written does not match payload_len.
+ */
+size_t wire_writer_finish(wire_writer_t *w);
+
+/* Frame writers (same layouts as the wire_build_* functions below) */
+size_t wire_write_frame(wire_writer_t *w, uint8_t msg_type, uint16_t seq,
+                        const uint8_t *payload, uint16_t payload_len);
+
+size_t wire_write_cmd_ack(wire_writer_t *w, uint16_t seq, uint16_t acked_seq,
+                          uint16_t cmd_id, uint8_t status, uint16_t detail,
+                          const uint8_t *optional_data, size_t optional_len);
+
+/* run_state may be NULL for the basic (backwards compatible) snapshot */
+size_t wire_write_telemetry(wire_writer_t *w, uint16_t seq, uint32_t timestamp_ms,
+                            uint16_t di_bits, uint16_t ro_bits, uint32_t alarm_bits,
+                            const wire_controller_data_t *controllers,
+                            uint8_t controller_count,
+                            const wire_telemetry_run_state_t *run_state);
+
+size_t wire_write_event(wire_writer_t *w, uint16_t seq, uint16_t event_id,
+                        uint8_t severity, uint8_t source,
+                        const uint8_t *event_data, size_t event_data_len);
+
+/*
+ * Bounds-checked payload reader
+ * =============================
+ * Decodes little-endian fields in order. A read past the end returns 0,
+ * consumes nothing and latches the error flag, so a handler can decode
+ * every field first and check wire_reader_ok() once:
+ *
+ *   wire_reader_t r;
+ *   wire_reader_init(&r, cmd_payload, cmd_payload_len);
+ *   uint32_t session_id = wire_get_u32(&r);
+ *   uint8_t  mode = wire_get_u8(&r);
+ *   if (!wire_reader_ok(&r)) { ... INVALID_ARGS ... }
+ *
+ * Trailing bytes are allowed (payloads may be extended, see docs/30).
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t   len;
+    size_t   pos;
+    bool     error;
+} wire_reader_t;
+
+static inline void wire_reader_init(wire_reader_t *r, const uint8_t *data, size_t len)
+{
+    r->data = data;
+    r->len = (data != NULL) ? len : 0;
+    r->pos = 0;
+    r->error = false;
+}
+
+static inline bool wire_reader_ok(const wire_reader_t *r)
+{
+    return !r->error;
+}
+
+static inline size_t wire_reader_remaining(const wire_reader_t *r)
+{
+    return r->len - r->pos;
+}
+
+/* Reserve n bytes; NULL (and error latched) if fewer remain */
+static inline const uint8_t *wire_reader_take(wire_reader_t *r, size_t n)
+{
+    if (r->error || n > r->len - r->pos) {
+        r->error = true;
+        return NULL;
+    }
+    const uint8_t *p = &r->data[r->pos];
+    r->pos += n;
+    return p;
+}
+
+static inline uint8_t wire_get_u8(wire_reader_t *r)
+{
+    const uint8_t *p = wire_reader_take(r, 1);
+    return p ? p[0] : 0;
+}
+
+static inline uint16_t wire_get_u16(wire_reader_t *r)
+{
+    const uint8_t *p = wire_reader_take(r, 2);
+    return p ? (uint16_t)(p[0] | ((uint16_t)p[1] << 8)) : 0;
+}
+
+static inline int16_t wire_get_i16(wire_reader_t *r)
+{
+    return (int16_t)wire_get_u16(r);
+}
+
+static inline uint32_t wire_get_u32(wire_reader_t *r)
+{
+    const uint8_t *p = wire_reader_take(r, 4);
+    return p ? (p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                ((uint32_t)p[3] << 24)) : 0;
+}
+
 /*
  * Build a complete frame with header, payload, and CRC.
  * Returns total frame length, or 0 on error.
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "wire_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Wire Protocol Stream Decoder
+ * ============================
+ *
+ * wire_parse_frame() expects exactly one frame per buffer, which is what a
+ * GATT write delivers. Byte-stream transports (UART console, TCP) deliver
+ * arbitrary chunks instead: a frame may be split across reads, several
+ * frames may share one read, and line noise may sit between frames.
+ *
+ * The stream decoder accepts chunks of any size and emits each valid frame
+ * through a callback. A candidate frame starts at a proto_ver byte and is
+ * accepted only when its payload_len is in range and its CRC matches. On
+ * any failure the decoder drops one byte and rescans from the next
+ * proto_ver byte, so a corrupted or truncated frame never swallows the
+ * frames that follow it.
+ *
+ * Copying: a frame that lies entirely inside one chunk is delivered
+ * straight from the caller's chunk. Only frames split across chunks are
+ * copied, once, into the caller-supplied buffer.
+ *
+ * Callbacks run synchronously from wire_stream_feed(); the header and
+ * payload pointers are valid only for the duration of the call.
+ */
+
+/* Smallest buffer that holds any legal frame */
+#define WIRE_STREAM_BUF_MIN         WIRE_MAX_FRAME_SIZE
+
+/**
+ * @brief Frame callback
+ *
+ * @param ctx Caller context from wire_stream_init()
+ * @param header Parsed frame header
+ * @param payload Payload bytes, or NULL when payload_len is 0
+ */
+typedef void (*wire_stream_frame_cb_t)(void *ctx, const wire_frame_header_t *header,
+                                       const uint8_t *payload);
+
+/* Decoder counters (monotonic until wire_stream_init()) */
+typedef struct {
+    uint32_t frames;            /* Valid frames delivered */
+    uint32_t frames_copied;     /* ...of which were reassembled in the buffer */
+    uint32_t resyncs;           /* Times the decoder lost and re-sought frame sync */
+    uint32_t crc_errors;        /* Candidates rejected on CRC */
+    uint32_t len_errors;        /* Candidates rejected on payload_len */
+    uint32_t bytes_discarded;   /* Bytes skipped while resynchronizing */
+} wire_stream_stats_t;
+
+typedef struct {
+    uint8_t *buf;               /* Partial-frame buffer (caller-owned) */
+    size_t   buf_size;
+    size_t   fill;              /* Bytes of the pending candidate held in buf */
+    bool     in_sync;           /* False while skipping garbage */
+    wire_stream_frame_cb_t on_frame;
+    void    *ctx;
+    wire_stream_stats_t stats;
+} wire_stream_t;
+
+/**
+ * @brief Initialise a decoder
+ *
+ * @param s Decoder state
+ * @param buf Partial-frame buffer, at least WIRE_STREAM_BUF_MIN bytes
+ * @param buf_size Size of buf
+ * @param on_frame Called for every valid frame
+ * @param ctx Passed through to on_frame
+ * @return true on success, false if arguments are invalid
+ */
+bool wire_stream_init(wire_stream_t *s, uint8_t *buf, size_t buf_size,
+                      wire_stream_frame_cb_t on_frame, void *ctx);
+
+/**
+ * @brief Drop any partially received frame
+ *
+ * Call on transport events that break framing (UART idle timeout, TCP
+ * reconnect). Counters are kept.
+ */
+void wire_stream_reset(wire_stream_t *s);
+
+/**
+ * @brief Feed received bytes into the decoder
+ *
+ * @param s Decoder state
+ * @param data Received bytes (any length, any alignment to frame boundaries)
+ * @param len Number of bytes
+ * @return Number of frames delivered during this call
+ */
+size_t wire_stream_feed(wire_stream_t *s, const uint8_t *data, size_t len);
+
+/**
+ * @brief Bytes of a partial frame currently held
+ */
+static inline size_t wire_stream_pending(const wire_stream_t *s)
+{
+    return s->fill;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,88 @@
+/*
+ * COMMAND descriptor table
+ *
+ * GENERATED by firmware/tools/gen_wire_schema.py from schema/commands.json - do not edit.
+ */
+
+#include "wire_cmd_schema.h"
+
+/* Schema IDs must match wire_cmd_id_t */
+_Static_assert(CMD_SET_RELAY == 0x0001, "CMD_SET_RELAY differs from schema");
+_Static_assert(CMD_SET_RELAY_MASK == 0x0002, "CMD_SET_RELAY_MASK differs from schema");
+_Static_assert(CMD_SET_SV == 0x0020, "CMD_SET_SV differs from schema");
+_Static_assert(CMD_SET_MODE == 0x0021, "CMD_SET_MODE differs from schema");
+_Static_assert(CMD_REQUEST_PV_SV_REFRESH == 0x0022, "CMD_REQUEST_PV_SV_REFRESH differs from schema");
+_Static_assert(CMD_SET_PID_PARAMS == 0x0023, "CMD_SET_PID_PARAMS differs from schema");
+_Static_assert(CMD_READ_PID_PARAMS == 0x0024, "CMD_READ_PID_PARAMS differs from schema");
+_Static_assert(CMD_START_AUTOTUNE == 0x0025, "CMD_START_AUTOTUNE differs from schema");
+_Static_assert(CMD_STOP_AUTOTUNE == 0x0026, "CMD_STOP_AUTOTUNE differs from schema");
+_Static_assert(CMD_SET_ALARM_LIMITS == 0x0027, "CMD_SET_ALARM_LIMITS differs from schema");
+_Static_assert(CMD_READ_ALARM_LIMITS == 0x0028, "CMD_READ_ALARM_LIMITS differs from schema");
+_Static_assert(CMD_READ_REGISTERS == 0x0030, "CMD_READ_REGISTERS differs from schema");
+_Static_assert(CMD_WRITE_REGISTER == 0x0031, "CMD_WRITE_REGISTER differs from schema");
+_Static_assert(CMD_SET_IDLE_TIMEOUT == 0x0040, "CMD_SET_IDLE_TIMEOUT differs from schema");
+_Static_assert(CMD_GET_IDLE_TIMEOUT == 0x0041, "CMD_GET_IDLE_TIMEOUT differs from schema");
+_Static_assert(CMD_GET_CAPABILITIES == 0x0070, "CMD_GET_CAPABILITIES differs from schema");
+_Static_assert(CMD_SET_CAPABILITY == 0x0071, "CMD_SET_CAPABILITY differs from schema");
+_Static_assert(CMD_GET_SAFETY_GATES == 0x0072, "CMD_GET_SAFETY_GATES differs from schema");
+_Static_assert(CMD_SET_SAFETY_GATE == 0x0073, "CMD_SET_SAFETY_GATE differs from schema");
+_Static_assert(CMD_REQUEST_SNAPSHOT_NOW == 0x00F0, "CMD_REQUEST_SNAPSHOT_NOW differs from schema");
+_Static_assert(CMD_CLEAR_WARNINGS == 0x00F1, "CMD_CLEAR_WARNINGS differs from schema");
+_Static_assert(CMD_CLEAR_LATCHED_ALARMS == 0x00F2, "CMD_CLEAR_LATCHED_ALARMS differs from schema");
+_Static_assert(CMD_SET_TRACE_LEVEL == 0x00F3, "CMD_SET_TRACE_LEVEL differs from schema");
+_Static_assert(CMD_GET_TRACE_STATS == 0x00F4, "CMD_GET_TRACE_STATS differs from schema");
+_Static_assert(CMD_SET_LINK_PROFILE == 0x00F5, "CMD_SET_LINK_PROFILE differs from schema");
+_Static_assert(CMD_LINK_BENCHMARK == 0x00F6, "CMD_LINK_BENCHMARK differs from schema");
+_Static_assert(CMD_GET_RELAY_STATS == 0x00F7, "CMD_GET_RELAY_STATS differs from schema");
+_Static_assert(CMD_OPEN_SESSION == 0x0100, "CMD_OPEN_SESSION differs from schema");
+_Static_assert(CMD_KEEPALIVE == 0x0101, "CMD_KEEPALIVE differs from schema");
+_Static_assert(CMD_START_RUN == 0x0102, "CMD_START_RUN differs from schema");
+_Static_assert(CMD_STOP_RUN == 0x0103, "CMD_STOP_RUN differs from schema");
+_Static_assert(CMD_PAUSE_RUN == 0x0104, "CMD_PAUSE_RUN differs from schema");
+_Static_assert(CMD_RESUME_RUN == 0x0105, "CMD_RESUME_RUN differs from schema");
+_Static_assert(CMD_ENABLE_SERVICE_MODE == 0x0110, "CMD_ENABLE_SERVICE_MODE differs from schema");
+_Static_assert(CMD_DISABLE_SERVICE_MODE == 0x0111, "CMD_DISABLE_SERVICE_MODE differs from schema");
+_Static_assert(CMD_CLEAR_ESTOP == 0x0112, "CMD_CLEAR_ESTOP differs from schema");
+_Static_assert(CMD_CLEAR_FAULT == 0x0113, "CMD_CLEAR_FAULT differs from schema");
+
+/* Packed layouts in wire_protocol.h must match the schema */
+_Static_assert(sizeof(wire_cmd_set_sv_t) == 3, "wire_cmd_set_sv_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_mode_t) == 2, "wire_cmd_set_mode_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_pid_params_t) == 7, "wire_cmd_set_pid_params_t differs from schema");
+_Static_assert(sizeof(wire_cmd_autotune_t) == 1, "wire_cmd_autotune_t differs from schema");
+_Static_assert(sizeof(wire_cmd_autotune_t) == 1, "wire_cmd_autotune_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_alarm_limits_t) == 5, "wire_cmd_set_alarm_limits_t differs from schema");
+_Static_assert(sizeof(wire_cmd_read_registers_t) == 4, "wire_cmd_read_registers_t differs from schema");
+_Static_assert(sizeof(wire_cmd_write_register_t) == 5, "wire_cmd_write_register_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_capability_t) == 2, "wire_cmd_set_capability_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_safety_gate_t) == 2, "wire_cmd_set_safety_gate_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_trace_level_t) == 2, "wire_cmd_set_trace_level_t differs from schema");
+_Static_assert(sizeof(wire_cmd_set_link_profile_t) == 1, "wire_cmd_set_link_profile_t differs from schema");
+_Static_assert(sizeof(wire_cmd_link_benchmark_t) == 5, "wire_cmd_link_benchmark_t differs from schema");
+_Static_assert(sizeof(wire_cmd_open_session_t) == 6, "wire_cmd_open_session_t differs from schema");
+_Static_assert(sizeof(wire_cmd_keepalive_t) == 4, "wire_cmd_keepalive_t differs from schema");
+
+static const wire_cmd_desc_t s_cmd_table[] = {
+#define X(name, id, lower, min_len, max_len, flags) { id, min_len, max_len, flags, #name },
+    WIRE_CMD_TABLE(X)
+#undef X
+};
+
+const wire_cmd_desc_t *wire_cmd_lookup(uint16_t cmd_id)
+{
+    size_t lo = 0;
+    size_t hi = sizeof(s_cmd_table) / sizeof(s_cmd_table[0]);
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (s_cmd_table[mid].cmd_id == cmd_id) {
+            return &s_cmd_table[mid];
+        }
+        if (s_cmd_table[mid].cmd_id < cmd_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
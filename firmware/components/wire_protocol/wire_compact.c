@@ -0,0 +1,319 @@
+#include "wire_compact.h"
+#include <string.h>
+
+/* ===== Varint primitives ===== */
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+typedef struct {
+    uint8_t *buf;
+    size_t   size;
+    size_t   len;
+    bool     error;
+} out_t;
+
+static void put_u8(out_t *o, uint8_t v)
+{
+    if (o->len >= o->size) {
+        o->error = true;
+        return;
+    }
+    o->buf[o->len++] = v;
+}
+
+static void put_varint(out_t *o, uint32_t v)
+{
+    while (v >= 0x80) {
+        put_u8(o, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    put_u8(o, (uint8_t)v);
+}
+
+/* LEB128, at most 5 bytes; latches a reader error on overrun */
+static uint32_t get_varint(wire_reader_t *r)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const uint8_t *p = wire_reader_take(r, 1);
+        if (p == NULL) {
+            return 0;
+        }
+        v |= (uint32_t)(*p & 0x7F) << shift;
+        if (!(*p & 0x80)) {
+            return v;
+        }
+    }
+    r->error = true;
+    return 0;
+}
+
+/* ===== Encoder ===== */
+
+static bool representable(const wire_telemetry_sample_t *s)
+{
+    if (s->controller_count > WIRE_COMPACT_MAX_CONTROLLERS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < s->controller_count; i++) {
+        if (s->controllers[i].controller_id > WIRE_COMPACT_CTRL_ID_MASK ||
+            s->controllers[i].mode > WIRE_COMPACT_CTRL_MODE_MASK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* A delta needs the same controllers and run-state presence as the reference */
+static bool same_shape(const wire_telemetry_sample_t *a, const wire_telemetry_sample_t *b)
+{
+    if (a->controller_count != b->controller_count || a->has_run_state != b->has_run_state) {
+        return false;
+    }
+    for (uint8_t i = 0; i < a->controller_count; i++) {
+        if (a->controllers[i].controller_id != b->controllers[i].controller_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void wire_compact_enc_init(wire_compact_enc_t *enc, uint16_t key_interval)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->key_interval = key_interval;
+}
+
+void wire_compact_enc_force_key(wire_compact_enc_t *enc)
+{
+    enc->have_ref = false;
+}
+
+size_t wire_compact_encode(wire_compact_enc_t *enc, const wire_telemetry_sample_t *sample,
+                           uint8_t *out, size_t out_size, bool *is_key)
+{
+    if (!representable(sample)) {
+        enc->have_ref = false;
+        return 0;
+    }
+
+    bool key = !enc->have_ref || !same_shape(&enc->ref, sample) ||
+               (enc->key_interval != 0 && enc->since_key >= enc->key_interval);
+
+    /* Keyframes are deltas against an all-zero reference */
+    static const wire_telemetry_sample_t zero;
+    const wire_telemetry_sample_t *ref = key ? &zero : &enc->ref;
+    out_t o = { .buf = out, .size = out_size };
+
+    uint8_t flags = sample->controller_count;
+    if (key) {
+        flags |= WIRE_COMPACT_FLAG_KEY | WIRE_COMPACT_FLAG_IO | WIRE_COMPACT_FLAG_ALARM;
+    } else {
+        if (((sample->di_bits ^ ref->di_bits) | (sample->ro_bits ^ ref->ro_bits)) & 0xFF) {
+            flags |= WIRE_COMPACT_FLAG_IO;
+        }
+        if (sample->alarm_bits != ref->alarm_bits) {
+            flags |= WIRE_COMPACT_FLAG_ALARM;
+        }
+    }
+    if (sample->has_run_state) {
+        flags |= WIRE_COMPACT_FLAG_RUN;
+        if (sample->run_state.precool_eta != ref->run_state.precool_eta) {
+            flags |= WIRE_COMPACT_FLAG_ETA;
+        }
+    }
+
+    uint32_t dt = sample->timestamp_ms - ref->timestamp_ms;
+    put_u8(&o, flags);
+    put_varint(&o, dt);
+    if (flags & WIRE_COMPACT_FLAG_IO) {
+        put_u8(&o, (uint8_t)sample->di_bits);
+        put_u8(&o, (uint8_t)sample->ro_bits);
+    }
+    if (flags & WIRE_COMPACT_FLAG_ALARM) {
+        put_varint(&o, sample->alarm_bits);
+    }
+
+    for (uint8_t i = 0; i < sample->controller_count; i++) {
+        const wire_controller_data_t *c = &sample->controllers[i];
+        const wire_controller_data_t *p = &ref->controllers[i];
+        int32_t d_pv = (int32_t)c->pv_x10 - p->pv_x10;
+        int32_t d_sv = (int32_t)c->sv_x10 - p->sv_x10;
+        int32_t d_op = (int32_t)c->op_x10 - p->op_x10;
+
+        uint8_t head = c->controller_id | (c->mode << WIRE_COMPACT_CTRL_MODE_SHIFT);
+        if (key || d_pv != 0) head |= WIRE_COMPACT_CTRL_PV;
+        if (key || d_sv != 0) head |= WIRE_COMPACT_CTRL_SV;
+        if (key || d_op != 0) head |= WIRE_COMPACT_CTRL_OP;
+        if (key || c->age_ms != p->age_ms) head |= WIRE_COMPACT_CTRL_AGE;
+
+        put_u8(&o, head);
+        if (head & WIRE_COMPACT_CTRL_PV) put_varint(&o, zigzag(d_pv));
+        if (head & WIRE_COMPACT_CTRL_SV) put_varint(&o, zigzag(d_sv));
+        if (head & WIRE_COMPACT_CTRL_OP) put_varint(&o, zigzag(d_op));
+        if (head & WIRE_COMPACT_CTRL_AGE) put_varint(&o, c->age_ms);
+    }
+
+    if (sample->has_run_state) {
+        const wire_telemetry_run_state_t *r = &sample->run_state;
+        const wire_telemetry_run_state_t *p = &ref->run_state;
+
+        /* Timers are predicted to advance with the timestamp between deltas */
+        uint32_t pdt = key ? 0 : dt;
+        int32_t d_elapsed = (int32_t)(r->run_elapsed_ms - (p->run_elapsed_ms + pdt));
+        int32_t d_remaining = (int32_t)(r->run_remaining_ms - (p->run_remaining_ms - pdt));
+        int32_t d_target = (int32_t)r->target_temp_x10 - p->target_temp_x10;
+
+        uint8_t mask = r->lazy_poll_active ? WIRE_COMPACT_RUN_LAZY : 0;
+        if (key || r->machine_state != p->machine_state) mask |= WIRE_COMPACT_RUN_STATE;
+        if (key || d_elapsed != 0) mask |= WIRE_COMPACT_RUN_ELAPSED;
+        if (key || d_remaining != 0) mask |= WIRE_COMPACT_RUN_REMAINING;
+        if (key || d_target != 0) mask |= WIRE_COMPACT_RUN_TARGET;
+        if (key || r->recipe_step != p->recipe_step) mask |= WIRE_COMPACT_RUN_STEP;
+        if (key || r->interlock_bits != p->interlock_bits) mask |= WIRE_COMPACT_RUN_INTERLOCK;
+        if (key || r->idle_timeout_min != p->idle_timeout_min) mask |= WIRE_COMPACT_RUN_IDLE;
+
+        put_u8(&o, mask);
+        if (mask & WIRE_COMPACT_RUN_STATE) put_u8(&o, r->machine_state);
+        if (mask & WIRE_COMPACT_RUN_ELAPSED) put_varint(&o, zigzag(d_elapsed));
+        if (mask & WIRE_COMPACT_RUN_REMAINING) put_varint(&o, zigzag(d_remaining));
+        if (mask & WIRE_COMPACT_RUN_TARGET) put_varint(&o, zigzag(d_target));
+        if (mask & WIRE_COMPACT_RUN_STEP) put_u8(&o, r->recipe_step);
+        if (mask & WIRE_COMPACT_RUN_INTERLOCK) put_u8(&o, r->interlock_bits);
+        if (mask & WIRE_COMPACT_RUN_IDLE) put_u8(&o, r->idle_timeout_min);
+        if (flags & WIRE_COMPACT_FLAG_ETA) put_u8(&o, r->precool_eta);
+    }
+
+    if (o.error) {
+        enc->have_ref = false;
+        return 0;
+    }
+
+    /* Keep the reference identical to what the decoder reconstructs */
+    enc->ref = *sample;
+    enc->ref.di_bits &= 0xFF;
+    enc->ref.ro_bits &= 0xFF;
+    enc->ref.run_state.lazy_poll_active = sample->run_state.lazy_poll_active ? 1 : 0;
+    enc->have_ref = true;
+    enc->since_key = key ? 1 : enc->since_key + 1;
+    if (is_key) {
+        *is_key = key;
+    }
+    return o.len;
+}
+
+/* ===== Decoder ===== */
+
+void wire_compact_dec_init(wire_compact_dec_t *dec)
+{
+    memset(dec, 0, sizeof(*dec));
+}
+
+wire_compact_result_t wire_compact_decode(wire_compact_dec_t *dec, uint16_t seq,
+                                          const uint8_t *payload, size_t len,
+                                          wire_telemetry_sample_t *out)
+{
+    wire_reader_t r;
+    wire_reader_init(&r, payload, len);
+
+    uint8_t flags = wire_get_u8(&r);
+    bool key = (flags & WIRE_COMPACT_FLAG_KEY) != 0;
+    uint8_t count = flags & WIRE_COMPACT_FLAG_COUNT_MASK;
+    bool has_run = (flags & WIRE_COMPACT_FLAG_RUN) != 0;
+
+    if (!wire_reader_ok(&r)) {
+        dec->have_ref = false;
+        return WIRE_COMPACT_MALFORMED;
+    }
+    if (!key && (!dec->have_ref || seq != (uint16_t)(dec->last_seq + 1))) {
+        dec->have_ref = false;
+        return WIRE_COMPACT_NEED_KEY;
+    }
+
+    wire_telemetry_sample_t s;
+    if (key) {
+        memset(&s, 0, sizeof(s));
+    } else {
+        s = dec->ref;
+        if (count != s.controller_count || has_run != s.has_run_state) {
+            dec->have_ref = false;
+            return WIRE_COMPACT_MALFORMED;
+        }
+    }
+    s.controller_count = count;
+    s.has_run_state = has_run;
+
+    uint32_t dt = get_varint(&r);
+    s.timestamp_ms += dt;
+    if (flags & WIRE_COMPACT_FLAG_IO) {
+        s.di_bits = wire_get_u8(&r);
+        s.ro_bits = wire_get_u8(&r);
+    }
+    if (flags & WIRE_COMPACT_FLAG_ALARM) {
+        s.alarm_bits = get_varint(&r);
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        wire_controller_data_t *c = &s.controllers[i];
+        uint8_t head = wire_get_u8(&r);
+        uint8_t id = head & WIRE_COMPACT_CTRL_ID_MASK;
+
+        if (!key && id != c->controller_id) {
+            r.error = true;
+        }
+        c->controller_id = id;
+        c->mode = (head >> WIRE_COMPACT_CTRL_MODE_SHIFT) & WIRE_COMPACT_CTRL_MODE_MASK;
+        if (head & WIRE_COMPACT_CTRL_PV) c->pv_x10 += (int16_t)unzigzag(get_varint(&r));
+        if (head & WIRE_COMPACT_CTRL_SV) c->sv_x10 += (int16_t)unzigzag(get_varint(&r));
+        if (head & WIRE_COMPACT_CTRL_OP) c->op_x10 += (uint16_t)unzigzag(get_varint(&r));
+        if (head & WIRE_COMPACT_CTRL_AGE) c->age_ms = (uint16_t)get_varint(&r);
+    }
+
+    if (has_run) {
+        wire_telemetry_run_state_t *rs = &s.run_state;
+        uint8_t mask = wire_get_u8(&r);
+
+        if (!key) {
+            rs->run_elapsed_ms += dt;
+            rs->run_remaining_ms -= dt;
+        }
+        rs->lazy_poll_active = (mask & WIRE_COMPACT_RUN_LAZY) ? 1 : 0;
+        if (mask & WIRE_COMPACT_RUN_STATE) rs->machine_state = wire_get_u8(&r);
+        if (mask & WIRE_COMPACT_RUN_ELAPSED) {
+            rs->run_elapsed_ms += (uint32_t)unzigzag(get_varint(&r));
+        }
+        if (mask & WIRE_COMPACT_RUN_REMAINING) {
+            rs->run_remaining_ms += (uint32_t)unzigzag(get_varint(&r));
+        }
+        if (mask & WIRE_COMPACT_RUN_TARGET) {
+            rs->target_temp_x10 += (int16_t)unzigzag(get_varint(&r));
+        }
+        if (mask & WIRE_COMPACT_RUN_STEP) rs->recipe_step = wire_get_u8(&r);
+        if (mask & WIRE_COMPACT_RUN_INTERLOCK) rs->interlock_bits = wire_get_u8(&r);
+        if (mask & WIRE_COMPACT_RUN_IDLE) rs->idle_timeout_min = wire_get_u8(&r);
+        if (flags & WIRE_COMPACT_FLAG_ETA) rs->precool_eta = wire_get_u8(&r);
+    } else if (flags & WIRE_COMPACT_FLAG_ETA) {
+        r.error = true;
+    }
+
+    if (!wire_reader_ok(&r) || wire_reader_remaining(&r) != 0) {
+        dec->have_ref = false;
+        return WIRE_COMPACT_MALFORMED;
+    }
+
+    dec->ref = s;
+    dec->have_ref = true;
+    dec->last_seq = seq;
+    if (out) {
+        *out = s;
+    }
+    return WIRE_COMPACT_OK;
+}
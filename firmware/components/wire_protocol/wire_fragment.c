@@ -0,0 +1,247 @@
+#include "wire_fragment.h"
+#include <string.h>
+
+/* ATT notification / write header (opcode + handle) */
+#define ATT_PDU_OVERHEAD    3
+
+static inline uint16_t rd_u16(const uint8_t *p)
+{
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t rd_u32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline bool block_held(const wire_reasm_t *r, uint16_t block)
+{
+    return (r->bitmap[block >> 3] >> (block & 7)) & 1;
+}
+
+/* ===== Reassembly ===== */
+
+void wire_reasm_init(wire_reasm_t *r, uint8_t *buf, uint32_t buf_size,
+                     uint8_t *bitmap, uint16_t max_blocks)
+{
+    memset(r, 0, sizeof(*r));
+    r->buf = buf;
+    r->buf_size = buf_size;
+    r->bitmap = bitmap;
+    r->max_blocks = max_blocks;
+}
+
+void wire_reasm_reset(wire_reasm_t *r)
+{
+    r->state = WIRE_REASM_IDLE;
+    r->blocks_received = 0;
+    r->block_count = 0;
+    r->total_len = 0;
+}
+
+wire_reasm_result_t wire_reasm_accept(wire_reasm_t *r, const uint8_t *payload,
+                                      size_t len, uint32_t now_ms)
+{
+    if (payload == NULL || len < WIRE_FRAG_HEADER_SIZE) {
+        return WIRE_REASM_ERR_MALFORMED;
+    }
+
+    uint16_t transfer_id = rd_u16(&payload[0]);
+    uint8_t  object_type = payload[2];
+    uint16_t chunk_size = rd_u16(&payload[4]);
+    uint32_t total_len = rd_u32(&payload[6]);
+    uint32_t offset = rd_u32(&payload[10]);
+    const uint8_t *data = &payload[WIRE_FRAG_HEADER_SIZE];
+    size_t data_len = len - WIRE_FRAG_HEADER_SIZE;
+
+    if (chunk_size == 0 || total_len == 0 || offset % chunk_size != 0 || offset >= total_len) {
+        return WIRE_REASM_ERR_MALFORMED;
+    }
+
+    if (r->state != WIRE_REASM_IDLE && transfer_id == r->transfer_id) {
+        if (r->state == WIRE_REASM_COMPLETE) {
+            return WIRE_REASM_DUPLICATE;
+        }
+        /* Same transfer: geometry must not change mid-way */
+        if (chunk_size != r->chunk_size || total_len != r->total_len ||
+            object_type != r->object_type) {
+            return WIRE_REASM_ERR_MALFORMED;
+        }
+    } else {
+        if (r->state == WIRE_REASM_ACTIVE) {
+            return WIRE_REASM_ERR_BUSY;
+        }
+
+        /* Start a new transfer */
+        uint32_t blocks = (total_len + chunk_size - 1) / chunk_size;
+        if (total_len > r->buf_size || blocks > r->max_blocks) {
+            return WIRE_REASM_ERR_TOO_LARGE;
+        }
+
+        r->state = WIRE_REASM_ACTIVE;
+        r->transfer_id = transfer_id;
+        r->object_type = object_type;
+        r->chunk_size = chunk_size;
+        r->total_len = total_len;
+        r->block_count = (uint16_t)blocks;
+        r->blocks_received = 0;
+        r->started_ms = now_ms;
+        r->last_rx_ms = now_ms;
+        memset(r->bitmap, 0, (blocks + 7) / 8);
+    }
+
+    uint16_t block = (uint16_t)(offset / chunk_size);
+    uint32_t expect = total_len - offset;
+    if (expect > chunk_size) {
+        expect = chunk_size;
+    }
+    if (data_len != expect) {
+        return WIRE_REASM_ERR_MALFORMED;
+    }
+
+    if (block_held(r, block)) {
+        return WIRE_REASM_DUPLICATE;
+    }
+
+    memcpy(&r->buf[offset], data, data_len);
+    r->bitmap[block >> 3] |= (uint8_t)(1 << (block & 7));
+    r->blocks_received++;
+    r->last_rx_ms = now_ms;
+
+    if (r->blocks_received == r->block_count) {
+        r->state = WIRE_REASM_COMPLETE;
+        return WIRE_REASM_DONE;
+    }
+    return WIRE_REASM_OK;
+}
+
+wire_reasm_poll_t wire_reasm_poll(wire_reasm_t *r, uint32_t now_ms,
+                                  uint32_t gap_timeout_ms, uint32_t transfer_timeout_ms)
+{
+    if (r->state != WIRE_REASM_ACTIVE) {
+        return WIRE_REASM_POLL_IDLE;
+    }
+
+    if (now_ms - r->started_ms >= transfer_timeout_ms) {
+        wire_reasm_reset(r);
+        return WIRE_REASM_POLL_TIMEOUT;
+    }
+
+    if (now_ms - r->last_rx_ms >= gap_timeout_ms) {
+        /* Restart the gap timer so the next NACK waits for retransmits */
+        r->last_rx_ms = now_ms;
+        return WIRE_REASM_POLL_NACK;
+    }
+
+    return WIRE_REASM_POLL_WAIT;
+}
+
+size_t wire_reasm_build_nack(const wire_reasm_t *r, uint16_t transfer_id, uint8_t status,
+                             uint8_t *out, size_t out_size)
+{
+    if (out_size < WIRE_FRAG_NACK_HEADER_SIZE) {
+        return 0;
+    }
+
+    out[0] = transfer_id & 0xFF;
+    out[1] = (transfer_id >> 8) & 0xFF;
+    out[2] = status;
+    out[3] = 0;
+    size_t len = WIRE_FRAG_NACK_HEADER_SIZE;
+
+    if (status != WIRE_FRAG_STATUS_MISSING || r->state != WIRE_REASM_ACTIVE ||
+        transfer_id != r->transfer_id) {
+        return len;
+    }
+
+    uint8_t count = 0;
+    for (uint16_t b = 0; b < r->block_count && count < WIRE_FRAG_NACK_MAX_MISSING; b++) {
+        if (block_held(r, b)) {
+            continue;
+        }
+        if (len + 2 > out_size) {
+            break;
+        }
+        out[len++] = b & 0xFF;
+        out[len++] = (b >> 8) & 0xFF;
+        count++;
+    }
+    out[3] = count;
+    return len;
+}
+
+/* ===== Sender helpers ===== */
+
+uint16_t wire_frag_chunk_for_mtu(uint16_t mtu)
+{
+    size_t overhead = ATT_PDU_OVERHEAD + WIRE_HEADER_SIZE + WIRE_CRC_SIZE + WIRE_FRAG_HEADER_SIZE;
+    if (mtu <= overhead) {
+        return 0;
+    }
+
+    size_t chunk = mtu - overhead;
+    if (chunk > WIRE_MAX_PAYLOAD - WIRE_FRAG_HEADER_SIZE) {
+        chunk = WIRE_MAX_PAYLOAD - WIRE_FRAG_HEADER_SIZE;
+    }
+    return (uint16_t)chunk;
+}
+
+size_t wire_build_fragment(uint8_t *out_buf, size_t out_buf_size, uint16_t seq,
+                           uint16_t transfer_id, uint8_t object_type, uint16_t chunk_size,
+                           const uint8_t *object, uint32_t total_len, uint16_t block)
+{
+    if (chunk_size == 0 || chunk_size > WIRE_MAX_PAYLOAD - WIRE_FRAG_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint32_t offset = (uint32_t)block * chunk_size;
+    if (offset >= total_len) {
+        return 0;
+    }
+
+    uint32_t data_len = total_len - offset;
+    if (data_len > chunk_size) {
+        data_len = chunk_size;
+    }
+
+    uint8_t payload[WIRE_MAX_PAYLOAD];
+    payload[0]  = transfer_id & 0xFF;
+    payload[1]  = (transfer_id >> 8) & 0xFF;
+    payload[2]  = object_type;
+    payload[3]  = 0;
+    payload[4]  = chunk_size & 0xFF;
+    payload[5]  = (chunk_size >> 8) & 0xFF;
+    payload[6]  = total_len & 0xFF;
+    payload[7]  = (total_len >> 8) & 0xFF;
+    payload[8]  = (total_len >> 16) & 0xFF;
+    payload[9]  = (total_len >> 24) & 0xFF;
+    payload[10] = offset & 0xFF;
+    payload[11] = (offset >> 8) & 0xFF;
+    payload[12] = (offset >> 16) & 0xFF;
+    payload[13] = (offset >> 24) & 0xFF;
+    memcpy(&payload[WIRE_FRAG_HEADER_SIZE], &object[offset], data_len);
+
+    return wire_build_frame(out_buf, out_buf_size, MSG_TYPE_FRAGMENT, seq,
+                            payload, (uint16_t)(WIRE_FRAG_HEADER_SIZE + data_len));
+}
+
+bool wire_parse_frag_nack(const uint8_t *payload, size_t len, wire_frag_nack_t *out,
+                          const uint8_t **missing_out)
+{
+    if (payload == NULL || out == NULL || len < WIRE_FRAG_NACK_HEADER_SIZE) {
+        return false;
+    }
+
+    out->transfer_id = rd_u16(&payload[0]);
+    out->status = payload[2];
+    out->missing_count = payload[3];
+
+    if (len < WIRE_FRAG_NACK_HEADER_SIZE + (size_t)out->missing_count * 2) {
+        return false;
+    }
+
+    if (missing_out) {
+        *missing_out = &payload[WIRE_FRAG_NACK_HEADER_SIZE];
+    }
+    return true;
+}
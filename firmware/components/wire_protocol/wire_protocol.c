@@ -1,88 +1,249 @@
 #include "wire_protocol.h"
+#include "crc16.h"
+#include <stddef.h>
 #include <string.h>
 
-/*
- * CRC-16/CCITT-FALSE lookup table
- * Poly: 0x1021, Init: 0xFFFF
- */
-static const uint16_t crc16_table[256] = {
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
-    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
-    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
-    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
-    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
-    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
-    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
-    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
-    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
-    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
-    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
-    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
-    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
-    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
-    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
-    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
-    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
-    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
-};
+uint16_t wire_crc16_update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    return crc16_ccitt_update(crc, data, len);
+}
 
 uint16_t wire_crc16(const uint8_t *data, size_t len)
 {
-    uint16_t crc = 0xFFFF;
-    for (size_t i = 0; i < len; i++) {
-        crc = (crc << 8) ^ crc16_table[((crc >> 8) ^ data[i]) & 0xFF];
+    return wire_crc16_update(0xFFFF, data, len);
+}
+
+/* ===== Streaming writer ===== */
+
+static void writer_flush(wire_writer_t *w)
+{
+    if (w->stage_len == 0 || w->error) {
+        w->stage_len = 0;
+        return;
+    }
+
+    if (w->sink) {
+        if (!w->sink(w->sink_ctx, w->stage, w->stage_len)) {
+            w->error = true;
+        }
+    } else if (w->len + w->stage_len <= w->buf_size) {
+        memcpy(&w->buf[w->len], w->stage, w->stage_len);
+    } else {
+        w->error = true;
     }
-    return crc;
+
+    w->len += w->stage_len;
+    w->stage_len = 0;
 }
 
-size_t wire_build_frame(
-    uint8_t *out_buf,
-    size_t out_buf_size,
-    uint8_t msg_type,
-    uint16_t seq,
-    const uint8_t *payload,
-    uint16_t payload_len)
+/* Append raw frame bytes (header, payload or CRC) without touching the CRC */
+static void writer_emit(wire_writer_t *w, const uint8_t *data, size_t len)
 {
-    size_t total_len = WIRE_HEADER_SIZE + payload_len + WIRE_CRC_SIZE;
-    if (out_buf_size < total_len || payload_len > WIRE_MAX_PAYLOAD) {
-        return 0;
+    while (len > 0 && !w->error) {
+        size_t room = WIRE_WRITER_STAGE_SIZE - w->stage_len;
+        size_t n = len < room ? len : room;
+        memcpy(&w->stage[w->stage_len], data, n);
+        w->stage_len += n;
+        data += n;
+        len -= n;
+        if (w->stage_len == WIRE_WRITER_STAGE_SIZE) {
+            writer_flush(w);
+        }
+    }
+}
+
+void wire_writer_init_buf(wire_writer_t *w, uint8_t *buf, size_t buf_size)
+{
+    memset(w, 0, offsetof(wire_writer_t, stage));
+    w->buf = buf;
+    w->buf_size = buf_size;
+}
+
+void wire_writer_init_sink(wire_writer_t *w, wire_sink_fn_t sink, void *ctx)
+{
+    memset(w, 0, offsetof(wire_writer_t, stage));
+    w->sink = sink;
+    w->sink_ctx = ctx;
+}
+
+bool wire_writer_begin(wire_writer_t *w, uint8_t msg_type, uint16_t seq, uint16_t payload_len)
+{
+    if (payload_len > WIRE_MAX_PAYLOAD ||
+        (w->sink == NULL && w->buf_size < (size_t)WIRE_HEADER_SIZE + payload_len + WIRE_CRC_SIZE)) {
+        w->error = true;
+        return false;
     }
 
-    // Build header (little-endian)
-    out_buf[0] = WIRE_PROTO_VERSION;
-    out_buf[1] = msg_type;
-    out_buf[2] = seq & 0xFF;
-    out_buf[3] = (seq >> 8) & 0xFF;
-    out_buf[4] = payload_len & 0xFF;
-    out_buf[5] = (payload_len >> 8) & 0xFF;
-
-    // Copy payload
-    if (payload && payload_len > 0) {
-        memcpy(&out_buf[WIRE_HEADER_SIZE], payload, payload_len);
+    uint8_t hdr[WIRE_HEADER_SIZE] = {
+        WIRE_PROTO_VERSION,
+        msg_type,
+        seq & 0xFF,
+        (seq >> 8) & 0xFF,
+        payload_len & 0xFF,
+        (payload_len >> 8) & 0xFF,
+    };
+
+    w->payload_len = payload_len;
+    w->payload_written = 0;
+    w->crc = wire_crc16_update(0xFFFF, hdr, sizeof(hdr));
+    writer_emit(w, hdr, sizeof(hdr));
+    return !w->error;
+}
+
+void wire_writer_put_bytes(wire_writer_t *w, const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (data == NULL || w->payload_written + len > w->payload_len) {
+        w->error = true;
+        return;
     }
 
-    // Compute CRC over header + payload
-    uint16_t crc = wire_crc16(out_buf, WIRE_HEADER_SIZE + payload_len);
+    w->crc = wire_crc16_update(w->crc, data, len);
+    w->payload_written += len;
+    writer_emit(w, data, len);
+}
+
+void wire_writer_put_u8(wire_writer_t *w, uint8_t v)
+{
+    wire_writer_put_bytes(w, &v, 1);
+}
+
+void wire_writer_put_u16(wire_writer_t *w, uint16_t v)
+{
+    uint8_t b[2] = { v & 0xFF, (v >> 8) & 0xFF };
+    wire_writer_put_bytes(w, b, sizeof(b));
+}
+
+void wire_writer_put_u32(wire_writer_t *w, uint32_t v)
+{
+    uint8_t b[4] = { v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, (v >> 24) & 0xFF };
+    wire_writer_put_bytes(w, b, sizeof(b));
+}
+
+size_t wire_writer_finish(wire_writer_t *w)
+{
+    if (w->payload_written != w->payload_len) {
+        w->error = true;
+    }
 
     // Append CRC (little-endian)
-    out_buf[WIRE_HEADER_SIZE + payload_len] = crc & 0xFF;
-    out_buf[WIRE_HEADER_SIZE + payload_len + 1] = (crc >> 8) & 0xFF;
+    uint8_t crc[WIRE_CRC_SIZE] = { w->crc & 0xFF, (w->crc >> 8) & 0xFF };
+    writer_emit(w, crc, sizeof(crc));
+    writer_flush(w);
+
+    return w->error ? 0 : w->len;
+}
+
+/* ===== Frame writers ===== */
+
+size_t wire_write_frame(wire_writer_t *w, uint8_t msg_type, uint16_t seq,
+                        const uint8_t *payload, uint16_t payload_len)
+{
+    wire_writer_begin(w, msg_type, seq, payload_len);
+    wire_writer_put_bytes(w, payload, payload_len);
+    return wire_writer_finish(w);
+}
+
+size_t wire_write_cmd_ack(wire_writer_t *w, uint16_t seq, uint16_t acked_seq,
+                          uint16_t cmd_id, uint8_t status, uint16_t detail,
+                          const uint8_t *optional_data, size_t optional_len)
+{
+    size_t payload_len = sizeof(wire_cmd_ack_t) + optional_len;
+    if (payload_len > WIRE_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    wire_writer_begin(w, MSG_TYPE_COMMAND_ACK, seq, (uint16_t)payload_len);
+    wire_writer_put_u16(w, acked_seq);
+    wire_writer_put_u16(w, cmd_id);
+    wire_writer_put_u8(w, status);
+    wire_writer_put_u16(w, detail);
+    wire_writer_put_bytes(w, optional_data, optional_len);
+    return wire_writer_finish(w);
+}
+
+size_t wire_write_telemetry(wire_writer_t *w, uint16_t seq, uint32_t timestamp_ms,
+                            uint16_t di_bits, uint16_t ro_bits, uint32_t alarm_bits,
+                            const wire_controller_data_t *controllers,
+                            uint8_t controller_count,
+                            const wire_telemetry_run_state_t *run_state)
+{
+    if (controller_count > 3) {
+        return 0;
+    }
+
+    size_t payload_len = sizeof(wire_telemetry_header_t) +
+                         controller_count * sizeof(wire_controller_data_t) +
+                         ((run_state != NULL) ? sizeof(wire_telemetry_run_state_t) : 0);
+
+    wire_writer_begin(w, MSG_TYPE_TELEMETRY_SNAPSHOT, seq, (uint16_t)payload_len);
+
+    // Telemetry header
+    wire_writer_put_u32(w, timestamp_ms);
+    wire_writer_put_u16(w, di_bits);
+    wire_writer_put_u16(w, ro_bits);
+    wire_writer_put_u32(w, alarm_bits);
+    wire_writer_put_u8(w, controller_count);
+
+    // Controller data
+    for (uint8_t i = 0; i < controller_count; i++) {
+        const wire_controller_data_t *c = &controllers[i];
+        wire_writer_put_u8(w, c->controller_id);
+        wire_writer_put_u16(w, (uint16_t)c->pv_x10);
+        wire_writer_put_u16(w, (uint16_t)c->sv_x10);
+        wire_writer_put_u16(w, c->op_x10);
+        wire_writer_put_u8(w, c->mode);
+        wire_writer_put_u16(w, c->age_ms);
+    }
 
-    return total_len;
+    // Extended run state (16 bytes)
+    if (run_state != NULL) {
+        wire_writer_put_u8(w, run_state->machine_state);
+        wire_writer_put_u32(w, run_state->run_elapsed_ms);
+        wire_writer_put_u32(w, run_state->run_remaining_ms);
+        wire_writer_put_u16(w, (uint16_t)run_state->target_temp_x10);
+        wire_writer_put_u8(w, run_state->recipe_step);
+        wire_writer_put_u8(w, run_state->interlock_bits);
+        wire_writer_put_u8(w, run_state->lazy_poll_active);
+        wire_writer_put_u8(w, run_state->idle_timeout_min);
+        wire_writer_put_u8(w, run_state->precool_eta);
+    }
+
+    return wire_writer_finish(w);
+}
+
+size_t wire_write_event(wire_writer_t *w, uint16_t seq, uint16_t event_id,
+                        uint8_t severity, uint8_t source,
+                        const uint8_t *event_data, size_t event_data_len)
+{
+    size_t payload_len = sizeof(wire_event_header_t) + event_data_len;
+    if (payload_len > WIRE_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    wire_writer_begin(w, MSG_TYPE_EVENT, seq, (uint16_t)payload_len);
+    wire_writer_put_u16(w, event_id);
+    wire_writer_put_u8(w, severity);
+    wire_writer_put_u8(w, source);
+    wire_writer_put_bytes(w, event_data, event_data_len);
+    return wire_writer_finish(w);
+}
+
+/* ===== Flat-buffer builders ===== */
+
+size_t wire_build_frame(
+    uint8_t *out_buf,
+    size_t out_buf_size,
+    uint8_t msg_type,
+    uint16_t seq,
+    const uint8_t *payload,
+    uint16_t payload_len)
+{
+    wire_writer_t w;
+    wire_writer_init_buf(&w, out_buf, out_buf_size);
+    return wire_write_frame(&w, msg_type, seq, payload, payload_len);
 }
 
 bool wire_parse_frame(
@@ -140,27 +301,10 @@ size_t wire_build_cmd_ack(
     const uint8_t *optional_data,
     size_t optional_len)
 {
-    uint8_t payload[WIRE_MAX_PAYLOAD];
-    size_t payload_len = sizeof(wire_cmd_ack_t) + optional_len;
-
-    if (payload_len > WIRE_MAX_PAYLOAD) {
-        return 0;
-    }
-
-    // Build ACK payload (little-endian)
-    payload[0] = acked_seq & 0xFF;
-    payload[1] = (acked_seq >> 8) & 0xFF;
-    payload[2] = cmd_id & 0xFF;
-    payload[3] = (cmd_id >> 8) & 0xFF;
-    payload[4] = status;
-    payload[5] = detail & 0xFF;
-    payload[6] = (detail >> 8) & 0xFF;
-
-    if (optional_data && optional_len > 0) {
-        memcpy(&payload[sizeof(wire_cmd_ack_t)], optional_data, optional_len);
-    }
-
-    return wire_build_frame(out_buf, out_buf_size, MSG_TYPE_COMMAND_ACK, seq, payload, payload_len);
+    wire_writer_t w;
+    wire_writer_init_buf(&w, out_buf, out_buf_size);
+    return wire_write_cmd_ack(&w, seq, acked_seq, cmd_id, status, detail,
+                              optional_data, optional_len);
 }
 
 size_t wire_build_telemetry(
@@ -174,51 +318,10 @@ size_t wire_build_telemetry(
     const wire_controller_data_t *controllers,
     uint8_t controller_count)
 {
-    uint8_t payload[WIRE_MAX_PAYLOAD];
-    size_t payload_len = sizeof(wire_telemetry_header_t) +
-                         controller_count * sizeof(wire_controller_data_t);
-
-    if (payload_len > WIRE_MAX_PAYLOAD || controller_count > 3) {
-        return 0;
-    }
-
-    // Build telemetry header (little-endian)
-    size_t offset = 0;
-
-    payload[offset++] = timestamp_ms & 0xFF;
-    payload[offset++] = (timestamp_ms >> 8) & 0xFF;
-    payload[offset++] = (timestamp_ms >> 16) & 0xFF;
-    payload[offset++] = (timestamp_ms >> 24) & 0xFF;
-
-    payload[offset++] = di_bits & 0xFF;
-    payload[offset++] = (di_bits >> 8) & 0xFF;
-
-    payload[offset++] = ro_bits & 0xFF;
-    payload[offset++] = (ro_bits >> 8) & 0xFF;
-
-    payload[offset++] = alarm_bits & 0xFF;
-    payload[offset++] = (alarm_bits >> 8) & 0xFF;
-    payload[offset++] = (alarm_bits >> 16) & 0xFF;
-    payload[offset++] = (alarm_bits >> 24) & 0xFF;
-
-    payload[offset++] = controller_count;
-
-    // Append controller data
-    for (uint8_t i = 0; i < controller_count; i++) {
-        const wire_controller_data_t *c = &controllers[i];
-        payload[offset++] = c->controller_id;
-        payload[offset++] = c->pv_x10 & 0xFF;
-        payload[offset++] = (c->pv_x10 >> 8) & 0xFF;
-        payload[offset++] = c->sv_x10 & 0xFF;
-        payload[offset++] = (c->sv_x10 >> 8) & 0xFF;
-        payload[offset++] = c->op_x10 & 0xFF;
-        payload[offset++] = (c->op_x10 >> 8) & 0xFF;
-        payload[offset++] = c->mode;
-        payload[offset++] = c->age_ms & 0xFF;
-        payload[offset++] = (c->age_ms >> 8) & 0xFF;
-    }
-
-    return wire_build_frame(out_buf, out_buf_size, MSG_TYPE_TELEMETRY_SNAPSHOT, seq, payload, offset);
+    wire_writer_t w;
+    wire_writer_init_buf(&w, out_buf, out_buf_size);
+    return wire_write_telemetry(&w, seq, timestamp_ms, di_bits, ro_bits, alarm_bits,
+                                controllers, controller_count, NULL);
 }
 
 size_t wire_build_telemetry_ext(
@@ -233,77 +336,10 @@ size_t wire_build_telemetry_ext(
     uint8_t controller_count,
     const wire_telemetry_run_state_t *run_state)
 {
-    uint8_t payload[WIRE_MAX_PAYLOAD];
-    size_t base_len = sizeof(wire_telemetry_header_t) +
-                      controller_count * sizeof(wire_controller_data_t);
-    size_t ext_len = (run_state != NULL) ? sizeof(wire_telemetry_run_state_t) : 0;
-    size_t payload_len = base_len + ext_len;
-
-    if (payload_len > WIRE_MAX_PAYLOAD || controller_count > 3) {
-        return 0;
-    }
-
-    // Build telemetry header (little-endian)
-    size_t offset = 0;
-
-    payload[offset++] = timestamp_ms & 0xFF;
-    payload[offset++] = (timestamp_ms >> 8) & 0xFF;
-    payload[offset++] = (timestamp_ms >> 16) & 0xFF;
-    payload[offset++] = (timestamp_ms >> 24) & 0xFF;
-
-    payload[offset++] = di_bits & 0xFF;
-    payload[offset++] = (di_bits >> 8) & 0xFF;
-
-    payload[offset++] = ro_bits & 0xFF;
-    payload[offset++] = (ro_bits >> 8) & 0xFF;
-
-    payload[offset++] = alarm_bits & 0xFF;
-    payload[offset++] = (alarm_bits >> 8) & 0xFF;
-    payload[offset++] = (alarm_bits >> 16) & 0xFF;
-    payload[offset++] = (alarm_bits >> 24) & 0xFF;
-
-    payload[offset++] = controller_count;
-
-    // Append controller data
-    for (uint8_t i = 0; i < controller_count; i++) {
-        const wire_controller_data_t *c = &controllers[i];
-        payload[offset++] = c->controller_id;
-        payload[offset++] = c->pv_x10 & 0xFF;
-        payload[offset++] = (c->pv_x10 >> 8) & 0xFF;
-        payload[offset++] = c->sv_x10 & 0xFF;
-        payload[offset++] = (c->sv_x10 >> 8) & 0xFF;
-        payload[offset++] = c->op_x10 & 0xFF;
-        payload[offset++] = (c->op_x10 >> 8) & 0xFF;
-        payload[offset++] = c->mode;
-        payload[offset++] = c->age_ms & 0xFF;
-        payload[offset++] = (c->age_ms >> 8) & 0xFF;
-    }
-
-    // Append extended run state if provided (16 bytes total)
-    if (run_state != NULL) {
-        payload[offset++] = run_state->machine_state;
-
-        payload[offset++] = run_state->run_elapsed_ms & 0xFF;
-        payload[offset++] = (run_state->run_elapsed_ms >> 8) & 0xFF;
-        payload[offset++] = (run_state->run_elapsed_ms >> 16) & 0xFF;
-        payload[offset++] = (run_state->run_elapsed_ms >> 24) & 0xFF;
-
-        payload[offset++] = run_state->run_remaining_ms & 0xFF;
-        payload[offset++] = (run_state->run_remaining_ms >> 8) & 0xFF;
-        payload[offset++] = (run_state->run_remaining_ms >> 16) & 0xFF;
-        payload[offset++] = (run_state->run_remaining_ms >> 24) & 0xFF;
-
-        payload[offset++] = run_state->target_temp_x10 & 0xFF;
-        payload[offset++] = (run_state->target_temp_x10 >> 8) & 0xFF;
-
-        payload[offset++] = run_state->recipe_step;
-        payload[offset++] = run_state->interlock_bits;
-        payload[offset++] = run_state->lazy_poll_active;
-        payload[offset++] = run_state->idle_timeout_min;
-        payload[offset++] = run_state->reserved;  // offset 15 - padding to 16 bytes
-    }
-
-    return wire_build_frame(out_buf, out_buf_size, MSG_TYPE_TELEMETRY_SNAPSHOT, seq, payload, offset);
+    wire_writer_t w;
+    wire_writer_init_buf(&w, out_buf, out_buf_size);
+    return wire_write_telemetry(&w, seq, timestamp_ms, di_bits, ro_bits, alarm_bits,
+                                controllers, controller_count, run_state);
 }
 
 size_t wire_build_event(
@@ -316,22 +352,7 @@ size_t wire_build_event(
     const uint8_t *event_data,
     size_t event_data_len)
 {
-    uint8_t payload[WIRE_MAX_PAYLOAD];
-    size_t payload_len = sizeof(wire_event_header_t) + event_data_len;
-
-    if (payload_len > WIRE_MAX_PAYLOAD) {
-        return 0;
-    }
-
-    // Build event header (little-endian)
-    payload[0] = event_id & 0xFF;
-    payload[1] = (event_id >> 8) & 0xFF;
-    payload[2] = severity;
-    payload[3] = source;
-
-    if (event_data && event_data_len > 0) {
-        memcpy(&payload[sizeof(wire_event_header_t)], event_data, event_data_len);
-    }
-
-    return wire_build_frame(out_buf, out_buf_size, MSG_TYPE_EVENT, seq, payload, payload_len);
+    wire_writer_t w;
+    wire_writer_init_buf(&w, out_buf, out_buf_size);
+    return wire_write_event(&w, seq, event_id, severity, source, event_data, event_data_len);
 }
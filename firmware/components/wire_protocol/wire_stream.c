@@ -0,0 +1,218 @@
+#include "wire_stream.h"
+#include <string.h>
+
+typedef enum {
+    CAND_NEED_MORE,             /* Valid so far, frame incomplete */
+    CAND_OK,                    /* Complete frame, CRC good */
+    CAND_BAD_START,             /* First byte is not proto_ver */
+    CAND_BAD_LEN,               /* payload_len out of range */
+    CAND_BAD_CRC,               /* Complete frame, CRC mismatch */
+} cand_result_t;
+
+static inline uint16_t rd_u16(const uint8_t *p)
+{
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+/*
+ * Classify the bytes at p as a frame candidate. On CAND_OK, *frame_len is
+ * the full frame length (header + payload + CRC).
+ */
+static cand_result_t check_candidate(const wire_stream_t *s, const uint8_t *p, size_t n,
+                                     size_t *frame_len)
+{
+    if (n == 0) {
+        return CAND_NEED_MORE;
+    }
+    if (p[0] != WIRE_PROTO_VERSION) {
+        return CAND_BAD_START;
+    }
+    if (n < WIRE_HEADER_SIZE) {
+        return CAND_NEED_MORE;
+    }
+
+    uint16_t payload_len = rd_u16(&p[4]);
+    size_t len = WIRE_HEADER_SIZE + (size_t)payload_len + WIRE_CRC_SIZE;
+    if (payload_len > WIRE_MAX_PAYLOAD || len > s->buf_size) {
+        return CAND_BAD_LEN;
+    }
+    if (n < len) {
+        return CAND_NEED_MORE;
+    }
+
+    size_t crc_offset = WIRE_HEADER_SIZE + payload_len;
+    if (rd_u16(&p[crc_offset]) != wire_crc16(p, crc_offset)) {
+        return CAND_BAD_CRC;
+    }
+
+    *frame_len = len;
+    return CAND_OK;
+}
+
+static void emit(wire_stream_t *s, const uint8_t *frame)
+{
+    wire_frame_header_t header = {
+        .proto_ver = frame[0],
+        .msg_type = frame[1],
+        .seq = rd_u16(&frame[2]),
+        .payload_len = rd_u16(&frame[4]),
+    };
+
+    s->stats.frames++;
+    s->in_sync = true;
+    if (s->on_frame) {
+        s->on_frame(s->ctx, &header,
+                    header.payload_len > 0 ? &frame[WIRE_HEADER_SIZE] : NULL);
+    }
+}
+
+static void note_reject(wire_stream_t *s, cand_result_t r)
+{
+    if (r == CAND_BAD_CRC) {
+        s->stats.crc_errors++;
+    } else if (r == CAND_BAD_LEN) {
+        s->stats.len_errors++;
+    }
+}
+
+/* Count skipped bytes; the first skip after a good frame is one resync */
+static void discard(wire_stream_t *s, size_t n)
+{
+    if (n == 0) {
+        return;
+    }
+    if (s->in_sync) {
+        s->in_sync = false;
+        s->stats.resyncs++;
+    }
+    s->stats.bytes_discarded += n;
+}
+
+/* Offset of the next proto_ver byte in p[0..n), or n if none */
+static size_t find_start(const uint8_t *p, size_t n)
+{
+    const uint8_t *hit = memchr(p, WIRE_PROTO_VERSION, n);
+    return hit ? (size_t)(hit - p) : n;
+}
+
+static void buf_consume(wire_stream_t *s, size_t n)
+{
+    s->fill -= n;
+    if (s->fill > 0) {
+        memmove(s->buf, &s->buf[n], s->fill);
+    }
+}
+
+/*
+ * Process whatever the partial buffer holds until it is empty or holds a
+ * valid-so-far prefix. After a rejected candidate the buffered bytes are
+ * rescanned, so frames hidden inside a bogus length are still recovered.
+ */
+static size_t drain_buffer(wire_stream_t *s)
+{
+    size_t frames = 0;
+
+    while (s->fill > 0) {
+        size_t frame_len = 0;
+        cand_result_t r = check_candidate(s, s->buf, s->fill, &frame_len);
+
+        if (r == CAND_NEED_MORE) {
+            break;
+        }
+        if (r == CAND_OK) {
+            emit(s, s->buf);
+            s->stats.frames_copied++;
+            frames++;
+            buf_consume(s, frame_len);
+        } else {
+            note_reject(s, r);
+            discard(s, 1);
+            buf_consume(s, 1);
+        }
+
+        size_t skip = find_start(s->buf, s->fill);
+        discard(s, skip);
+        buf_consume(s, skip);
+    }
+    return frames;
+}
+
+/* ===== Public API ===== */
+
+bool wire_stream_init(wire_stream_t *s, uint8_t *buf, size_t buf_size,
+                      wire_stream_frame_cb_t on_frame, void *ctx)
+{
+    if (s == NULL || buf == NULL || buf_size < WIRE_STREAM_BUF_MIN) {
+        return false;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->buf = buf;
+    s->buf_size = buf_size;
+    s->on_frame = on_frame;
+    s->ctx = ctx;
+    s->in_sync = true;
+    return true;
+}
+
+void wire_stream_reset(wire_stream_t *s)
+{
+    discard(s, s->fill);
+    s->fill = 0;
+}
+
+size_t wire_stream_feed(wire_stream_t *s, const uint8_t *data, size_t len)
+{
+    size_t frames = 0;
+
+    while (len > 0) {
+        if (s->fill > 0) {
+            /* Top up the pending candidate: header first, then exactly the rest */
+            size_t want;
+            if (s->fill < WIRE_HEADER_SIZE) {
+                want = WIRE_HEADER_SIZE - s->fill;
+            } else {
+                want = WIRE_HEADER_SIZE + rd_u16(&s->buf[4]) + WIRE_CRC_SIZE - s->fill;
+            }
+            if (want > len) {
+                want = len;
+            }
+
+            memcpy(&s->buf[s->fill], data, want);
+            s->fill += want;
+            data += want;
+            len -= want;
+            frames += drain_buffer(s);
+            continue;
+        }
+
+        /* Nothing pending: work directly on the caller's bytes */
+        size_t skip = find_start(data, len);
+        discard(s, skip);
+        data += skip;
+        len -= skip;
+        if (len == 0) {
+            break;
+        }
+
+        size_t frame_len = 0;
+        cand_result_t r = check_candidate(s, data, len, &frame_len);
+        if (r == CAND_OK) {
+            emit(s, data);
+            frames++;
+            data += frame_len;
+            len -= frame_len;
+        } else if (r == CAND_NEED_MORE) {
+            /* Tail of the chunk is a frame prefix - fits by construction */
+            memcpy(s->buf, data, len);
+            s->fill = len;
+            len = 0;
+        } else {
+            note_reject(s, r);
+            discard(s, 1);
+            data++;
+            len--;
+        }
+    }
+    return frames;
+}
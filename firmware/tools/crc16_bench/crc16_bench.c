@@ -0,0 +1,283 @@
+/*
+ * Host conformance check and benchmark for the crc16 kernels.
+ *
+ * Build (from firmware/), once per kernel width:
+ *   cc -O2 -std=gnu11 [-DCONFIG_CRC16_SLICE_BY_8=1] \
+ *      -Itools/crc16_bench -Itools/machine_state_sim/host -Icomponents/crc16 \
+ *      -Icomponents/crc16/include -Icomponents/wire_protocol/include \
+ *      tools/crc16_bench/crc16_bench.c tools/crc16_bench/crc16_ref.c \
+ *      components/crc16/crc16.c components/crc16/crc16_tables.c \
+ *      components/wire_protocol/wire_protocol.c -o /tmp/crc16_bench
+ * or just run tools/crc16_bench/run.sh, which builds and runs slice-by-4 and -8.
+ *
+ * Usage:
+ *   crc16_bench [--seed S]      conformance against the removed byte-wise kernels
+ *   crc16_bench --bench MB      MB/s and bytes/cycle per buffer length
+ *
+ * The check compares crc16_ccitt_update() / crc16_modbus_update(), the
+ * streaming ctx API and wire_crc16() against the byte-wise wire/Modbus
+ * kernels they replaced (crc16_ref.c) and a bit-serial loop:
+ *   - the standard check values and crc16_self_test()
+ *   - every length 0..MAX_LEN at every start alignment 0..15, from the
+ *     init value and from a random running value
+ *   - every two-way split of every length 0..SPLIT_LEN
+ *   - random multi-chunk feeds of random lengths up to 4 KB
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crc16.h"
+#include "crc16_tables.h"
+#include "crc16_ref.h"
+#include "wire_protocol.h"
+
+#define MAX_LEN             1100    /* Past the 512-byte wire frame and 256-byte RTU frame */
+#define MAX_ALIGN           16
+#define SPLIT_LEN           300
+#define FEED_TRIALS         20000
+#define FEED_MAX_LEN        4096
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "CHECK failed: %s (%s:%d): ", #cond, __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fputc('\n', stderr); \
+            exit(1); \
+        } \
+    } while (0)
+
+typedef uint16_t (*crc_kernel_t)(uint16_t crc, const uint8_t *data, size_t len);
+
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 16);
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)rnd();
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* ===== Conformance ===== */
+
+static void check_one(const uint8_t *p, size_t len, uint16_t crc, size_t align)
+{
+    uint16_t ref_c = ref_wire_crc16_update(crc, p, len);
+    uint16_t ref_m = ref_modbus_crc16_update(crc, p, len);
+
+    CHECK(ref_ccitt_bitwise(crc, p, len) == ref_c, "ccitt byte-wise vs bit-serial, len %zu", len);
+    CHECK(ref_modbus_bitwise(crc, p, len) == ref_m, "modbus byte-wise vs bit-serial, len %zu", len);
+    CHECK(crc16_ccitt_update(crc, p, len) == ref_c,
+          "ccitt len %zu align %zu crc 0x%04X", len, align, crc);
+    CHECK(crc16_modbus_update(crc, p, len) == ref_m,
+          "modbus len %zu align %zu crc 0x%04X", len, align, crc);
+    if (crc == 0xFFFF) {
+        CHECK(wire_crc16(p, len) == ref_c, "wire_crc16 len %zu align %zu", len, align);
+    }
+}
+
+static void check_lengths(void)
+{
+    static uint8_t buf[MAX_ALIGN + MAX_LEN] __attribute__((aligned(16)));
+    fill_random(buf, sizeof(buf));
+
+    for (size_t align = 0; align < MAX_ALIGN; align++) {
+        for (size_t len = 0; len <= MAX_LEN; len++) {
+            check_one(&buf[align], len, 0xFFFF, align);
+            check_one(&buf[align], len, (uint16_t)rnd(), align);
+        }
+    }
+}
+
+static void check_splits(void)
+{
+    static uint8_t buf[MAX_ALIGN + SPLIT_LEN] __attribute__((aligned(16)));
+    fill_random(buf, sizeof(buf));
+
+    for (size_t len = 0; len <= SPLIT_LEN; len++) {
+        const uint8_t *p = &buf[len % MAX_ALIGN];
+        uint16_t ref_c = ref_wire_crc16_update(CRC16_CCITT_INIT, p, len);
+        uint16_t ref_m = ref_modbus_crc16_update(CRC16_MODBUS_INIT, p, len);
+
+        for (size_t split = 0; split <= len; split++) {
+            crc16_ctx_t cc, mc;
+            crc16_ccitt_init(&cc);
+            crc16_ccitt_feed(&cc, p, split);
+            crc16_ccitt_feed(&cc, p + split, len - split);
+            crc16_modbus_init(&mc);
+            crc16_modbus_feed(&mc, p, split);
+            crc16_modbus_feed(&mc, p + split, len - split);
+
+            CHECK(crc16_ccitt_final(&cc) == ref_c, "ccitt len %zu split %zu", len, split);
+            CHECK(crc16_modbus_final(&mc) == ref_m, "modbus len %zu split %zu", len, split);
+        }
+    }
+}
+
+static void check_feeds(void)
+{
+    static uint8_t buf[MAX_ALIGN + FEED_MAX_LEN] __attribute__((aligned(16)));
+
+    for (int trial = 0; trial < FEED_TRIALS; trial++) {
+        size_t len = rnd() % (FEED_MAX_LEN + 1);
+        const uint8_t *p = &buf[rnd() % MAX_ALIGN];
+        fill_random((uint8_t *)p, len);
+
+        /* Chunk sizes from 1..8 up to 1..1024, mixed within a trial */
+        crc16_ctx_t cc, mc;
+        crc16_ccitt_init(&cc);
+        crc16_modbus_init(&mc);
+        for (size_t off = 0; off < len;) {
+            size_t n = 1 + rnd() % (8u << (rnd() % 8));
+            if (n > len - off) {
+                n = len - off;
+            }
+            crc16_ccitt_feed(&cc, p + off, n);
+            crc16_modbus_feed(&mc, p + off, n);
+            off += n;
+        }
+
+        CHECK(crc16_ccitt_final(&cc) == ref_wire_crc16_update(CRC16_CCITT_INIT, p, len),
+              "ccitt trial %d len %zu", trial, len);
+        CHECK(crc16_modbus_final(&mc) == ref_modbus_crc16_update(CRC16_MODBUS_INIT, p, len),
+              "modbus trial %d len %zu", trial, len);
+    }
+}
+
+static int run_check(void)
+{
+    static const uint8_t check[] = "123456789";
+
+    CHECK(crc16_ccitt(check, 9) == CRC16_CCITT_CHECK, "ccitt check value");
+    CHECK(crc16_modbus(check, 9) == CRC16_MODBUS_CHECK, "modbus check value");
+    CHECK(ref_wire_crc16_update(0xFFFF, check, 9) == CRC16_CCITT_CHECK, "reference ccitt");
+    CHECK(ref_modbus_crc16_update(0xFFFF, check, 9) == CRC16_MODBUS_CHECK, "reference modbus");
+    CHECK(crc16_self_test() == ESP_OK, "crc16_self_test()");
+
+    check_lengths();
+    check_splits();
+    check_feeds();
+
+    printf("slice-by-%d: lengths 0..%d x %d alignments, all splits 0..%d, %d chunked feeds: ok\n",
+           CRC16_SLICES, MAX_LEN, MAX_ALIGN, SPLIT_LEN, FEED_TRIALS);
+    return 0;
+}
+
+/* ===== Benchmark ===== */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+static uint64_t cycles(void)
+{
+    return __rdtsc();
+}
+#else
+#define HAVE_TSC 0
+static uint64_t cycles(void)
+{
+    return 0;
+}
+#endif
+
+typedef struct {
+    double mb_s;
+    double bytes_per_cycle;
+} bench_result_t;
+
+static bench_result_t time_kernel(crc_kernel_t fn, const uint8_t *data, size_t len, size_t total)
+{
+    size_t reps = total / len + 1;
+    volatile uint16_t sink = 0;
+
+    /* Chain the result so the calls cannot overlap or be hoisted */
+    uint16_t crc = 0xFFFF;
+    uint64_t t0 = now_ns(), c0 = cycles();
+    for (size_t r = 0; r < reps; r++) {
+        crc = fn(crc, data, len);
+    }
+    uint64_t c1 = cycles(), t1 = now_ns();
+    sink = crc;
+    (void)sink;
+
+    double bytes = (double)len * (double)reps;
+    return (bench_result_t){
+        .mb_s = bytes / (double)(t1 - t0) * 1e3,
+        .bytes_per_cycle = HAVE_TSC ? bytes / (double)(c1 - c0) : 0.0,
+    };
+}
+
+static int run_bench(unsigned mb)
+{
+    static const size_t lens[] = { 8, 20, 64, 244, 512, 4096 };
+    static const struct {
+        const char  *name;
+        crc_kernel_t fn;
+    } kernels[] = {
+        { "ccitt byte-wise", ref_wire_crc16_update },
+        { "ccitt sliced",    crc16_ccitt_update },
+        { "modbus byte-wise", ref_modbus_crc16_update },
+        { "modbus sliced",   crc16_modbus_update },
+    };
+    static uint8_t buf[4096] __attribute__((aligned(16)));
+    fill_random(buf, sizeof(buf));
+    size_t total = (size_t)mb << 20;
+
+    printf("slice-by-%d, %u MB per point%s\n", CRC16_SLICES, mb,
+           HAVE_TSC ? "; bytes/cycle in TSC cycles" : "");
+    printf("%-17s", "len");
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        printf(" %16zu", lens[i]);
+    }
+    printf("\n");
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        printf("%-17s", kernels[k].name);
+        for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+            bench_result_t r = time_kernel(kernels[k].fn, buf, lens[i], total);
+            printf(" %8.0f MB/s", r.mb_s);
+            if (HAVE_TSC) {
+                printf(" %4.2f", r.bytes_per_cycle);
+            } else {
+                printf("     ");
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned bench_mb = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            s_rng = strtoull(argv[++i], NULL, 0) | 1;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_mb = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--seed S] | --bench MB\n", argv[0]);
+            return 2;
+        }
+    }
+    return bench_mb ? run_bench(bench_mb) : run_check();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Byte-wise kernels removed from wire_protocol.c / modbus_master.c (crc16_ref.c) */
+uint16_t ref_wire_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+uint16_t ref_modbus_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/* Bit-serial, straight from the polynomial */
+uint16_t ref_ccitt_bitwise(uint16_t crc, const uint8_t *data, size_t len);
+uint16_t ref_modbus_bitwise(uint16_t crc, const uint8_t *data, size_t len);
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+# Build the crc16 host harness for slice-by-4 and slice-by-8 and check both against the
+# byte-wise kernels they replaced. Extra arguments are passed through, e.g. run.sh --bench 64
+set -euo pipefail
+cd "$(dirname "$0")/../.."
+for slices in 4 8; do
+    out="${TMPDIR:-/tmp}/crc16_bench_$slices"
+    defs=""
+    if [ "$slices" = 8 ]; then
+        defs="-DCONFIG_CRC16_SLICE_BY_8=1"
+    fi
+    cc -O2 -std=gnu11 -Wall -Wextra -Wno-unused-parameter $defs \
+        -Itools/crc16_bench -Itools/machine_state_sim/host -Icomponents/crc16 \
+        -Icomponents/crc16/include -Icomponents/wire_protocol/include \
+        tools/crc16_bench/crc16_bench.c tools/crc16_bench/crc16_ref.c \
+        components/crc16/crc16.c components/crc16/crc16_tables.c \
+        components/wire_protocol/wire_protocol.c -o "$out"
+    "$out" "$@"
+done
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Host simulation of E-stop / door detection latency: 50 ms poll vs TCA9534 INT.
+
+Usage: tools/di_latency_sim.py [--trials N] [--poll-ms MS] [--i2c-hz HZ] ...
+
+Models the machine_state path from an input edge to the safe relay pattern:
+
+  poll:  edge -> next state tick -> DI read -> transition_to(E_STOP) -> 1 relay write
+  irq:   edge -> INT low -> ISR -> task notify -> DI read -> ... same as above
+
+I2C transaction times are derived from the bus clock (relay_ctrl runs the
+expanders at 100 kHz); the safe pattern is one relay_ctrl transaction commit.
+The state task can be delayed by a queued command it is still applying,
+modelled as an occasional busy period of up to --busy-ms. An INT
+edge is missed with probability --miss (e.g. a change that lands while INT
+is still asserted and the post-read level check is disabled); those fall
+back to the poll path. Compare the result with
+machine_state_get_di_stats() on hardware.
+"""
+import argparse, random
+
+I2C_BITS_PER_BYTE = 9           # 8 data + ACK
+I2C_FRAME_OVERHEAD_BITS = 2     # START / STOP
+
+
+def i2c_us(nbytes, hz, driver_us):
+    return (nbytes * I2C_BITS_PER_BYTE + I2C_FRAME_OVERHEAD_BITS) * 1e6 / hz + driver_us
+
+
+def simulate(args, use_irq, rng):
+    read_us = i2c_us(2, args.i2c_hz, args.driver_us) + i2c_us(2, args.i2c_hz, args.driver_us)
+    write_us = i2c_us(3, args.i2c_hz, args.driver_us)
+    safe_us = args.relay_writes * write_us
+    poll_us = args.poll_ms * 1000
+
+    out = []
+    for _ in range(args.trials):
+        edge = rng.uniform(0, poll_us)              # Phase of the edge within a tick
+        # A command being applied at the edge keeps the task busy for the rest of it
+        busy_until = edge
+        if rng.random() < args.busy_p:
+            busy_until += rng.uniform(0, args.busy_ms * 1000)
+
+        if use_irq and rng.random() >= args.miss:
+            start = edge + args.isr_wake_us
+        else:
+            start = poll_us + args.tick_jitter_us * rng.random()   # Next periodic tick
+
+        # The task reads DI and ticks once it is free
+        t = max(start, busy_until) + read_us + safe_us
+        out.append(t - edge)
+    return sorted(out)
+
+
+def pct(v, p):
+    return v[min(len(v) - 1, int(p / 100.0 * len(v)))]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--trials", type=int, default=100000)
+    ap.add_argument("--poll-ms", type=float, default=50, help="STATE_POLL_INTERVAL_MS")
+    ap.add_argument("--i2c-hz", type=float, default=100000, help="RELAY_I2C_FREQ_HZ")
+    ap.add_argument("--driver-us", type=float, default=60, help="per-transaction driver overhead")
+    ap.add_argument("--relay-writes", type=int, default=1,
+                    help="output writes to reach the safe pattern (6 before relay transactions)")
+    ap.add_argument("--isr-wake-us", type=float, default=15, help="ISR + notify + context switch")
+    ap.add_argument("--tick-jitter-us", type=float, default=200)
+    ap.add_argument("--busy-p", type=float, default=0.02,
+                    help="chance the state task is applying a command at the edge")
+    ap.add_argument("--busy-ms", type=float, default=5)
+    ap.add_argument("--miss", type=float, default=0.0, help="fraction of INT edges missed")
+    ap.add_argument("--seed", type=int, default=1)
+    args = ap.parse_args()
+
+    print(f"{args.trials} edges, poll {args.poll_ms:g} ms, I2C {args.i2c_hz / 1000:g} kHz, "
+          f"{args.relay_writes} relay writes")
+    print(f"{'path':<6}{'p50 ms':>9}{'p90 ms':>9}{'p99 ms':>9}{'max ms':>9}")
+    for name, use_irq in (("poll", False), ("irq", True)):
+        v = simulate(args, use_irq, random.Random(args.seed))
+        print(f"{name:<6}" + "".join(f"{pct(v, p) / 1000:>9.2f}" for p in (50, 90, 99)) +
+              f"{v[-1] / 1000:>9.2f}")
+
+
+if __name__ == "__main__":
+    main()
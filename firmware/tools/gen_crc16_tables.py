@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Generate slice-by-N lookup tables for components/crc16.
+
+Usage: tools/gen_crc16_tables.py [components/crc16/crc16_tables.c]
+
+Table k holds the CRC contribution of a byte followed by k zero bytes, so
+N bytes can be folded with N independent lookups. Rows 4..7 are only
+compiled when CONFIG_CRC16_SLICE_BY_8 is set.
+"""
+import os, sys
+
+SLICES = 8
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_OUT = os.path.join(HERE, "..", "components", "crc16", "crc16_tables.c")
+
+
+def ccitt_tables():
+    """CRC-16/CCITT-FALSE: poly 0x1021, MSB-first."""
+    t0 = []
+    for b in range(256):
+        crc = b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        t0.append(crc & 0xFFFF)
+    tables = [t0]
+    for _ in range(1, SLICES):
+        prev = tables[-1]
+        tables.append([((v << 8) & 0xFFFF) ^ t0[v >> 8] for v in prev])
+    return tables
+
+
+def modbus_tables():
+    """CRC-16/MODBUS: poly 0xA001 (reflected 0x8005), LSB-first."""
+    t0 = []
+    for b in range(256):
+        crc = b
+        for _ in range(8):
+            crc = ((crc >> 1) ^ 0xA001) if crc & 1 else (crc >> 1)
+        t0.append(crc)
+    tables = [t0]
+    for _ in range(1, SLICES):
+        prev = tables[-1]
+        tables.append([(v >> 8) ^ t0[v & 0xFF] for v in prev])
+    return tables
+
+
+def emit_array(lines, name, tables):
+    lines.append(f"CRC16_TABLE_ATTR const uint16_t {name}[CRC16_SLICES][256] = {{")
+    for k, table in enumerate(tables):
+        if k == 4:
+            lines.append("#if CRC16_SLICES > 4")
+        lines.append(f"    {{   /* T{k} */")
+        for row in range(0, 256, 8):
+            vals = ", ".join(f"0x{v:04X}" for v in table[row:row + 8])
+            lines.append(f"        {vals},")
+        lines.append("    },")
+    lines.append("#endif")
+    lines.append("};")
+
+
+def main():
+    out_path = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_OUT
+
+    lines = [
+        "/*",
+        " * Slice-by-N CRC-16 lookup tables",
+        " *",
+        " * GENERATED by firmware/tools/gen_crc16_tables.py - do not edit.",
+        " */",
+        "",
+        '#include "crc16_tables.h"',
+        "",
+        "/* CRC-16/CCITT-FALSE (poly 0x1021, MSB-first) */",
+    ]
+    emit_array(lines, "crc16_ccitt_tables", ccitt_tables())
+    lines += ["", "/* CRC-16/MODBUS (poly 0xA001, LSB-first) */"]
+    emit_array(lines, "crc16_modbus_tables", modbus_tables())
+
+    with open(out_path, "w", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+    print(f"Wrote {os.path.normpath(out_path)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+"""Generate COMMAND payload decoders and golden vectors from the wire schema.
+
+Usage: tools/gen_wire_schema.py
+
+Reads  components/wire_protocol/schema/commands.json
+Writes components/wire_protocol/include/wire_cmd_schema.h  (structs, decoders, table X-macro)
+       components/wire_protocol/wire_cmd_schema.c          (descriptor table, layout asserts)
+       components/wire_protocol/schema/vectors.json        (golden frames for app-side tests)
+"""
+import json, os, struct, sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+WIRE = os.path.join(HERE, "..", "components", "wire_protocol")
+SCHEMA = os.path.join(WIRE, "schema", "commands.json")
+
+TYPES = {
+    #       C type      size  reader            struct fmt
+    "u8":  ("uint8_t",  1,    "wire_get_u8",    "<B"),
+    "u16": ("uint16_t", 2,    "wire_get_u16",   "<H"),
+    "i16": ("int16_t",  2,    "wire_get_i16",   "<h"),
+    "u32": ("uint32_t", 4,    "wire_get_u32",   "<I"),
+}
+
+BANNER = "GENERATED by firmware/tools/gen_wire_schema.py from schema/commands.json - do not edit."
+
+MSG_TYPE_COMMAND = 0x10
+PROTO_VER = 0x01
+VECTOR_SEQ = 0x0001
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        crc &= 0xFFFF
+    return crc
+
+
+def load():
+    with open(SCHEMA) as f:
+        cmds = json.load(f)["commands"]
+
+    seen = set()
+    for c in cmds:
+        c["id"] = int(c["id"], 16)
+        if c["id"] in seen:
+            sys.exit(f"duplicate cmd_id 0x{c['id']:04X} ({c['name']})")
+        seen.add(c["id"])
+        c["lower"] = c["name"].lower()
+        c["flags"] = "WIRE_CMD_F_OBSERVER" if c.get("observer") else "0"
+
+        optional = False
+        c["min_len"] = c["max_len"] = 0
+        for fld in c["fields"]:
+            if fld["type"] not in TYPES:
+                sys.exit(f"{c['name']}.{fld['name']}: unknown type {fld['type']}")
+            size = TYPES[fld["type"]][1]
+            if fld.get("optional"):
+                optional = True
+            elif optional:
+                sys.exit(f"{c['name']}.{fld['name']}: required field after optional field")
+            else:
+                c["min_len"] += size
+            c["max_len"] += size
+    return sorted(cmds, key=lambda c: c["id"])
+
+
+def gen_header(cmds):
+    L = [
+        "#pragma once",
+        "",
+        "/*",
+        " * COMMAND payload decoders",
+        " *",
+        f" * {BANNER}",
+        " *",
+        " * One struct + decoder per command that carries a payload. Decoders",
+        " * read through wire_reader_t, so a short payload fails cleanly instead",
+        " * of reading past the frame. Trailing bytes beyond the schema are ignored.",
+        " */",
+        "",
+        "#include <stdint.h>",
+        "#include <stdbool.h>",
+        '#include "wire_protocol.h"',
+        "",
+        "#ifdef __cplusplus",
+        'extern "C" {',
+        "#endif",
+        "",
+        "/* Command may be sent by an observer session (read-only) */",
+        "#define WIRE_CMD_F_OBSERVER     (1 << 0)",
+        "",
+        "/* X(NAME, cmd_id, lower_name, min_len, max_len, flags) - sorted by cmd_id */",
+        "#define WIRE_CMD_TABLE(X) \\",
+    ]
+    rows = [f"    X({c['name']}, 0x{c['id']:04X}, {c['lower']}, {c['min_len']}, {c['max_len']}, "
+            f"{c['flags']})" for c in cmds]
+    L += [r + " \\" for r in rows[:-1]] + rows[-1:]
+    L += [
+        "",
+        "/* X(NAME, lower_name, min_len, max_len) - commands with a wire_decode_<lower_name>() */",
+        "#define WIRE_CMD_DECODERS(X) \\",
+    ]
+    rows = [f"    X({c['name']}, {c['lower']}, {c['min_len']}, {c['max_len']})"
+            for c in cmds if c["fields"]]
+    L += [r + " \\" for r in rows[:-1]] + rows[-1:]
+    L += [
+        "",
+        "typedef struct {",
+        "    uint16_t    cmd_id;",
+        "    uint8_t     min_len;        /* Payload bytes required (after cmd_id + flags) */",
+        "    uint8_t     max_len;        /* Payload bytes decoded incl. optional fields */",
+        "    uint8_t     flags;          /* WIRE_CMD_F_* */",
+        "    const char *name;",
+        "} wire_cmd_desc_t;",
+        "",
+        "/**",
+        " * @brief Look up a command in the schema table",
+        " *",
+        " * @return Descriptor, or NULL for an unknown cmd_id",
+        " */",
+        "const wire_cmd_desc_t *wire_cmd_lookup(uint16_t cmd_id);",
+    ]
+
+    for c in cmds:
+        if not c["fields"]:
+            continue
+        t = f"wire_req_{c['lower']}_t"
+        L += ["", f"/* {c['name']} (0x{c['id']:04X}) */", "typedef struct {"]
+        for fld in c["fields"]:
+            ctype = TYPES[fld["type"]][0]
+            note = f"    /* Optional, default {fld.get('default', 0)} */" if fld.get("optional") else ""
+            L.append(f"    {ctype + ' ' + fld['name'] + ';':<28}{note}".rstrip())
+        L += [f"}} {t};", ""]
+        L.append(f"static inline bool wire_decode_{c['lower']}(wire_reader_t *r, {t} *out)")
+        L.append("{")
+        for fld in c["fields"]:
+            reader = TYPES[fld["type"]][2]
+            if fld.get("optional"):
+                size = TYPES[fld["type"]][1]
+                L.append(f"    out->{fld['name']} = (wire_reader_remaining(r) >= {size}) ? "
+                         f"{reader}(r) : {fld.get('default', 0)};")
+            else:
+                L.append(f"    out->{fld['name']} = {reader}(r);")
+        L += ["    return wire_reader_ok(r);", "}"]
+
+    L += ["", "#ifdef __cplusplus", "}", "#endif", ""]
+    return "\n".join(L)
+
+
+def gen_source(cmds):
+    L = [
+        "/*",
+        " * COMMAND descriptor table",
+        " *",
+        f" * {BANNER}",
+        " */",
+        "",
+        '#include "wire_cmd_schema.h"',
+        "",
+        "/* Schema IDs must match wire_cmd_id_t */",
+    ]
+    for c in cmds:
+        L.append(f'_Static_assert(CMD_{c["name"]} == 0x{c["id"]:04X}, "CMD_{c["name"]} differs from schema");')
+    L += ["", "/* Packed layouts in wire_protocol.h must match the schema */"]
+    for c in cmds:
+        if "struct" in c:
+            L.append(f'_Static_assert(sizeof({c["struct"]}) == {c["max_len"]}, '
+                     f'"{c["struct"]} differs from schema");')
+    L += [
+        "",
+        "static const wire_cmd_desc_t s_cmd_table[] = {",
+        "#define X(name, id, lower, min_len, max_len, flags) { id, min_len, max_len, flags, #name },",
+        "    WIRE_CMD_TABLE(X)",
+        "#undef X",
+        "};",
+        "",
+        "const wire_cmd_desc_t *wire_cmd_lookup(uint16_t cmd_id)",
+        "{",
+        "    size_t lo = 0;",
+        "    size_t hi = sizeof(s_cmd_table) / sizeof(s_cmd_table[0]);",
+        "",
+        "    while (lo < hi) {",
+        "        size_t mid = (lo + hi) / 2;",
+        "        if (s_cmd_table[mid].cmd_id == cmd_id) {",
+        "            return &s_cmd_table[mid];",
+        "        }",
+        "        if (s_cmd_table[mid].cmd_id < cmd_id) {",
+        "            lo = mid + 1;",
+        "        } else {",
+        "            hi = mid;",
+        "        }",
+        "    }",
+        "    return NULL;",
+        "}",
+        "",
+    ]
+    return "\n".join(L)
+
+
+def gen_vectors(cmds):
+    vectors = []
+    for c in cmds:
+        body = b"".join(struct.pack(TYPES[f["type"]][3], f["example"]) for f in c["fields"])
+        payload = struct.pack("<HH", c["id"], 0) + body
+        header = struct.pack("<BBHH", PROTO_VER, MSG_TYPE_COMMAND, VECTOR_SEQ, len(payload))
+        frame = header + payload
+        frame += struct.pack("<H", crc16_ccitt(frame))
+        vectors.append({
+            "name": c["name"],
+            "cmd_id": f"0x{c['id']:04X}",
+            "fields": {f["name"]: f["example"] for f in c["fields"]},
+            "min_len": c["min_len"],
+            "cmd_payload_hex": body.hex(" ").upper(),
+            "frame_hex": frame.hex(" ").upper(),
+        })
+    return json.dumps({"comment": BANNER, "seq": VECTOR_SEQ, "vectors": vectors}, indent=2) + "\n"
+
+
+def write(path, text):
+    with open(path, "w", newline="\n") as f:
+        f.write(text)
+    print(f"Wrote {os.path.normpath(path)}")
+
+
+def main():
+    cmds = load()
+    write(os.path.join(WIRE, "include", "wire_cmd_schema.h"), gen_header(cmds))
+    write(os.path.join(WIRE, "wire_cmd_schema.c"), gen_source(cmds))
+    write(os.path.join(WIRE, "schema", "vectors.json"), gen_vectors(cmds))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,28 @@
+#pragma once
+
+/* Host build of esp_log.h: silent unless built with -DMS_SIM_LOG (stderr) */
+
+#include <stdio.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#ifdef MS_SIM_LOG
+#define ESP_HOST_LOG(lvl, tag, fmt, ...) \
+    fprintf(stderr, lvl " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#else
+#define ESP_HOST_LOG(lvl, tag, fmt, ...) \
+    do { if (0) fprintf(stderr, "%s " fmt, tag, ##__VA_ARGS__); } while (0)
+#endif
+
+#define ESP_LOGE(tag, fmt, ...) ESP_HOST_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_HOST_LOG("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_HOST_LOG("D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_HOST_LOG("V", tag, fmt, ##__VA_ARGS__)
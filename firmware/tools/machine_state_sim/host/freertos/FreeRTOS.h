@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+ * Host build of the FreeRTOS subset used by the components built under
+ * tools/. Declarations only: each harness implements the calls it needs,
+ * usually single-threaded with hooks for the interleavings it tests.
+ */
+
+#include <stdint.h>
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
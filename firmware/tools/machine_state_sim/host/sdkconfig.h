@@ -0,0 +1,6 @@
+#pragma once
+
+/* Host build of sdkconfig.h: Kconfig defaults for the components built under tools/ */
+
+#define CONFIG_CRC16_SLICE_BY_4 1                   /* crc16: slice-by-4, tables in flash */
+#define CONFIG_RELAY_CTRL_RECONCILE_PERIOD_MS 1000  /* relay_ctrl */
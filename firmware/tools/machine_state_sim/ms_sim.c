@@ -0,0 +1,710 @@
+/*
+ * Host driver for the machine_state core with a virtual clock.
+ *
+ * Build (from firmware/):
+ *   cc -O2 -std=gnu11 -Itools/machine_state_sim/host -Icomponents/machine_state \
+ *      -Icomponents/machine_state/include -Icomponents/wire_protocol/include \
+ *      -Icomponents/recipe/include \
+ *      tools/machine_state_sim/ms_sim.c components/machine_state/machine_state_core.c \
+ *      components/machine_state/precool_eta.c components/machine_state/relay_seq.c \
+ *      components/recipe/recipe_format.c -lm -o /tmp/ms_sim
+ * or just run tools/machine_state_sim/run.sh.
+ *
+ * Usage:
+ *   ms_sim SCENARIO              print the transition trace
+ *   ms_sim --check SCENARIO...   diff each trace against SCENARIO's .trace file
+ *   ms_sim --update SCENARIO...  rewrite the .trace files
+ *   ms_sim --bench N SCENARIO    run the scenario N times, report cycles/s
+ *
+ * Scenario lines (one per line, '#' comments). Commands run at the current
+ * virtual time; only wait/until advance it, one 50 ms tick at a time, plus
+ * the early ticks the core asks for (wake_at) to step relay sequences.
+ *
+ *   di HEX                   raw DI byte (default 0xFF: no E-stop, door closed, LN2)
+ *   estop 0|1                DI1 (1 = pressed)
+ *   door open|closed         DI2
+ *   ln2 0|1                  DI3
+ *   di_fail 0|1              DI reads return ESP_FAIL
+ *   hmi 0|1                  HMI heartbeat live (default 1)
+ *   pv DEG|off               chamber PV in °C, or controller offline
+ *   ramp DEG DEG_PER_S       move PV toward DEG at the given rate every tick
+ *   follow DEG_PER_S         move PV toward the chamber SV at the given rate
+ *   approach DEG TAU_S       exponential approach to DEG with time constant TAU_S
+ *   start MODE TARGET_X10 DURATION_MS
+ *   segment SV_X10 RAMP_X10_PER_MIN HOLD_MS [motor] [wait] [h1=SV_X10] [h2=SV_X10]
+ *                            append a segment to the next start_recipe
+ *   start_recipe MODE [PRECOOL_X10]
+ *                            run the segments given so far as a recipe
+ *   stop normal|abort
+ *   pause keep|stop
+ *   resume
+ *   service on|off
+ *   clear estop|fault
+ *   force_safe
+ *   wait MS                  tick for MS
+ *   until STATE MAX_MS       tick until STATE (or MAX_MS elapsed)
+ *   info                     trace run info (remaining, target, step, precool ETA)
+ *
+ * Trace lines: "<ms> STATE a -> b", "<ms> EVENT 0xID sev [data]",
+ * "<ms> RO 0xBITS" (relay image, on change), "<ms> CMD line" ... "<ms> ACK err",
+ * "<ms> SV addr x10" (setpoint requests, at most one per second per address),
+ * "<ms> INFO ..." (run info),
+ * "<ms> SEQ name i/n +Tms" (relay sequence step i of n written, T after the sequence start),
+ * "<ms> SAFE Nus writes K" (tripping tick: modelled I2C time from the DI read
+ * to the write that turned the last hazard relay off, output writes in the tick).
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "machine_state_core.h"
+#include "recipe.h"
+#include "wire_protocol.h"
+
+#define SIM_T0_US       1000000LL   /* esp_timer is never 0 once the app runs */
+#define SIM_MAX_LINES   512
+#define SIM_PID_COUNT   3
+#define SIM_SV_TRACE_MS 1000        /* Coarser than PID_SV_STREAM_MIN_GAP_MS to keep traces short */
+
+/* TCA95xx transaction times at 100 kHz, START to STOP */
+#define SIM_I2C_WRITE_US    300     /* addr + reg + data */
+#define SIM_I2C_READ_US     400     /* addr + reg, repeated START, addr + data */
+
+/* Relays that must be off in the safe state (all but the chamber light) */
+#define SIM_HAZARD_RELAYS   (uint8_t)~(1 << (RO_CHAMBER_LIGHT - 1))
+
+typedef struct {
+    int64_t  now_us;
+    int64_t  next_tick_us;      /* Periodic tick schedule */
+    int64_t  wake_us;           /* Early tick requested by the core, 0 = none */
+    uint8_t  di;
+    bool     di_fail;
+    bool     hmi_live;
+    bool     pv_valid;
+    float    pv;
+    bool     ramp;
+    float    ramp_to;
+    float    ramp_rate;         /* °C per second */
+    bool     follow;            /* ramp_to tracks the chamber SV */
+    float    tau_s;             /* > 0: exponential approach to ramp_to instead */
+    uint8_t  relays;
+    uint8_t  relays_traced;
+
+    /* Modelled I2C time in the current tick, for E-stop -> safe outputs */
+    uint32_t bus_us;
+    uint32_t bus_writes;
+    int32_t  safe_at_us;        /* bus_us when the hazard relays were all off, -1 = not yet */
+
+    /* Setpoints by PID address - 1 */
+    int16_t  sv[SIM_PID_COUNT];
+    int16_t  sv_traced[SIM_PID_COUNT];
+    int64_t  sv_traced_us[SIM_PID_COUNT];
+
+    /* Recipe under construction */
+    uint8_t  blob[RECIPE_BLOB_MAX];
+    uint8_t  segments;
+
+    bool     tracing;
+    char    *trace;
+    size_t   trace_len;
+    size_t   trace_cap;
+    unsigned long ticks;
+} sim_t;
+
+/* ===== Trace ===== */
+
+static void trace(sim_t *s, const char *fmt, ...)
+{
+    if (!s->tracing) return;
+
+    char line[160];
+    int n = snprintf(line, sizeof(line), "%8lld ", (long long)((s->now_us - SIM_T0_US) / 1000));
+    va_list ap;
+    va_start(ap, fmt);
+    n += vsnprintf(line + n, sizeof(line) - n, fmt, ap);
+    va_end(ap);
+    if (n >= (int)sizeof(line) - 1) n = sizeof(line) - 2;
+    line[n++] = '\n';
+
+    if (s->trace_len + n + 1 > s->trace_cap) {
+        s->trace_cap = (s->trace_cap + n + 1) * 2;
+        s->trace = realloc(s->trace, s->trace_cap);
+        if (s->trace == NULL) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+    memcpy(s->trace + s->trace_len, line, n);
+    s->trace_len += n;
+    s->trace[s->trace_len] = '\0';
+}
+
+/* ===== Environment ===== */
+
+static int64_t env_now_us(void *ctx)
+{
+    return ((sim_t *)ctx)->now_us;
+}
+
+static esp_err_t env_read_di(void *ctx, uint8_t *di_byte)
+{
+    sim_t *s = ctx;
+    if (s->di_fail) return ESP_FAIL;
+    *di_byte = s->di;
+    return ESP_OK;
+}
+
+static bool env_chamber_temp(void *ctx, int16_t *temp_x10)
+{
+    sim_t *s = ctx;
+    if (!s->pv_valid) return false;
+    *temp_x10 = (int16_t)(s->pv * 10.0f);   /* Same conversion as the firmware */
+    return true;
+}
+
+static bool env_hmi_live(void *ctx)
+{
+    return ((sim_t *)ctx)->hmi_live;
+}
+
+static bool env_start_allowed(void *ctx)
+{
+    /* Default safety gates: E-stop, door and HMI block a start */
+    sim_t *s = ctx;
+    bool estop = (s->di & (1 << (DI_ESTOP - 1))) == 0;
+    bool door_open = (s->di & (1 << (DI_DOOR_CLOSED - 1))) == 0;
+    return !estop && !door_open && s->hmi_live;
+}
+
+static void env_set_sv(void *ctx, uint8_t pid_addr, int16_t sv_x10)
+{
+    sim_t *s = ctx;
+    if (pid_addr >= 1 && pid_addr <= SIM_PID_COUNT) {
+        s->sv[pid_addr - 1] = sv_x10;
+    }
+}
+
+/* Trace setpoint changes, coalesced like the firmware's SV stream */
+static void sv_flush(sim_t *s)
+{
+    for (int i = 0; i < SIM_PID_COUNT; i++) {
+        if (s->sv[i] != s->sv_traced[i] &&
+            s->now_us - s->sv_traced_us[i] >= SIM_SV_TRACE_MS * 1000LL) {
+            s->sv_traced[i] = s->sv[i];
+            s->sv_traced_us[i] = s->now_us;
+            trace(s, "SV %d %d", i + 1, s->sv[i]);
+        }
+    }
+}
+
+static esp_err_t env_write_outputs(void *ctx, uint8_t mask, uint8_t values, bool verify)
+{
+    sim_t *s = ctx;
+    s->relays = (s->relays & ~mask) | (values & mask);
+    s->bus_us += SIM_I2C_WRITE_US;
+    s->bus_writes++;
+    if (s->safe_at_us < 0 && (s->relays & SIM_HAZARD_RELAYS) == 0) {
+        s->safe_at_us = (int32_t)s->bus_us;
+    }
+    if (verify) {
+        s->bus_us += SIM_I2C_READ_US;
+    }
+    return ESP_OK;
+}
+
+static void env_outputs_changed(void *ctx)
+{
+    sim_t *s = ctx;
+    if (s->relays != s->relays_traced) {
+        s->relays_traced = s->relays;
+        trace(s, "RO 0x%02X", s->relays);
+    }
+}
+
+static void env_inputs_changed(void *ctx, uint16_t di_bits)
+{
+    (void)ctx;
+    (void)di_bits;
+}
+
+static void env_event(void *ctx, uint16_t event_id, uint8_t severity,
+                      const uint8_t *data, size_t data_len)
+{
+    sim_t *s = ctx;
+    char hex[3 * 8 + 1] = "";
+    for (size_t i = 0; i < data_len && i < 8; i++) {
+        snprintf(hex + 3 * i, sizeof(hex) - 3 * i, " %02X", data[i]);
+    }
+    trace(s, "EVENT 0x%04X sev %u%s", event_id, severity, hex);
+}
+
+static void env_transition(void *ctx, machine_state_t old_state, machine_state_t new_state)
+{
+    trace(ctx, "STATE %s -> %s", machine_state_to_str(old_state),
+          machine_state_to_str(new_state));
+}
+
+static void env_wake_at(void *ctx, int64_t due_us)
+{
+    ((sim_t *)ctx)->wake_us = due_us;
+}
+
+static void env_seq_step(void *ctx, const relay_seq_t *seq, uint8_t index, int64_t started_us)
+{
+    sim_t *s = ctx;
+    trace(s, "SEQ %s %u/%u +%ldms", seq->name, index + 1, seq->count,
+          (long)((s->now_us - started_us) / 1000));
+}
+
+/* ===== Scenario ===== */
+
+typedef struct {
+    const char *path;
+    char       *lines[SIM_MAX_LINES];
+    int         line_no[SIM_MAX_LINES];
+    int         count;
+} scenario_t;
+
+static bool scenario_load(scenario_t *sc, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char buf[256];
+    int no = 0;
+    sc->path = path;
+    sc->count = 0;
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        no++;
+        char *p = buf + strspn(buf, " \t");
+        size_t len = strcspn(p, "#\r\n");
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) len--;
+        p[len] = '\0';
+        if (len == 0) continue;
+        if (sc->count == SIM_MAX_LINES) {
+            fprintf(stderr, "%s: more than %d lines\n", path, SIM_MAX_LINES);
+            fclose(f);
+            return false;
+        }
+        sc->line_no[sc->count] = no;
+        sc->lines[sc->count++] = strdup(p);
+    }
+    fclose(f);
+    return true;
+}
+
+static int parse_state(const char *name)
+{
+    for (int i = 0; i < MACHINE_STATE_MAX; i++) {
+        if (strcmp(name, machine_state_to_str(i)) == 0) return i;
+    }
+    return -1;
+}
+
+static void set_di_bit(sim_t *s, int channel, bool high)
+{
+    uint8_t bit = (uint8_t)(1 << (channel - 1));
+    s->di = high ? (s->di | bit) : (s->di & ~bit);
+}
+
+static void sim_step(sim_t *s, ms_core_t *core);
+
+/* Advance to the next periodic tick, or to an earlier wake_at request */
+static void sim_tick(sim_t *s, ms_core_t *core)
+{
+    if (s->wake_us > s->now_us && s->wake_us < s->next_tick_us) {
+        /* Early tick: like the firmware task, the periodic schedule stays */
+        s->now_us = s->wake_us;
+        s->wake_us = 0;
+        sim_step(s, core);
+        return;
+    }
+
+    s->now_us = s->next_tick_us;
+    s->next_tick_us += MS_CORE_TICK_MS * 1000;
+    if (s->wake_us <= s->now_us) {
+        s->wake_us = 0;
+    }
+    if (s->follow) {
+        s->ramp_to = s->sv[MS_PID_ADDR_CHAMBER - 1] / 10.0f;
+    }
+    if (s->ramp && s->pv_valid && s->tau_s > 0.0f) {
+        s->pv += (s->ramp_to - s->pv) * (MS_CORE_TICK_MS / 1000.0f) / s->tau_s;
+    } else if (s->ramp && s->pv_valid) {
+        float step = s->ramp_rate * MS_CORE_TICK_MS / 1000.0f;
+        if (s->pv > s->ramp_to) {
+            s->pv = (s->pv - step < s->ramp_to) ? s->ramp_to : s->pv - step;
+        } else {
+            s->pv = (s->pv + step > s->ramp_to) ? s->ramp_to : s->pv + step;
+        }
+    }
+    sim_step(s, core);
+}
+
+/* One core tick at the current time */
+static void sim_step(sim_t *s, ms_core_t *core)
+{
+    s->bus_us = SIM_I2C_READ_US;                    /* The DI read below */
+    s->bus_writes = 0;
+    s->safe_at_us = -1;
+    ms_core_read_inputs(core);
+    if (ms_core_tick(core) && s->safe_at_us >= 0) {
+        /* Bus time from the DI read to the write that dropped the last hazard relay */
+        trace(s, "SAFE %ldus writes %lu", (long)s->safe_at_us, (unsigned long)s->bus_writes);
+    }
+    sv_flush(s);
+    s->ticks++;
+}
+
+static void cmd_result(sim_t *s, esp_err_t err)
+{
+    trace(s, "ACK %s", esp_err_to_name(err));
+}
+
+static bool add_segment(sim_t *s, const char *line)
+{
+    recipe_segment_t seg = {
+        .heater_sv_x10 = { RECIPE_SV_UNCHANGED, RECIPE_SV_UNCHANGED },
+    };
+    long sv, rate, hold;
+    int used = 0;
+
+    if (sscanf(line, "segment %ld %ld %ld%n", &sv, &rate, &hold, &used) != 3 ||
+        s->segments == RECIPE_MAX_SEGMENTS) {
+        return false;
+    }
+    seg.chamber_sv_x10 = (int16_t)sv;
+    seg.ramp_x10_per_min = (uint16_t)rate;
+    seg.hold_ms = (uint32_t)hold;
+
+    char opt[16];
+    int n;
+    for (const char *p = line + used; sscanf(p, "%15s%n", opt, &n) == 1; p += n) {
+        if (strcmp(opt, "motor") == 0) {
+            seg.flags |= RECIPE_SEG_MOTOR;
+        } else if (strcmp(opt, "wait") == 0) {
+            seg.flags |= RECIPE_SEG_WAIT_PV;
+        } else if (strncmp(opt, "h1=", 3) == 0 || strncmp(opt, "h2=", 3) == 0) {
+            seg.heater_sv_x10[opt[1] - '1'] = (int16_t)atoi(opt + 3);
+        } else {
+            return false;
+        }
+    }
+
+    memcpy(s->blob + sizeof(recipe_header_t) + s->segments * sizeof(seg), &seg, sizeof(seg));
+    s->segments++;
+    return true;
+}
+
+/* Serialise the pending segments as slot 1 and start them, as recipe_load + START_RUN would */
+static esp_err_t start_recipe(sim_t *s, ms_core_t *core, run_mode_t mode, int16_t precool_x10)
+{
+    recipe_header_t hdr = {
+        .version = RECIPE_FORMAT_VERSION,
+        .slot = 1,
+        .segment_count = s->segments,
+        .recipe_id = 0x0001,
+        .precool_x10 = precool_x10,
+    };
+    recipe_t recipe;
+
+    memcpy(s->blob, &hdr, sizeof(hdr));
+    s->segments = 0;
+    esp_err_t err = recipe_parse(s->blob, sizeof(hdr) + hdr.segment_count * sizeof(recipe_segment_t),
+                                 &recipe);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return ms_core_start_recipe(core, mode, &recipe);
+}
+
+static bool run_line(sim_t *s, ms_core_t *core, const char *line)
+{
+    char op[16] = "", a[16] = "";
+    long n1, n2, n3;
+    float f1, f2;
+    sscanf(line, "%15s %15s", op, a);
+
+    static const char *const commands[] = {
+        "start", "start_recipe", "stop", "pause", "resume", "service", "clear", "force_safe",
+    };
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(op, commands[i]) == 0) {
+            trace(s, "CMD %s", line);
+        }
+    }
+
+    if (strcmp(op, "di") == 0) {
+        s->di = (uint8_t)strtoul(a, NULL, 16);
+    } else if (strcmp(op, "estop") == 0) {
+        set_di_bit(s, DI_ESTOP, atoi(a) == 0);
+    } else if (strcmp(op, "door") == 0) {
+        set_di_bit(s, DI_DOOR_CLOSED, strcmp(a, "closed") == 0);
+    } else if (strcmp(op, "ln2") == 0) {
+        set_di_bit(s, DI_LN2_PRESENT, atoi(a) != 0);
+    } else if (strcmp(op, "di_fail") == 0) {
+        s->di_fail = atoi(a) != 0;
+    } else if (strcmp(op, "hmi") == 0) {
+        s->hmi_live = atoi(a) != 0;
+    } else if (strcmp(op, "pv") == 0) {
+        s->pv_valid = strcmp(a, "off") != 0;
+        s->pv = s->pv_valid ? strtof(a, NULL) : 0.0f;
+        s->ramp = false;
+        s->follow = false;
+    } else if (sscanf(line, "ramp %f %f", &f1, &f2) == 2) {
+        s->ramp = true;
+        s->follow = false;
+        s->tau_s = 0.0f;
+        s->ramp_to = f1;
+        s->ramp_rate = f2;
+    } else if (sscanf(line, "approach %f %f", &f1, &f2) == 2) {
+        s->ramp = true;
+        s->follow = false;
+        s->tau_s = f2;
+        s->ramp_to = f1;
+    } else if (sscanf(line, "follow %f", &f1) == 1) {
+        s->ramp = true;
+        s->follow = true;
+        s->tau_s = 0.0f;
+        s->ramp_rate = f1;
+    } else if (strcmp(op, "info") == 0) {
+        machine_run_info_t info;
+        ms_core_get_run_info(core, &info);
+        trace(s, "INFO %s remaining %lu target %d step %u eta 0x%02X",
+              machine_state_to_str(info.state), (unsigned long)info.run_remaining_ms,
+              info.target_temp_x10, info.recipe_step, info.precool_eta);
+    } else if (strcmp(op, "segment") == 0) {
+        return add_segment(s, line);
+    } else if (strcmp(op, "start_recipe") == 0) {
+        n2 = 0;
+        if (sscanf(line, "start_recipe %ld %ld", &n1, &n2) < 1) return false;
+        cmd_result(s, start_recipe(s, core, (run_mode_t)n1, (int16_t)n2));
+    } else if (sscanf(line, "start %ld %ld %ld", &n1, &n2, &n3) == 3) {
+        cmd_result(s, ms_core_start_run(core, (run_mode_t)n1, (int16_t)n2, (uint32_t)n3));
+    } else if (strcmp(op, "stop") == 0) {
+        cmd_result(s, ms_core_stop_run(core, strcmp(a, "abort") == 0 ?
+                                             STOP_MODE_ABORT : STOP_MODE_NORMAL));
+    } else if (strcmp(op, "pause") == 0) {
+        cmd_result(s, ms_core_pause_run(core, strcmp(a, "stop") == 0 ?
+                                              PAUSE_MODE_STOP_COOLING : PAUSE_MODE_KEEP_COOLING));
+    } else if (strcmp(op, "resume") == 0) {
+        cmd_result(s, ms_core_resume_run(core));
+    } else if (strcmp(op, "service") == 0) {
+        cmd_result(s, strcmp(a, "on") == 0 ? ms_core_enter_service(core)
+                                                 : ms_core_exit_service(core));
+    } else if (strcmp(op, "clear") == 0) {
+        cmd_result(s, strcmp(a, "estop") == 0 ? ms_core_clear_estop(core)
+                                                    : ms_core_clear_fault(core));
+    } else if (strcmp(op, "force_safe") == 0) {
+        ms_core_force_safe(core);
+    } else if (sscanf(line, "wait %ld", &n1) == 1) {
+        int64_t end_us = s->now_us + (int64_t)n1 * 1000;
+        while (s->now_us < end_us) {
+            sim_tick(s, core);
+        }
+    } else if (sscanf(line, "until %15s %ld", a, &n1) == 2) {
+        int want = parse_state(a);
+        if (want < 0) return false;
+        int64_t end_us = s->now_us + (int64_t)n1 * 1000;
+        while ((int)core->state != want && s->now_us < end_us) {
+            sim_tick(s, core);
+        }
+        if ((int)core->state != want) {
+            trace(s, "TIMEOUT waiting for %s (state %s)", a, machine_state_to_str(core->state));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool scenario_run(const scenario_t *sc, sim_t *s)
+{
+    static const ms_env_t env = {
+        .now_us          = env_now_us,
+        .read_di         = env_read_di,
+        .chamber_temp    = env_chamber_temp,
+        .hmi_live        = env_hmi_live,
+        .start_allowed   = env_start_allowed,
+        .set_sv          = env_set_sv,
+        .write_outputs   = env_write_outputs,
+        .outputs_changed = env_outputs_changed,
+        .inputs_changed  = env_inputs_changed,
+        .event           = env_event,
+        .transition      = env_transition,
+        .wake_at         = env_wake_at,
+        .seq_step        = env_seq_step,
+    };
+    ms_env_t bound = env;
+    ms_core_t core;
+
+    bound.ctx = s;
+    s->now_us = SIM_T0_US;
+    s->next_tick_us = SIM_T0_US + MS_CORE_TICK_MS * 1000;
+    s->wake_us = 0;
+    s->di = 0xFF;
+    s->di_fail = false;
+    s->hmi_live = true;
+    s->pv_valid = true;
+    s->pv = 20.0f;
+    s->ramp = false;
+    s->follow = false;
+    s->tau_s = 0.0f;
+    s->relays = s->relays_traced = 0;
+    s->segments = 0;
+    for (int p = 0; p < SIM_PID_COUNT; p++) {
+        s->sv[p] = s->sv_traced[p] = 0;
+        s->sv_traced_us[p] = SIM_T0_US - SIM_SV_TRACE_MS * 1000LL;
+    }
+    s->trace_len = 0;
+
+    /* Leading input lines describe the power-on state */
+    int i = 0;
+    for (; i < sc->count; i++) {
+        const char *l = sc->lines[i];
+        if (strncmp(l, "di", 2) && strncmp(l, "estop", 5) && strncmp(l, "door", 4) &&
+            strncmp(l, "ln2", 3) && strncmp(l, "hmi", 3) && strncmp(l, "pv", 2)) {
+            break;
+        }
+        run_line(s, &core, l);
+    }
+
+    ms_core_init(&core, &bound);
+    trace(s, "INIT %s", machine_state_to_str(core.state));
+
+    for (; i < sc->count; i++) {
+        if (!run_line(s, &core, sc->lines[i])) {
+            fprintf(stderr, "%s:%d: bad line: %s\n", sc->path, sc->line_no[i], sc->lines[i]);
+            return false;
+        }
+    }
+    trace(s, "END %s", machine_state_to_str(core.state));
+    return true;
+}
+
+/* ===== Main ===== */
+
+static char *trace_path(const char *scn)
+{
+    size_t n = strlen(scn);
+    char *p = malloc(n + 7);
+    const char *dot = strrchr(scn, '.');
+    size_t base = (dot != NULL && strchr(dot, '/') == NULL) ? (size_t)(dot - scn) : n;
+    memcpy(p, scn, base);
+    strcpy(p + base, ".trace");
+    return p;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(n + 1);
+    buf[fread(buf, 1, n, f)] = '\0';
+    fclose(f);
+    return buf;
+}
+
+static bool check(const char *scn_path, sim_t *s, bool update)
+{
+    scenario_t sc;
+    if (!scenario_load(&sc, scn_path) || !scenario_run(&sc, s)) return false;
+
+    char *golden_path = trace_path(scn_path);
+    if (update) {
+        FILE *f = fopen(golden_path, "w");
+        if (f == NULL) {
+            perror(golden_path);
+            return false;
+        }
+        fputs(s->trace, f);
+        fclose(f);
+        printf("Wrote %s\n", golden_path);
+        free(golden_path);
+        return true;
+    }
+
+    char *golden = read_file(golden_path);
+    if (golden == NULL) {
+        printf("FAIL %s: no %s\n", scn_path, golden_path);
+        free(golden_path);
+        return false;
+    }
+
+    bool ok = strcmp(golden, s->trace) == 0;
+    if (ok) {
+        printf("ok   %s\n", scn_path);
+    } else {
+        /* Report the first differing line */
+        const char *g = golden, *t = s->trace;
+        int line = 1;
+        while (*g && *g == *t) {
+            if (*g == '\n') line++;
+            g++;
+            t++;
+        }
+        while (g > golden && g[-1] != '\n') g--;
+        while (t > s->trace && t[-1] != '\n') t--;
+        printf("FAIL %s: line %d\n  want: %.*s\n  got:  %.*s\n", scn_path, line,
+               (int)strcspn(g, "\n"), g, (int)strcspn(t, "\n"), t);
+    }
+    free(golden);
+    free(golden_path);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    sim_t s = { .tracing = true };
+
+    if (argc >= 3 && (strcmp(argv[1], "--check") == 0 || strcmp(argv[1], "--update") == 0)) {
+        bool update = strcmp(argv[1], "--update") == 0;
+        int failed = 0;
+        for (int i = 2; i < argc; i++) {
+            failed += !check(argv[i], &s, update);
+        }
+        return failed ? 1 : 0;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--bench") == 0) {
+        scenario_t sc;
+        long runs = atol(argv[2]);
+        if (!scenario_load(&sc, argv[3])) return 2;
+
+        s.tracing = false;
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (long i = 0; i < runs; i++) {
+            if (!scenario_run(&sc, &s)) return 2;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        double sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        double virt = (double)(s.now_us - SIM_T0_US) / 1e6;
+        printf("%s: %ld runs, %.0f s virtual each, %lu ticks in %.3f s\n",
+               argv[3], runs, virt, s.ticks, sec);
+        printf("%.0f runs/s, %.2f M ticks/s, %.0fx real time\n",
+               runs / sec, s.ticks / sec / 1e6, virt * runs / sec);
+        return 0;
+    }
+
+    if (argc == 2 && argv[1][0] != '-') {
+        scenario_t sc;
+        if (!scenario_load(&sc, argv[1]) || !scenario_run(&sc, &s)) return 2;
+        fputs(s.trace, stdout);
+        return 0;
+    }
+
+    fprintf(stderr, "usage: %s SCENARIO | --check SCENARIO... | --update SCENARIO... | "
+            "--bench N SCENARIO\n", argv[0]);
+    return 2;
+}
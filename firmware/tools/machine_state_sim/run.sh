@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+# Build the host state machine simulator and check every scenario against its golden trace.
+# Extra arguments are passed through, e.g. run.sh --update scenarios/foo.scn
+set -euo pipefail
+cd "$(dirname "$0")/../.."
+out="${TMPDIR:-/tmp}/ms_sim"
+cc -O2 -std=gnu11 -Wall -Wextra -Wno-unused-parameter \
+    -Itools/machine_state_sim/host -Icomponents/machine_state \
+    -Icomponents/machine_state/include -Icomponents/wire_protocol/include \
+    -Icomponents/recipe/include \
+    tools/machine_state_sim/ms_sim.c components/machine_state/machine_state_core.c \
+    components/machine_state/precool_eta.c components/machine_state/relay_seq.c \
+    components/recipe/recipe_format.c -lm -o "$out"
+if [ $# -gt 0 ]; then
+    exec "$out" "$@"
+fi
+exec "$out" --check tools/machine_state_sim/scenarios/*.scn
@@ -0,0 +1,278 @@
+/*
+ * Host check of the relay_ctrl output reconciler against commits that race it.
+ *
+ * relay_ctrl.c is compiled into this file so the static reconcile_once() can be
+ * stepped directly. The TCA9554/TCA9534 pair is a register model behind a fake
+ * i2c_bus; FreeRTOS is single-threaded: the mutex aborts on re-entry, and a
+ * "task" that would block on it runs when it is given back. Hooks let a
+ * scenario land an E-stop commit (all OFF, verified) at a chosen point inside
+ * reconcile_once():
+ *
+ *   confirm   between the first readback and the confirming one
+ *   lock      after the mismatch is confirmed, before the restore takes the lock
+ *   restore   during the restore writes (the commit waits for the lock)
+ *
+ * In every case the expander must end up driving the commit's image and the
+ * reconciler must never write back the image from before it.
+ *
+ * Build and run: tools/relay_ctrl_sim/run.sh
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "relay_ctrl.c"
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "CHECK failed: %s (%s:%d): ", #cond, __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fputc('\n', stderr); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define ESTOP_IMAGE     0x00
+#define RUN_IMAGE       0x0F
+
+typedef enum {
+    RACE_NONE,
+    RACE_CONFIRM,
+    RACE_LOCK,
+    RACE_RESTORE,
+} race_t;
+
+/* ===== Expander model (i2c_bus) ===== */
+
+struct i2c_bus_dev {
+    uint8_t addr;
+    uint8_t regs[4];            /* TCA9554_REG_* */
+};
+
+static struct i2c_bus_dev s_out_dev = { .addr = RELAY_TCA9554_ADDR };
+static struct i2c_bus_dev s_in_dev = { .addr = DI_TCA9534_ADDR };
+
+static race_t s_race;
+static bool   s_in_reconcile;
+static int    s_reconcile_reads;
+static bool   s_estop_done;
+static bool   s_stale_write;    /* Pre-E-stop image written after the E-stop commit */
+
+static void estop_commit(void);
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *cfg)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_probe(uint8_t addr)
+{
+    return (addr == RELAY_TCA9554_ADDR || addr == DI_TCA9534_ADDR) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_bus_add_device(const char *name, uint8_t addr, uint32_t scl_hz,
+                             uint8_t flags, i2c_bus_dev_t **out_dev)
+{
+    *out_dev = (addr == RELAY_TCA9554_ADDR) ? &s_out_dev : &s_in_dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_read(i2c_bus_dev_t *dev, uint8_t reg, uint8_t *data, size_t len,
+                       i2c_bus_prio_t prio)
+{
+    CHECK(len == 1 && reg < 4, "read reg %u len %zu", reg, len);
+    if (dev == &s_out_dev && s_in_reconcile && prio == I2C_BUS_PRIO_DIAG) {
+        /* Reads 0-1: first readback; 2-3: the confirming one */
+        if (s_race == RACE_CONFIRM && s_reconcile_reads++ == 2) {
+            s_race = RACE_NONE;
+            estop_commit();
+        }
+    }
+    *data = dev->regs[reg];
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_write(i2c_bus_dev_t *dev, uint8_t reg, const uint8_t *data, size_t len,
+                        i2c_bus_prio_t prio)
+{
+    CHECK(len == 1 && reg < 4, "write reg %u len %zu", reg, len);
+    if (dev == &s_out_dev && reg == TCA9554_REG_OUTPUT && s_estop_done && data[0] != ESTOP_IMAGE) {
+        s_stale_write = true;
+    }
+    dev->regs[reg] = data[0];
+    if (dev == &s_out_dev && s_in_reconcile && s_race == RACE_RESTORE) {
+        s_race = RACE_NONE;
+        estop_commit();         /* Blocks on s_out_lock until the restore gives it */
+    }
+    return ESP_OK;
+}
+
+/* Power-on defaults: every pin an input, output register 0xFF */
+static void expander_reset(void)
+{
+    s_out_dev.regs[TCA9554_REG_OUTPUT] = 0xFF;
+    s_out_dev.regs[TCA9554_REG_CONFIG] = 0xFF;
+}
+
+/* ===== FreeRTOS (single-threaded) ===== */
+
+struct host_sem {
+    bool held;
+    void (*waiter)(void);       /* Blocked "task", run on give */
+};
+
+static struct host_sem s_sem;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return &s_sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    if (s_in_reconcile && s_race == RACE_LOCK && !sem->held) {
+        s_race = RACE_NONE;
+        estop_commit();
+    }
+    CHECK(!sem->held, "mutex taken twice");
+    sem->held = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    CHECK(sem->held, "mutex given while free");
+    sem->held = false;
+
+    void (*waiter)(void) = sem->waiter;
+    sem->waiter = NULL;
+    if (waiter != NULL) {
+        waiter();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *out_handle)
+{
+    *out_handle = (TaskHandle_t)&s_sem;     /* Never scheduled: scenarios step it */
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+}
+
+/* ===== relay_wear ===== */
+
+static uint8_t s_wear_image;
+
+esp_err_t relay_wear_init(void)
+{
+    s_wear_image = 0x00;
+    return ESP_OK;
+}
+
+void relay_wear_note(uint8_t old_state, uint8_t new_state)
+{
+    CHECK(old_state == s_wear_image, "wear saw 0x%02X, last image 0x%02X", old_state, s_wear_image);
+    s_wear_image = new_state;
+}
+
+/* ===== Scenarios ===== */
+
+static void estop_run(void)
+{
+    relay_ctrl_txn_t txn;
+    relay_ctrl_txn_begin(&txn);
+    relay_ctrl_txn_set_mask(&txn, 0xFF, ESTOP_IMAGE);
+    esp_err_t ret = relay_ctrl_txn_commit(&txn, RELAY_TXN_VERIFY | RELAY_TXN_FORCE);
+    CHECK(ret == ESP_OK, "E-stop commit: %s", esp_err_to_name(ret));
+    s_estop_done = true;
+}
+
+/* The state task preempts the reconciler; with the lock held it waits */
+static void estop_commit(void)
+{
+    if (s_sem.held) {
+        s_sem.waiter = estop_run;
+    } else {
+        estop_run();
+    }
+}
+
+static bool step(void)
+{
+    s_in_reconcile = true;
+    s_reconcile_reads = 0;
+    bool clean = reconcile_once();
+    s_in_reconcile = false;
+    CHECK(!s_sem.held && s_sem.waiter == NULL, "lock left held");
+    return clean;
+}
+
+static void setup(void)
+{
+    memset(&s_reconcile, 0, sizeof(s_reconcile));
+    s_race = RACE_NONE;
+    s_estop_done = false;
+    s_stale_write = false;
+
+    relay_ctrl_txn_t txn;
+    relay_ctrl_txn_begin(&txn);
+    relay_ctrl_txn_set_mask(&txn, 0xFF, RUN_IMAGE);
+    CHECK(relay_ctrl_txn_commit(&txn, RELAY_TXN_VERIFY | RELAY_TXN_FORCE) == ESP_OK, "run image");
+    CHECK(step() && s_reconcile.mismatches == 0, "clean check");
+}
+
+/* Reconcile until clean; the outputs must then drive want */
+static void settle(uint8_t want)
+{
+    for (int i = 0; i < 3 && !step(); i++) {
+    }
+    CHECK(s_out_dev.regs[TCA9554_REG_OUTPUT] == want && s_out_dev.regs[TCA9554_REG_CONFIG] == 0x00,
+          "output 0x%02X config 0x%02X, want 0x%02X", s_out_dev.regs[TCA9554_REG_OUTPUT],
+          s_out_dev.regs[TCA9554_REG_CONFIG], want);
+    CHECK(relay_ctrl_get_state() == want, "shadow 0x%02X", relay_ctrl_get_state());
+    CHECK(step() && s_reconcile.restore_failures == 0, "not settled");
+}
+
+static void scenario_reset(void)
+{
+    setup();
+    expander_reset();
+    CHECK(step(), "restore failed");
+    CHECK(s_reconcile.mismatches == 1 && s_reconcile.latched, "mismatch not reported");
+    settle(RUN_IMAGE);
+}
+
+static void scenario_race(race_t race, const char *name)
+{
+    setup();
+    expander_reset();
+    s_race = race;
+    step();
+    CHECK(s_race == RACE_NONE && s_estop_done, "%s: commit never landed", name);
+    CHECK(!s_stale_write, "%s: restore wrote the pre-E-stop image after the commit", name);
+    CHECK(s_out_dev.regs[TCA9554_REG_OUTPUT] == ESTOP_IMAGE, "%s: output 0x%02X after the commit",
+          name, s_out_dev.regs[TCA9554_REG_OUTPUT]);
+    /* Config may still be all inputs (relays off); the next check restores it */
+    settle(ESTOP_IMAGE);
+    CHECK(!s_stale_write, "%s: stale image written while settling", name);
+}
+
+int main(void)
+{
+    CHECK(relay_ctrl_init() == ESP_OK, "init");
+
+    scenario_reset();
+    printf("ok   reset: shadow restored\n");
+    scenario_race(RACE_CONFIRM, "confirm");
+    printf("ok   commit between readbacks: restore skipped\n");
+    scenario_race(RACE_LOCK, "lock");
+    printf("ok   commit before the restore takes the lock: restore skipped\n");
+    scenario_race(RACE_RESTORE, "restore");
+    printf("ok   commit during the restore: applied after it\n");
+    return 0;
+}
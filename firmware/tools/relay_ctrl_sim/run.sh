@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+# Build the host relay_ctrl reconciler check and run every race scenario.
+set -euo pipefail
+cd "$(dirname "$0")/../.."
+out="${TMPDIR:-/tmp}/relay_sim"
+cc -O1 -g -std=gnu11 -Wall -Wextra -Wno-unused-parameter -Wno-unused-function \
+    -fsanitize=address,undefined -fno-sanitize-recover=all \
+    -Itools/machine_state_sim/host -Icomponents/relay_ctrl -Icomponents/relay_ctrl/include \
+    -Icomponents/i2c_bus/include \
+    tools/relay_ctrl_sim/relay_sim.c -o "$out"
+exec "$out" "$@"
@@ -0,0 +1,404 @@
+#!/usr/bin/env python3
+"""Reference codec and size/cost benchmark for compact telemetry (telemetry_ver 2).
+
+Usage: tools/telemetry_compact.py [--key-interval N] CAPTURE...
+       tools/telemetry_compact.py --synthetic FRAMES
+
+CAPTURE is a recorded run: any text file with one TELEMETRY_SNAPSHOT frame
+per line as hex bytes (e.g. an app-side notification log or an idf.py
+monitor hex dump). Lines that do not hold a valid 0x01 frame are skipped.
+
+Each snapshot is re-encoded exactly as the firmware would
+(components/wire_protocol/wire_compact.c), decoded again, and checked
+against the original. Reports frame counts, payload bytes in both
+encodings and the per-frame encode/decode time of this reference codec.
+"""
+import argparse, random, re, struct, sys, time
+
+MSG_TELEMETRY_SNAPSHOT = 0x01
+MSG_TELEMETRY_COMPACT = 0x02
+
+F_KEY, F_IO, F_ALARM, F_RUN, F_ETA = 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6
+C_PV, C_SV, C_OP, C_AGE = 1 << 4, 1 << 5, 1 << 6, 1 << 7
+R_STATE, R_ELAPSED, R_REMAINING, R_TARGET = 1 << 0, 1 << 1, 1 << 2, 1 << 3
+R_STEP, R_INTERLOCK, R_IDLE, R_LAZY = 1 << 4, 1 << 5, 1 << 6, 1 << 7
+
+HEX_RE = re.compile(r"(?:\b[0-9A-Fa-f]{2}\b[ ,:]*){8,}")
+M32 = 0xFFFFFFFF
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        crc &= 0xFFFF
+    return crc
+
+
+def s32(v):
+    v &= M32
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def s16(v):
+    v &= 0xFFFF
+    return v - (1 << 16) if v & 0x8000 else v
+
+
+def zigzag(v):
+    v = s32(v)
+    return ((v << 1) ^ (v >> 31)) & M32
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def put_varint(out, v):
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+class Reader:
+    def __init__(self, data):
+        self.data, self.pos = data, 0
+
+    def u8(self):
+        if self.pos >= len(self.data):
+            raise ValueError("truncated")
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def varint(self):
+        v = 0
+        for shift in range(0, 35, 7):
+            b = self.u8()
+            v |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return v & M32
+        raise ValueError("varint too long")
+
+
+# ===== Samples =====
+
+CTRL_FIELDS = ("controller_id", "pv_x10", "sv_x10", "op_x10", "mode", "age_ms")
+RUN_FIELDS = ("machine_state", "run_elapsed_ms", "run_remaining_ms", "target_temp_x10",
+              "recipe_step", "interlock_bits", "lazy_poll_active", "idle_timeout_min",
+              "precool_eta")
+
+
+def zero_sample():
+    return {"timestamp_ms": 0, "di_bits": 0, "ro_bits": 0, "alarm_bits": 0,
+            "controllers": [], "run": None}
+
+
+def parse_snapshot(payload):
+    """TELEMETRY_SNAPSHOT payload -> sample (None if malformed)"""
+    if len(payload) < 13:
+        return None
+    ts, di, ro, alarm, count = struct.unpack_from("<IHHIB", payload, 0)
+    if count > 3 or len(payload) not in (13 + 10 * count, 13 + 10 * count + 16):
+        return None
+    s = {"timestamp_ms": ts, "di_bits": di & 0xFF, "ro_bits": ro & 0xFF, "alarm_bits": alarm,
+         "controllers": [], "run": None}
+    for i in range(count):
+        s["controllers"].append(dict(zip(CTRL_FIELDS,
+                                         struct.unpack_from("<BhhHBH", payload, 13 + 10 * i))))
+    if len(payload) == 13 + 10 * count + 16:
+        vals = struct.unpack_from("<BIIhBBBBB", payload, 13 + 10 * count)
+        s["run"] = dict(zip(RUN_FIELDS, vals))
+        s["run"]["lazy_poll_active"] = 1 if s["run"]["lazy_poll_active"] else 0
+    return s
+
+
+def snapshot_size(s):
+    return 13 + 10 * len(s["controllers"]) + (16 if s["run"] else 0)
+
+
+def representable(s):
+    return all(c["controller_id"] <= 3 and c["mode"] <= 3 for c in s["controllers"])
+
+
+def same_shape(a, b):
+    return ([c["controller_id"] for c in a["controllers"]] ==
+            [c["controller_id"] for c in b["controllers"]] and
+            (a["run"] is None) == (b["run"] is None))
+
+
+ZERO_CTRL = dict.fromkeys(CTRL_FIELDS, 0)
+ZERO_RUN = dict.fromkeys(RUN_FIELDS, 0)
+
+
+# ===== Codec =====
+
+class Encoder:
+    def __init__(self, key_interval):
+        self.key_interval, self.ref, self.since_key = key_interval, None, 0
+
+    def encode(self, s):
+        """Returns (payload, is_key), or (None, False) if not representable"""
+        if not representable(s):
+            self.ref = None
+            return None, False
+        key = (self.ref is None or not same_shape(self.ref, s) or
+               (self.key_interval and self.since_key >= self.key_interval))
+        ref = zero_sample() if key else self.ref
+        out = bytearray()
+
+        flags = len(s["controllers"])
+        if key:
+            flags |= F_KEY | F_IO | F_ALARM
+        else:
+            if s["di_bits"] != ref["di_bits"] or s["ro_bits"] != ref["ro_bits"]:
+                flags |= F_IO
+            if s["alarm_bits"] != ref["alarm_bits"]:
+                flags |= F_ALARM
+        if s["run"]:
+            flags |= F_RUN
+            if s["run"]["precool_eta"] != (ref["run"] or ZERO_RUN)["precool_eta"]:
+                flags |= F_ETA
+
+        dt = (s["timestamp_ms"] - ref["timestamp_ms"]) & M32
+        out.append(flags)
+        put_varint(out, dt)
+        if flags & F_IO:
+            out += bytes((s["di_bits"], s["ro_bits"]))
+        if flags & F_ALARM:
+            put_varint(out, s["alarm_bits"])
+
+        for i, c in enumerate(s["controllers"]):
+            p = ZERO_CTRL if key else ref["controllers"][i]
+            d_pv, d_sv, d_op = (c[k] - p[k] for k in ("pv_x10", "sv_x10", "op_x10"))
+            head = c["controller_id"] | (c["mode"] << 2)
+            head |= C_PV if key or d_pv else 0
+            head |= C_SV if key or d_sv else 0
+            head |= C_OP if key or d_op else 0
+            head |= C_AGE if key or c["age_ms"] != p["age_ms"] else 0
+            out.append(head)
+            for bit, d in ((C_PV, d_pv), (C_SV, d_sv), (C_OP, d_op)):
+                if head & bit:
+                    put_varint(out, zigzag(d))
+            if head & C_AGE:
+                put_varint(out, c["age_ms"])
+
+        if s["run"]:
+            r, p = s["run"], ZERO_RUN if key else ref["run"]
+            pdt = 0 if key else dt
+            d_el = s32(r["run_elapsed_ms"] - (p["run_elapsed_ms"] + pdt))
+            d_rem = s32(r["run_remaining_ms"] - (p["run_remaining_ms"] - pdt))
+            d_tgt = r["target_temp_x10"] - p["target_temp_x10"]
+            mask = R_LAZY if r["lazy_poll_active"] else 0
+            for bit, changed in ((R_STATE, r["machine_state"] != p["machine_state"]),
+                                 (R_ELAPSED, d_el), (R_REMAINING, d_rem), (R_TARGET, d_tgt),
+                                 (R_STEP, r["recipe_step"] != p["recipe_step"]),
+                                 (R_INTERLOCK, r["interlock_bits"] != p["interlock_bits"]),
+                                 (R_IDLE, r["idle_timeout_min"] != p["idle_timeout_min"])):
+                mask |= bit if key or changed else 0
+            out.append(mask)
+            if mask & R_STATE:
+                out.append(r["machine_state"])
+            for bit, d in ((R_ELAPSED, d_el), (R_REMAINING, d_rem), (R_TARGET, d_tgt)):
+                if mask & bit:
+                    put_varint(out, zigzag(d))
+            for bit, k in ((R_STEP, "recipe_step"), (R_INTERLOCK, "interlock_bits"),
+                           (R_IDLE, "idle_timeout_min")):
+                if mask & bit:
+                    out.append(r[k])
+            if flags & F_ETA:
+                out.append(r["precool_eta"])
+
+        self.ref = s
+        self.since_key = 1 if key else self.since_key + 1
+        return bytes(out), key
+
+
+class Decoder:
+    def __init__(self):
+        self.ref, self.last_seq = None, 0
+
+    def decode(self, seq, payload):
+        """Returns the sample; raises ValueError if it cannot be applied"""
+        try:
+            s = self._decode(seq, payload)
+        except ValueError:
+            self.ref = None
+            raise
+        self.ref, self.last_seq = s, seq
+        return s
+
+    def _decode(self, seq, payload):
+        r = Reader(payload)
+        flags = r.u8()
+        key, count = bool(flags & F_KEY), flags & 3
+        if not key:
+            if self.ref is None or seq != (self.last_seq + 1) & 0xFFFF:
+                raise ValueError("need keyframe")
+            if count != len(self.ref["controllers"]) or bool(flags & F_RUN) != bool(self.ref["run"]):
+                raise ValueError("shape mismatch")
+        ref = zero_sample() if key else self.ref
+
+        dt = r.varint()
+        s = {"timestamp_ms": (ref["timestamp_ms"] + dt) & M32,
+             "di_bits": ref["di_bits"], "ro_bits": ref["ro_bits"],
+             "alarm_bits": ref["alarm_bits"], "controllers": [], "run": None}
+        if flags & F_IO:
+            s["di_bits"], s["ro_bits"] = r.u8(), r.u8()
+        if flags & F_ALARM:
+            s["alarm_bits"] = r.varint()
+
+        for i in range(count):
+            p = ZERO_CTRL if key else ref["controllers"][i]
+            head = r.u8()
+            if not key and head & 3 != p["controller_id"]:
+                raise ValueError("controller mismatch")
+            c = dict(p, controller_id=head & 3, mode=(head >> 2) & 3)
+            if head & C_PV:
+                c["pv_x10"] = s16(c["pv_x10"] + unzigzag(r.varint()))
+            if head & C_SV:
+                c["sv_x10"] = s16(c["sv_x10"] + unzigzag(r.varint()))
+            if head & C_OP:
+                c["op_x10"] = (c["op_x10"] + unzigzag(r.varint())) & 0xFFFF
+            if head & C_AGE:
+                c["age_ms"] = r.varint() & 0xFFFF
+            s["controllers"].append(c)
+
+        if flags & F_RUN:
+            run = dict(ZERO_RUN if key else ref["run"])
+            mask = r.u8()
+            if not key:
+                run["run_elapsed_ms"] = (run["run_elapsed_ms"] + dt) & M32
+                run["run_remaining_ms"] = (run["run_remaining_ms"] - dt) & M32
+            run["lazy_poll_active"] = 1 if mask & R_LAZY else 0
+            if mask & R_STATE:
+                run["machine_state"] = r.u8()
+            if mask & R_ELAPSED:
+                run["run_elapsed_ms"] = (run["run_elapsed_ms"] + unzigzag(r.varint())) & M32
+            if mask & R_REMAINING:
+                run["run_remaining_ms"] = (run["run_remaining_ms"] + unzigzag(r.varint())) & M32
+            if mask & R_TARGET:
+                run["target_temp_x10"] = s16(run["target_temp_x10"] + unzigzag(r.varint()))
+            if mask & R_STEP:
+                run["recipe_step"] = r.u8()
+            if mask & R_INTERLOCK:
+                run["interlock_bits"] = r.u8()
+            if mask & R_IDLE:
+                run["idle_timeout_min"] = r.u8()
+            if flags & F_ETA:
+                run["precool_eta"] = r.u8()
+            s["run"] = run
+        elif flags & F_ETA:
+            raise ValueError("ETA without RUN")
+
+        if r.pos != len(payload):
+            raise ValueError("trailing bytes")
+        return s
+
+
+# ===== Inputs =====
+
+def load_capture(path):
+    samples = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            for m in HEX_RE.finditer(line):
+                frame = bytes.fromhex(re.sub(r"[^0-9A-Fa-f]", "", m.group(0)))
+                if len(frame) < 8 or frame[0] != 0x01 or frame[1] != MSG_TELEMETRY_SNAPSHOT:
+                    continue
+                plen = frame[4] | (frame[5] << 8)
+                if len(frame) < 8 + plen:
+                    continue
+                crc = frame[6 + plen] | (frame[7 + plen] << 8)
+                if crc != crc16_ccitt(frame[:6 + plen]):
+                    continue
+                s = parse_snapshot(frame[6:6 + plen])
+                if s:
+                    samples.append(s)
+    return samples
+
+
+def synthetic_run(frames, seed=1):
+    """Idle -> precool -> run -> stop, 3 controllers, 10 Hz"""
+    rng = random.Random(seed)
+    ts, pv = 1000, [220, 215, 230]
+    s = []
+    for k in range(frames):
+        phase = 4 * k // frames
+        ts += 100 + (rng.random() < 0.3)
+        pv = [p + rng.choice((-1, 0, 0, 1)) - (2 if phase in (1, 2) else 0) for p in pv]
+        elapsed = (ts - 1000) if phase == 2 else 0
+        s.append({
+            "timestamp_ms": ts, "di_bits": 0x01, "ro_bits": 0x07 if phase in (1, 2) else 0x01,
+            "alarm_bits": 0,
+            "controllers": [{"controller_id": i + 1, "pv_x10": pv[i], "sv_x10": -1850,
+                             "op_x10": 1000 if phase in (1, 2) else 0,
+                             "mode": 2, "age_ms": rng.randrange(50, 350)} for i in range(3)],
+            "run": {"machine_state": phase, "run_elapsed_ms": elapsed,
+                    "run_remaining_ms": max(0, 600000 - elapsed) if phase == 2 else 0,
+                    "target_temp_x10": -1850, "recipe_step": 1 if phase == 2 else 0,
+                    "interlock_bits": 0, "lazy_poll_active": 0, "idle_timeout_min": 5,
+                    "precool_eta": 0x29 if phase == 1 else 0},
+        })
+    return s
+
+
+# ===== Benchmark =====
+
+def bench(name, samples, key_interval):
+    enc, dec = Encoder(key_interval), Decoder()
+    snap = compact = keys = fallbacks = 0
+    t_enc = t_dec = 0.0
+    for seq, s in enumerate(samples):
+        t0 = time.perf_counter()
+        payload, key = enc.encode(s)
+        t1 = time.perf_counter()
+        if payload is None:
+            fallbacks += 1
+            compact += snapshot_size(s)
+            dec.ref = None
+            snap += snapshot_size(s)
+            continue
+        got = dec.decode(seq & 0xFFFF, payload)
+        t_dec += time.perf_counter() - t1
+        t_enc += t1 - t0
+        if got != s:
+            sys.exit(f"{name}: round trip mismatch at frame {seq}")
+        snap += snapshot_size(s)
+        compact += len(payload)
+        keys += key
+
+    n = len(samples)
+    if n == 0:
+        print(f"{name}: no TELEMETRY_SNAPSHOT frames found")
+        return
+    print(f"{name}: {n} frames ({keys} key, {fallbacks} fallback)")
+    print(f"  payload bytes  snapshot {snap} ({snap / n:.1f}/frame)  "
+          f"compact {compact} ({compact / n:.1f}/frame)  ratio {snap / compact:.2f}x")
+    print(f"  frame bytes    snapshot {snap + 8 * n}  compact {compact + 8 * n}  "
+          f"ratio {(snap + 8 * n) / (compact + 8 * n):.2f}x")
+    print(f"  reference codec  encode {1e6 * t_enc / n:.1f} us/frame  "
+          f"decode {1e6 * t_dec / n:.1f} us/frame")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("captures", nargs="*")
+    ap.add_argument("--key-interval", type=int, default=50,
+                    help="CONFIG_TELEMETRY_COMPACT_KEYFRAME_INTERVAL (default 50)")
+    ap.add_argument("--synthetic", type=int, metavar="FRAMES",
+                    help="benchmark a generated idle/precool/run/stop cycle")
+    args = ap.parse_args()
+
+    if not args.captures and not args.synthetic:
+        ap.error("give capture files or --synthetic FRAMES")
+    if args.synthetic:
+        bench(f"synthetic[{args.synthetic}]", synthetic_run(args.synthetic), args.key_interval)
+    for path in args.captures:
+        bench(path, load_capture(path), args.key_interval)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# Build the COMMAND path fuzz harness (ASan + UBSan) and run it from the golden vectors.
+# Extra arguments are passed through, e.g. run.sh --iters 10000000 --seed 7, or run.sh crash.bin
+set -euo pipefail
+cd "$(dirname "$0")/../.."
+out="${TMPDIR:-/tmp}/wire_fuzz"
+cc -O1 -g -std=gnu11 -Wall -Wextra -Wno-unused-parameter \
+    -fsanitize=address,undefined -fno-sanitize-recover=all \
+    -Itools/wire_fuzz -Itools/machine_state_sim/host \
+    -Icomponents/ble_gatt -Icomponents/ble_gatt/include -Icomponents/wire_protocol/include \
+    -Icomponents/crc16/include -Icomponents/version/include \
+    -Icomponents/session_mgr/include -Icomponents/telemetry/include \
+    -Icomponents/relay_ctrl/include -Icomponents/pid_controller/include \
+    -Icomponents/safety_gate/include -Icomponents/trace_log/include \
+    -Icomponents/machine_state/include \
+    tools/wire_fuzz/wire_fuzz.c tools/wire_fuzz/stubs.c \
+    components/ble_gatt/ble_cmd_dispatch.c components/wire_protocol/wire_protocol.c \
+    components/wire_protocol/wire_cmd_schema.c components/crc16/crc16.c \
+    components/crc16/crc16_tables.c -o "$out"
+exec "$out" "$@"
@@ -0,0 +1,259 @@
+/*
+ * Host stubs for the components ble_cmd_dispatch.c calls.
+ *
+ * Every call that can fail returns g_stub_err (picked per input by the
+ * harness), so the fuzzer reaches each handler's error branches as well
+ * as its ACK encoding. Session roles come from g_stub_role /
+ * g_stub_controller_held. Outputs are filled even on error, so handlers
+ * that read them only on success would show up under the sanitizers.
+ */
+
+#include <string.h>
+
+#include "wire_fuzz.h"
+#include "ble_gatt.h"
+#include "session_mgr.h"
+#include "telemetry.h"
+#include "relay_ctrl.h"
+#include "pid_controller.h"
+#include "safety_gate.h"
+#include "trace_log.h"
+
+esp_err_t g_stub_err;
+session_role_t g_stub_role;
+bool g_stub_controller_held;
+
+/* ===== session_mgr ===== */
+
+esp_err_t session_mgr_open(uint16_t conn_handle, session_role_t role, uint32_t client_nonce,
+                           uint32_t *out_session_id, uint16_t *out_lease_ms)
+{
+    *out_session_id = client_nonce ^ 0x5E551000u;
+    *out_lease_ms = 3000;
+    return g_stub_err;
+}
+
+esp_err_t session_mgr_keepalive(uint32_t session_id)
+{
+    return g_stub_err;
+}
+
+session_role_t session_mgr_get_role(uint32_t session_id)
+{
+    return g_stub_role;
+}
+
+bool session_mgr_has_controller(void)
+{
+    return g_stub_controller_held;
+}
+
+/* ===== telemetry ===== */
+
+void telemetry_set_ro_bits(uint16_t bits)
+{
+}
+
+void telemetry_request_keyframe(void)
+{
+}
+
+/* ===== relay_ctrl ===== */
+
+esp_err_t relay_ctrl_set(uint8_t relay_index, uint8_t state)
+{
+    return g_stub_err;
+}
+
+esp_err_t relay_ctrl_set_mask(uint8_t mask, uint8_t values)
+{
+    return g_stub_err;
+}
+
+uint8_t relay_ctrl_get_state(void)
+{
+    return 0xA5;
+}
+
+esp_err_t relay_ctrl_get_wear(relay_ctrl_wear_stats_t *out)
+{
+    memset(out, 0x5A, sizeof(*out));
+    return g_stub_err;
+}
+
+/* ===== pid_controller ===== */
+
+void pid_controller_signal_activity(void)
+{
+}
+
+esp_err_t pid_controller_set_sv(uint8_t addr, float sv_celsius)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_force_poll(uint8_t addr)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_set_mode(uint8_t addr, uint8_t mode)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_write_params(uint8_t addr, float p_gain, uint16_t i_time, uint16_t d_time)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_read_params(uint8_t addr, float *p_gain, uint16_t *i_time,
+                                     uint16_t *d_time)
+{
+    *p_gain = 12.3f;
+    *i_time = 240;
+    *d_time = 60;
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_start_autotune(uint8_t addr)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_stop_autotune(uint8_t addr)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_set_alarm_limits(uint8_t addr, float alarm1_celsius,
+                                          float alarm2_celsius)
+{
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_read_alarm_limits(uint8_t addr, float *alarm1_celsius,
+                                           float *alarm2_celsius)
+{
+    *alarm1_celsius = -80.0f;
+    *alarm2_celsius = 40.0f;
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_read_registers(uint8_t addr, uint16_t start_reg, uint8_t count,
+                                        uint16_t *values)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        values[i] = (uint16_t)(start_reg + i);
+    }
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_write_register(uint8_t addr, uint16_t reg, uint16_t value,
+                                        uint16_t *verified_value)
+{
+    *verified_value = value;
+    return g_stub_err;
+}
+
+esp_err_t pid_controller_set_idle_timeout(uint8_t minutes)
+{
+    return g_stub_err;
+}
+
+uint8_t pid_controller_get_idle_timeout(void)
+{
+    return 5;
+}
+
+/* ===== safety_gate ===== */
+
+bool safety_gate_can_enable_pid(uint8_t pid_id, int8_t *out_blocking_gate)
+{
+    *out_blocking_gate = (int8_t)(pid_id % GATE_MAX);
+    return g_stub_err == ESP_OK;
+}
+
+void safety_gate_get_all_capabilities(uint8_t *out_caps)
+{
+    memset(out_caps, CAP_REQUIRED, SUBSYS_MAX);
+}
+
+esp_err_t safety_gate_set_capability(subsystem_id_t subsys, capability_level_t level)
+{
+    return g_stub_err;
+}
+
+uint32_t safety_gate_get_enable_mask(void)
+{
+    return 0xFFFF;
+}
+
+uint32_t safety_gate_get_status_mask(void)
+{
+    return 0x0003;
+}
+
+esp_err_t safety_gate_set_enabled(gate_id_t gate, bool enabled)
+{
+    return g_stub_err;
+}
+
+/* ===== trace_log ===== */
+
+/* Every site enabled, so the record arguments are evaluated too */
+uint8_t trace_log_module_level[TRACE_MOD_MAX] = {
+    [0 ... TRACE_MOD_MAX - 1] = ESP_LOG_VERBOSE,
+};
+
+const uint8_t trace_log_fmt_module[TRACE_FMT_MAX] = {
+#define TRACE_FMT_MOD(id, mod, fmt) [id] = mod,
+    TRACE_FMT_LIST(TRACE_FMT_MOD)
+#undef TRACE_FMT_MOD
+};
+
+void trace_log_record(esp_log_level_t level, trace_fmt_id_t id,
+                      const uint32_t args[TRACE_LOG_MAX_ARGS])
+{
+}
+
+uint32_t trace_log_pack_bytes(const uint8_t *data, size_t len, size_t offset)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < 4; i++) {
+        v = (v << 8) | (offset + i < len ? data[offset + i] : 0);
+    }
+    return v;
+}
+
+esp_err_t trace_log_set_level(trace_module_t module, esp_log_level_t level)
+{
+    if ((unsigned)module >= TRACE_MOD_MAX || (unsigned)level > ESP_LOG_VERBOSE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;                      /* Levels stay at VERBOSE for the harness */
+}
+
+void trace_log_get_stats(trace_log_stats_t *out_stats)
+{
+    memset(out_stats, 0, sizeof(*out_stats));
+    out_stats->recorded = 1000;
+}
+
+esp_err_t trace_log_get_site_stats(trace_fmt_id_t id, trace_log_site_stats_t *out_stats)
+{
+    memset(out_stats, 0, sizeof(*out_stats));
+    if ((unsigned)id >= TRACE_FMT_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    out_stats->count = id;
+    out_stats->record_cycles_avg = 70000u * id;
+    return ESP_OK;
+}
+
+/* ===== ble_gatt (link) ===== */
+
+esp_err_t ble_gatt_set_link_profile(ble_link_profile_t profile)
+{
+    return (unsigned)profile < BLE_LINK_PROFILE_MAX ? g_stub_err : ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,647 @@
+/*
+ * Host fuzz harness for the COMMAND path: wire_parse_frame(), the schema
+ * table (wire_cmd_lookup() and every generated wire_decode_*()) and the
+ * command dispatcher in components/ble_gatt/ble_cmd_dispatch.c, built
+ * against stubbed components (stubs.c). Run under ASan + UBSan.
+ *
+ * Build (from firmware/):
+ *   cc -O1 -g -std=gnu11 -fsanitize=address,undefined -fno-sanitize-recover=all \
+ *      -Itools/wire_fuzz -Itools/machine_state_sim/host \
+ *      -Icomponents/ble_gatt -Icomponents/ble_gatt/include -Icomponents/wire_protocol/include \
+ *      -Icomponents/crc16/include -Icomponents/version/include \
+ *      -Icomponents/session_mgr/include -Icomponents/telemetry/include \
+ *      -Icomponents/relay_ctrl/include -Icomponents/pid_controller/include \
+ *      -Icomponents/safety_gate/include -Icomponents/trace_log/include \
+ *      -Icomponents/machine_state/include \
+ *      tools/wire_fuzz/wire_fuzz.c tools/wire_fuzz/stubs.c \
+ *      components/ble_gatt/ble_cmd_dispatch.c components/wire_protocol/wire_protocol.c \
+ *      components/wire_protocol/wire_cmd_schema.c components/crc16/crc16.c \
+ *      components/crc16/crc16_tables.c -o /tmp/wire_fuzz
+ * or just run tools/wire_fuzz/run.sh. With clang, -DWIRE_FUZZ_LIBFUZZER
+ * -fsanitize=fuzzer builds the same target for libFuzzer (no main here).
+ *
+ * Usage:
+ *   wire_fuzz [--iters N] [--seed S] [--vectors FILE]
+ *                                 seeds from schema/vectors.json, then N mutations
+ *   wire_fuzz --dump-corpus DIR   write the seeds into an existing DIR (libFuzzer corpus)
+ *   wire_fuzz FILE...             run saved inputs once (crash reproduction)
+ *
+ * Input: one selector byte, then the frame as written to Command RX.
+ *   bits 0-2  result of every stub that can fail (ESP_OK, INVALID_STATE, ...)
+ *   bits 3-4  client: 0 no session, 1 controller, 2 observer,
+ *             3 no session while another client holds the controller
+ *   bit 5     ATT MTU 23 + 16 * bits 0-2 (23..135) instead of 247
+ *   bit 6     rewrite payload_len to match the frame length
+ *   bit 7     rewrite the CRC
+ * Bits 6-7 let mutations past the CRC check without a custom mutator.
+ *
+ * Checks (abort on failure, so libFuzzer and the driver both stop there):
+ *   - wire_parse_frame() accepts only frames whose header fits the input
+ *   - wire_cmd_lookup() agrees with WIRE_CMD_TABLE for the received ID
+ *   - each decoder succeeds exactly when the payload has min_len bytes and
+ *     never consumes more than max_len
+ *   - every dispatched command is answered exactly once, with an ACK that
+ *     fits a frame (and the link MTU for GET_TRACE_STATS / GET_RELAY_STATS,
+ *     whose relay pages are contiguous from first_channel)
+ *   - observers and clients without a session while a controller exists
+ *     get REJECTED_POLICY / 0x0006 for every non-observer command
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wire_fuzz.h"
+#include "wire_protocol.h"
+#include "wire_cmd_schema.h"
+#include "ble_cmd_dispatch.h"
+#include "relay_ctrl.h"
+
+#define INPUT_MAX           (1 + WIRE_MAX_FRAME_SIZE)
+#define CORPUS_MAX          4096
+#define SIG_BITS            (1u << 16)
+
+#define SEL_ERR_MASK        0x07
+#define SEL_CLIENT_SHIFT    3
+#define SEL_MTU_MIN         (1 << 5)
+#define SEL_FIX_LEN         (1 << 6)
+#define SEL_FIX_CRC         (1 << 7)
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "CHECK failed: %s (%s:%d): ", #cond, __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fputc('\n', stderr); \
+            abort(); \
+        } \
+    } while (0)
+
+static const esp_err_t s_stub_errs[8] = {
+    ESP_OK, ESP_ERR_INVALID_STATE, ESP_ERR_INVALID_ARG, ESP_ERR_TIMEOUT,
+    ESP_ERR_INVALID_RESPONSE, ESP_ERR_NOT_FOUND, ESP_ERR_NO_MEM, ESP_FAIL,
+};
+
+/* How far an input got */
+typedef enum {
+    STAGE_EMPTY,
+    STAGE_BAD_FRAME,            /* wire_parse_frame() rejected it */
+    STAGE_NOT_COMMAND,          /* Valid frame, rejected by ble_cmd_parse() */
+    STAGE_DISPATCHED,
+} stage_t;
+
+/* What the dispatcher did with one input */
+typedef struct {
+    const ble_cmd_t *cmd;
+    uint16_t mtu;
+    stage_t  stage;
+    int      acks;
+    int      posts;
+    int      sessions_opened;
+    uint8_t  status;
+    uint16_t detail;
+    size_t   ack_len;
+    const uint8_t *ack_data;
+} fuzz_run_t;
+
+static fuzz_run_t s_run;
+
+/* ===== Dispatch environment ===== */
+
+static void fz_send_ack(void *ctx, uint16_t seq, uint16_t cmd_id, uint8_t status,
+                        uint16_t detail, const uint8_t *data, size_t data_len)
+{
+    fuzz_run_t *run = ctx;
+    static uint8_t copy[WIRE_MAX_PAYLOAD];
+
+    CHECK(seq == run->cmd->seq && cmd_id == run->cmd->cmd_id,
+          "ACK for seq %u cmd 0x%04X", seq, cmd_id);
+    CHECK(data != NULL || data_len == 0, "cmd 0x%04X", cmd_id);
+    CHECK(sizeof(wire_cmd_ack_t) + data_len <= WIRE_MAX_PAYLOAD,
+          "cmd 0x%04X ACK data %zu bytes", cmd_id, data_len);
+    if (data_len > 0) {
+        memcpy(copy, data, data_len);   /* Let ASan see every byte */
+    }
+
+    run->acks++;
+    run->status = status;
+    run->detail = detail;
+    run->ack_len = data_len;
+    run->ack_data = copy;
+}
+
+static void fz_post_state_cmd(void *ctx, machine_state_cmd_t *cmd, const ble_cmd_t *c)
+{
+    fuzz_run_t *run = ctx;
+    CHECK(c == run->cmd, "cmd 0x%04X", c->cmd_id);
+    run->posts++;
+}
+
+static void fz_session_opened(void *ctx, uint32_t conn_gen, uint32_t session_id,
+                              uint8_t telemetry_ver)
+{
+    fuzz_run_t *run = ctx;
+    CHECK(conn_gen == run->cmd->conn_gen, "gen %" PRIu32, conn_gen);
+    CHECK(telemetry_ver >= WIRE_TELEMETRY_VER_SNAPSHOT &&
+          telemetry_ver <= WIRE_TELEMETRY_VER_MAX, "telemetry_ver %u", telemetry_ver);
+    run->sessions_opened++;
+}
+
+static uint16_t fz_att_mtu(void *ctx, uint16_t conn_handle)
+{
+    return ((fuzz_run_t *)ctx)->mtu;
+}
+
+static esp_err_t fz_start_benchmark(void *ctx, const ble_cmd_t *c, uint32_t total_bytes,
+                                    uint8_t rtt_samples)
+{
+    return g_stub_err;
+}
+
+static const ble_cmd_env_t s_env = {
+    .send_ack = fz_send_ack,
+    .post_state_cmd = fz_post_state_cmd,
+    .session_opened = fz_session_opened,
+    .att_mtu = fz_att_mtu,
+    .start_benchmark = fz_start_benchmark,
+    .ctx = &s_run,
+};
+
+/* ===== Checks ===== */
+
+static void check_lookup(uint16_t cmd_id)
+{
+    const wire_cmd_desc_t *desc = wire_cmd_lookup(cmd_id);
+    bool listed = false;
+
+#define X(name, id, lower, min, max, fl) \
+    if (cmd_id == (id)) { \
+        listed = true; \
+        CHECK(desc != NULL && desc->min_len == (min) && desc->max_len == (max) && \
+              desc->flags == (fl), #name); \
+    }
+    WIRE_CMD_TABLE(X)
+#undef X
+
+    CHECK(listed == (desc != NULL), "cmd 0x%04X", cmd_id);
+    CHECK(desc == NULL || desc->cmd_id == cmd_id, "cmd 0x%04X", cmd_id);
+}
+
+/* Run every decoder over the payload, whatever its cmd_id says */
+static void check_decoders(const uint8_t *p, size_t n)
+{
+#define X(name, lower, min, max) { \
+        wire_reader_t r; \
+        wire_req_##lower##_t out; \
+        size_t need = (min);                /* Not a constant: no -Wtype-limits for 0 */ \
+        wire_reader_init(&r, p, n); \
+        bool ok = wire_decode_##lower(&r, &out); \
+        CHECK(ok == (n >= need), #name " decode of %zu bytes", n); \
+        CHECK(!ok || n - wire_reader_remaining(&r) <= (max), \
+              #name " consumed %zu", n - wire_reader_remaining(&r)); \
+    }
+    WIRE_CMD_DECODERS(X)
+#undef X
+}
+
+static bool observer_rejected(const wire_cmd_desc_t *desc, bool observer)
+{
+    return observer && !(desc->flags & WIRE_CMD_F_OBSERVER);
+}
+
+/* Header + one channel: the smallest reply GET_RELAY_STATS sends */
+#define RELAY_STATS_MIN_MTU (3 + WIRE_HEADER_SIZE + sizeof(wire_cmd_ack_t) + WIRE_CRC_SIZE + \
+                             sizeof(wire_ack_relay_stats_t) + sizeof(wire_relay_channel_stats_t))
+
+static void check_relay_stats(const ble_cmd_t *c)
+{
+    if (s_run.mtu < RELAY_STATS_MIN_MTU) {
+        CHECK(s_run.status == CMD_STATUS_NOT_READY && s_run.detail == 0x0008 && s_run.ack_len == 0,
+              "GET_RELAY_STATS at MTU %u: status %u detail 0x%04X", s_run.mtu, s_run.status,
+              s_run.detail);
+        return;
+    }
+    CHECK(s_run.status == CMD_STATUS_OK, "GET_RELAY_STATS at MTU %u: status %u", s_run.mtu,
+          s_run.status);
+
+    size_t frame = WIRE_HEADER_SIZE + sizeof(wire_cmd_ack_t) + s_run.ack_len + WIRE_CRC_SIZE;
+    CHECK(frame + 3 <= s_run.mtu, "GET_RELAY_STATS ACK %zu bytes at MTU %u", frame, s_run.mtu);
+
+    wire_ack_relay_stats_t hdr;
+    CHECK(s_run.ack_len >= sizeof(hdr), "GET_RELAY_STATS ACK %zu bytes", s_run.ack_len);
+    memcpy(&hdr, s_run.ack_data, sizeof(hdr));
+    CHECK(s_run.ack_len == sizeof(hdr) + hdr.channel_count * sizeof(wire_relay_channel_stats_t),
+          "GET_RELAY_STATS %u channels in %zu bytes", hdr.channel_count, s_run.ack_len);
+
+    /* Contiguous from first_channel, and a short page only at the last channel */
+    const uint8_t *req = &c->rd.data[sizeof(wire_cmd_header_t)];
+    uint8_t first = c->payload_len >= 1 && req[0] > 1 ? req[0] : 1;
+    for (uint8_t i = 0; i < hdr.channel_count; i++) {
+        wire_relay_channel_stats_t ch;
+        memcpy(&ch, &s_run.ack_data[sizeof(hdr) + i * sizeof(ch)], sizeof(ch));
+        CHECK(ch.channel == first + i && ch.channel <= RELAY_CTRL_CHANNELS,
+              "GET_RELAY_STATS entry %u is channel %u, first %u", i, ch.channel, first);
+    }
+    size_t fits = (s_run.mtu - 3 - WIRE_HEADER_SIZE - sizeof(wire_cmd_ack_t) - WIRE_CRC_SIZE -
+                   sizeof(hdr)) / sizeof(wire_relay_channel_stats_t);
+    size_t left = first <= RELAY_CTRL_CHANNELS ? RELAY_CTRL_CHANNELS - first + 1 : 0;
+    CHECK(hdr.channel_count == (left < fits ? left : fits),
+          "GET_RELAY_STATS %u channels from %u at MTU %u", hdr.channel_count, first, s_run.mtu);
+}
+
+static void check_dispatch(const ble_cmd_t *c, bool observer)
+{
+    const wire_cmd_desc_t *desc = wire_cmd_lookup(c->cmd_id);
+
+    CHECK(s_run.acks + s_run.posts == 1, "cmd 0x%04X answered %d times",
+          c->cmd_id, s_run.acks + s_run.posts);
+    CHECK(s_run.sessions_opened == 0 || c->cmd_id == CMD_OPEN_SESSION, "cmd 0x%04X", c->cmd_id);
+
+    if (desc == NULL || c->payload_len < desc->min_len) {
+        CHECK(s_run.acks == 1 && s_run.status == CMD_STATUS_INVALID_ARGS, "cmd 0x%04X", c->cmd_id);
+        return;
+    }
+    if (observer_rejected(desc, observer)) {
+        CHECK(s_run.acks == 1 && s_run.status == CMD_STATUS_REJECTED_POLICY &&
+              s_run.detail == 0x0006, "%s from an observer: status %u", desc->name, s_run.status);
+    }
+    if (c->cmd_id == CMD_GET_TRACE_STATS && s_run.ack_len > sizeof(wire_ack_trace_stats_t)) {
+        size_t frame = WIRE_HEADER_SIZE + sizeof(wire_cmd_ack_t) + s_run.ack_len + WIRE_CRC_SIZE;
+        CHECK(frame + 3 <= s_run.mtu, "GET_TRACE_STATS ACK %zu bytes at MTU %u", frame, s_run.mtu);
+    }
+    if (c->cmd_id == CMD_GET_RELAY_STATS && !observer_rejected(desc, observer)) {
+        check_relay_stats(c);
+    }
+}
+
+/* ===== Target ===== */
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void fuzz_one(const uint8_t *data, size_t size)
+{
+    memset(&s_run, 0, sizeof(s_run));
+    if (size < 1 || size > INPUT_MAX) {
+        return;
+    }
+
+    uint8_t sel = data[0];
+    size_t len = size - 1;
+    unsigned client = (sel >> SEL_CLIENT_SHIFT) & 3;
+
+    g_stub_err = s_stub_errs[sel & SEL_ERR_MASK];
+    g_stub_role = client == 1 ? SESSION_ROLE_CONTROLLER :
+                  client == 2 ? SESSION_ROLE_OBSERVER : SESSION_ROLE_NONE;
+    g_stub_controller_held = client != 0;
+    s_run.mtu = (sel & SEL_MTU_MIN) ? 23 + 16 * (sel & SEL_ERR_MASK) : 247;
+
+    /* Exact-size heap copy, so reads past the frame trip ASan */
+    uint8_t *frame = malloc(len ? len : 1);
+    memcpy(frame, &data[1], len);
+    if ((sel & SEL_FIX_LEN) && len >= WIRE_HEADER_SIZE + WIRE_CRC_SIZE) {
+        put_u16(&frame[4], (uint16_t)(len - WIRE_HEADER_SIZE - WIRE_CRC_SIZE));
+    }
+    if ((sel & SEL_FIX_CRC) && len >= WIRE_HEADER_SIZE + WIRE_CRC_SIZE) {
+        size_t crc_offset = WIRE_HEADER_SIZE + (frame[4] | ((size_t)frame[5] << 8));
+        if (crc_offset + WIRE_CRC_SIZE <= len) {
+            put_u16(&frame[crc_offset], wire_crc16(frame, crc_offset));
+        }
+    }
+
+    wire_frame_header_t header;
+    const uint8_t *payload = NULL;
+    s_run.stage = STAGE_BAD_FRAME;
+    if (!wire_parse_frame(frame, len, &header, &payload)) {
+        free(frame);
+        return;
+    }
+    CHECK(WIRE_HEADER_SIZE + (size_t)header.payload_len + WIRE_CRC_SIZE <= len &&
+          header.payload_len <= WIRE_MAX_PAYLOAD, "payload_len %u in %zu bytes",
+          header.payload_len, len);
+    CHECK(payload == (header.payload_len > 0 ? &frame[WIRE_HEADER_SIZE] : NULL),
+          "payload pointer");
+
+    s_run.stage = STAGE_NOT_COMMAND;
+    if (header.payload_len >= sizeof(wire_cmd_header_t)) {
+        check_lookup(payload[0] | ((uint16_t)payload[1] << 8));
+        check_decoders(&payload[sizeof(wire_cmd_header_t)],
+                       header.payload_len - sizeof(wire_cmd_header_t));
+    }
+
+    ble_cmd_t cmd;
+    if (ble_cmd_parse(frame, len, &cmd)) {
+        cmd.conn_handle = 1;
+        cmd.conn_gen = 7;
+        cmd.session_id = (client == 1 || client == 2) ? 0x5E551001u : 0;
+        cmd.events_indicate = (sel & 1) != 0;
+        s_run.cmd = &cmd;
+        s_run.stage = STAGE_DISPATCHED;
+        ble_cmd_dispatch(&s_env, &cmd);
+        check_dispatch(&cmd, client >= 2);
+    } else {
+        CHECK(header.msg_type != MSG_TYPE_COMMAND ||
+              header.payload_len < sizeof(wire_cmd_header_t), "COMMAND not parsed");
+    }
+    free(frame);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    fuzz_one(data, size);
+    return 0;
+}
+
+#ifndef WIRE_FUZZ_LIBFUZZER
+
+/* ===== Standalone driver ===== */
+
+typedef struct {
+    uint8_t *data;
+    size_t   len;
+} input_t;
+
+static input_t s_corpus[CORPUS_MAX];
+static size_t s_corpus_count;
+static size_t s_seed_count;
+static uint8_t s_sig_seen[SIG_BITS / 8];
+static size_t s_sig_count;
+static uint64_t s_rng;
+
+static uint32_t rnd(void)
+{
+    /* xorshift64* */
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void corpus_add(const uint8_t *data, size_t len)
+{
+    if (s_corpus_count >= CORPUS_MAX) {
+        return;
+    }
+    input_t *in = &s_corpus[s_corpus_count++];
+    in->data = malloc(len);
+    in->len = len;
+    memcpy(in->data, data, len);
+}
+
+/* Outcome signature of the last run; true the first time it is seen */
+static bool note_outcome(void)
+{
+    uint32_t h = 2166136261u;
+    uint32_t parts[] = {
+        s_run.stage, s_run.cmd ? s_run.cmd->cmd_id : 0, s_run.status, s_run.detail,
+        (uint32_t)s_run.posts, (uint32_t)s_run.ack_len,
+    };
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        h = (h ^ parts[i]) * 16777619u;
+    }
+    h %= SIG_BITS;
+    if (s_sig_seen[h / 8] & (1u << (h % 8))) {
+        return false;
+    }
+    s_sig_seen[h / 8] |= (uint8_t)(1u << (h % 8));
+    s_sig_count++;
+    return true;
+}
+
+/* Seeds: every "frame_hex" string in vectors.json */
+static int load_vectors(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    static char text[1 << 18];
+    size_t n = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[n] = '\0';
+
+    const char *key = "\"frame_hex\"";
+    for (const char *p = strstr(text, key); p != NULL; p = strstr(p, key)) {
+        p = strchr(p + strlen(key), '"');
+        if (p == NULL) {
+            break;
+        }
+        uint8_t buf[INPUT_MAX];
+        size_t len = 0;
+        buf[len++] = 0;                 /* Selector: stubs succeed, no session */
+        for (p++; *p != '"' && *p != '\0' && len < sizeof(buf);) {
+            unsigned byte;
+            int used;
+            if (sscanf(p, " %2x%n", &byte, &used) != 1) {
+                break;
+            }
+            buf[len++] = (uint8_t)byte;
+            p += used;
+        }
+        corpus_add(buf, len);
+    }
+    s_seed_count = s_corpus_count;
+    return s_seed_count > 0 ? 0 : -1;
+}
+
+static size_t mutate(uint8_t *buf, size_t len)
+{
+    static const uint8_t bytes[] = { 0x00, 0x01, 0x02, 0x10, 0x7F, 0x80, 0xFF };
+    static const uint16_t words[] = { 0, 1, 2, 4, 8, 0x100, 0x1FF, 0x200, 0x201, 0x7FFF, 0xFFFF };
+    static const uint16_t cmd_ids[] = {
+#define X(name, id, lower, min_len, max_len, flags) id,
+        WIRE_CMD_TABLE(X)
+#undef X
+        CMD_GET_TRACE_STATS + 0x100,    /* Unknown */
+    };
+
+    for (int ops = 1 + rnd() % 4; ops > 0; ops--) {
+        size_t pos = len > 1 ? 1 + rnd() % (len - 1) : 1;
+        switch (rnd() % 10) {
+        case 0:
+            if (pos < len) buf[pos] ^= (uint8_t)(1u << (rnd() % 8));
+            break;
+        case 1:
+            if (pos < len) buf[pos] = (uint8_t)rnd();
+            break;
+        case 2:
+            if (pos < len) buf[pos] = bytes[rnd() % sizeof(bytes)];
+            break;
+        case 3:
+            if (pos + 1 < len) put_u16(&buf[pos], words[rnd() % (sizeof(words) / sizeof(words[0]))]);
+            break;
+        case 4: {
+            size_t k = 1 + rnd() % 8;
+            if (len + k <= INPUT_MAX && pos <= len) {
+                memmove(&buf[pos + k], &buf[pos], len - pos);
+                for (size_t i = 0; i < k; i++) {
+                    buf[pos + i] = (uint8_t)rnd();
+                }
+                len += k;
+            }
+            break;
+        }
+        case 5: {
+            size_t k = 1 + rnd() % 8;
+            if (pos + k <= len) {
+                memmove(&buf[pos], &buf[pos + k], len - pos - k);
+                len -= k;
+            }
+            break;
+        }
+        case 6:
+            len = pos;
+            break;
+        case 7: {
+            const input_t *other = &s_corpus[rnd() % s_corpus_count];
+            size_t from = other->len > 1 ? 1 + rnd() % (other->len - 1) : 1;
+            size_t k = other->len > from ? other->len - from : 0;
+            if (pos + k > INPUT_MAX) {
+                k = INPUT_MAX - pos;
+            }
+            memcpy(&buf[pos], &other->data[from], k);
+            len = pos + k > len ? pos + k : len;
+            break;
+        }
+        case 8:
+            /* cmd_id sits after the selector and the 6-byte frame header */
+            if (len >= 9) put_u16(&buf[7], cmd_ids[rnd() % (sizeof(cmd_ids) / sizeof(cmd_ids[0]))]);
+            break;
+        default:
+            buf[0] = (uint8_t)rnd();
+            break;
+        }
+    }
+
+    if (rnd() % 8 != 0) {
+        buf[0] |= SEL_FIX_LEN | SEL_FIX_CRC;
+    }
+    return len;
+}
+
+static int dump_corpus(const char *dir)
+{
+    for (size_t i = 0; i < s_seed_count; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/seed_%03zu", dir, i);
+        FILE *f = fopen(path, "wb");
+        if (f == NULL) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return 1;
+        }
+        fwrite(s_corpus[i].data, 1, s_corpus[i].len, f);
+        fclose(f);
+    }
+    printf("%zu seeds written to %s\n", s_seed_count, dir);
+    return 0;
+}
+
+static int run_files(char **paths, int count)
+{
+    for (int i = 0; i < count; i++) {
+        uint8_t buf[INPUT_MAX + 1];
+        FILE *f = fopen(paths[i], "rb");
+        if (f == NULL) {
+            fprintf(stderr, "%s: %s\n", paths[i], strerror(errno));
+            return 1;
+        }
+        size_t n = fread(buf, 1, sizeof(buf), f);
+        fclose(f);
+        fuzz_one(buf, n);
+        printf("%s: stage %d acks %d posts %d status %u detail 0x%04X\n", paths[i],
+               s_run.stage, s_run.acks, s_run.posts, s_run.status, s_run.detail);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *vectors = "components/wire_protocol/schema/vectors.json";
+    const char *dump_dir = NULL;
+    unsigned long iters = 1000000;
+    int first_file = argc;
+    s_rng = 0xF0225EEDULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+            iters = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            s_rng = strtoull(argv[++i], NULL, 0) | 1;
+        } else if (strcmp(argv[i], "--vectors") == 0 && i + 1 < argc) {
+            vectors = argv[++i];
+        } else if (strcmp(argv[i], "--dump-corpus") == 0 && i + 1 < argc) {
+            dump_dir = argv[++i];
+        } else if (argv[i][0] != '-') {
+            first_file = i;
+            break;
+        } else {
+            fprintf(stderr, "usage: %s [--iters N] [--seed S] [--vectors FILE] | "
+                    "--dump-corpus DIR | FILE...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (first_file < argc) {
+        return run_files(&argv[first_file], argc - first_file);
+    }
+    if (load_vectors(vectors) != 0) {
+        fprintf(stderr, "%s: no frame_hex vectors\n", vectors);
+        return 1;
+    }
+    if (dump_dir) {
+        return dump_corpus(dump_dir);
+    }
+
+    /* Every seed under every stub result, client role and MTU */
+    unsigned long execs = 0;
+    size_t dispatched = 0;
+    for (size_t i = 0; i < s_seed_count; i++) {
+        uint8_t buf[INPUT_MAX];
+        memcpy(buf, s_corpus[i].data, s_corpus[i].len);
+        for (unsigned sel = 0; sel < 64; sel++) {
+            buf[0] = (uint8_t)sel;
+            fuzz_one(buf, s_corpus[i].len);
+            note_outcome();
+            execs++;
+            dispatched += s_run.stage == STAGE_DISPATCHED;
+        }
+    }
+    CHECK(dispatched == execs, "a golden vector did not reach the dispatcher");
+
+    double t0 = now_s();
+    for (unsigned long it = 0; it < iters; it++) {
+        uint8_t buf[INPUT_MAX];
+        const input_t *in = &s_corpus[rnd() % s_corpus_count];
+        memcpy(buf, in->data, in->len);
+        size_t len = mutate(buf, in->len);
+
+        fuzz_one(buf, len);
+        execs++;
+        dispatched += s_run.stage == STAGE_DISPATCHED;
+        if (note_outcome()) {
+            corpus_add(buf, len);
+        }
+    }
+    double dt = now_s() - t0;
+
+    printf("%lu execs (%zu seeds x 64 selectors + %lu mutations), %.0f exec/s\n",
+           execs, s_seed_count, iters, dt > 0 ? iters / dt : 0.0);
+    printf("%zu reached the dispatcher, %zu distinct outcomes, corpus %zu\n",
+           dispatched, s_sig_count, s_corpus_count);
+    return 0;
+}
+
+#endif /* WIRE_FUZZ_LIBFUZZER */
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "session_mgr.h"
+
+/* Stub behaviour for the current input (stubs.c) */
+extern esp_err_t g_stub_err;            /* Returned by every stub that can fail */
+extern session_role_t g_stub_role;      /* session_mgr_get_role() */
+extern bool g_stub_controller_held;     /* session_mgr_has_controller() */
@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Build the wire_stream host harness and check chunked decoding against a whole-stream parse.
+# Extra arguments are passed through, e.g. run.sh --trials 10000 --seed 7, or run.sh --bench 64
+set -euo pipefail
+cd "$(dirname "$0")/../.."
+out="${TMPDIR:-/tmp}/stream_bench"
+cc -O2 -std=gnu11 -Wall -Wextra -Wno-unused-parameter \
+    -Itools/machine_state_sim/host -Icomponents/wire_protocol/include \
+    -Icomponents/crc16/include \
+    tools/wire_stream_bench/stream_bench.c components/wire_protocol/wire_stream.c \
+    components/wire_protocol/wire_protocol.c components/crc16/crc16.c \
+    components/crc16/crc16_tables.c -o "$out"
+exec "$out" "$@"
@@ -0,0 +1,430 @@
+/*
+ * Host check and benchmark for the wire_stream decoder.
+ *
+ * Build (from firmware/):
+ *   cc -O2 -std=gnu11 -Itools/machine_state_sim/host -Icomponents/wire_protocol/include \
+ *      -Icomponents/crc16/include \
+ *      tools/wire_stream_bench/stream_bench.c components/wire_protocol/wire_stream.c \
+ *      components/wire_protocol/wire_protocol.c components/crc16/crc16.c \
+ *      components/crc16/crc16_tables.c -o /tmp/stream_bench
+ * or just run tools/wire_stream_bench/run.sh.
+ *
+ * Usage:
+ *   stream_bench [--trials N] [--seed S]   random streams, chunked vs whole vs reference
+ *   stream_bench --bench MB [--seed S]     decoder throughput per chunk size, in MB/s
+ *
+ * Each trial builds a stream of valid frames (payload 0..300 bytes) mixed
+ * with noise (biased towards proto_ver bytes), truncated frame prefixes and
+ * frames with one corrupted byte. The stream is decoded three ways:
+ *
+ *   reference  greedy scan of the whole buffer: at each offset accept a
+ *              candidate with a good length and CRC and skip it, otherwise
+ *              advance one byte
+ *   whole      one wire_stream_feed() call
+ *   chunked    random chunk sizes (1..8, 1..64, 1..4096 or mixed per trial)
+ *
+ * All three must deliver the same frames (type, seq, payload) in the same
+ * order, the same CRC / length reject counts and the same pending tail.
+ * Every other trial ends in an idle line (a frame's worth of zeros) so no
+ * candidate is left open; those trials also report how many of the intact
+ * frames were recovered. Anything short of all of them means a noise
+ * candidate passed the CRC check and swallowed a real frame.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wire_protocol.h"
+#include "wire_stream.h"
+
+#define STREAM_MAX          (1u << 20)
+#define FRAMES_MAX          8192
+#define PAYLOAD_GEN_MAX     300
+
+/* ===== Helpers ===== */
+
+static uint64_t s_rng;
+
+static uint32_t rnd(void)
+{
+    /* xorshift64* */
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t rnd_range(uint32_t lo, uint32_t hi)
+{
+    return lo + rnd() % (hi - lo + 1);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t fnv1a(const uint8_t *p, size_t n)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static uint16_t rd_u16(const uint8_t *p)
+{
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+/* ===== Frame records ===== */
+
+typedef struct {
+    uint8_t  msg_type;
+    uint16_t seq;
+    uint16_t payload_len;
+    uint32_t hash;
+} frame_rec_t;
+
+typedef struct {
+    frame_rec_t recs[FRAMES_MAX];
+    size_t count;
+    uint32_t crc_errors;
+    uint32_t len_errors;
+    size_t pending;
+} frame_log_t;
+
+static void log_frame(frame_log_t *log, const wire_frame_header_t *h, const uint8_t *payload)
+{
+    if (log->count >= FRAMES_MAX) {
+        return;
+    }
+    frame_rec_t *r = &log->recs[log->count++];
+    r->msg_type = h->msg_type;
+    r->seq = h->seq;
+    r->payload_len = h->payload_len;
+    r->hash = payload ? fnv1a(payload, h->payload_len) : 0;
+}
+
+static void on_frame(void *ctx, const wire_frame_header_t *h, const uint8_t *payload)
+{
+    log_frame(ctx, h, payload);
+}
+
+static bool same_rec(const frame_rec_t *a, const frame_rec_t *b)
+{
+    return a->msg_type == b->msg_type && a->seq == b->seq &&
+           a->payload_len == b->payload_len && a->hash == b->hash;
+}
+
+static bool same_frames(const frame_log_t *a, const frame_log_t *b)
+{
+    if (a->count != b->count) {
+        return false;
+    }
+    for (size_t i = 0; i < a->count; i++) {
+        if (!same_rec(&a->recs[i], &b->recs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ===== Reference ===== */
+
+/* Greedy whole-buffer scan; stops at a candidate the buffer ends inside */
+static void reference_scan(const uint8_t *p, size_t n, frame_log_t *log)
+{
+    size_t i = 0;
+
+    while (i < n) {
+        if (p[i] != WIRE_PROTO_VERSION) {
+            i++;
+            continue;
+        }
+        if (n - i < WIRE_HEADER_SIZE) {
+            break;
+        }
+        uint16_t payload_len = rd_u16(&p[i + 4]);
+        size_t len = WIRE_HEADER_SIZE + (size_t)payload_len + WIRE_CRC_SIZE;
+        if (payload_len > WIRE_MAX_PAYLOAD) {
+            log->len_errors++;
+            i++;
+            continue;
+        }
+        if (n - i < len) {
+            break;
+        }
+        size_t crc_offset = WIRE_HEADER_SIZE + payload_len;
+        if (rd_u16(&p[i + crc_offset]) != wire_crc16(&p[i], crc_offset)) {
+            log->crc_errors++;
+            i++;
+            continue;
+        }
+        wire_frame_header_t h = {
+            .proto_ver = p[i],
+            .msg_type = p[i + 1],
+            .seq = rd_u16(&p[i + 2]),
+            .payload_len = payload_len,
+        };
+        log_frame(log, &h, payload_len > 0 ? &p[i + WIRE_HEADER_SIZE] : NULL);
+        i += len;
+    }
+    log->pending = n - i;
+}
+
+/* ===== Stream generation ===== */
+
+static size_t gen_frame(uint8_t *out, size_t cap, uint16_t seq, frame_rec_t *rec)
+{
+    uint8_t payload[PAYLOAD_GEN_MAX];
+    uint16_t payload_len = (uint16_t)(rnd() % 4 == 0 ? rnd_range(0, 8)
+                                                     : rnd_range(0, PAYLOAD_GEN_MAX));
+    for (uint16_t i = 0; i < payload_len; i++) {
+        payload[i] = (uint8_t)rnd();
+    }
+    uint8_t msg_type = (uint8_t)rnd();
+
+    size_t n = wire_build_frame(out, cap, msg_type, seq, payload, payload_len);
+    if (n > 0 && rec) {
+        rec->msg_type = msg_type;
+        rec->seq = seq;
+        rec->payload_len = payload_len;
+        rec->hash = payload_len > 0 ? fnv1a(payload, payload_len) : 0;
+    }
+    return n;
+}
+
+/*
+ * Fill p with `frames` events. noise_pct / damage_pct set how often an
+ * event is noise or a truncated / corrupted frame instead of an intact one.
+ * Intact frames are recorded in sent (may be NULL).
+ */
+static size_t gen_stream(uint8_t *p, size_t cap, size_t frames, unsigned noise_pct,
+                         unsigned damage_pct, frame_log_t *sent)
+{
+    size_t n = 0;
+    uint16_t seq = (uint16_t)rnd();
+
+    for (size_t k = 0; k < frames && cap - n >= WIRE_MAX_FRAME_SIZE + 64; k++) {
+        uint32_t roll = rnd() % 100;
+
+        if (roll < noise_pct) {
+            size_t len = rnd_range(1, 40);
+            for (size_t i = 0; i < len; i++) {
+                p[n++] = rnd() % 4 == 0 ? WIRE_PROTO_VERSION : (uint8_t)rnd();
+            }
+        } else if (roll < noise_pct + damage_pct) {
+            size_t len = gen_frame(&p[n], cap - n, seq++, NULL);
+            if (rnd() % 2) {
+                n += rnd_range(1, (uint32_t)len - 1);          /* Truncated */
+            } else {
+                p[n + rnd_range(1, (uint32_t)len - 1)] ^= (uint8_t)rnd_range(1, 255);
+                n += len;                                      /* Corrupted */
+            }
+        } else {
+            frame_rec_t rec;
+            size_t len = gen_frame(&p[n], cap - n, seq++, &rec);
+            if (sent && sent->count < FRAMES_MAX) {
+                sent->recs[sent->count++] = rec;
+            }
+            n += len;
+        }
+    }
+    return n;
+}
+
+/* ===== Decoder runs ===== */
+
+typedef enum {
+    CHUNK_TINY,
+    CHUNK_SMALL,
+    CHUNK_LARGE,
+    CHUNK_MIXED,
+    CHUNK_MODES,
+} chunk_mode_t;
+
+static const char *const s_chunk_names[CHUNK_MODES] = { "1..8", "1..64", "1..4096", "mixed" };
+
+static size_t next_chunk(chunk_mode_t mode)
+{
+    switch (mode) {
+    case CHUNK_TINY:  return rnd_range(1, 8);
+    case CHUNK_SMALL: return rnd_range(1, 64);
+    case CHUNK_LARGE: return rnd_range(1, 4096);
+    default:          return next_chunk((chunk_mode_t)(rnd() % CHUNK_MIXED));
+    }
+}
+
+static void decode(const uint8_t *p, size_t n, int mode, frame_log_t *log)
+{
+    static uint8_t buf[WIRE_STREAM_BUF_MIN];
+    wire_stream_t s;
+
+    wire_stream_init(&s, buf, sizeof(buf), on_frame, log);
+    for (size_t off = 0; off < n;) {
+        size_t len = mode < 0 ? n : next_chunk((chunk_mode_t)mode);
+        if (len > n - off) {
+            len = n - off;
+        }
+        wire_stream_feed(&s, &p[off], len);
+        off += len;
+    }
+    log->crc_errors = s.stats.crc_errors;
+    log->len_errors = s.stats.len_errors;
+    log->pending = wire_stream_pending(&s);
+}
+
+/* Count sent frames that appear, in order, in got (extra frames in got are skipped) */
+static size_t recovered(const frame_log_t *sent, const frame_log_t *got)
+{
+    size_t found = 0, j = 0;
+    for (size_t i = 0; i < sent->count; i++) {
+        for (size_t k = j; k < got->count; k++) {
+            if (same_rec(&got->recs[k], &sent->recs[i])) {
+                found++;
+                j = k + 1;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+static bool same_run(const frame_log_t *a, const frame_log_t *b)
+{
+    return same_frames(a, b) && a->crc_errors == b->crc_errors &&
+           a->len_errors == b->len_errors && a->pending == b->pending;
+}
+
+static void print_run(const char *name, const frame_log_t *log)
+{
+    fprintf(stderr, "  %-10s frames %zu crc %" PRIu32 " len %" PRIu32 " pending %zu\n",
+            name, log->count, log->crc_errors, log->len_errors, log->pending);
+}
+
+/* ===== Modes ===== */
+
+static int run_check(unsigned trials)
+{
+    static uint8_t stream[STREAM_MAX];
+    static frame_log_t sent, ref, whole, chunked;
+    size_t total_bytes = 0, total_sent = 0, total_recovered = 0;
+    unsigned failed = 0;
+
+    for (unsigned t = 0; t < trials; t++) {
+        memset(&sent, 0, sizeof(sent));
+        memset(&ref, 0, sizeof(ref));
+        memset(&whole, 0, sizeof(whole));
+        memset(&chunked, 0, sizeof(chunked));
+
+        size_t n = gen_stream(stream, sizeof(stream), rnd_range(1, 400),
+                              rnd_range(0, 30), rnd_range(0, 20), &sent);
+        chunk_mode_t mode = (chunk_mode_t)(t % CHUNK_MODES);
+        bool flushed = t % 2 == 0;
+        if (flushed) {
+            /* Idle line: resolves any candidate still open at the end */
+            memset(&stream[n], 0, WIRE_MAX_FRAME_SIZE);
+            n += WIRE_MAX_FRAME_SIZE;
+        }
+
+        reference_scan(stream, n, &ref);
+        decode(stream, n, -1, &whole);
+        decode(stream, n, mode, &chunked);
+
+        total_bytes += n;
+        if (flushed) {
+            total_sent += sent.count;
+            total_recovered += recovered(&sent, &ref);
+        }
+
+        if (!same_run(&ref, &whole) || !same_run(&ref, &chunked)) {
+            fprintf(stderr, "FAIL trial %u (%zu bytes, chunks %s)\n", t, n,
+                    s_chunk_names[mode]);
+            print_run("reference", &ref);
+            print_run("whole", &whole);
+            print_run("chunked", &chunked);
+            failed++;
+        }
+    }
+
+    printf("%u/%u trials match, %zu bytes, intact frames recovered (flushed trials) %zu/%zu\n",
+           trials - failed, trials, total_bytes, total_recovered, total_sent);
+    return failed ? 1 : 0;
+}
+
+static int run_bench(unsigned mb)
+{
+    static uint8_t stream[STREAM_MAX];
+    static frame_log_t log;
+    static const size_t chunks[] = { 1, 20, 244, 4096, 0 };
+
+    /* Mostly clean traffic: 2% noise, 1% damaged frames */
+    size_t n = gen_stream(stream, sizeof(stream), FRAMES_MAX, 2, 1, NULL);
+    unsigned reps = (unsigned)(((size_t)mb << 20) / n) + 1;
+    static uint8_t buf[WIRE_STREAM_BUF_MIN];
+
+    printf("stream %zu bytes x %u\n", n, reps);
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        size_t chunk = chunks[c] ? chunks[c] : n;
+        wire_stream_t s;
+        size_t frames = 0;
+
+        double t0 = now_s();
+        for (unsigned r = 0; r < reps; r++) {
+            log.count = 0;
+            wire_stream_init(&s, buf, sizeof(buf), on_frame, &log);
+            for (size_t off = 0; off < n; off += chunk) {
+                frames += wire_stream_feed(&s, &stream[off], chunk < n - off ? chunk : n - off);
+            }
+        }
+        double dt = now_s() - t0;
+
+        char label[16];
+        if (chunks[c]) {
+            snprintf(label, sizeof(label), "%zu", chunk);
+        } else {
+            snprintf(label, sizeof(label), "whole");
+        }
+        printf("chunk %-6s %8.1f MB/s  %7.2f Mframes/s  copied %" PRIu32 "/%" PRIu32 "\n",
+               label, (double)n * reps / dt / 1e6, frames / dt / 1e6,
+               s.stats.frames_copied, s.stats.frames);
+    }
+
+    double t0 = now_s();
+    for (unsigned r = 0; r < reps; r++) {
+        memset(&log, 0, sizeof(log));
+        reference_scan(stream, n, &log);
+    }
+    double dt = now_s() - t0;
+    printf("reference    %8.1f MB/s\n", (double)n * reps / dt / 1e6);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned trials = 2000, bench_mb = 0;
+    s_rng = 0x5EED5EEDULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            trials = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            s_rng = strtoull(argv[++i], NULL, 0) | 1;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_mb = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--trials N] [--seed S] | --bench MB [--seed S]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    return bench_mb ? run_bench(bench_mb) : run_check(trials);
+}